@@ -0,0 +1,181 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "datalayerread.h"
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace ProblemSolver
+{
+
+/**
+ * Asynchronous reads of a data layer. Every read returns at once with a Read that is waited for later,
+ * and the reads are run by a pool of threads, so independent reads wait for the database at the same time.
+ * The read data layer must allow reads from many threads at once. The MongoDbDataLayer takes a connection from
+ * the pool of the driver for every read, so each read in flight has its own query.
+ * With no threads every read runs in the calling thread before it returns, the same as a plain read, and its errors
+ * are thrown right away.
+ * The result maps must not be touched until their read is done.
+ */
+class AsyncDataLayerRead
+{
+public:
+    
+    static const unsigned DEFAULT_THREAD_COUNT = 4;
+    
+public:
+    
+    explicit AsyncDataLayerRead(IDataLayerRead& dataLayer, unsigned threadCount = DEFAULT_THREAD_COUNT);
+    
+    /**
+     * Waits for the reads that were started, then stops the threads
+     */
+    ~AsyncDataLayerRead();
+    
+private:
+    
+    struct ReadState;
+    
+public:
+    
+    /**
+     * The future result of a read, copies refer to the same read.
+     * A default constructed Read is already done.
+     */
+    class Read
+    {
+    public:
+        
+        Read(){}
+        
+        bool isDone() const;
+        
+        /**
+         * Waits until the read is done and throws a DataLayerException if it failed
+         */
+        void wait() const;
+        
+    private:
+        
+        friend class AsyncDataLayerRead;
+        
+        explicit Read(const boost::shared_ptr<ReadState>& state):
+            _state(state){}
+        
+        /**
+         * Waits until the read is done, its error is not thrown. A fiber is suspended only if maySuspend is set,
+         * otherwise it blocks its thread.
+         */
+        void waitDone(bool maySuspend) const;
+        
+        boost::shared_ptr<ReadState> _state;
+    };
+    
+    /**
+     * Reads started together, all of them are waited for when the group is destroyed.
+     * Used to keep the result maps alive while a read can still write to them, e.g. when one of the reads failed.
+     */
+    class ReadGroup
+    {
+    public:
+        
+        ReadGroup(){}
+        
+        /**
+         * Waits for all reads, their errors are ignored. It can run while an exception unwinds the stack,
+         * so a fiber blocks its thread here instead of being suspended. Call wait or drain first to let it suspend.
+         */
+        ~ReadGroup();
+        
+    public:
+        
+        Read add(const Read& read);
+        
+        /**
+         * Waits for all reads, then throws the error of the first one that failed
+         */
+        void wait();
+        
+        /**
+         * Waits for all reads, their errors are ignored
+         */
+        void drain();
+        
+    private:
+        
+        std::vector<Read> _reads;
+    };
+    
+public:
+    
+    unsigned getThreadCount() const { return _threads.size(); }
+    
+    /**
+     * The same as the functions of IDataLayerRead, the IDs are copied
+     */
+    template<class T>
+    Read get(const std::vector<Identifier>& ids, boost::unordered_map<Identifier, T>& result, std::vector<Identifier>* notFound = NULL)
+    {
+        void (IDataLayerRead::*read)(const std::vector<Identifier>&, boost::unordered_map<Identifier, T>&, std::vector<Identifier>*) =
+            &IDataLayerRead::get;
+        
+        return start(boost::bind(read, &_dataLayer, ids, boost::ref(result), notFound));
+    }
+    
+    Read getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found = NULL);
+    Read getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found = NULL);
+    
+    Read getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found = NULL);
+    Read getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found = NULL);
+    
+private:
+    
+    /**
+     * Without threads the read runs right away and its errors are thrown by start
+     */
+    template<class Function>
+    Read start(const Function& read)
+    {
+        if(_threads.empty())
+        {
+            read();
+            return Read();
+        }
+        
+        return queue(read);
+    }
+    
+    Read queue(const boost::function<void ()>& read);
+    
+    static void run(ReadState& state);
+    
+    void readLoop();
+    
+private:
+    
+    IDataLayerRead& _dataLayer;
+    
+    std::deque<boost::shared_ptr<ReadState> > _queue;
+    bool _stopped;
+    
+    boost::mutex _mutex;
+    boost::condition_variable _queueChanged;
+    
+    std::vector<boost::shared_ptr<boost::thread> > _threads;
+};
+
+} // namespace ProblemSolver
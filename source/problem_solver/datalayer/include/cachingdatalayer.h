@@ -8,6 +8,7 @@
 #pragma once
 
 #include "datalayer.h"
+#include "changefeed.h"
 
 #include <auto_ptr.h>
 
@@ -18,22 +19,88 @@ namespace ProblemSolver
  * A Data layer designed to cache data from a source DataLayer into a cache DataLayer.
  * When accessing, it is first searched in the cache, and if missing, it is looked up in the source
  * and the result is saved into the cache for later use.
- * When modifying, it is saved both into the cache and into the source.
+ * When modifying, it is saved first into the source and then into the cache.
+ * The cache must add missing objects on modify (like the MemoryDataLayer does).
+ * Investigations are not cached, they are always read from and written to the source.
  * The caching datalayer takes ownership of the pointers to source and cache.
  */
 class CachingDataLayer: public IDataLayer
 {
 public:
     
-    CachingDataLayer(IDataLayer* source, IDataLayer* cache);
+    static const unsigned DEFAULT_PRELOAD_BATCH_SIZE = 10000; // how many objects each preload cursor reads at once
+    
+public:
+    
+    /**
+     * Set cacheComplete if the cache already holds all knowledge objects (e.g. loaded from a snapshot),
+     * then it is used the same way as after a preload.
+     */
+    CachingDataLayer(IDataLayer* source, IDataLayer* cache, bool cacheComplete = false);
     virtual ~CachingDataLayer(){}
-
+    
+public:
+    
+    /**
+     * Exception thrown from caching data layer specific operations
+     */
+    class Exception: public DataLayerException
+    {
+    public:
+        explicit Exception(const std::string& errorMessage):
+            DataLayerException(errorMessage){}
+    };
+    
+    /**
+     * Statistics of a completed preload
+     */
+    struct PreloadReport
+    {
+        PreloadReport():
+            categories(0), problems(0), symptoms(0), solutions(0), symptomLinks(0), solutionLinks(0),
+            seconds(0), memoryBytes(0){}
+        
+        unsigned categories;
+        unsigned problems;
+        unsigned symptoms;
+        unsigned solutions;
+        unsigned symptomLinks;
+        unsigned solutionLinks;
+        
+        double seconds; // wall time of the whole load
+        long memoryBytes; // growth of the resident memory of the process during the load
+    };
+    
+public:
+    
+    /**
+     * Loads all categories, problems, symptoms, solutions and links from the source into the cache.
+     * Every collection is read by its own thread through its own source cursor.
+     * After a successful preload the cache is considered complete and the source is not read anymore,
+     * except for investigations.
+     * Must be called before the data layer is shared between threads.
+     */
+    PreloadReport preload(unsigned batchSize = DEFAULT_PRELOAD_BATCH_SIZE);
+    
+    bool isPreloaded() const { return _preloaded; }
+    
+    /**
+     * Brings the cache up to date with changes made in the source by other nodes (see IChangeFeed).
+     * Every changed object is read again from the source and saved in the cache, or removed from the cache
+     * if the source does not have it anymore (links of removed objects are removed with them).
+     * The operation of the change is not trusted, so the result does not depend on the order of the changes.
+     * Changes of investigations are ignored as they are not cached. Returns the number of objects refreshed.
+     */
+    unsigned applyChanges(const std::vector<DataChange>& changes);
+    
 public:
     
     virtual void get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound = NULL);
     virtual void get(const std::vector<Identifier>& problemIDs, ProblemMap& result, std::vector<Identifier>* notFound = NULL);
     virtual void get(const std::vector<Identifier>& symptomIDs, SymptomMap& result, std::vector<Identifier>* notFound = NULL);
     virtual void get(const std::vector<Identifier>& solutionIDs, SolutionMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomLinkIDs, SymptomLinkMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionLinkIDs, SolutionLinkMap& result, std::vector<Identifier>* notFound = NULL);
     virtual void get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound = NULL);
     
     virtual void get(const std::vector<Identifier>& problemIDs, ExtendedProblemMap& result, std::vector<Identifier>* notFound = NULL);
@@ -46,51 +113,96 @@ public:
     virtual void getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found = NULL);
     virtual void getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found = NULL);
     
+    virtual void openCursor(CategoryCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(InvestigationCursor& cursor, unsigned batchSize);
+    
+    virtual void openCursor(ExtendedProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize);
+    
 public:
-
+    
     virtual Identifier add(const Category& category);
     virtual Identifier add(const ExtendedProblem& problem);
     virtual Identifier add(const ExtendedSymptom& symptom);
     virtual Identifier add(const ExtendedSolution& solution);
     virtual Identifier add(const SymptomLink& symptomLink);
     virtual Identifier add(const SolutionLink& solutionLink);
-    virtual Identifier add(const Investigation& solutionLink);
-
+    virtual Identifier add(const Investigation& investigation);
+    
     virtual void modify(const Category& category);
     virtual void modify(const ExtendedProblem& problem);
     virtual void modify(const ExtendedSymptom& symptom);
     virtual void modify(const ExtendedSolution& solution);
     virtual void modify(const SymptomLink& symptomLink);
     virtual void modify(const SolutionLink& solutionLink);
-    virtual void modify(const Investigation& solutionLink);
-
+    virtual void modify(const Investigation& investigation);
+    
+    virtual void add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs);
+    
+    virtual void modify(const std::vector<Category>& categories);
+    virtual void modify(const std::vector<ExtendedProblem>& problems);
+    virtual void modify(const std::vector<ExtendedSymptom>& symptoms);
+    virtual void modify(const std::vector<ExtendedSolution>& solutions);
+    virtual void modify(const std::vector<SymptomLink>& symptomLinks);
+    virtual void modify(const std::vector<SolutionLink>& solutionLinks);
+    
     virtual void remove(const Category& category);
     virtual void remove(const Problem& problem);
     virtual void remove(const Symptom& symptom);
     virtual void remove(const Solution& solution);
     virtual void remove(const SymptomLink& symptomLink);
     virtual void remove(const SolutionLink& solutionLink);
-    virtual void remove(const Investigation& solutionLink);
+    virtual void remove(const Investigation& investigation);
     
 private:
     
-    template<class T>
+    IDataLayer* getLinksSource();
+    
+    template<class T, class Y>
     void templateGet(const std::vector<Identifier>& ids, boost::unordered_map<Identifier, T>& result, std::vector<Identifier>* notFound);
     
+    template<class T>
+    void templateOpenCursor(std::auto_ptr<IDataLayerCursor<T> >& cursor, unsigned batchSize);
+    
     template<class T>
     Identifier templateAdd(const T& object);
     
     template<class T>
     void templateModify(const T& object);
     
+    template<class T>
+    void templateAdd(const std::vector<T>& objects, std::vector<Identifier>& newIDs);
+    
+    template<class T>
+    void templateModify(const std::vector<T>& objects);
+    
     template<class T>
     void templateRemove(const T& object);
     
+    template<class T, class R>
+    void refreshObjects(const std::vector<Identifier>& ids);
+    
+    template<class T>
+    void preloadCollection(unsigned batchSize, unsigned* loadedCount, std::string* error);
+    
 private:
     
     std::auto_ptr<IDataLayer> _source;
     std::auto_ptr<IDataLayer> _cache;
     
+    bool _preloaded;
+
 };
 
 } // namespace ProblemSolver
@@ -0,0 +1,87 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "datalayer.h"
+
+#include <string>
+#include <vector>
+
+namespace ProblemSolver
+{
+
+enum DataChangeOperation
+{
+    dataChangeUpsert = 1, // object was added or modified
+    dataChangeRemove = 2
+};
+
+enum DataObjectType
+{
+    dataObjectCategory = 1,
+    dataObjectProblem = 2,
+    dataObjectSymptom = 3,
+    dataObjectSolution = 4,
+    dataObjectSymptomLink = 5,
+    dataObjectSolutionLink = 6,
+    dataObjectInvestigation = 7
+};
+
+/**
+ * Notification that an object of the knowledge base was changed.
+ * Only the ID is sent, the receiver reads the current state of the object from the database,
+ * so applying the same change many times or out of order leaves the receiver with the latest state.
+ */
+struct DataChange
+{
+    DataChange():
+        operation(dataChangeUpsert), objectType(dataObjectCategory){}
+    DataChange(DataChangeOperation operation, DataObjectType objectType, CIdentifier id):
+        operation(operation), objectType(objectType), id(id){}
+    
+    DataChangeOperation operation;
+    DataObjectType objectType;
+    Identifier id;
+    
+    static const char* toString(DataChangeOperation operation);
+    static const char* toString(DataObjectType objectType);
+    
+    /**
+     * Return false if the text is not a known name
+     */
+    static bool fromString(const std::string& text, DataChangeOperation& operation);
+    static bool fromString(const std::string& text, DataObjectType& objectType);
+};
+
+/**
+ * Channel through which the nodes sharing a knowledge base tell each other about changed objects.
+ * Changes are seen by all readers of the feed, including the one that published them.
+ */
+class IChangeFeed
+{
+public:
+    
+    virtual ~IChangeFeed(){}
+    
+public:
+    
+    /**
+     * Publishes changes that were already saved in the database. Safe to call from many threads.
+     */
+    virtual void publish(const std::vector<DataChange>& changes) = 0;
+    
+    /**
+     * Appends to changes everything published since the previous read (or since the feed was created).
+     * If nothing is available waits up to about timeout milliseconds. Returns false if nothing was read.
+     * Must be called from a single thread.
+     */
+    virtual bool read(std::vector<DataChange>& changes, unsigned timeout) = 0;
+
+};
+
+} // namespace ProblemSolver
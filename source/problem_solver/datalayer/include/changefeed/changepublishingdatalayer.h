@@ -0,0 +1,99 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "forwardingdatalayer.h"
+#include "changefeed.h"
+
+#include <boost/shared_ptr.hpp>
+
+namespace ProblemSolver
+{
+
+/**
+ * Data layer that publishes every successful change of the knowledge base into a change feed,
+ * so other nodes can update their caches. Investigations are private to the node serving them
+ * and change on every step, so they are not published.
+ * If publishing fails the change is already saved, the error is only reported.
+ */
+class ChangePublishingDataLayer: public ForwardingDataLayer
+{
+public:
+    
+    ChangePublishingDataLayer(IDataLayer* target, boost::shared_ptr<IChangeFeed> changeFeed);
+    virtual ~ChangePublishingDataLayer(){}
+    
+public:
+    
+    // investigations are passed to the target unchanged
+    using ForwardingDataLayer::add;
+    using ForwardingDataLayer::modify;
+    using ForwardingDataLayer::remove;
+    
+    virtual Identifier add(const Category& category);
+    virtual Identifier add(const ExtendedProblem& problem);
+    virtual Identifier add(const ExtendedSymptom& symptom);
+    virtual Identifier add(const ExtendedSolution& solution);
+    virtual Identifier add(const SymptomLink& symptomLink);
+    virtual Identifier add(const SolutionLink& solutionLink);
+    
+    virtual void modify(const Category& category);
+    virtual void modify(const ExtendedProblem& problem);
+    virtual void modify(const ExtendedSymptom& symptom);
+    virtual void modify(const ExtendedSolution& solution);
+    virtual void modify(const SymptomLink& symptomLink);
+    virtual void modify(const SolutionLink& solutionLink);
+    
+    virtual void add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs);
+    
+    virtual void modify(const std::vector<Category>& categories);
+    virtual void modify(const std::vector<ExtendedProblem>& problems);
+    virtual void modify(const std::vector<ExtendedSymptom>& symptoms);
+    virtual void modify(const std::vector<ExtendedSolution>& solutions);
+    virtual void modify(const std::vector<SymptomLink>& symptomLinks);
+    virtual void modify(const std::vector<SolutionLink>& solutionLinks);
+    
+    virtual void remove(const Category& category);
+    virtual void remove(const Problem& problem);
+    virtual void remove(const Symptom& symptom);
+    virtual void remove(const Solution& solution);
+    virtual void remove(const SymptomLink& symptomLink);
+    virtual void remove(const SolutionLink& solutionLink);
+    
+private:
+    
+    template<class T>
+    Identifier templateAdd(const T& object, DataObjectType objectType);
+    
+    template<class T>
+    void templateModify(const T& object, DataObjectType objectType);
+    
+    template<class T>
+    void templateAdd(const std::vector<T>& objects, std::vector<Identifier>& newIDs, DataObjectType objectType);
+    
+    template<class T>
+    void templateModify(const std::vector<T>& objects, DataObjectType objectType);
+    
+    template<class T>
+    void templateRemove(const T& object, DataObjectType objectType);
+    
+    void publish(DataChangeOperation operation, DataObjectType objectType, CIdentifier id);
+    void publish(const std::vector<DataChange>& changes);
+    
+private:
+    
+    boost::shared_ptr<IChangeFeed> _changeFeed;
+
+};
+
+} // namespace ProblemSolver
@@ -0,0 +1,63 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "changefeed.h"
+
+namespace ProblemSolver
+{
+
+/**
+ * Change feed kept in a local text file, one change per line: "<operation> <object type> <id>".
+ * Meant for tests and for processes running on one machine, as any tool can append lines to the file.
+ * Changes are appended with a single write, so many processes can publish into the same file.
+ * A reader starts at the end of the file and does not see what was there before it was created.
+ */
+class FileChangeFeed: public IChangeFeed
+{
+public:
+    
+    explicit FileChangeFeed(const std::string& fileName);
+    virtual ~FileChangeFeed();
+    
+public:
+    
+    /**
+     * Exception thrown when the feed file can not be used
+     */
+    class Exception: public DataLayerException
+    {
+    public:
+        explicit Exception(const std::string& errorMessage):
+            DataLayerException(errorMessage){}
+    };
+    
+public:
+    
+    virtual void publish(const std::vector<DataChange>& changes);
+    virtual bool read(std::vector<DataChange>& changes, unsigned timeout);
+    
+private:
+    
+    FileChangeFeed(const FileChangeFeed&);
+    FileChangeFeed& operator=(const FileChangeFeed&);
+    
+    void parseLine(const std::string& line, std::vector<DataChange>& changes);
+    
+private:
+    
+    std::string _fileName;
+    
+    int _writeFile; // opened for appending, shared by all publishers
+    int _readFile; // used only by the reader
+    
+    std::string _pending; // end of the last read that is not a complete line yet
+
+};
+
+} // namespace ProblemSolver
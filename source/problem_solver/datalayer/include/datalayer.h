@@ -45,6 +45,25 @@ public:
     virtual void modify(const SolutionLink& solutionLink) = 0;
     virtual void modify(const Investigation& investigation) = 0;
     
+    /**
+     * Bulk versions of add and modify for imports of the knowledge base, the objects are written in as few
+     * round trips as the data layer can. The IDs of the new objects are appended to newIDs in the order of the objects.
+     * If a bulk write fails some of the objects can already be written.
+     */
+    virtual void add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs) = 0;
+    virtual void add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs) = 0;
+    virtual void add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs) = 0;
+    virtual void add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs) = 0;
+    virtual void add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs) = 0;
+    virtual void add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs) = 0;
+    
+    virtual void modify(const std::vector<Category>& categories) = 0;
+    virtual void modify(const std::vector<ExtendedProblem>& problems) = 0;
+    virtual void modify(const std::vector<ExtendedSymptom>& symptoms) = 0;
+    virtual void modify(const std::vector<ExtendedSolution>& solutions) = 0;
+    virtual void modify(const std::vector<SymptomLink>& symptomLinks) = 0;
+    virtual void modify(const std::vector<SolutionLink>& solutionLinks) = 0;
+    
     /**
      * Only the ID of the supplied object is used
      */
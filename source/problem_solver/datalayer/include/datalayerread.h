@@ -17,6 +17,7 @@
 #include "baseexception.h"
 
 #include <vector>
+#include <memory>
 #include <boost/unordered_map.hpp>
 
 namespace ProblemSolver
@@ -49,6 +50,40 @@ typedef boost::unordered_map<Identifier, SolutionLink> SolutionsWithSameProblem;
 // all links connected with a certain solution, organized by problem ID
 typedef boost::unordered_map<Identifier, SolutionLink> ProblemsWithSameSolution;
 
+/**
+ * Cursor over all objects of one type.
+ * Used to read whole collections in batches instead of loading everything in memory at once.
+ */
+template<class T>
+class IDataLayerCursor
+{
+public:
+    
+    virtual ~IDataLayerCursor(){}
+    
+public:
+    
+    /**
+     * Clears result and fills it with the next batch of objects.
+     * Returns false when there are no more objects to read.
+     */
+    virtual bool next(boost::unordered_map<Identifier, T>& result) = 0;
+};
+
+typedef std::auto_ptr<IDataLayerCursor<Category> > CategoryCursor;
+typedef std::auto_ptr<IDataLayerCursor<Problem> > ProblemCursor;
+typedef std::auto_ptr<IDataLayerCursor<Symptom> > SymptomCursor;
+typedef std::auto_ptr<IDataLayerCursor<Solution> > SolutionCursor;
+
+typedef std::auto_ptr<IDataLayerCursor<ExtendedProblem> > ExtendedProblemCursor;
+typedef std::auto_ptr<IDataLayerCursor<ExtendedSymptom> > ExtendedSymptomCursor;
+typedef std::auto_ptr<IDataLayerCursor<ExtendedSolution> > ExtendedSolutionCursor;
+
+typedef std::auto_ptr<IDataLayerCursor<SymptomLink> > SymptomLinkCursor;
+typedef std::auto_ptr<IDataLayerCursor<SolutionLink> > SolutionLinkCursor;
+
+typedef std::auto_ptr<IDataLayerCursor<Investigation> > InvestigationCursor;
+
 /**
  * Exception thrown from all DataLayer operations
  */
@@ -102,6 +137,22 @@ public:
     virtual void getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found = NULL) = 0;
     virtual void getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found = NULL) = 0;
     
+    /**
+     * Opens a cursor over ALL objects of the given type that returns them in batches of at most batchSize.
+     * Use these instead of get with no IDs when the result can be too big to be kept in memory.
+     */
+    virtual void openCursor(CategoryCursor& cursor, unsigned batchSize) = 0;
+    virtual void openCursor(ProblemCursor& cursor, unsigned batchSize) = 0;
+    virtual void openCursor(SymptomCursor& cursor, unsigned batchSize) = 0;
+    virtual void openCursor(SolutionCursor& cursor, unsigned batchSize) = 0;
+    virtual void openCursor(SymptomLinkCursor& cursor, unsigned batchSize) = 0;
+    virtual void openCursor(SolutionLinkCursor& cursor, unsigned batchSize) = 0;
+    virtual void openCursor(InvestigationCursor& cursor, unsigned batchSize) = 0;
+    
+    virtual void openCursor(ExtendedProblemCursor& cursor, unsigned batchSize) = 0;
+    virtual void openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize) = 0;
+    virtual void openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize) = 0;
+    
 };
 
 } // namespace ProblemSolver
@@ -0,0 +1,67 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "atomiccounter.h"
+#include "latencyhistogram.h"
+
+namespace ProblemSolver
+{
+
+/**
+ * Process wide counters of all data layers, safe to update from many threads.
+ * Round trips are the requests sent to a database server, their time is also summed per thread
+ * so a request can tell how long it waited for the database.
+ */
+class DataLayerStatistics
+{
+public:
+    
+    static utils::AtomicCounter cacheHits; // objects and links a CachingDataLayer found in its cache
+    static utils::AtomicCounter cacheMisses; // objects and links it had to read from its source
+    
+    static utils::AtomicCounter roundTrips;
+    static utils::ConcurrentLatencyHistogram roundTripLatency; // in nanoseconds
+    
+public:
+    
+    /**
+     * Returns the nanoseconds the calling thread spent in round trips so far
+     */
+    static uint64_t getThreadRoundTripTime() { return _threadRoundTripTime; }
+    
+    /**
+     * Counts time the calling thread waited for round trips made by other threads
+     */
+    static void addThreadRoundTripTime(uint64_t time) { _threadRoundTripTime += time; }
+    
+    /**
+     * Measures one round trip from its construction to its destruction
+     */
+    class RoundTrip
+    {
+    public:
+    
+        RoundTrip();
+        ~RoundTrip();
+    
+    private:
+    
+        uint64_t _start;
+    };
+    
+private:
+    
+    static __thread uint64_t _threadRoundTripTime;
+    
+    // requests running as fibers of one thread each count their own round trip time
+    static void swapFiberLocal(uint64_t& saved);
+    static bool _fiberLocalAdded;
+};
+
+} // namespace ProblemSolver
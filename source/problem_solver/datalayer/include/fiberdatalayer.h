@@ -0,0 +1,179 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "forwardingdatalayer.h"
+#include "fiberscheduler.h"
+
+#include <deque>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace ProblemSolver
+{
+
+/**
+ * Data layer for targets that block their thread, e.g. the database driver, when they are called from fibers.
+ * An operation called from a fiber is run by a pool of I/O threads while the fiber is suspended,
+ * so the thread of the fiber runs the other fibers meanwhile. Cursors are wrapped so reading a batch is also moved.
+ * Operations called outside a fiber are passed to the target right away.
+ * The target must allow calls from many threads at once and must not depend on the thread it is called from.
+ */
+class FiberDataLayer: public ForwardingDataLayer
+{
+public:
+    
+    static const unsigned DEFAULT_THREAD_COUNT = 8;
+    
+public:
+    
+    explicit FiberDataLayer(IDataLayer* target, unsigned threadCount = DEFAULT_THREAD_COUNT);
+    
+    /**
+     * Waits for the operations that were started, then stops the threads
+     */
+    virtual ~FiberDataLayer();
+    
+public:
+    
+    virtual void get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& problemIDs, ProblemMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomIDs, SymptomMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionIDs, SolutionMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomLinkIDs, SymptomLinkMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionLinkIDs, SolutionLinkMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound = NULL);
+    
+    virtual void get(const std::vector<Identifier>& problemIDs, ExtendedProblemMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomIDs, ExtendedSymptomMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionIDs, ExtendedSolutionMap& result, std::vector<Identifier>* notFound = NULL);
+    
+    virtual void getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found = NULL);
+    virtual void getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found = NULL);
+    
+    virtual void getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found = NULL);
+    virtual void getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found = NULL);
+    
+    virtual void openCursor(CategoryCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(InvestigationCursor& cursor, unsigned batchSize);
+    
+    virtual void openCursor(ExtendedProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize);
+    
+public:
+    
+    virtual Identifier add(const Category& category);
+    virtual Identifier add(const ExtendedProblem& problem);
+    virtual Identifier add(const ExtendedSymptom& symptom);
+    virtual Identifier add(const ExtendedSolution& solution);
+    virtual Identifier add(const SymptomLink& symptomLink);
+    virtual Identifier add(const SolutionLink& solutionLink);
+    virtual Identifier add(const Investigation& investigation);
+    
+    virtual void modify(const Category& category);
+    virtual void modify(const ExtendedProblem& problem);
+    virtual void modify(const ExtendedSymptom& symptom);
+    virtual void modify(const ExtendedSolution& solution);
+    virtual void modify(const SymptomLink& symptomLink);
+    virtual void modify(const SolutionLink& solutionLink);
+    virtual void modify(const Investigation& investigation);
+    
+    virtual void add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs);
+    
+    virtual void modify(const std::vector<Category>& categories);
+    virtual void modify(const std::vector<ExtendedProblem>& problems);
+    virtual void modify(const std::vector<ExtendedSymptom>& symptoms);
+    virtual void modify(const std::vector<ExtendedSolution>& solutions);
+    virtual void modify(const std::vector<SymptomLink>& symptomLinks);
+    virtual void modify(const std::vector<SolutionLink>& solutionLinks);
+    
+    virtual void remove(const Category& category);
+    virtual void remove(const Problem& problem);
+    virtual void remove(const Symptom& symptom);
+    virtual void remove(const Solution& solution);
+    virtual void remove(const SymptomLink& symptomLink);
+    virtual void remove(const SolutionLink& solutionLink);
+    virtual void remove(const Investigation& investigation);
+    
+private:
+    
+    struct Call;
+    
+    template<class T>
+    class Cursor;
+    
+private:
+    
+    /**
+     * Outside a fiber or without threads the operation runs right away
+     */
+    template<class Function>
+    void call(const Function& operation)
+    {
+        if(_threads.empty() || !utils::FiberScheduler::isInFiber())
+        {
+            operation();
+            return;
+        }
+        
+        offload(operation);
+    }
+    
+    void offload(const boost::function<void ()>& operation);
+    
+    void ioLoop();
+    
+    template<class T>
+    void templateGet(const std::vector<Identifier>& ids, boost::unordered_map<Identifier, T>& result, std::vector<Identifier>* notFound);
+    
+    template<class T>
+    void templateOpenCursor(std::auto_ptr<IDataLayerCursor<T> >& cursor, unsigned batchSize);
+    
+    template<class T>
+    Identifier templateAdd(const T& object);
+    
+    template<class T>
+    void templateModify(const T& object);
+    
+    template<class T>
+    void templateAdd(const std::vector<T>& objects, std::vector<Identifier>& newIDs);
+    
+    template<class T>
+    void templateModify(const std::vector<T>& objects);
+    
+    template<class T>
+    void templateRemove(const T& object);
+    
+private:
+    
+    std::deque<Call*> _queue; // the calls live on the stacks of their suspended fibers
+    bool _stopped;
+    
+    boost::mutex _mutex;
+    boost::condition_variable _queueChanged;
+    
+    std::vector<boost::shared_ptr<boost::thread> > _threads;
+    
+};
+
+} // namespace ProblemSolver
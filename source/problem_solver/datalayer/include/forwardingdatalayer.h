@@ -0,0 +1,111 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "datalayer.h"
+
+#include <auto_ptr.h>
+
+namespace ProblemSolver
+{
+
+/**
+ * Base of data layers that wrap another data layer and change only some of its operations.
+ * Every operation is passed unchanged to the target, derived classes override what they need.
+ * The forwarding data layer takes ownership of the target.
+ */
+class ForwardingDataLayer: public IDataLayer
+{
+public:
+    
+    explicit ForwardingDataLayer(IDataLayer* target);
+    virtual ~ForwardingDataLayer(){}
+    
+public:
+    
+    IDataLayer& getTarget() { return *_target; }
+    
+public:
+    
+    virtual void get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& problemIDs, ProblemMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomIDs, SymptomMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionIDs, SolutionMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomLinkIDs, SymptomLinkMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionLinkIDs, SolutionLinkMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound = NULL);
+    
+    virtual void get(const std::vector<Identifier>& problemIDs, ExtendedProblemMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomIDs, ExtendedSymptomMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionIDs, ExtendedSolutionMap& result, std::vector<Identifier>* notFound = NULL);
+    
+    virtual void getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found = NULL);
+    virtual void getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found = NULL);
+    
+    virtual void getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found = NULL);
+    virtual void getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found = NULL);
+    
+    virtual void openCursor(CategoryCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(InvestigationCursor& cursor, unsigned batchSize);
+    
+    virtual void openCursor(ExtendedProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize);
+    
+public:
+    
+    virtual Identifier add(const Category& category);
+    virtual Identifier add(const ExtendedProblem& problem);
+    virtual Identifier add(const ExtendedSymptom& symptom);
+    virtual Identifier add(const ExtendedSolution& solution);
+    virtual Identifier add(const SymptomLink& symptomLink);
+    virtual Identifier add(const SolutionLink& solutionLink);
+    virtual Identifier add(const Investigation& investigation);
+    
+    virtual void modify(const Category& category);
+    virtual void modify(const ExtendedProblem& problem);
+    virtual void modify(const ExtendedSymptom& symptom);
+    virtual void modify(const ExtendedSolution& solution);
+    virtual void modify(const SymptomLink& symptomLink);
+    virtual void modify(const SolutionLink& solutionLink);
+    virtual void modify(const Investigation& investigation);
+    
+    virtual void add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs);
+    
+    virtual void modify(const std::vector<Category>& categories);
+    virtual void modify(const std::vector<ExtendedProblem>& problems);
+    virtual void modify(const std::vector<ExtendedSymptom>& symptoms);
+    virtual void modify(const std::vector<ExtendedSolution>& solutions);
+    virtual void modify(const std::vector<SymptomLink>& symptomLinks);
+    virtual void modify(const std::vector<SolutionLink>& solutionLinks);
+    
+    virtual void remove(const Category& category);
+    virtual void remove(const Problem& problem);
+    virtual void remove(const Symptom& symptom);
+    virtual void remove(const Solution& solution);
+    virtual void remove(const SymptomLink& symptomLink);
+    virtual void remove(const SolutionLink& solutionLink);
+    virtual void remove(const Investigation& investigation);
+    
+protected:
+    
+    std::auto_ptr<IDataLayer> _target;
+
+};
+
+} // namespace ProblemSolver
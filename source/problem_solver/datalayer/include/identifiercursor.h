@@ -0,0 +1,66 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "datalayerread.h"
+
+#include <algorithm>
+
+namespace ProblemSolver
+{
+
+/**
+ * Cursor that reads a fixed list of IDs from a data layer in batches.
+ * Useful for data layers that can cheaply list all their IDs but should not copy all objects at once.
+ * Objects removed after the cursor was opened are skipped.
+ */
+template<class T>
+class IdentifierCursor: public IDataLayerCursor<T>
+{
+public:
+    
+    IdentifierCursor(IDataLayerRead& dataLayer, const std::vector<Identifier>& ids, unsigned batchSize):
+        _dataLayer(dataLayer),
+        _ids(ids),
+        _position(0),
+        _batchSize(batchSize > 0 ? batchSize : 1)
+    {
+    }
+    
+    virtual ~IdentifierCursor(){}
+    
+public:
+    
+    virtual bool next(boost::unordered_map<Identifier, T>& result)
+    {
+        result.clear();
+        
+        std::vector<Identifier> batch;
+        std::vector<Identifier> notFound;
+        
+        while(result.empty() && _position < _ids.size())
+        {
+            size_t end = std::min(_position + _batchSize, _ids.size());
+            batch.assign(_ids.begin() + _position, _ids.begin() + end);
+            _position = end;
+            
+            _dataLayer.get(batch, result, &notFound);
+        }
+        
+        return !result.empty();
+    }
+    
+private:
+    
+    IDataLayerRead& _dataLayer;
+    std::vector<Identifier> _ids;
+    size_t _position;
+    size_t _batchSize;
+};
+
+} // namespace ProblemSolver
@@ -9,79 +9,172 @@
 
 #include "datalayer.h"
 
+#include <boost/unordered_set.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
 namespace ProblemSolver
 {
 
+/**
+ * Datalayer that keeps all objects in memory together with indexes of the links by problem, symptom and solution.
+ * It is safe to use from many threads at once.
+ * Unlike other data layers modify will add the object with its own ID if it is missing,
+ * this allows the layer to be used as a cache of another data layer.
+ */
 class MemoryDataLayer: public IDataLayer
 {
 public:
     
-    MemoryDataLayer(){}
+    MemoryDataLayer();
     virtual ~MemoryDataLayer(){}
-
+    
+public:
+    
+    /**
+     * Exception thrown from all operations of the memory data layer
+     */
+    class Exception: public DataLayerException
+    {
+    public:
+        explicit Exception(const std::string& errorMessage):
+            DataLayerException(errorMessage){}
+    };
+    
 public:
     
     virtual void get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound = NULL);
     virtual void get(const std::vector<Identifier>& problemIDs, ProblemMap& result, std::vector<Identifier>* notFound = NULL);
     virtual void get(const std::vector<Identifier>& symptomIDs, SymptomMap& result, std::vector<Identifier>* notFound = NULL);
     virtual void get(const std::vector<Identifier>& solutionIDs, SolutionMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomLinkIDs, SymptomLinkMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionLinkIDs, SolutionLinkMap& result, std::vector<Identifier>* notFound = NULL);
     virtual void get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound = NULL);
-
+    
     virtual void get(const std::vector<Identifier>& problemIDs, ExtendedProblemMap& result, std::vector<Identifier>* notFound = NULL);
     virtual void get(const std::vector<Identifier>& symptomIDs, ExtendedSymptomMap& result, std::vector<Identifier>* notFound = NULL);
     virtual void get(const std::vector<Identifier>& solutionIDs, ExtendedSolutionMap& result, std::vector<Identifier>* notFound = NULL);
-
+    
     virtual void getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found = NULL);
     virtual void getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found = NULL);
     
     virtual void getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found = NULL);
     virtual void getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found = NULL);
     
+    virtual void openCursor(CategoryCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(InvestigationCursor& cursor, unsigned batchSize);
+    
+    virtual void openCursor(ExtendedProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize);
+    
 public:
-
+    
     virtual Identifier add(const Category& category);
     virtual Identifier add(const ExtendedProblem& problem);
     virtual Identifier add(const ExtendedSymptom& symptom);
     virtual Identifier add(const ExtendedSolution& solution);
     virtual Identifier add(const SymptomLink& symptomLink);
     virtual Identifier add(const SolutionLink& solutionLink);
-    virtual Identifier add(const Investigation& solutionLink);
-
+    virtual Identifier add(const Investigation& investigation);
+    
     virtual void modify(const Category& category);
     virtual void modify(const ExtendedProblem& problem);
     virtual void modify(const ExtendedSymptom& symptom);
     virtual void modify(const ExtendedSolution& solution);
     virtual void modify(const SymptomLink& symptomLink);
     virtual void modify(const SolutionLink& solutionLink);
-    virtual void modify(const Investigation& solutionLink);
-
+    virtual void modify(const Investigation& investigation);
+    
+    virtual void add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs);
+    
+    virtual void modify(const std::vector<Category>& categories);
+    virtual void modify(const std::vector<ExtendedProblem>& problems);
+    virtual void modify(const std::vector<ExtendedSymptom>& symptoms);
+    virtual void modify(const std::vector<ExtendedSolution>& solutions);
+    virtual void modify(const std::vector<SymptomLink>& symptomLinks);
+    virtual void modify(const std::vector<SolutionLink>& solutionLinks);
+    
     virtual void remove(const Category& category);
     virtual void remove(const Problem& problem);
     virtual void remove(const Symptom& symptom);
     virtual void remove(const Solution& solution);
     virtual void remove(const SymptomLink& symptomLink);
     virtual void remove(const SolutionLink& solutionLink);
-    virtual void remove(const Investigation& solutionLink);
+    virtual void remove(const Investigation& investigation);
+    
+private:
+    
+    // link ID's organized by the ID of a linked object
+    typedef boost::unordered_map<Identifier, boost::unordered_set<Identifier> > LinkIndex;
     
 private:
     
+    template<class T, class Y>
+    void templateGet(const std::vector<Identifier>& ids, const boost::unordered_map<Identifier, T>& objects,
+                     boost::unordered_map<Identifier, Y>& result, std::vector<Identifier>* notFound, const char* objectName);
+    
+    template<class T>
+    void templateGetLinks(CIdentifier byId, const LinkIndex& index, const boost::unordered_map<Identifier, T>& links,
+                          Identifier T::* organizeField, boost::unordered_map<Identifier, T>& result, bool* found);
+    
+    template<class T, class Y>
+    void templateOpenCursor(const boost::unordered_map<Identifier, T>& objects, std::auto_ptr<IDataLayerCursor<Y> >& cursor, unsigned batchSize);
+    
     template<class T>
-    void templateGet(const std::vector<Identifier>& ids, boost::unordered_map<Identifier, T>& result, std::vector<Identifier>* notFound);
+    Identifier templateAdd(const T& object, boost::unordered_map<Identifier, T>& objects);
     
     template<class T>
-    Identifier templateAdd(const T& object);
+    void templateModify(const T& object, boost::unordered_map<Identifier, T>& objects);
     
     template<class T>
-    void templateModify(const T& object);
+    void templateAdd(const std::vector<T>& newObjects, boost::unordered_map<Identifier, T>& objects, std::vector<Identifier>& newIDs);
     
     template<class T>
-    void templateRemove(const T& object);
+    void templateModify(const std::vector<T>& changedObjects, boost::unordered_map<Identifier, T>& objects);
     
 private:
     
-    std::auto_ptr<IDataLayer> _source;
-    std::auto_ptr<IDataLayer> _cache;
+    Identifier generateIdentifier();
     
+    void storeLink(const SymptomLink& symptomLink);
+    void storeLink(const SolutionLink& solutionLink);
+    
+    void removeSymptomLink(CIdentifier symptomLinkID);
+    void removeSolutionLink(CIdentifier solutionLinkID);
+    
+    static void addToIndex(LinkIndex& index, CIdentifier objectID, CIdentifier linkID);
+    static void removeFromIndex(LinkIndex& index, CIdentifier objectID, CIdentifier linkID);
+    
+private:
+    
+    boost::shared_mutex _mutex;
+    
+    unsigned _identifierSeed;
+    unsigned _identifierCounter;
+    
+    CategoryMap _categories;
+    ExtendedProblemMap _problems;
+    ExtendedSymptomMap _symptoms;
+    ExtendedSolutionMap _solutions;
+    SymptomLinkMap _symptomLinks;
+    SolutionLinkMap _solutionLinks;
+    InvestigationMap _investigations;
+    
+    LinkIndex _symptomLinksByProblem;
+    LinkIndex _symptomLinksBySymptom;
+    LinkIndex _solutionLinksByProblem;
+    LinkIndex _solutionLinksBySolution;
+
 };
 
 } // namespace ProblemSolver
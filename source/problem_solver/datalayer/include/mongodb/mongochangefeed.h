@@ -0,0 +1,84 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "changefeed.h"
+
+#include <auto_ptr.h>
+
+class MongoConnection;
+
+namespace mongo
+{
+class DBClientCursor;
+}
+
+namespace ProblemSolver
+{
+
+/**
+ * Change feed kept in the capped collection "changes" of the knowledge base database.
+ * Publishers insert one document per change, readers follow the collection with a tailable cursor,
+ * which the server keeps open and wakes when new documents arrive, so no collection is scanned repeatedly.
+ * The collection is created on first use, the oldest changes are dropped when it is full.
+ *
+ * A reader starts after the last change that existed when it was created. If its cursor dies
+ * (e.g. the collection wrapped around faster than it was read) it continues after the last change it has seen.
+ * Changes are ordered by insertion, only after a cursor is lost the IDs of the documents are compared,
+ * so a change inserted by a node with a clock running behind at that moment may be missed.
+ */
+class MongoChangeFeed: public IChangeFeed
+{
+public:
+    
+    static const long long DEFAULT_COLLECTION_SIZE = 64 * 1024 * 1024; // bytes
+    
+public:
+    
+    MongoChangeFeed(const std::string& connectionString, const std::string& database, long long collectionSize = DEFAULT_COLLECTION_SIZE);
+    virtual ~MongoChangeFeed();
+    
+public:
+    
+    /**
+     * Exception thrown from all operations of the Mongo change feed
+     */
+    class Exception: public DataLayerException
+    {
+    public:
+        explicit Exception(const std::string& errorMessage):
+            DataLayerException(errorMessage){}
+    };
+    
+public:
+    
+    virtual void publish(const std::vector<DataChange>& changes);
+    virtual bool read(std::vector<DataChange>& changes, unsigned timeout);
+    
+private:
+    
+    MongoChangeFeed(const MongoChangeFeed&);
+    MongoChangeFeed& operator=(const MongoChangeFeed&);
+    
+    void openCursor();
+    void closeCursor();
+    
+private:
+    
+    std::string _connectionString;
+    std::string _collection;
+    
+    std::string _lastId; // of the last change read, empty if the collection was empty
+    
+    // used only by the reader
+    std::auto_ptr<MongoConnection> _readConnection;
+    std::auto_ptr<mongo::DBClientCursor> _cursor;
+
+};
+
+} // namespace ProblemSolver
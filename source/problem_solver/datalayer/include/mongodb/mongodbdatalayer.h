@@ -19,10 +19,19 @@ namespace ProblemSolver
 {
 
 /**
- * Datalayer using MongoDB for storage
+ * Datalayer using MongoDB for storage.
+ * Every operation takes its own connection from the pool of the driver, so operations of many threads
+ * (e.g. the reads of an AsyncDataLayerRead) have their queries in flight at once.
  */
 class MongoDbDataLayer: public IDataLayer
 {
+public:
+    
+    /**
+     * Objects of a bulk add sent in one insert
+     */
+    static const unsigned BULK_WRITE_SIZE = 1000;
+    
 public:
     
     MongoDbDataLayer(const std::string& connectionString, const std::string& database);
@@ -61,6 +70,18 @@ public:
     virtual void getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found = NULL);
     virtual void getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found = NULL);
     
+    virtual void openCursor(CategoryCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(InvestigationCursor& cursor, unsigned batchSize);
+    
+    virtual void openCursor(ExtendedProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize);
+    
 public:
 
     virtual Identifier add(const Category& category);
@@ -79,6 +100,20 @@ public:
     virtual void modify(const SolutionLink& solutionLink);
     virtual void modify(const Investigation& investigation);
 
+    virtual void add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs);
+
+    virtual void modify(const std::vector<Category>& categories);
+    virtual void modify(const std::vector<ExtendedProblem>& problems);
+    virtual void modify(const std::vector<ExtendedSymptom>& symptoms);
+    virtual void modify(const std::vector<ExtendedSolution>& solutions);
+    virtual void modify(const std::vector<SymptomLink>& symptomLinks);
+    virtual void modify(const std::vector<SolutionLink>& solutionLinks);
+
     virtual void remove(const Category& category);
     virtual void remove(const Problem& problem);
     virtual void remove(const Symptom& symptom);
@@ -89,6 +124,9 @@ public:
     
 private:
     
+    template<class T>
+    class Cursor;
+    
     // functions used in GET operations
     
     template<class T>
@@ -120,11 +158,21 @@ private:
     
     void modifyObject(CIdentifier id, const mongo::BSONObj& object, const std::string& collection, bool insert);
     void removeObject(const mongo::BSONObj& query, const std::string& collection);
+    void insertObjects(const std::vector<mongo::BSONObj>& objects, const std::string& collection);
+    
+    template<class T>
+    void templateAdd(const std::vector<T>& objects, std::vector<Identifier>& newIDs, const std::string& collection);
+    
+    template<class T>
+    void templateModify(const std::vector<T>& objects, const std::string& collection);
 
     template<class T>
     void makeExtendedInfo(const T& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier = NULL);
     
     void makeBson(const Category& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier = NULL);
+    void makeBson(const ExtendedProblem& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier = NULL);
+    void makeBson(const ExtendedSymptom& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier = NULL);
+    void makeBson(const ExtendedSolution& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier = NULL);
     void makeBson(const SymptomLink& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier = NULL);
     void makeBson(const SolutionLink& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier = NULL);
     void makeBson(const Investigation& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier = NULL);
@@ -0,0 +1,231 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "forwardingdatalayer.h"
+#include "atomiccounter.h"
+
+namespace ProblemSolver
+{
+
+/**
+ * Data layer operations measured by the ProfilingDataLayer
+ */
+enum ProfiledOperation
+{
+    profiledGetCategories = 0,
+    profiledGetProblems = 1,
+    profiledGetSymptoms = 2,
+    profiledGetSolutions = 3,
+    profiledGetSymptomLinks = 4,
+    profiledGetSolutionLinks = 5,
+    profiledGetInvestigations = 6,
+    profiledGetExtendedProblems = 7,
+    profiledGetExtendedSymptoms = 8,
+    profiledGetExtendedSolutions = 9,
+    profiledGetSymptomLinksByProblem = 10,
+    profiledGetSymptomLinksBySymptom = 11,
+    profiledGetSolutionLinksByProblem = 12,
+    profiledGetSolutionLinksBySolution = 13,
+    profiledOpenCursor = 14,
+    profiledAdd = 15,
+    profiledModify = 16,
+    profiledRemove = 17,
+    profiledOperationCount = 18
+};
+
+/**
+ * Counters of the data layer calls of a ProfilingDataLayer
+ */
+struct DataLayerProfile
+{
+    struct Counters
+    {
+        Counters():
+            calls(0), requestedIDs(0), returnedObjects(0), nanoseconds(0){}
+        
+        uint64_t calls;
+        uint64_t requestedIDs; // IDs passed to gets, one for every link lookup, modify and remove
+        uint64_t returnedObjects; // objects and links, without the objects read through cursors
+        uint64_t nanoseconds; // wall time
+    };
+    
+    Counters operations[profiledOperationCount];
+    
+    Counters getTotal() const;
+    void add(const DataLayerProfile& other);
+    
+    static const char* getOperationName(ProfiledOperation operation);
+};
+
+/**
+ * Data layer that counts the calls, requested IDs, returned objects and wall time of every operation
+ * passed to its target. The counters of the whole process are kept lock free and the calls made by a thread
+ * can also be collected in a Scope, e.g. to see how many data layer calls one suggestion made.
+ */
+class ProfilingDataLayer: public ForwardingDataLayer
+{
+public:
+    
+    explicit ProfilingDataLayer(IDataLayer* target);
+    virtual ~ProfilingDataLayer(){}
+    
+public:
+    
+    /**
+     * Collects all calls the current thread makes to any ProfilingDataLayer while the scope exists.
+     * Scopes can be nested, a nested scope adds its profile to the enclosing one when it ends.
+     */
+    class Scope
+    {
+    public:
+    
+        Scope();
+        ~Scope();
+    
+    public:
+    
+        const DataLayerProfile& getProfile() const { return _profile; }
+    
+    private:
+    
+        DataLayerProfile _profile;
+        DataLayerProfile* _enclosingProfile;
+    };
+    
+public:
+    
+    /**
+     * Returns the counters of all calls made so far
+     */
+    void getTotals(DataLayerProfile& result) const;
+    
+public:
+    
+    virtual void get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& problemIDs, ProblemMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomIDs, SymptomMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionIDs, SolutionMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomLinkIDs, SymptomLinkMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionLinkIDs, SolutionLinkMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound = NULL);
+    
+    virtual void get(const std::vector<Identifier>& problemIDs, ExtendedProblemMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomIDs, ExtendedSymptomMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionIDs, ExtendedSolutionMap& result, std::vector<Identifier>* notFound = NULL);
+    
+    virtual void getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found = NULL);
+    virtual void getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found = NULL);
+    
+    virtual void getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found = NULL);
+    virtual void getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found = NULL);
+    
+    virtual void openCursor(CategoryCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(InvestigationCursor& cursor, unsigned batchSize);
+    
+    virtual void openCursor(ExtendedProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize);
+    
+public:
+    
+    virtual Identifier add(const Category& category);
+    virtual Identifier add(const ExtendedProblem& problem);
+    virtual Identifier add(const ExtendedSymptom& symptom);
+    virtual Identifier add(const ExtendedSolution& solution);
+    virtual Identifier add(const SymptomLink& symptomLink);
+    virtual Identifier add(const SolutionLink& solutionLink);
+    virtual Identifier add(const Investigation& investigation);
+    
+    virtual void modify(const Category& category);
+    virtual void modify(const ExtendedProblem& problem);
+    virtual void modify(const ExtendedSymptom& symptom);
+    virtual void modify(const ExtendedSolution& solution);
+    virtual void modify(const SymptomLink& symptomLink);
+    virtual void modify(const SolutionLink& solutionLink);
+    virtual void modify(const Investigation& investigation);
+    
+    virtual void add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs);
+    virtual void add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs);
+    
+    virtual void modify(const std::vector<Category>& categories);
+    virtual void modify(const std::vector<ExtendedProblem>& problems);
+    virtual void modify(const std::vector<ExtendedSymptom>& symptoms);
+    virtual void modify(const std::vector<ExtendedSolution>& solutions);
+    virtual void modify(const std::vector<SymptomLink>& symptomLinks);
+    virtual void modify(const std::vector<SolutionLink>& solutionLinks);
+    
+    virtual void remove(const Category& category);
+    virtual void remove(const Problem& problem);
+    virtual void remove(const Symptom& symptom);
+    virtual void remove(const Solution& solution);
+    virtual void remove(const SymptomLink& symptomLink);
+    virtual void remove(const SolutionLink& solutionLink);
+    virtual void remove(const Investigation& investigation);
+    
+private:
+    
+    /**
+     * Lock free version of DataLayerProfile::Counters
+     */
+    struct AtomicCounters
+    {
+        utils::AtomicCounter calls;
+        utils::AtomicCounter requestedIDs;
+        utils::AtomicCounter returnedObjects;
+        utils::AtomicCounter nanoseconds;
+    };
+    
+private:
+    
+    template<class T>
+    void templateGet(ProfiledOperation operation, const std::vector<Identifier>& ids, boost::unordered_map<Identifier, T>& result,
+                     std::vector<Identifier>* notFound);
+    
+    template<class T>
+    void templateOpenCursor(std::auto_ptr<IDataLayerCursor<T> >& cursor, unsigned batchSize);
+    
+    template<class T>
+    Identifier templateAdd(const T& object);
+    
+    template<class T>
+    void templateModify(const T& object);
+    
+    template<class T>
+    void templateAdd(const std::vector<T>& objects, std::vector<Identifier>& newIDs);
+    
+    template<class T>
+    void templateModify(const std::vector<T>& objects);
+    
+    template<class T>
+    void templateRemove(const T& object);
+    
+    void record(ProfiledOperation operation, uint64_t requestedIDs, uint64_t returnedObjects, uint64_t startTime);
+    
+private:
+    
+    AtomicCounters _totals[profiledOperationCount];
+    
+    static __thread DataLayerProfile* _scopeProfile; // of the innermost scope of the thread, NULL without a scope
+    
+    // requests running as fibers of one thread each have their own scopes
+    static void swapFiberLocal(uint64_t& saved);
+    static bool _fiberLocalAdded;
+
+};
+
+} // namespace ProblemSolver
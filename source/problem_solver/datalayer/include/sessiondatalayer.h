@@ -0,0 +1,127 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "forwardingdatalayer.h"
+#include "atomiccounter.h"
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace ProblemSolver
+{
+
+/**
+ * Data layer that keeps open investigations in memory while they are used (an investigation session).
+ * Reads of a session are served from memory and changes are only saved in memory and written to the target
+ * by a background thread, at most flushDelay milliseconds after the first unwritten change.
+ * Sessions not used for idleTimeout seconds are dropped after they are written.
+ * Closing or removing an investigation ends its session and is written to the target right away.
+ * Changes of the last flushDelay milliseconds are lost if the process crashes, and an investigation must be
+ * served by only one node at a time as the sessions of other nodes are not updated.
+ * Everything else is passed to the target unchanged.
+ */
+class SessionDataLayer: public ForwardingDataLayer
+{
+public:
+    
+    static const unsigned DEFAULT_FLUSH_DELAY = 1000; // milliseconds
+    static const unsigned DEFAULT_IDLE_TIMEOUT = 600; // seconds
+    
+public:
+    
+    SessionDataLayer(IDataLayer* target, unsigned flushDelay = DEFAULT_FLUSH_DELAY, unsigned idleTimeout = DEFAULT_IDLE_TIMEOUT);
+    
+    /**
+     * Stops the background thread and writes all changes
+     */
+    virtual ~SessionDataLayer();
+    
+public:
+    
+    /**
+     * Counters of the sessions since the data layer was created
+     */
+    struct Statistics
+    {
+        Statistics():
+            sessions(0), hits(0), misses(0), writes(0), writeErrors(0), evictions(0){}
+        
+        unsigned sessions; // open right now
+        uint64_t hits; // investigations read from a session
+        uint64_t misses; // investigations read from the target
+        uint64_t writes; // investigations written by the background thread or flush
+        uint64_t writeErrors; // failed writes, they are retried
+        uint64_t evictions; // idle sessions dropped
+    };
+    
+    Statistics getStatistics() const;
+    
+    /**
+     * Writes all changed sessions to the target now, returns the number of failed writes
+     */
+    unsigned flush();
+    
+public:
+    
+    // everything except investigations is passed to the target unchanged
+    using ForwardingDataLayer::get;
+    using ForwardingDataLayer::openCursor;
+    using ForwardingDataLayer::add;
+    using ForwardingDataLayer::modify;
+    using ForwardingDataLayer::remove;
+    
+    virtual void get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void openCursor(InvestigationCursor& cursor, unsigned batchSize);
+    
+    virtual Identifier add(const Investigation& investigation);
+    virtual void modify(const Investigation& investigation);
+    virtual void remove(const Investigation& investigation);
+    
+private:
+    
+    struct Session
+    {
+        Investigation investigation;
+        bool changed; // not yet written to the target
+        uint64_t changeTime; // of the first unwritten change
+        uint64_t useTime; // of the last read or change
+    };
+    
+    typedef boost::unordered_map<Identifier, Session> SessionMap;
+    
+private:
+    
+    unsigned writeSessions(bool all);
+    void flushLoop();
+    
+private:
+    
+    uint64_t _flushDelay; // nanoseconds
+    uint64_t _idleTimeout; // nanoseconds
+    uint64_t _checkInterval; // nanoseconds between runs of the background thread
+    
+    SessionMap _sessions;
+    mutable boost::mutex _sessionsMutex;
+    
+    /**
+     * Held while investigations are written to the target, so a session written in the background
+     * can never overwrite a later change written right away
+     */
+    boost::mutex _writeMutex;
+    
+    utils::AtomicCounter _hits;
+    utils::AtomicCounter _misses;
+    utils::AtomicCounter _writes;
+    utils::AtomicCounter _writeErrors;
+    utils::AtomicCounter _evictions;
+    
+    boost::thread _flushThread;
+};
+
+} // namespace ProblemSolver
@@ -0,0 +1,143 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "datalayerread.h"
+#include "snapshotformat.h"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace ProblemSolver
+{
+
+class SnapshotReader;
+
+/**
+ * Read-only data layer that works directly over a snapshot file mapped in memory.
+ * Objects are found with binary search and links with the CSR indexes of the snapshot (version 2 or later),
+ * nothing is copied at startup, so many processes using the same file share the same physical memory.
+ *
+ * New snapshots are published by writing them under a temporary name and renaming them over the file
+ * (like SnapshotWriter does). refresh() notices the new file and maps it, operations that are already
+ * running finish with the old mapping, which is released when the last of them completes.
+ * It is safe to use from many threads at once.
+ */
+class MappedDataLayer: public IDataLayerRead
+{
+public:
+    
+    explicit MappedDataLayer(const std::string& fileName, bool verifyChecksum = false);
+    virtual ~MappedDataLayer(){}
+    
+public:
+    
+    /**
+     * Exception thrown from all operations of the mapped data layer
+     */
+    class Exception: public DataLayerException
+    {
+    public:
+        explicit Exception(const std::string& errorMessage):
+            DataLayerException(errorMessage){}
+    };
+    
+public:
+    
+    /**
+     * Maps the snapshot again if the file was replaced. Returns true if a new snapshot is now used.
+     * If the new snapshot is invalid the old one is kept and an exception is thrown.
+     */
+    bool refresh();
+    
+    /**
+     * Returns the snapshot currently used, it stays valid as long as the pointer is kept
+     */
+    boost::shared_ptr<const SnapshotReader> getSnapshot() const;
+    
+public:
+    
+    virtual void get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& problemIDs, ProblemMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomIDs, SymptomMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionIDs, SolutionMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomLinkIDs, SymptomLinkMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionLinkIDs, SolutionLinkMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound = NULL);
+    
+    virtual void get(const std::vector<Identifier>& problemIDs, ExtendedProblemMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& symptomIDs, ExtendedSymptomMap& result, std::vector<Identifier>* notFound = NULL);
+    virtual void get(const std::vector<Identifier>& solutionIDs, ExtendedSolutionMap& result, std::vector<Identifier>* notFound = NULL);
+    
+    virtual void getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found = NULL);
+    virtual void getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found = NULL);
+    
+    virtual void getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found = NULL);
+    virtual void getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found = NULL);
+    
+    virtual void openCursor(CategoryCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SymptomLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(SolutionLinkCursor& cursor, unsigned batchSize);
+    virtual void openCursor(InvestigationCursor& cursor, unsigned batchSize);
+    
+    virtual void openCursor(ExtendedProblemCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize);
+    virtual void openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize);
+    
+private:
+    
+    /**
+     * Cursor over the records of one section of a snapshot
+     */
+    template<class T>
+    class Cursor: public IDataLayerCursor<T>
+    {
+    public:
+    
+        Cursor(boost::shared_ptr<const SnapshotReader> snapshot, SnapshotSectionType type, unsigned batchSize);
+        virtual ~Cursor(){}
+    
+    public:
+    
+        virtual bool next(boost::unordered_map<Identifier, T>& result);
+    
+    private:
+    
+        boost::shared_ptr<const SnapshotReader> _snapshot;
+        unsigned _position;
+        unsigned _count;
+        unsigned _batchSize;
+    };
+    
+private:
+    
+    template<class T>
+    void templateGet(SnapshotSectionType type, const std::vector<Identifier>& ids, boost::unordered_map<Identifier, T>& result,
+                     std::vector<Identifier>* notFound, const char* objectName);
+    
+    template<class T>
+    void templateGetLinks(SnapshotSectionType indexType, SnapshotSectionType ownerType, CIdentifier byId,
+                          Identifier T::* organizeField, boost::unordered_map<Identifier, T>& result, bool* found);
+    
+    template<class T>
+    void templateOpenCursor(SnapshotSectionType type, std::auto_ptr<IDataLayerCursor<T> >& cursor, unsigned batchSize);
+    
+private:
+    
+    std::string _fileName;
+    bool _verifyChecksum;
+    
+    mutable boost::mutex _snapshotMutex; // guards only the pointer, never held while reading
+    boost::shared_ptr<const SnapshotReader> _snapshot;
+
+};
+
+} // namespace ProblemSolver
@@ -0,0 +1,156 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace ProblemSolver
+{
+
+/**
+ * On-disk layout of a knowledge base snapshot.
+ *
+ * The file starts with a SnapshotHeader, followed by the table of SnapshotSection entries and the sections themselves.
+ * Every section starts at an 8 byte aligned offset and contains an array of fixed-width records.
+ * Strings are kept only once in the strings section and are referenced by offset and length.
+ * Variable length lists (children, tags, steps, investigation lists) are kept in the lists section
+ * as arrays of string references and are referenced by first element and count.
+ * Records of every section are sorted by ID and every record starts with its ID, so IDs can be found with binary search.
+ * Since version 2 the links of every problem, symptom and solution are indexed in CSR form:
+ * an index section is an array of uint32 that starts with (owner records count + 1) offsets
+ * followed by the positions of the links. The links of owner record i are at positions [offsets[i], offsets[i + 1])
+ * of the part after the offsets. Links to objects missing from the snapshot are not indexed.
+ * Nothing in the file depends on the address it is loaded at, so it can be used directly through mmap.
+ * All numbers are in the byte order of the machine that wrote the snapshot.
+ * The checksum is CRC32 of everything after the header.
+ */
+struct SnapshotFormat
+{
+    static const uint32_t VERSION = 2;
+    static const uint32_t MIN_SUPPORTED_VERSION = 1;
+    static const uint32_t SECTION_ALIGNMENT = 8;
+    
+    static const char* MAGIC; // 8 bytes, including the terminating zeros
+};
+
+/**
+ * Types of sections inside a snapshot
+ */
+enum SnapshotSectionType
+{
+    snapshotSectionStrings = 1,
+    snapshotSectionLists = 2,
+    snapshotSectionCategories = 3,
+    snapshotSectionProblems = 4,
+    snapshotSectionSymptoms = 5,
+    snapshotSectionSolutions = 6,
+    snapshotSectionSymptomLinks = 7,
+    snapshotSectionSolutionLinks = 8,
+    snapshotSectionInvestigations = 9,
+    snapshotSectionSymptomLinksByProblem = 10,
+    snapshotSectionSymptomLinksBySymptom = 11,
+    snapshotSectionSolutionLinksByProblem = 12,
+    snapshotSectionSolutionLinksBySolution = 13
+};
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t sectionCount;
+    uint64_t fileSize;
+    uint64_t createdAt; // unix time of creation
+    uint32_t checksum;
+    uint32_t reserved;
+};
+
+struct SnapshotSection
+{
+    uint32_t type; // SnapshotSectionType
+    uint32_t recordCount;
+    uint64_t offset; // from the start of the file
+    uint64_t size; // in bytes
+};
+
+// string inside the strings section, always followed by a terminating zero
+struct SnapshotString
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+// array of strings inside the lists section
+struct SnapshotList
+{
+    uint32_t first;
+    uint32_t count;
+};
+
+struct SnapshotCategory
+{
+    SnapshotString id;
+    SnapshotString name;
+    SnapshotString description;
+    SnapshotString parent;
+    SnapshotList childs;
+};
+
+// used for problems, symptoms and solutions
+struct SnapshotGenericInfo
+{
+    SnapshotString id;
+    SnapshotString categoryID;
+    SnapshotString name;
+    SnapshotString description;
+    SnapshotList tags;
+    SnapshotList steps;
+    int32_t difficulty;
+    uint8_t confirmed;
+    uint8_t padding[3];
+};
+
+struct SnapshotSymptomLink
+{
+    SnapshotString id;
+    SnapshotString problemID;
+    SnapshotString symptomID;
+    int32_t positiveChecks;
+    int32_t falsePositiveChecks;
+    int32_t negativeChecks;
+    uint8_t confirmed;
+    uint8_t padding[3];
+};
+
+struct SnapshotSolutionLink
+{
+    SnapshotString id;
+    SnapshotString problemID;
+    SnapshotString solutionID;
+    int32_t positive;
+    int32_t negative;
+    uint8_t confirmed;
+    uint8_t padding[3];
+};
+
+struct SnapshotInvestigation
+{
+    SnapshotString id;
+    SnapshotString positiveProblem;
+    SnapshotString positiveSolution;
+    SnapshotList positiveSymptoms;
+    SnapshotList negativeSymptoms;
+    SnapshotList bannedSymptoms;
+    SnapshotList negativeProblems;
+    SnapshotList bannedProblems;
+    SnapshotList negativeSolutions;
+    SnapshotList bannedSolutions;
+    uint8_t closed;
+    uint8_t padding[3];
+};
+
+} // namespace ProblemSolver
@@ -0,0 +1,136 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "datalayer.h"
+#include "snapshotformat.h"
+
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+namespace ProblemSolver
+{
+
+/**
+ * Gives access to a snapshot file (see SnapshotFormat) mapped in memory.
+ * The file is validated when opened, records are converted to objects only when they are read.
+ * Reading is safe from many threads at once.
+ */
+class SnapshotReader
+{
+public:
+    
+    /**
+     * Maps the file in memory and validates its header and section table.
+     * When verifyChecksum is set the whole file is read once to verify its checksum.
+     */
+    explicit SnapshotReader(const std::string& fileName, bool verifyChecksum = true);
+    ~SnapshotReader();
+    
+public:
+    
+    /**
+     * Exception thrown when the snapshot is missing, corrupted or of unsupported version
+     */
+    class Exception: public DataLayerException
+    {
+    public:
+        explicit Exception(const std::string& errorMessage):
+            DataLayerException(errorMessage){}
+    };
+    
+public:
+    
+    const SnapshotHeader& getHeader() const { return *_header; }
+    
+    /**
+     * Information about the mapped file, used to recognize when the file name points to a new snapshot
+     */
+    const struct stat& getFileInfo() const { return _fileInfo; }
+    
+    /**
+     * Returns the number of records of the section or 0 if the section is missing
+     */
+    unsigned getRecordCount(SnapshotSectionType type) const;
+    
+    /**
+     * Returns the position of the record with the given ID or -1 if it is missing
+     */
+    int findRecord(SnapshotSectionType type, CIdentifier id) const;
+    
+    /**
+     * Returns the positions of all links of the owner record at ownerIndex from a link index section.
+     * Returns false if the snapshot has no such index (written before version 2).
+     */
+    bool getLinkPositions(SnapshotSectionType indexType, unsigned ownerIndex, const uint32_t*& begin, const uint32_t*& end) const;
+    
+    /**
+     * Converts the record at position index of the related section.
+     * The non-extended versions read only the fields they need.
+     */
+    void read(unsigned index, Problem& result) const;
+    void read(unsigned index, Symptom& result) const;
+    void read(unsigned index, Solution& result) const;
+    
+    void read(unsigned index, Category& result) const;
+    void read(unsigned index, ExtendedProblem& result) const;
+    void read(unsigned index, ExtendedSymptom& result) const;
+    void read(unsigned index, ExtendedSolution& result) const;
+    void read(unsigned index, SymptomLink& result) const;
+    void read(unsigned index, SolutionLink& result) const;
+    void read(unsigned index, Investigation& result) const;
+    
+    /**
+     * Saves all objects from the snapshot into target using modify,
+     * so target must add missing objects on modify (like the MemoryDataLayer does).
+     */
+    void load(IDataLayer& target, bool withInvestigations = true) const;
+    
+private:
+    
+    SnapshotReader(const SnapshotReader&);
+    SnapshotReader& operator=(const SnapshotReader&);
+    
+    void validate(bool verifyChecksum);
+    
+    template<class R>
+    const R& getRecord(SnapshotSectionType type, unsigned index) const;
+    
+    template<class T>
+    void loadSection(SnapshotSectionType type, IDataLayer& target) const;
+    
+    void readGeneric(const SnapshotGenericInfo& record, GenericInfo& info) const;
+    void readGeneric(const SnapshotGenericInfo& record, GenericInfo& info, ExtendedGenericInfo& extendedInfo) const;
+    
+    int compareString(const SnapshotString& value, const char* compare, size_t compareLength) const;
+    
+    std::string getString(const SnapshotString& value) const;
+    Identifier getIdentifier(const SnapshotString& value) const;
+    
+    void getValue(const SnapshotString& value, std::string& result) const;
+    void getValue(const SnapshotString& value, Identifier& result) const;
+    
+    template<class T>
+    void getList(const SnapshotList& value, T& result) const;
+    
+private:
+    
+    std::string _fileName;
+    
+    int _file;
+    struct stat _fileInfo;
+    const char* _data;
+    size_t _size;
+    
+    const SnapshotHeader* _header;
+    std::vector<const SnapshotSection*> _sections; // indexed by SnapshotSectionType, NULL if missing
+
+};
+
+} // namespace ProblemSolver
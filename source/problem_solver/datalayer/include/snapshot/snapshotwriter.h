@@ -0,0 +1,105 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "datalayerread.h"
+#include "snapshotformat.h"
+
+#include <string>
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+namespace ProblemSolver
+{
+
+/**
+ * Writes all objects of a data layer into a snapshot file (see SnapshotFormat).
+ * The snapshot is first written under a temporary name and then renamed over the target file,
+ * so a reader never sees a partially written snapshot.
+ * One writer can be used to write many snapshots, but only from one thread at a time.
+ */
+class SnapshotWriter
+{
+public:
+    
+    static const unsigned DEFAULT_BATCH_SIZE = 10000; // how many objects are read from the data layer at once
+    
+public:
+    
+    SnapshotWriter(){}
+    ~SnapshotWriter(){}
+    
+public:
+    
+    /**
+     * Exception thrown when the snapshot can not be written
+     */
+    class Exception: public DataLayerException
+    {
+    public:
+        explicit Exception(const std::string& errorMessage):
+            DataLayerException(errorMessage){}
+    };
+    
+public:
+    
+    /**
+     * Reads everything from the data layer and writes it in fileName. Returns the size of the snapshot in bytes.
+     */
+    uint64_t write(IDataLayerRead& dataLayer, const std::string& fileName, unsigned batchSize = DEFAULT_BATCH_SIZE);
+    
+private:
+    
+    /**
+     * A section that is ready to be written in the file
+     */
+    struct PendingSection
+    {
+        SnapshotSectionType type;
+        uint32_t recordCount;
+        std::string data;
+    };
+    
+    template<class T, class R>
+    void addSection(IDataLayerRead& dataLayer, SnapshotSectionType type, unsigned batchSize);
+    
+    void fillRecord(const Category& category, SnapshotCategory& record);
+    void fillRecord(const ExtendedProblem& problem, SnapshotGenericInfo& record);
+    void fillRecord(const ExtendedSymptom& symptom, SnapshotGenericInfo& record);
+    void fillRecord(const ExtendedSolution& solution, SnapshotGenericInfo& record);
+    void fillRecord(const SymptomLink& symptomLink, SnapshotSymptomLink& record);
+    void fillRecord(const SolutionLink& solutionLink, SnapshotSolutionLink& record);
+    void fillRecord(const Investigation& investigation, SnapshotInvestigation& record);
+    
+    void fillGenericRecord(const GenericInfo& info, const ExtendedGenericInfo& extendedInfo, SnapshotGenericInfo& record);
+    
+    template<class R>
+    void addLinkIndex(SnapshotSectionType type, SnapshotSectionType ownerType, SnapshotSectionType linkType, SnapshotString R::* ownerField);
+    
+    const PendingSection& getPendingSection(SnapshotSectionType type) const;
+    
+    SnapshotString addString(const std::string& value);
+    SnapshotString addString(CIdentifier value);
+    
+    template<class T>
+    SnapshotList addList(const T& values);
+    
+    void clear();
+    
+private:
+    
+    std::string _strings;
+    boost::unordered_map<std::string, SnapshotString> _stringIndex;
+    
+    std::vector<SnapshotString> _lists;
+    
+    std::vector<PendingSection> _sections;
+
+};
+
+} // namespace ProblemSolver
@@ -0,0 +1,258 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "asyncdatalayerread.h"
+#include "datalayerstatistics.h"
+#include "utils.h"
+#include "fiberscheduler.h"
+
+#include <boost/foreach.hpp>
+
+namespace ProblemSolver
+{
+
+struct AsyncDataLayerRead::ReadState
+{
+    explicit ReadState(const boost::function<void ()>& read):
+        read(read), done(false), failed(false){}
+    
+    boost::function<void ()> read;
+    
+    bool done;
+    bool failed;
+    std::string error;
+    
+    boost::mutex mutex;
+    boost::condition_variable doneChanged;
+    std::vector<utils::FiberScheduler::Handle> waitingFibers;
+};
+
+const unsigned AsyncDataLayerRead::DEFAULT_THREAD_COUNT;
+
+AsyncDataLayerRead::AsyncDataLayerRead(IDataLayerRead& dataLayer, unsigned threadCount):
+    _dataLayer(dataLayer),
+    _stopped(false)
+{
+    for(unsigned i = 0; i < threadCount; ++i)
+    {
+        _threads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(&AsyncDataLayerRead::readLoop, this)));
+    }
+}
+
+AsyncDataLayerRead::~AsyncDataLayerRead()
+{
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _stopped = true;
+        _queueChanged.notify_all();
+    }
+    
+    BOOST_FOREACH(const boost::shared_ptr<boost::thread>& thread, _threads)
+    {
+        thread->join();
+    }
+}
+
+bool AsyncDataLayerRead::Read::isDone() const
+{
+    if(_state.get() == NULL)
+        return true;
+    
+    boost::mutex::scoped_lock lock(_state->mutex);
+    return _state->done;
+}
+
+void AsyncDataLayerRead::Read::wait() const
+{
+    if(_state.get() == NULL)
+        return;
+    
+    waitDone(true);
+    
+    boost::mutex::scoped_lock lock(_state->mutex);
+    
+    if(_state->failed)
+        throw DataLayerException(_state->error);
+}
+
+/**
+ * The time spent waiting is counted as round trip time of the calling thread, as it waited for the database
+ * the same as if it had run the read itself. Reads that overlap are counted once.
+ * A fiber is suspended instead, so its thread runs the other fibers meanwhile.
+ */
+void AsyncDataLayerRead::Read::waitDone(bool maySuspend) const
+{
+    if(_state.get() == NULL)
+        return;
+    
+    boost::mutex::scoped_lock lock(_state->mutex);
+    
+    if(!_state->done)
+    {
+        uint64_t start = utils::getMonotonicNanoseconds();
+        
+        if(maySuspend && utils::FiberScheduler::isInFiber())
+        {
+            _state->waitingFibers.push_back(utils::FiberScheduler::getRunning());
+            
+            lock.unlock();
+            utils::FiberScheduler::suspend();
+            lock.lock();
+        }
+        
+        while(!_state->done)
+        {
+            _state->doneChanged.wait(lock);
+        }
+        
+        DataLayerStatistics::addThreadRoundTripTime(utils::getMonotonicNanoseconds() - start);
+    }
+}
+
+/**
+ * The reads run in the threads of the reader, which never wait for the fibers, so blocking the thread ends
+ */
+AsyncDataLayerRead::ReadGroup::~ReadGroup()
+{
+    BOOST_FOREACH(const Read& read, _reads)
+    {
+        read.waitDone(false);
+    }
+}
+
+AsyncDataLayerRead::Read AsyncDataLayerRead::ReadGroup::add(const Read& read)
+{
+    _reads.push_back(read);
+    return read;
+}
+
+/**
+ * All reads are done before the error is thrown, so the destructor does not block a fiber's thread
+ */
+void AsyncDataLayerRead::ReadGroup::wait()
+{
+    drain();
+    
+    BOOST_FOREACH(const Read& read, _reads)
+    {
+        read.wait();
+    }
+}
+
+void AsyncDataLayerRead::ReadGroup::drain()
+{
+    BOOST_FOREACH(const Read& read, _reads)
+    {
+        read.waitDone(true);
+    }
+}
+
+AsyncDataLayerRead::Read AsyncDataLayerRead::getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found)
+{
+    void (IDataLayerRead::*read)(Identifier, SymptomsWithSameProblem&, bool*) = &IDataLayerRead::getLinksByProblem;
+    return start(boost::bind(read, &_dataLayer, problemID, boost::ref(result), found));
+}
+AsyncDataLayerRead::Read AsyncDataLayerRead::getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found)
+{
+    return start(boost::bind(&IDataLayerRead::getLinksBySymptom, &_dataLayer, symptomID, boost::ref(result), found));
+}
+
+AsyncDataLayerRead::Read AsyncDataLayerRead::getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found)
+{
+    void (IDataLayerRead::*read)(Identifier, SolutionsWithSameProblem&, bool*) = &IDataLayerRead::getLinksByProblem;
+    return start(boost::bind(read, &_dataLayer, problemID, boost::ref(result), found));
+}
+AsyncDataLayerRead::Read AsyncDataLayerRead::getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found)
+{
+    return start(boost::bind(&IDataLayerRead::getLinksBySolution, &_dataLayer, solutionID, boost::ref(result), found));
+}
+
+AsyncDataLayerRead::Read AsyncDataLayerRead::queue(const boost::function<void ()>& read)
+{
+    boost::shared_ptr<ReadState> state(new ReadState(read));
+    
+    boost::mutex::scoped_lock lock(_mutex);
+    _queue.push_back(state);
+    _queueChanged.notify_one();
+    
+    return Read(state);
+}
+
+/**
+ * Runs the read and marks it done, its error is kept to be thrown by the waiting thread
+ */
+void AsyncDataLayerRead::run(ReadState& state)
+{
+    bool failed = false;
+    std::string error;
+    
+    try
+    {
+        state.read();
+    }
+    catch(std::exception& e)
+    {
+        failed = true;
+        error = e.what();
+    }
+    catch(...)
+    {
+        failed = true;
+        error = "Unknown error while reading the data layer";
+    }
+    
+    // the bound arguments are released before the read is done, the caller owns them again
+    state.read = boost::function<void ()>();
+    
+    std::vector<utils::FiberScheduler::Handle> waitingFibers;
+    
+    {
+        boost::mutex::scoped_lock lock(state.mutex);
+        
+        state.done = true;
+        state.failed = failed;
+        state.error = error;
+        
+        state.doneChanged.notify_all();
+        waitingFibers.swap(state.waitingFibers);
+    }
+    
+    BOOST_FOREACH(const utils::FiberScheduler::Handle& fiber, waitingFibers)
+    {
+        fiber.resume();
+    }
+}
+
+/**
+ * Runs the queued reads until the object is destroyed, the reads still queued then are run first
+ */
+void AsyncDataLayerRead::readLoop()
+{
+    while(true)
+    {
+        boost::shared_ptr<ReadState> state;
+        
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            
+            while(_queue.empty() && !_stopped)
+            {
+                _queueChanged.wait(lock);
+            }
+            
+            if(_queue.empty())
+                return;
+            
+            state = _queue.front();
+            _queue.pop_front();
+        }
+        
+        run(*state);
+    }
+}
+
+} // namespace ProblemSolver
@@ -6,216 +6,509 @@
  */
 
 #include "cachingdatalayer.h"
+#include "datalayerstatistics.h"
+#include "utils.h"
+
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/thread/thread.hpp>
 
 namespace ProblemSolver
 {
 
-CachingDataLayer::CachingDataLayer(IDataLayer* source, IDataLayer* cache):
+const unsigned CachingDataLayer::DEFAULT_PRELOAD_BATCH_SIZE;
+
+CachingDataLayer::CachingDataLayer(IDataLayer* source, IDataLayer* cache, bool cacheComplete):
     _source(source),
-    _cache(cache)
+    _cache(cache),
+    _preloaded(cacheComplete)
+{
+}
+
+CachingDataLayer::PreloadReport CachingDataLayer::preload(unsigned batchSize)
 {
-    // initial load of all related objects
+    PreloadReport report;
+    
+    double startTime = utils::getCurrentSeconds();
+    long startMemory = utils::getResidentMemory();
+    
+    // every collection is loaded by a separate thread, errors are reported back through these
+    std::string errors[6];
+    
+    boost::thread_group loaders;
+    loaders.create_thread(boost::bind(&CachingDataLayer::preloadCollection<Category>, this, batchSize, &report.categories, &errors[0]));
+    loaders.create_thread(boost::bind(&CachingDataLayer::preloadCollection<ExtendedProblem>, this, batchSize, &report.problems, &errors[1]));
+    loaders.create_thread(boost::bind(&CachingDataLayer::preloadCollection<ExtendedSymptom>, this, batchSize, &report.symptoms, &errors[2]));
+    loaders.create_thread(boost::bind(&CachingDataLayer::preloadCollection<ExtendedSolution>, this, batchSize, &report.solutions, &errors[3]));
+    loaders.create_thread(boost::bind(&CachingDataLayer::preloadCollection<SymptomLink>, this, batchSize, &report.symptomLinks, &errors[4]));
+    loaders.create_thread(boost::bind(&CachingDataLayer::preloadCollection<SolutionLink>, this, batchSize, &report.solutionLinks, &errors[5]));
+    loaders.join_all();
+    
+    BOOST_FOREACH(const std::string& error, errors)
+    {
+        if(!error.empty())
+            throw Exception("Preload failed: " + error);
+    }
+    
+    report.seconds = utils::getCurrentSeconds() - startTime;
+    report.memoryBytes = utils::getResidentMemory() - startMemory;
     
+    _preloaded = true;
+    
+    return report;
 }
 
-void CachingDataLayer::get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound)
+unsigned CachingDataLayer::applyChanges(const std::vector<DataChange>& changes)
 {
+    // the same object is often changed many times in a row, read it only once
+    std::vector<Identifier> ids[dataObjectInvestigation + 1];
+    boost::unordered_set<Identifier> seen[dataObjectInvestigation + 1];
+    
+    BOOST_FOREACH(const DataChange& change, changes)
+    {
+        if(change.objectType == dataObjectInvestigation)
+            continue;
+        
+        if(seen[change.objectType].insert(change.id).second)
+            ids[change.objectType].push_back(change.id);
+    }
     
+    // objects go before links, so links of removed objects are already gone when links are refreshed
+    refreshObjects<Category, Category>(ids[dataObjectCategory]);
+    refreshObjects<ExtendedProblem, Problem>(ids[dataObjectProblem]);
+    refreshObjects<ExtendedSymptom, Symptom>(ids[dataObjectSymptom]);
+    refreshObjects<ExtendedSolution, Solution>(ids[dataObjectSolution]);
+    refreshObjects<SymptomLink, SymptomLink>(ids[dataObjectSymptomLink]);
+    refreshObjects<SolutionLink, SolutionLink>(ids[dataObjectSolutionLink]);
+    
+    unsigned refreshed = 0;
+    for(int type = dataObjectCategory; type < dataObjectInvestigation; ++type)
+    {
+        refreshed += ids[type].size();
+    }
+    
+    return refreshed;
+}
+
+void CachingDataLayer::get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet<Category, Category>(categoryIDs, result, notFound);
 }
 void CachingDataLayer::get(const std::vector<Identifier>& problemIDs, ProblemMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet<Problem, ExtendedProblem>(problemIDs, result, notFound);
 }
 void CachingDataLayer::get(const std::vector<Identifier>& symptomIDs, SymptomMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet<Symptom, ExtendedSymptom>(symptomIDs, result, notFound);
 }
 void CachingDataLayer::get(const std::vector<Identifier>& solutionIDs, SolutionMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet<Solution, ExtendedSolution>(solutionIDs, result, notFound);
+}
+void CachingDataLayer::get(const std::vector<Identifier>& symptomLinkIDs, SymptomLinkMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet<SymptomLink, SymptomLink>(symptomLinkIDs, result, notFound);
+}
+void CachingDataLayer::get(const std::vector<Identifier>& solutionLinkIDs, SolutionLinkMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet<SolutionLink, SolutionLink>(solutionLinkIDs, result, notFound);
 }
 void CachingDataLayer::get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound)
 {
-    
+    _source->get(investigationIDs, result, notFound);
 }
-    
+
 void CachingDataLayer::get(const std::vector<Identifier>& problemIDs, ExtendedProblemMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet<ExtendedProblem, ExtendedProblem>(problemIDs, result, notFound);
 }
 void CachingDataLayer::get(const std::vector<Identifier>& symptomIDs, ExtendedSymptomMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet<ExtendedSymptom, ExtendedSymptom>(symptomIDs, result, notFound);
 }
 void CachingDataLayer::get(const std::vector<Identifier>& solutionIDs, ExtendedSolutionMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet<ExtendedSolution, ExtendedSolution>(solutionIDs, result, notFound);
 }
-    
+
+/**
+ * Links of an object can be complete only if everything is preloaded, until then the source is used
+ */
 void CachingDataLayer::getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found)
 {
-    
+    getLinksSource()->getLinksByProblem(problemID, result, found);
 }
 void CachingDataLayer::getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found)
 {
-    
+    getLinksSource()->getLinksBySymptom(symptomID, result, found);
 }
-    
+
 void CachingDataLayer::getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found)
 {
-    
+    getLinksSource()->getLinksByProblem(problemID, result, found);
 }
 void CachingDataLayer::getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found)
 {
-    
+    getLinksSource()->getLinksBySolution(solutionID, result, found);
+}
+
+void CachingDataLayer::openCursor(CategoryCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void CachingDataLayer::openCursor(ProblemCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void CachingDataLayer::openCursor(SymptomCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void CachingDataLayer::openCursor(SolutionCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void CachingDataLayer::openCursor(SymptomLinkCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void CachingDataLayer::openCursor(SolutionLinkCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void CachingDataLayer::openCursor(InvestigationCursor& cursor, unsigned batchSize)
+{
+    _source->openCursor(cursor, batchSize);
+}
+
+void CachingDataLayer::openCursor(ExtendedProblemCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void CachingDataLayer::openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void CachingDataLayer::openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
 }
 
 Identifier CachingDataLayer::add(const Category& category)
 {
-    return "";
+    return templateAdd(category);
 }
 Identifier CachingDataLayer::add(const ExtendedProblem& problem)
 {
-    return "";
+    return templateAdd(problem);
 }
 Identifier CachingDataLayer::add(const ExtendedSymptom& symptom)
 {
-    return "";
+    return templateAdd(symptom);
 }
 Identifier CachingDataLayer::add(const ExtendedSolution& solution)
 {
-    return "";
+    return templateAdd(solution);
 }
 Identifier CachingDataLayer::add(const SymptomLink& symptomLink)
 {
-    return "";
+    return templateAdd(symptomLink);
 }
 Identifier CachingDataLayer::add(const SolutionLink& solutionLink)
 {
-    return "";
+    return templateAdd(solutionLink);
 }
-Identifier CachingDataLayer::add(const Investigation& solutionLink)
+Identifier CachingDataLayer::add(const Investigation& investigation)
 {
-    return "";
+    return _source->add(investigation);
 }
 
 void CachingDataLayer::modify(const Category& category)
 {
-    
+    templateModify(category);
 }
 void CachingDataLayer::modify(const ExtendedProblem& problem)
 {
-    
+    templateModify(problem);
 }
 void CachingDataLayer::modify(const ExtendedSymptom& symptom)
 {
-    
+    templateModify(symptom);
 }
 void CachingDataLayer::modify(const ExtendedSolution& solution)
 {
-    
+    templateModify(solution);
 }
 void CachingDataLayer::modify(const SymptomLink& symptomLink)
 {
-    
+    templateModify(symptomLink);
 }
 void CachingDataLayer::modify(const SolutionLink& solutionLink)
 {
-    
+    templateModify(solutionLink);
 }
-void CachingDataLayer::modify(const Investigation& solutionLink)
+void CachingDataLayer::modify(const Investigation& investigation)
 {
-    
+    _source->modify(investigation);
+}
+
+void CachingDataLayer::add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs)
+{
+    templateAdd(categories, newIDs);
+}
+void CachingDataLayer::add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs)
+{
+    templateAdd(problems, newIDs);
+}
+void CachingDataLayer::add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs)
+{
+    templateAdd(symptoms, newIDs);
+}
+void CachingDataLayer::add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs)
+{
+    templateAdd(solutions, newIDs);
+}
+void CachingDataLayer::add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs)
+{
+    templateAdd(symptomLinks, newIDs);
+}
+void CachingDataLayer::add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs)
+{
+    templateAdd(solutionLinks, newIDs);
+}
+
+void CachingDataLayer::modify(const std::vector<Category>& categories)
+{
+    templateModify(categories);
+}
+void CachingDataLayer::modify(const std::vector<ExtendedProblem>& problems)
+{
+    templateModify(problems);
+}
+void CachingDataLayer::modify(const std::vector<ExtendedSymptom>& symptoms)
+{
+    templateModify(symptoms);
+}
+void CachingDataLayer::modify(const std::vector<ExtendedSolution>& solutions)
+{
+    templateModify(solutions);
+}
+void CachingDataLayer::modify(const std::vector<SymptomLink>& symptomLinks)
+{
+    templateModify(symptomLinks);
+}
+void CachingDataLayer::modify(const std::vector<SolutionLink>& solutionLinks)
+{
+    templateModify(solutionLinks);
 }
 
 void CachingDataLayer::remove(const Category& category)
 {
-    
+    templateRemove(category);
 }
 void CachingDataLayer::remove(const Problem& problem)
 {
-    
+    templateRemove(problem);
 }
 void CachingDataLayer::remove(const Symptom& symptom)
 {
-    
+    templateRemove(symptom);
 }
 void CachingDataLayer::remove(const Solution& solution)
 {
-    
+    templateRemove(solution);
 }
 void CachingDataLayer::remove(const SymptomLink& symptomLink)
 {
-    
+    templateRemove(symptomLink);
 }
 void CachingDataLayer::remove(const SolutionLink& solutionLink)
 {
-    
+    templateRemove(solutionLink);
+}
+void CachingDataLayer::remove(const Investigation& investigation)
+{
+    _source->remove(investigation);
 }
-void CachingDataLayer::remove(const Investigation& solutionLink)
+
+/**
+ * Returns the data layer that can answer link lookups and counts the lookup as a cache hit or miss
+ */
+IDataLayer* CachingDataLayer::getLinksSource()
 {
+    if(_preloaded)
+    {
+        DataLayerStatistics::cacheHits.add();
+        return _cache.get();
+    }
     
+    DataLayerStatistics::cacheMisses.add();
+    return _source.get();
 }
 
 /**
  * Retrieves objects from the cache, and if they are not found searches for them in the source.
  * Anything found in the source is saved in cache for later use.
- *//*
-template<class T>
-bool CachingDataLayer::templateGet(const std::vector<int>& ids, std::vector<const T*>& result)
+ * T is the requested type and Y is the type kept in the cache (e.g. Problem and ExtendedProblem).
+ */
+template<class T, class Y>
+void CachingDataLayer::templateGet(const std::vector<Identifier>& ids, boost::unordered_map<Identifier, T>& result, std::vector<Identifier>* notFound)
 {
-    // look up what we can from cache
-    if(!_cache->get(ids, result))
-        return false;
+    typedef boost::unordered_map<Identifier, Y> StoredMap;
     
-    std::vector<int> cacheMissIDs;
-    std::vector<int> cacheMissOriginalIdexes;
-    for(uint i = 0; i < result.size(); ++i)
+    if(_preloaded)
     {
-        if(result[i] == NULL)
-        {
-            cacheMissIDs.push_back(ids[i]);
-            cacheMissOriginalIdexes.push_back(i);
-        }
+        _cache->get(ids, result, notFound);
+        DataLayerStatistics::cacheHits.add(ids.size());
+        return;
     }
     
-    // check if we have cache misses
-    if(!cacheMissIDs.empty())
+    // without preload the cache can not return all objects
+    if(ids.empty())
     {
-        std::vector<const T*> cacheMissObjects;
-        cacheMissObjects.reserve(cacheMissIDs.size());
-        
-        // look up cache misses from source
-        if(!_source->get(cacheMissIDs, cacheMissObjects))
-            return false;
-        
-        //  save anything found back to cache and update the result
-        for(uint i = 0; i < cacheMissObjects.size(); ++i)
-        {
-            if(cacheMissObjects[i] != NULL)
-            {
-                T* cacheUpdate = _cache->modify(cacheMissObjects[i]);
-                if(cacheUpdate == NULL)
-                    return false;
-                
-                result[cacheMissOriginalIdexes[i]] = cacheUpdate;
-            }
-        }
+        _source->get(ids, result, notFound);
+        return;
     }
     
-    return true;
+    std::vector<Identifier> cacheMissIDs;
+    _cache->get(ids, result, &cacheMissIDs);
+    
+    DataLayerStatistics::cacheHits.add(ids.size() - cacheMissIDs.size());
+    DataLayerStatistics::cacheMisses.add(cacheMissIDs.size());
+    
+    if(cacheMissIDs.empty())
+        return;
+    
+    StoredMap cacheMissObjects;
+    _source->get(cacheMissIDs, cacheMissObjects, notFound);
+    
+    // save anything found back to cache and update the result
+    BOOST_FOREACH(const typename StoredMap::value_type& pair, cacheMissObjects)
+    {
+        _cache->modify(pair.second);
+        result[pair.first] = pair.second;
+    }
+}
+
+template<class T>
+void CachingDataLayer::templateOpenCursor(std::auto_ptr<IDataLayerCursor<T> >& cursor, unsigned batchSize)
+{
+    (_preloaded ? _cache : _source)->openCursor(cursor, batchSize);
 }
 
 template<class T>
-T* CachingDataLayer::templateModify(const T* object)
+Identifier CachingDataLayer::templateAdd(const T& object)
 {
-    // update the object inside the source
-    T* modifyResult = _source->modify(object);
-    if(modifyResult == NULL)
-        return NULL;
+    T newObject = object;
+    newObject.id = _source->add(object);
+    
+    _cache->modify(newObject);
     
-    return _cache->modify(object);
-}*/
+    return newObject.id;
+}
+
+template<class T>
+void CachingDataLayer::templateModify(const T& object)
+{
+    _source->modify(object);
+    _cache->modify(object);
+}
 
+/**
+ * The new objects are written to the cache with the IDs the source gave them
+ */
+template<class T>
+void CachingDataLayer::templateAdd(const std::vector<T>& objects, std::vector<Identifier>& newIDs)
+{
+    size_t firstNewID = newIDs.size();
+    _source->add(objects, newIDs);
+    
+    std::vector<T> newObjects(objects);
+    for(size_t i = 0; i < newObjects.size(); ++i)
+    {
+        newObjects[i].id = newIDs[firstNewID + i];
+    }
+    
+    _cache->modify(newObjects);
+}
+
+template<class T>
+void CachingDataLayer::templateModify(const std::vector<T>& objects)
+{
+    _source->modify(objects);
+    _cache->modify(objects);
+}
+
+template<class T>
+void CachingDataLayer::templateRemove(const T& object)
+{
+    _source->remove(object);
+    _cache->remove(object);
+}
+
+/**
+ * Reads the objects from the source into the cache, removes from the cache those the source does not have.
+ * T is the type kept in the cache and R is the type used to remove it (e.g. ExtendedProblem and Problem).
+ */
+template<class T, class R>
+void CachingDataLayer::refreshObjects(const std::vector<Identifier>& ids)
+{
+    typedef boost::unordered_map<Identifier, T> ValueMap;
+    
+    if(ids.empty())
+        return;
+    
+    ValueMap objects;
+    std::vector<Identifier> removedIDs;
+    _source->get(ids, objects, &removedIDs);
+    
+    BOOST_FOREACH(const typename ValueMap::value_type& pair, objects)
+    {
+        _cache->modify(pair.second);
+    }
+    
+    BOOST_FOREACH(CIdentifier id, removedIDs)
+    {
+        R object;
+        object.id = id;
+        _cache->remove(object);
+    }
+}
+
+/**
+ * Reads a whole collection from the source into the cache. Runs in a separate thread.
+ */
+template<class T>
+void CachingDataLayer::preloadCollection(unsigned batchSize, unsigned* loadedCount, std::string* error)
+{
+    typedef boost::unordered_map<Identifier, T> ValueMap;
+    
+    try
+    {
+        std::auto_ptr<IDataLayerCursor<T> > cursor;
+        _source->openCursor(cursor, batchSize);
+        
+        ValueMap batch;
+        while(cursor->next(batch))
+        {
+            BOOST_FOREACH(const typename ValueMap::value_type& pair, batch)
+            {
+                _cache->modify(pair.second);
+            }
+            
+            *loadedCount += batch.size();
+        }
+    }
+    catch(std::exception& e)
+    {
+        *error = e.what();
+    }
+    catch(...)
+    {
+        *error = "Unknown error";
+    }
+}
 
 } // namespace ProblemSolver
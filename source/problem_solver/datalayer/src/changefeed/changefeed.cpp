@@ -0,0 +1,68 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "changefeed.h"
+
+namespace ProblemSolver
+{
+
+const char* DataChange::toString(DataChangeOperation operation)
+{
+    switch(operation)
+    {
+        case dataChangeUpsert: return "upsert";
+        case dataChangeRemove: return "remove";
+    }
+    
+    return "unknown";
+}
+
+const char* DataChange::toString(DataObjectType objectType)
+{
+    switch(objectType)
+    {
+        case dataObjectCategory: return "category";
+        case dataObjectProblem: return "problem";
+        case dataObjectSymptom: return "symptom";
+        case dataObjectSolution: return "solution";
+        case dataObjectSymptomLink: return "symptomLink";
+        case dataObjectSolutionLink: return "solutionLink";
+        case dataObjectInvestigation: return "investigation";
+    }
+    
+    return "unknown";
+}
+
+bool DataChange::fromString(const std::string& text, DataChangeOperation& operation)
+{
+    for(int value = dataChangeUpsert; value <= dataChangeRemove; ++value)
+    {
+        if(text == toString(static_cast<DataChangeOperation>(value)))
+        {
+            operation = static_cast<DataChangeOperation>(value);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool DataChange::fromString(const std::string& text, DataObjectType& objectType)
+{
+    for(int value = dataObjectCategory; value <= dataObjectInvestigation; ++value)
+    {
+        if(text == toString(static_cast<DataObjectType>(value)))
+        {
+            objectType = static_cast<DataObjectType>(value);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+} // namespace ProblemSolver
@@ -0,0 +1,240 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "changepublishingdatalayer.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <boost/foreach.hpp>
+
+namespace ProblemSolver
+{
+
+ChangePublishingDataLayer::ChangePublishingDataLayer(IDataLayer* target, boost::shared_ptr<IChangeFeed> changeFeed):
+    ForwardingDataLayer(target),
+    _changeFeed(changeFeed)
+{
+}
+
+Identifier ChangePublishingDataLayer::add(const Category& category)
+{
+    return templateAdd(category, dataObjectCategory);
+}
+Identifier ChangePublishingDataLayer::add(const ExtendedProblem& problem)
+{
+    return templateAdd(problem, dataObjectProblem);
+}
+Identifier ChangePublishingDataLayer::add(const ExtendedSymptom& symptom)
+{
+    return templateAdd(symptom, dataObjectSymptom);
+}
+Identifier ChangePublishingDataLayer::add(const ExtendedSolution& solution)
+{
+    return templateAdd(solution, dataObjectSolution);
+}
+Identifier ChangePublishingDataLayer::add(const SymptomLink& symptomLink)
+{
+    return templateAdd(symptomLink, dataObjectSymptomLink);
+}
+Identifier ChangePublishingDataLayer::add(const SolutionLink& solutionLink)
+{
+    return templateAdd(solutionLink, dataObjectSolutionLink);
+}
+
+void ChangePublishingDataLayer::modify(const Category& category)
+{
+    templateModify(category, dataObjectCategory);
+}
+void ChangePublishingDataLayer::modify(const ExtendedProblem& problem)
+{
+    templateModify(problem, dataObjectProblem);
+}
+void ChangePublishingDataLayer::modify(const ExtendedSymptom& symptom)
+{
+    templateModify(symptom, dataObjectSymptom);
+}
+void ChangePublishingDataLayer::modify(const ExtendedSolution& solution)
+{
+    templateModify(solution, dataObjectSolution);
+}
+void ChangePublishingDataLayer::modify(const SymptomLink& symptomLink)
+{
+    templateModify(symptomLink, dataObjectSymptomLink);
+}
+void ChangePublishingDataLayer::modify(const SolutionLink& solutionLink)
+{
+    templateModify(solutionLink, dataObjectSolutionLink);
+}
+
+void ChangePublishingDataLayer::add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs)
+{
+    templateAdd(categories, newIDs, dataObjectCategory);
+}
+void ChangePublishingDataLayer::add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs)
+{
+    templateAdd(problems, newIDs, dataObjectProblem);
+}
+void ChangePublishingDataLayer::add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs)
+{
+    templateAdd(symptoms, newIDs, dataObjectSymptom);
+}
+void ChangePublishingDataLayer::add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs)
+{
+    templateAdd(solutions, newIDs, dataObjectSolution);
+}
+void ChangePublishingDataLayer::add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs)
+{
+    templateAdd(symptomLinks, newIDs, dataObjectSymptomLink);
+}
+void ChangePublishingDataLayer::add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs)
+{
+    templateAdd(solutionLinks, newIDs, dataObjectSolutionLink);
+}
+
+void ChangePublishingDataLayer::modify(const std::vector<Category>& categories)
+{
+    templateModify(categories, dataObjectCategory);
+}
+void ChangePublishingDataLayer::modify(const std::vector<ExtendedProblem>& problems)
+{
+    templateModify(problems, dataObjectProblem);
+}
+void ChangePublishingDataLayer::modify(const std::vector<ExtendedSymptom>& symptoms)
+{
+    templateModify(symptoms, dataObjectSymptom);
+}
+void ChangePublishingDataLayer::modify(const std::vector<ExtendedSolution>& solutions)
+{
+    templateModify(solutions, dataObjectSolution);
+}
+void ChangePublishingDataLayer::modify(const std::vector<SymptomLink>& symptomLinks)
+{
+    templateModify(symptomLinks, dataObjectSymptomLink);
+}
+void ChangePublishingDataLayer::modify(const std::vector<SolutionLink>& solutionLinks)
+{
+    templateModify(solutionLinks, dataObjectSolutionLink);
+}
+
+void ChangePublishingDataLayer::remove(const Category& category)
+{
+    templateRemove(category, dataObjectCategory);
+}
+void ChangePublishingDataLayer::remove(const Problem& problem)
+{
+    templateRemove(problem, dataObjectProblem);
+}
+void ChangePublishingDataLayer::remove(const Symptom& symptom)
+{
+    templateRemove(symptom, dataObjectSymptom);
+}
+void ChangePublishingDataLayer::remove(const Solution& solution)
+{
+    templateRemove(solution, dataObjectSolution);
+}
+void ChangePublishingDataLayer::remove(const SymptomLink& symptomLink)
+{
+    templateRemove(symptomLink, dataObjectSymptomLink);
+}
+void ChangePublishingDataLayer::remove(const SolutionLink& solutionLink)
+{
+    templateRemove(solutionLink, dataObjectSolutionLink);
+}
+
+template<class T>
+Identifier ChangePublishingDataLayer::templateAdd(const T& object, DataObjectType objectType)
+{
+    Identifier id = _target->add(object);
+    publish(dataChangeUpsert, objectType, id);
+    
+    return id;
+}
+
+template<class T>
+void ChangePublishingDataLayer::templateModify(const T& object, DataObjectType objectType)
+{
+    _target->modify(object);
+    publish(dataChangeUpsert, objectType, object.id);
+}
+
+/**
+ * All changes of a bulk write are published at once
+ */
+template<class T>
+void ChangePublishingDataLayer::templateAdd(const std::vector<T>& objects, std::vector<Identifier>& newIDs, DataObjectType objectType)
+{
+    size_t firstNewID = newIDs.size();
+    _target->add(objects, newIDs);
+    
+    std::vector<DataChange> changes;
+    changes.reserve(newIDs.size() - firstNewID);
+    
+    for(size_t i = firstNewID; i < newIDs.size(); ++i)
+    {
+        changes.push_back(DataChange(dataChangeUpsert, objectType, newIDs[i]));
+    }
+    
+    publish(changes);
+}
+
+template<class T>
+void ChangePublishingDataLayer::templateModify(const std::vector<T>& objects, DataObjectType objectType)
+{
+    _target->modify(objects);
+    
+    std::vector<DataChange> changes;
+    changes.reserve(objects.size());
+    
+    BOOST_FOREACH(const T& object, objects)
+    {
+        changes.push_back(DataChange(dataChangeUpsert, objectType, object.id));
+    }
+    
+    publish(changes);
+}
+
+/**
+ * Links removed together with a problem, symptom or solution are not published one by one,
+ * the receivers remove them the same way when they apply the removal of the object.
+ */
+template<class T>
+void ChangePublishingDataLayer::templateRemove(const T& object, DataObjectType objectType)
+{
+    _target->remove(object);
+    publish(dataChangeRemove, objectType, object.id);
+}
+
+void ChangePublishingDataLayer::publish(DataChangeOperation operation, DataObjectType objectType, CIdentifier id)
+{
+    try
+    {
+        _changeFeed->publish(std::vector<DataChange>(1, DataChange(operation, objectType, id)));
+    }
+    catch(std::exception& e)
+    {
+        utils::Logger::log(utils::logError, "Could not publish %s of %s %s! Error: %s",
+                           DataChange::toString(operation), DataChange::toString(objectType), id.toString().c_str(), e.what());
+    }
+}
+
+void ChangePublishingDataLayer::publish(const std::vector<DataChange>& changes)
+{
+    if(changes.empty())
+        return;
+    
+    try
+    {
+        _changeFeed->publish(changes);
+    }
+    catch(std::exception& e)
+    {
+        utils::Logger::log(utils::logError, "Could not publish %u changes of %s! Error: %s",
+                           static_cast<unsigned>(changes.size()), DataChange::toString(changes.front().objectType), e.what());
+    }
+}
+
+} // namespace ProblemSolver
@@ -0,0 +1,130 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "filechangefeed.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <sstream>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace ProblemSolver
+{
+
+FileChangeFeed::FileChangeFeed(const std::string& fileName):
+    _fileName(fileName),
+    _writeFile(-1),
+    _readFile(-1)
+{
+    _writeFile = open(fileName.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if(_writeFile < 0)
+        throw Exception((boost::format("Could not open change feed file %s for writing!") % fileName).str());
+    
+    _readFile = open(fileName.c_str(), O_RDONLY);
+    if(_readFile < 0 || lseek(_readFile, 0, SEEK_END) < 0)
+    {
+        close(_writeFile);
+        if(_readFile >= 0)
+            close(_readFile);
+        
+        throw Exception((boost::format("Could not open change feed file %s for reading!") % fileName).str());
+    }
+}
+
+FileChangeFeed::~FileChangeFeed()
+{
+    close(_writeFile);
+    close(_readFile);
+}
+
+void FileChangeFeed::publish(const std::vector<DataChange>& changes)
+{
+    if(changes.empty())
+        return;
+    
+    std::string text;
+    BOOST_FOREACH(const DataChange& change, changes)
+    {
+        text += (boost::format("%s %s %s\n") % DataChange::toString(change.operation) % DataChange::toString(change.objectType) % change.id).str();
+    }
+    
+    // O_APPEND makes a single write atomic relative to the writes of other processes
+    ssize_t written = write(_writeFile, text.data(), text.size());
+    if(written != static_cast<ssize_t>(text.size()))
+        throw Exception((boost::format("Could not write to change feed file %s!") % _fileName).str());
+}
+
+bool FileChangeFeed::read(std::vector<DataChange>& changes, unsigned timeout)
+{
+    size_t startCount = changes.size();
+    
+    for(int attempt = 0; attempt < 2; ++attempt)
+    {
+        // the file was truncated by someone, start again from its beginning
+        struct stat fileInfo;
+        if(fstat(_readFile, &fileInfo) == 0 && fileInfo.st_size < lseek(_readFile, 0, SEEK_CUR))
+        {
+            lseek(_readFile, 0, SEEK_SET);
+            _pending.clear();
+        }
+        
+        char buffer[64 * 1024];
+        ssize_t size;
+        while((size = ::read(_readFile, buffer, sizeof(buffer))) > 0)
+        {
+            _pending.append(buffer, size);
+        }
+        
+        size_t lineStart = 0;
+        size_t lineEnd;
+        while((lineEnd = _pending.find('\n', lineStart)) != std::string::npos)
+        {
+            parseLine(_pending.substr(lineStart, lineEnd - lineStart), changes);
+            lineStart = lineEnd + 1;
+        }
+        _pending.erase(0, lineStart);
+        
+        if(changes.size() > startCount || timeout == 0 || attempt > 0)
+            break;
+        
+        boost::this_thread::sleep(boost::posix_time::milliseconds(timeout));
+    }
+    
+    return changes.size() > startCount;
+}
+
+/**
+ * Lines that can not be parsed are reported and skipped, so a mistake of a test tool does not stop the feed
+ */
+void FileChangeFeed::parseLine(const std::string& line, std::vector<DataChange>& changes)
+{
+    std::istringstream stream(line);
+    std::string operationText;
+    std::string objectTypeText;
+    DataChange change;
+    
+    if(line.empty())
+        return;
+    
+    if(!(stream >> operationText >> objectTypeText >> change.id) || change.id.empty() ||
+       !DataChange::fromString(operationText, change.operation) ||
+       !DataChange::fromString(objectTypeText, change.objectType))
+    {
+        utils::Logger::log(utils::logError, "Invalid line in change feed file %s: %s", _fileName.c_str(), line.c_str());
+        return;
+    }
+    
+    changes.push_back(change);
+}
+
+} // namespace ProblemSolver
@@ -0,0 +1,46 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "datalayerstatistics.h"
+#include "utils.h"
+#include "fiberscheduler.h"
+
+#include <algorithm>
+
+namespace ProblemSolver
+{
+
+utils::AtomicCounter DataLayerStatistics::cacheHits;
+utils::AtomicCounter DataLayerStatistics::cacheMisses;
+
+utils::AtomicCounter DataLayerStatistics::roundTrips;
+utils::ConcurrentLatencyHistogram DataLayerStatistics::roundTripLatency;
+
+__thread uint64_t DataLayerStatistics::_threadRoundTripTime = 0;
+
+bool DataLayerStatistics::_fiberLocalAdded = utils::FiberScheduler::addLocal(&DataLayerStatistics::swapFiberLocal);
+
+void DataLayerStatistics::swapFiberLocal(uint64_t& saved)
+{
+    std::swap(saved, _threadRoundTripTime);
+}
+
+DataLayerStatistics::RoundTrip::RoundTrip():
+    _start(utils::getMonotonicNanoseconds())
+{
+}
+
+DataLayerStatistics::RoundTrip::~RoundTrip()
+{
+    uint64_t time = utils::getMonotonicNanoseconds() - _start;
+    
+    roundTrips.add();
+    roundTripLatency.record(time);
+    _threadRoundTripTime += time;
+}
+
+} // namespace ProblemSolver
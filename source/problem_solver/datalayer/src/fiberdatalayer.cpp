@@ -0,0 +1,468 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "fiberdatalayer.h"
+#include "datalayerstatistics.h"
+#include "utils.h"
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+namespace ProblemSolver
+{
+
+namespace
+{
+
+template<class T>
+void addObject(IDataLayer* target, const T* object, Identifier* newID)
+{
+    *newID = target->add(*object);
+}
+
+template<class T>
+void readNext(IDataLayerCursor<T>* cursor, boost::unordered_map<Identifier, T>* result, bool* more)
+{
+    *more = cursor->next(*result);
+}
+
+} // namespace
+
+/**
+ * An operation waiting for an I/O thread, it is owned by the suspended fiber
+ */
+struct FiberDataLayer::Call
+{
+    explicit Call(const boost::function<void ()>& operation):
+        operation(operation), fiber(utils::FiberScheduler::getRunning()), failed(false){}
+    
+    boost::function<void ()> operation;
+    utils::FiberScheduler::Handle fiber;
+    
+    bool failed;
+    std::string error;
+};
+
+/**
+ * Reads every batch in an I/O thread, the target cursor stays owned by the wrapper
+ */
+template<class T>
+class FiberDataLayer::Cursor: public IDataLayerCursor<T>
+{
+public:
+    
+    Cursor(FiberDataLayer& dataLayer, std::auto_ptr<IDataLayerCursor<T> > target):
+        _dataLayer(dataLayer), _target(target){}
+    
+    virtual bool next(boost::unordered_map<Identifier, T>& result)
+    {
+        bool more = false;
+        _dataLayer.call(boost::bind(&readNext<T>, _target.get(), &result, &more));
+        
+        return more;
+    }
+    
+private:
+    
+    FiberDataLayer& _dataLayer;
+    std::auto_ptr<IDataLayerCursor<T> > _target;
+};
+
+const unsigned FiberDataLayer::DEFAULT_THREAD_COUNT;
+
+FiberDataLayer::FiberDataLayer(IDataLayer* target, unsigned threadCount):
+    ForwardingDataLayer(target),
+    _stopped(false)
+{
+    for(unsigned i = 0; i < threadCount; ++i)
+    {
+        _threads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(&FiberDataLayer::ioLoop, this)));
+    }
+}
+
+FiberDataLayer::~FiberDataLayer()
+{
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _stopped = true;
+        _queueChanged.notify_all();
+    }
+    
+    BOOST_FOREACH(const boost::shared_ptr<boost::thread>& thread, _threads)
+    {
+        thread->join();
+    }
+}
+
+void FiberDataLayer::get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(categoryIDs, result, notFound);
+}
+void FiberDataLayer::get(const std::vector<Identifier>& problemIDs, ProblemMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(problemIDs, result, notFound);
+}
+void FiberDataLayer::get(const std::vector<Identifier>& symptomIDs, SymptomMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(symptomIDs, result, notFound);
+}
+void FiberDataLayer::get(const std::vector<Identifier>& solutionIDs, SolutionMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(solutionIDs, result, notFound);
+}
+void FiberDataLayer::get(const std::vector<Identifier>& symptomLinkIDs, SymptomLinkMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(symptomLinkIDs, result, notFound);
+}
+void FiberDataLayer::get(const std::vector<Identifier>& solutionLinkIDs, SolutionLinkMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(solutionLinkIDs, result, notFound);
+}
+void FiberDataLayer::get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(investigationIDs, result, notFound);
+}
+
+void FiberDataLayer::get(const std::vector<Identifier>& problemIDs, ExtendedProblemMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(problemIDs, result, notFound);
+}
+void FiberDataLayer::get(const std::vector<Identifier>& symptomIDs, ExtendedSymptomMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(symptomIDs, result, notFound);
+}
+void FiberDataLayer::get(const std::vector<Identifier>& solutionIDs, ExtendedSolutionMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(solutionIDs, result, notFound);
+}
+
+void FiberDataLayer::getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found)
+{
+    void (IDataLayerRead::*read)(Identifier, SymptomsWithSameProblem&, bool*) = &IDataLayerRead::getLinksByProblem;
+    call(boost::bind(read, _target.get(), problemID, boost::ref(result), found));
+}
+void FiberDataLayer::getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found)
+{
+    void (IDataLayerRead::*read)(Identifier, ProblemsWithSameSymptom&, bool*) = &IDataLayerRead::getLinksBySymptom;
+    call(boost::bind(read, _target.get(), symptomID, boost::ref(result), found));
+}
+
+void FiberDataLayer::getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found)
+{
+    void (IDataLayerRead::*read)(Identifier, SolutionsWithSameProblem&, bool*) = &IDataLayerRead::getLinksByProblem;
+    call(boost::bind(read, _target.get(), problemID, boost::ref(result), found));
+}
+void FiberDataLayer::getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found)
+{
+    void (IDataLayerRead::*read)(Identifier, ProblemsWithSameSolution&, bool*) = &IDataLayerRead::getLinksBySolution;
+    call(boost::bind(read, _target.get(), solutionID, boost::ref(result), found));
+}
+
+void FiberDataLayer::openCursor(CategoryCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void FiberDataLayer::openCursor(ProblemCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void FiberDataLayer::openCursor(SymptomCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void FiberDataLayer::openCursor(SolutionCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void FiberDataLayer::openCursor(SymptomLinkCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void FiberDataLayer::openCursor(SolutionLinkCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void FiberDataLayer::openCursor(InvestigationCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+
+void FiberDataLayer::openCursor(ExtendedProblemCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void FiberDataLayer::openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void FiberDataLayer::openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+
+Identifier FiberDataLayer::add(const Category& category)
+{
+    return templateAdd(category);
+}
+Identifier FiberDataLayer::add(const ExtendedProblem& problem)
+{
+    return templateAdd(problem);
+}
+Identifier FiberDataLayer::add(const ExtendedSymptom& symptom)
+{
+    return templateAdd(symptom);
+}
+Identifier FiberDataLayer::add(const ExtendedSolution& solution)
+{
+    return templateAdd(solution);
+}
+Identifier FiberDataLayer::add(const SymptomLink& symptomLink)
+{
+    return templateAdd(symptomLink);
+}
+Identifier FiberDataLayer::add(const SolutionLink& solutionLink)
+{
+    return templateAdd(solutionLink);
+}
+Identifier FiberDataLayer::add(const Investigation& investigation)
+{
+    return templateAdd(investigation);
+}
+
+void FiberDataLayer::modify(const Category& category)
+{
+    templateModify(category);
+}
+void FiberDataLayer::modify(const ExtendedProblem& problem)
+{
+    templateModify(problem);
+}
+void FiberDataLayer::modify(const ExtendedSymptom& symptom)
+{
+    templateModify(symptom);
+}
+void FiberDataLayer::modify(const ExtendedSolution& solution)
+{
+    templateModify(solution);
+}
+void FiberDataLayer::modify(const SymptomLink& symptomLink)
+{
+    templateModify(symptomLink);
+}
+void FiberDataLayer::modify(const SolutionLink& solutionLink)
+{
+    templateModify(solutionLink);
+}
+void FiberDataLayer::modify(const Investigation& investigation)
+{
+    templateModify(investigation);
+}
+
+void FiberDataLayer::add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs)
+{
+    templateAdd(categories, newIDs);
+}
+void FiberDataLayer::add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs)
+{
+    templateAdd(problems, newIDs);
+}
+void FiberDataLayer::add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs)
+{
+    templateAdd(symptoms, newIDs);
+}
+void FiberDataLayer::add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs)
+{
+    templateAdd(solutions, newIDs);
+}
+void FiberDataLayer::add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs)
+{
+    templateAdd(symptomLinks, newIDs);
+}
+void FiberDataLayer::add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs)
+{
+    templateAdd(solutionLinks, newIDs);
+}
+
+void FiberDataLayer::modify(const std::vector<Category>& categories)
+{
+    templateModify(categories);
+}
+void FiberDataLayer::modify(const std::vector<ExtendedProblem>& problems)
+{
+    templateModify(problems);
+}
+void FiberDataLayer::modify(const std::vector<ExtendedSymptom>& symptoms)
+{
+    templateModify(symptoms);
+}
+void FiberDataLayer::modify(const std::vector<ExtendedSolution>& solutions)
+{
+    templateModify(solutions);
+}
+void FiberDataLayer::modify(const std::vector<SymptomLink>& symptomLinks)
+{
+    templateModify(symptomLinks);
+}
+void FiberDataLayer::modify(const std::vector<SolutionLink>& solutionLinks)
+{
+    templateModify(solutionLinks);
+}
+
+void FiberDataLayer::remove(const Category& category)
+{
+    templateRemove(category);
+}
+void FiberDataLayer::remove(const Problem& problem)
+{
+    templateRemove(problem);
+}
+void FiberDataLayer::remove(const Symptom& symptom)
+{
+    templateRemove(symptom);
+}
+void FiberDataLayer::remove(const Solution& solution)
+{
+    templateRemove(solution);
+}
+void FiberDataLayer::remove(const SymptomLink& symptomLink)
+{
+    templateRemove(symptomLink);
+}
+void FiberDataLayer::remove(const SolutionLink& solutionLink)
+{
+    templateRemove(solutionLink);
+}
+void FiberDataLayer::remove(const Investigation& investigation)
+{
+    templateRemove(investigation);
+}
+
+template<class T>
+void FiberDataLayer::templateGet(const std::vector<Identifier>& ids, boost::unordered_map<Identifier, T>& result,
+                                 std::vector<Identifier>* notFound)
+{
+    void (IDataLayerRead::*read)(const std::vector<Identifier>&, boost::unordered_map<Identifier, T>&, std::vector<Identifier>*) =
+        &IDataLayerRead::get;
+    
+    call(boost::bind(read, _target.get(), boost::cref(ids), boost::ref(result), notFound));
+}
+
+template<class T>
+void FiberDataLayer::templateOpenCursor(std::auto_ptr<IDataLayerCursor<T> >& cursor, unsigned batchSize)
+{
+    void (IDataLayerRead::*open)(std::auto_ptr<IDataLayerCursor<T> >&, unsigned) = &IDataLayerRead::openCursor;
+    call(boost::bind(open, _target.get(), boost::ref(cursor), batchSize));
+    
+    if(cursor.get() != NULL)
+        cursor.reset(new Cursor<T>(*this, cursor));
+}
+
+template<class T>
+Identifier FiberDataLayer::templateAdd(const T& object)
+{
+    Identifier newID;
+    call(boost::bind(&addObject<T>, _target.get(), &object, &newID));
+    
+    return newID;
+}
+
+template<class T>
+void FiberDataLayer::templateModify(const T& object)
+{
+    void (IDataLayer::*modify)(const T&) = &IDataLayer::modify;
+    call(boost::bind(modify, _target.get(), boost::cref(object)));
+}
+
+template<class T>
+void FiberDataLayer::templateAdd(const std::vector<T>& objects, std::vector<Identifier>& newIDs)
+{
+    void (IDataLayer::*add)(const std::vector<T>&, std::vector<Identifier>&) = &IDataLayer::add;
+    call(boost::bind(add, _target.get(), boost::cref(objects), boost::ref(newIDs)));
+}
+
+template<class T>
+void FiberDataLayer::templateModify(const std::vector<T>& objects)
+{
+    void (IDataLayer::*modify)(const std::vector<T>&) = &IDataLayer::modify;
+    call(boost::bind(modify, _target.get(), boost::cref(objects)));
+}
+
+template<class T>
+void FiberDataLayer::templateRemove(const T& object)
+{
+    void (IDataLayer::*remove)(const T&) = &IDataLayer::remove;
+    call(boost::bind(remove, _target.get(), boost::cref(object)));
+}
+
+/**
+ * The time the fiber is suspended is counted as its round trip time, the same as a wait for an asynchronous read
+ */
+void FiberDataLayer::offload(const boost::function<void ()>& operation)
+{
+    Call call(operation);
+    uint64_t start = utils::getMonotonicNanoseconds();
+    
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _queue.push_back(&call);
+        _queueChanged.notify_one();
+    }
+    
+    utils::FiberScheduler::suspend();
+    
+    DataLayerStatistics::addThreadRoundTripTime(utils::getMonotonicNanoseconds() - start);
+    
+    if(call.failed)
+        throw DataLayerException(call.error);
+}
+
+/**
+ * Runs the queued calls until the object is destroyed, the calls still queued then are run first
+ */
+void FiberDataLayer::ioLoop()
+{
+    while(true)
+    {
+        Call* call;
+        
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            
+            while(_queue.empty() && !_stopped)
+            {
+                _queueChanged.wait(lock);
+            }
+            
+            if(_queue.empty())
+                return;
+            
+            call = _queue.front();
+            _queue.pop_front();
+        }
+        
+        try
+        {
+            call->operation();
+        }
+        catch(std::exception& e)
+        {
+            call->failed = true;
+            call->error = e.what();
+        }
+        catch(...)
+        {
+            call->failed = true;
+            call->error = "Unknown error in the data layer";
+        }
+        
+        // the fiber can return and free the call as soon as it is resumed
+        utils::FiberScheduler::Handle fiber = call->fiber;
+        fiber.resume();
+    }
+}
+
+} // namespace ProblemSolver
@@ -0,0 +1,259 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "forwardingdatalayer.h"
+
+namespace ProblemSolver
+{
+
+ForwardingDataLayer::ForwardingDataLayer(IDataLayer* target):
+    _target(target)
+{
+}
+
+void ForwardingDataLayer::get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound)
+{
+    _target->get(categoryIDs, result, notFound);
+}
+void ForwardingDataLayer::get(const std::vector<Identifier>& problemIDs, ProblemMap& result, std::vector<Identifier>* notFound)
+{
+    _target->get(problemIDs, result, notFound);
+}
+void ForwardingDataLayer::get(const std::vector<Identifier>& symptomIDs, SymptomMap& result, std::vector<Identifier>* notFound)
+{
+    _target->get(symptomIDs, result, notFound);
+}
+void ForwardingDataLayer::get(const std::vector<Identifier>& solutionIDs, SolutionMap& result, std::vector<Identifier>* notFound)
+{
+    _target->get(solutionIDs, result, notFound);
+}
+void ForwardingDataLayer::get(const std::vector<Identifier>& symptomLinkIDs, SymptomLinkMap& result, std::vector<Identifier>* notFound)
+{
+    _target->get(symptomLinkIDs, result, notFound);
+}
+void ForwardingDataLayer::get(const std::vector<Identifier>& solutionLinkIDs, SolutionLinkMap& result, std::vector<Identifier>* notFound)
+{
+    _target->get(solutionLinkIDs, result, notFound);
+}
+void ForwardingDataLayer::get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound)
+{
+    _target->get(investigationIDs, result, notFound);
+}
+
+void ForwardingDataLayer::get(const std::vector<Identifier>& problemIDs, ExtendedProblemMap& result, std::vector<Identifier>* notFound)
+{
+    _target->get(problemIDs, result, notFound);
+}
+void ForwardingDataLayer::get(const std::vector<Identifier>& symptomIDs, ExtendedSymptomMap& result, std::vector<Identifier>* notFound)
+{
+    _target->get(symptomIDs, result, notFound);
+}
+void ForwardingDataLayer::get(const std::vector<Identifier>& solutionIDs, ExtendedSolutionMap& result, std::vector<Identifier>* notFound)
+{
+    _target->get(solutionIDs, result, notFound);
+}
+
+void ForwardingDataLayer::getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found)
+{
+    _target->getLinksByProblem(problemID, result, found);
+}
+
+void ForwardingDataLayer::getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found)
+{
+    _target->getLinksBySymptom(symptomID, result, found);
+}
+
+void ForwardingDataLayer::getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found)
+{
+    _target->getLinksByProblem(problemID, result, found);
+}
+
+void ForwardingDataLayer::getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found)
+{
+    _target->getLinksBySolution(solutionID, result, found);
+}
+
+void ForwardingDataLayer::openCursor(CategoryCursor& cursor, unsigned batchSize)
+{
+    _target->openCursor(cursor, batchSize);
+}
+void ForwardingDataLayer::openCursor(ProblemCursor& cursor, unsigned batchSize)
+{
+    _target->openCursor(cursor, batchSize);
+}
+void ForwardingDataLayer::openCursor(SymptomCursor& cursor, unsigned batchSize)
+{
+    _target->openCursor(cursor, batchSize);
+}
+void ForwardingDataLayer::openCursor(SolutionCursor& cursor, unsigned batchSize)
+{
+    _target->openCursor(cursor, batchSize);
+}
+void ForwardingDataLayer::openCursor(SymptomLinkCursor& cursor, unsigned batchSize)
+{
+    _target->openCursor(cursor, batchSize);
+}
+void ForwardingDataLayer::openCursor(SolutionLinkCursor& cursor, unsigned batchSize)
+{
+    _target->openCursor(cursor, batchSize);
+}
+void ForwardingDataLayer::openCursor(InvestigationCursor& cursor, unsigned batchSize)
+{
+    _target->openCursor(cursor, batchSize);
+}
+
+void ForwardingDataLayer::openCursor(ExtendedProblemCursor& cursor, unsigned batchSize)
+{
+    _target->openCursor(cursor, batchSize);
+}
+void ForwardingDataLayer::openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize)
+{
+    _target->openCursor(cursor, batchSize);
+}
+void ForwardingDataLayer::openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize)
+{
+    _target->openCursor(cursor, batchSize);
+}
+
+Identifier ForwardingDataLayer::add(const Category& category)
+{
+    return _target->add(category);
+}
+Identifier ForwardingDataLayer::add(const ExtendedProblem& problem)
+{
+    return _target->add(problem);
+}
+Identifier ForwardingDataLayer::add(const ExtendedSymptom& symptom)
+{
+    return _target->add(symptom);
+}
+Identifier ForwardingDataLayer::add(const ExtendedSolution& solution)
+{
+    return _target->add(solution);
+}
+Identifier ForwardingDataLayer::add(const SymptomLink& symptomLink)
+{
+    return _target->add(symptomLink);
+}
+Identifier ForwardingDataLayer::add(const SolutionLink& solutionLink)
+{
+    return _target->add(solutionLink);
+}
+Identifier ForwardingDataLayer::add(const Investigation& investigation)
+{
+    return _target->add(investigation);
+}
+
+void ForwardingDataLayer::modify(const Category& category)
+{
+    _target->modify(category);
+}
+void ForwardingDataLayer::modify(const ExtendedProblem& problem)
+{
+    _target->modify(problem);
+}
+void ForwardingDataLayer::modify(const ExtendedSymptom& symptom)
+{
+    _target->modify(symptom);
+}
+void ForwardingDataLayer::modify(const ExtendedSolution& solution)
+{
+    _target->modify(solution);
+}
+void ForwardingDataLayer::modify(const SymptomLink& symptomLink)
+{
+    _target->modify(symptomLink);
+}
+void ForwardingDataLayer::modify(const SolutionLink& solutionLink)
+{
+    _target->modify(solutionLink);
+}
+void ForwardingDataLayer::modify(const Investigation& investigation)
+{
+    _target->modify(investigation);
+}
+
+void ForwardingDataLayer::add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs)
+{
+    _target->add(categories, newIDs);
+}
+void ForwardingDataLayer::add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs)
+{
+    _target->add(problems, newIDs);
+}
+void ForwardingDataLayer::add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs)
+{
+    _target->add(symptoms, newIDs);
+}
+void ForwardingDataLayer::add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs)
+{
+    _target->add(solutions, newIDs);
+}
+void ForwardingDataLayer::add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs)
+{
+    _target->add(symptomLinks, newIDs);
+}
+void ForwardingDataLayer::add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs)
+{
+    _target->add(solutionLinks, newIDs);
+}
+
+void ForwardingDataLayer::modify(const std::vector<Category>& categories)
+{
+    _target->modify(categories);
+}
+void ForwardingDataLayer::modify(const std::vector<ExtendedProblem>& problems)
+{
+    _target->modify(problems);
+}
+void ForwardingDataLayer::modify(const std::vector<ExtendedSymptom>& symptoms)
+{
+    _target->modify(symptoms);
+}
+void ForwardingDataLayer::modify(const std::vector<ExtendedSolution>& solutions)
+{
+    _target->modify(solutions);
+}
+void ForwardingDataLayer::modify(const std::vector<SymptomLink>& symptomLinks)
+{
+    _target->modify(symptomLinks);
+}
+void ForwardingDataLayer::modify(const std::vector<SolutionLink>& solutionLinks)
+{
+    _target->modify(solutionLinks);
+}
+
+void ForwardingDataLayer::remove(const Category& category)
+{
+    _target->remove(category);
+}
+void ForwardingDataLayer::remove(const Problem& problem)
+{
+    _target->remove(problem);
+}
+void ForwardingDataLayer::remove(const Symptom& symptom)
+{
+    _target->remove(symptom);
+}
+void ForwardingDataLayer::remove(const Solution& solution)
+{
+    _target->remove(solution);
+}
+void ForwardingDataLayer::remove(const SymptomLink& symptomLink)
+{
+    _target->remove(symptomLink);
+}
+void ForwardingDataLayer::remove(const SolutionLink& solutionLink)
+{
+    _target->remove(solutionLink);
+}
+void ForwardingDataLayer::remove(const Investigation& investigation)
+{
+    _target->remove(investigation);
+}
+
+} // namespace ProblemSolver
@@ -6,147 +6,595 @@
  */
 
 #include "memorydatalayer.h"
+#include "identifiercursor.h"
+
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#include <boost/format.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread/locks.hpp>
 
 namespace ProblemSolver
 {
 
+typedef boost::shared_lock<boost::shared_mutex> ReadLock;
+typedef boost::unique_lock<boost::shared_mutex> WriteLock;
+
+MemoryDataLayer::MemoryDataLayer():
+    _identifierSeed(static_cast<unsigned>(getpid()) ^ static_cast<unsigned>(time(NULL))),
+    _identifierCounter(0)
+{
+}
+
 void MemoryDataLayer::get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet(categoryIDs, _categories, result, notFound, "category");
 }
 void MemoryDataLayer::get(const std::vector<Identifier>& problemIDs, ProblemMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet(problemIDs, _problems, result, notFound, "problem");
 }
 void MemoryDataLayer::get(const std::vector<Identifier>& symptomIDs, SymptomMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet(symptomIDs, _symptoms, result, notFound, "symptom");
 }
 void MemoryDataLayer::get(const std::vector<Identifier>& solutionIDs, SolutionMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet(solutionIDs, _solutions, result, notFound, "solution");
+}
+void MemoryDataLayer::get(const std::vector<Identifier>& symptomLinkIDs, SymptomLinkMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(symptomLinkIDs, _symptomLinks, result, notFound, "symptomLink");
+}
+void MemoryDataLayer::get(const std::vector<Identifier>& solutionLinkIDs, SolutionLinkMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(solutionLinkIDs, _solutionLinks, result, notFound, "solutionLink");
 }
 void MemoryDataLayer::get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet(investigationIDs, _investigations, result, notFound, "investigation");
 }
-    
+
 void MemoryDataLayer::get(const std::vector<Identifier>& problemIDs, ExtendedProblemMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet(problemIDs, _problems, result, notFound, "problem");
 }
 void MemoryDataLayer::get(const std::vector<Identifier>& symptomIDs, ExtendedSymptomMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet(symptomIDs, _symptoms, result, notFound, "symptom");
 }
 void MemoryDataLayer::get(const std::vector<Identifier>& solutionIDs, ExtendedSolutionMap& result, std::vector<Identifier>* notFound)
 {
-    
+    templateGet(solutionIDs, _solutions, result, notFound, "solution");
 }
-    
+
 void MemoryDataLayer::getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found)
 {
-    
+    templateGetLinks(problemID, _symptomLinksByProblem, _symptomLinks, &SymptomLink::symptomID, result, found);
 }
 void MemoryDataLayer::getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found)
 {
-    
+    templateGetLinks(symptomID, _symptomLinksBySymptom, _symptomLinks, &SymptomLink::problemID, result, found);
 }
-    
+
 void MemoryDataLayer::getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found)
 {
-    
+    templateGetLinks(problemID, _solutionLinksByProblem, _solutionLinks, &SolutionLink::solutionID, result, found);
 }
 void MemoryDataLayer::getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found)
 {
-    
+    templateGetLinks(solutionID, _solutionLinksBySolution, _solutionLinks, &SolutionLink::problemID, result, found);
+}
+
+void MemoryDataLayer::openCursor(CategoryCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(_categories, cursor, batchSize);
+}
+void MemoryDataLayer::openCursor(ProblemCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(_problems, cursor, batchSize);
+}
+void MemoryDataLayer::openCursor(SymptomCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(_symptoms, cursor, batchSize);
+}
+void MemoryDataLayer::openCursor(SolutionCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(_solutions, cursor, batchSize);
+}
+void MemoryDataLayer::openCursor(SymptomLinkCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(_symptomLinks, cursor, batchSize);
+}
+void MemoryDataLayer::openCursor(SolutionLinkCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(_solutionLinks, cursor, batchSize);
+}
+void MemoryDataLayer::openCursor(InvestigationCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(_investigations, cursor, batchSize);
+}
+
+void MemoryDataLayer::openCursor(ExtendedProblemCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(_problems, cursor, batchSize);
+}
+void MemoryDataLayer::openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(_symptoms, cursor, batchSize);
+}
+void MemoryDataLayer::openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(_solutions, cursor, batchSize);
 }
 
 Identifier MemoryDataLayer::add(const Category& category)
 {
-    return "";
+    return templateAdd(category, _categories);
 }
 Identifier MemoryDataLayer::add(const ExtendedProblem& problem)
 {
-    return "";
+    return templateAdd(problem, _problems);
 }
 Identifier MemoryDataLayer::add(const ExtendedSymptom& symptom)
 {
-    return "";
+    return templateAdd(symptom, _symptoms);
 }
 Identifier MemoryDataLayer::add(const ExtendedSolution& solution)
 {
-    return "";
+    return templateAdd(solution, _solutions);
 }
 Identifier MemoryDataLayer::add(const SymptomLink& symptomLink)
 {
-    return "";
+    WriteLock lock(_mutex);
+    
+    SymptomLink newLink = symptomLink;
+    newLink.id = generateIdentifier();
+    storeLink(newLink);
+    
+    return newLink.id;
 }
 Identifier MemoryDataLayer::add(const SolutionLink& solutionLink)
 {
-    return "";
+    WriteLock lock(_mutex);
+    
+    SolutionLink newLink = solutionLink;
+    newLink.id = generateIdentifier();
+    storeLink(newLink);
+    
+    return newLink.id;
 }
-Identifier MemoryDataLayer::add(const Investigation& solutionLink)
+Identifier MemoryDataLayer::add(const Investigation& investigation)
 {
-    return "";
+    return templateAdd(investigation, _investigations);
 }
 
 void MemoryDataLayer::modify(const Category& category)
 {
-    
+    templateModify(category, _categories);
 }
 void MemoryDataLayer::modify(const ExtendedProblem& problem)
 {
-    
+    templateModify(problem, _problems);
 }
 void MemoryDataLayer::modify(const ExtendedSymptom& symptom)
 {
-    
+    templateModify(symptom, _symptoms);
 }
 void MemoryDataLayer::modify(const ExtendedSolution& solution)
 {
-    
+    templateModify(solution, _solutions);
 }
 void MemoryDataLayer::modify(const SymptomLink& symptomLink)
 {
-    
+    WriteLock lock(_mutex);
+    storeLink(symptomLink);
 }
 void MemoryDataLayer::modify(const SolutionLink& solutionLink)
 {
+    WriteLock lock(_mutex);
+    storeLink(solutionLink);
+}
+void MemoryDataLayer::modify(const Investigation& investigation)
+{
+    templateModify(investigation, _investigations);
+}
+
+void MemoryDataLayer::add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs)
+{
+    templateAdd(categories, _categories, newIDs);
+}
+void MemoryDataLayer::add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs)
+{
+    templateAdd(problems, _problems, newIDs);
+}
+void MemoryDataLayer::add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs)
+{
+    templateAdd(symptoms, _symptoms, newIDs);
+}
+void MemoryDataLayer::add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs)
+{
+    templateAdd(solutions, _solutions, newIDs);
+}
+void MemoryDataLayer::add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs)
+{
+    WriteLock lock(_mutex);
+    
+    newIDs.reserve(newIDs.size() + symptomLinks.size());
+    
+    BOOST_FOREACH(const SymptomLink& symptomLink, symptomLinks)
+    {
+        SymptomLink newLink = symptomLink;
+        newLink.id = generateIdentifier();
+        storeLink(newLink);
+        
+        newIDs.push_back(newLink.id);
+    }
+}
+void MemoryDataLayer::add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs)
+{
+    WriteLock lock(_mutex);
     
+    newIDs.reserve(newIDs.size() + solutionLinks.size());
+    
+    BOOST_FOREACH(const SolutionLink& solutionLink, solutionLinks)
+    {
+        SolutionLink newLink = solutionLink;
+        newLink.id = generateIdentifier();
+        storeLink(newLink);
+        
+        newIDs.push_back(newLink.id);
+    }
+}
+
+void MemoryDataLayer::modify(const std::vector<Category>& categories)
+{
+    templateModify(categories, _categories);
+}
+void MemoryDataLayer::modify(const std::vector<ExtendedProblem>& problems)
+{
+    templateModify(problems, _problems);
+}
+void MemoryDataLayer::modify(const std::vector<ExtendedSymptom>& symptoms)
+{
+    templateModify(symptoms, _symptoms);
+}
+void MemoryDataLayer::modify(const std::vector<ExtendedSolution>& solutions)
+{
+    templateModify(solutions, _solutions);
 }
-void MemoryDataLayer::modify(const Investigation& solutionLink)
+void MemoryDataLayer::modify(const std::vector<SymptomLink>& symptomLinks)
 {
+    WriteLock lock(_mutex);
     
+    BOOST_FOREACH(const SymptomLink& symptomLink, symptomLinks)
+    {
+        storeLink(symptomLink);
+    }
+}
+void MemoryDataLayer::modify(const std::vector<SolutionLink>& solutionLinks)
+{
+    WriteLock lock(_mutex);
+    
+    BOOST_FOREACH(const SolutionLink& solutionLink, solutionLinks)
+    {
+        storeLink(solutionLink);
+    }
 }
 
 void MemoryDataLayer::remove(const Category& category)
 {
-    
+    WriteLock lock(_mutex);
+    _categories.erase(category.id);
 }
 void MemoryDataLayer::remove(const Problem& problem)
 {
+    WriteLock lock(_mutex);
+    _problems.erase(problem.id);
+    
+    // remove all links to the problem just like the other data layers
+    LinkIndex::iterator symptomLinks = _symptomLinksByProblem.find(problem.id);
+    if(symptomLinks != _symptomLinksByProblem.end())
+    {
+        std::vector<Identifier> linkIDs(symptomLinks->second.begin(), symptomLinks->second.end());
+        BOOST_FOREACH(CIdentifier linkID, linkIDs)
+        {
+            removeSymptomLink(linkID);
+        }
+    }
     
+    LinkIndex::iterator solutionLinks = _solutionLinksByProblem.find(problem.id);
+    if(solutionLinks != _solutionLinksByProblem.end())
+    {
+        std::vector<Identifier> linkIDs(solutionLinks->second.begin(), solutionLinks->second.end());
+        BOOST_FOREACH(CIdentifier linkID, linkIDs)
+        {
+            removeSolutionLink(linkID);
+        }
+    }
 }
 void MemoryDataLayer::remove(const Symptom& symptom)
 {
+    WriteLock lock(_mutex);
+    _symptoms.erase(symptom.id);
     
+    LinkIndex::iterator symptomLinks = _symptomLinksBySymptom.find(symptom.id);
+    if(symptomLinks != _symptomLinksBySymptom.end())
+    {
+        std::vector<Identifier> linkIDs(symptomLinks->second.begin(), symptomLinks->second.end());
+        BOOST_FOREACH(CIdentifier linkID, linkIDs)
+        {
+            removeSymptomLink(linkID);
+        }
+    }
 }
 void MemoryDataLayer::remove(const Solution& solution)
 {
+    WriteLock lock(_mutex);
+    _solutions.erase(solution.id);
     
+    LinkIndex::iterator solutionLinks = _solutionLinksBySolution.find(solution.id);
+    if(solutionLinks != _solutionLinksBySolution.end())
+    {
+        std::vector<Identifier> linkIDs(solutionLinks->second.begin(), solutionLinks->second.end());
+        BOOST_FOREACH(CIdentifier linkID, linkIDs)
+        {
+            removeSolutionLink(linkID);
+        }
+    }
 }
 void MemoryDataLayer::remove(const SymptomLink& symptomLink)
 {
-    
+    WriteLock lock(_mutex);
+    removeSymptomLink(symptomLink.id);
 }
 void MemoryDataLayer::remove(const SolutionLink& solutionLink)
 {
+    WriteLock lock(_mutex);
+    removeSolutionLink(solutionLink.id);
+}
+void MemoryDataLayer::remove(const Investigation& investigation)
+{
+    WriteLock lock(_mutex);
+    _investigations.erase(investigation.id);
+}
+
+/**
+ * Copies the requested objects into result. T can be a child of Y, in that case only the Y part is copied.
+ */
+template<class T, class Y>
+void MemoryDataLayer::templateGet(const std::vector<Identifier>& ids, const boost::unordered_map<Identifier, T>& objects,
+                                  boost::unordered_map<Identifier, Y>& result, std::vector<Identifier>* notFound, const char* objectName)
+{
+    typedef boost::unordered_map<Identifier, T> ObjectMap;
+    
+    ReadLock lock(_mutex);
+    
+    if(ids.empty())
+    {
+        BOOST_FOREACH(const typename ObjectMap::value_type& pair, objects)
+        {
+            result[pair.first] = pair.second;
+        }
+        
+        return;
+    }
+    
+    BOOST_FOREACH(CIdentifier id, ids)
+    {
+        typename ObjectMap::const_iterator it = objects.find(id);
+        if(it != objects.end())
+        {
+            result[id] = it->second;
+        }
+        else if(notFound == NULL)
+        {
+            throw Exception((boost::format("Missing ID %s of %s") % id % objectName).str());
+        }
+        else
+        {
+            notFound->push_back(id);
+        }
+    }
+}
+
+/**
+ * Copies all links of an object into result organizing them by the ID of the object at the other end of the link
+ */
+template<class T>
+void MemoryDataLayer::templateGetLinks(CIdentifier byId, const LinkIndex& index, const boost::unordered_map<Identifier, T>& links,
+                                       Identifier T::* organizeField, boost::unordered_map<Identifier, T>& result, bool* found)
+{
+    ReadLock lock(_mutex);
     
+    LinkIndex::const_iterator linkIDs = index.find(byId);
+    if(linkIDs != index.end())
+    {
+        BOOST_FOREACH(CIdentifier linkID, linkIDs->second)
+        {
+            const T& link = links.find(linkID)->second;
+            result[link.*organizeField] = link;
+        }
+    }
+    
+    // having no links is not an error, same as in the other data layers
+    if(found != NULL)
+        *found = true;
 }
-void MemoryDataLayer::remove(const Investigation& solutionLink)
+
+/**
+ * Opens a cursor over the IDs present at the moment, objects are copied only when their batch is read
+ */
+template<class T, class Y>
+void MemoryDataLayer::templateOpenCursor(const boost::unordered_map<Identifier, T>& objects, std::auto_ptr<IDataLayerCursor<Y> >& cursor, unsigned batchSize)
+{
+    typedef boost::unordered_map<Identifier, T> ObjectMap;
+    
+    std::vector<Identifier> ids;
+    
+    {
+        ReadLock lock(_mutex);
+        
+        ids.reserve(objects.size());
+        BOOST_FOREACH(const typename ObjectMap::value_type& pair, objects)
+        {
+            ids.push_back(pair.first);
+        }
+    }
+    
+    cursor.reset(new IdentifierCursor<Y>(*this, ids, batchSize));
+}
+
+template<class T>
+Identifier MemoryDataLayer::templateAdd(const T& object, boost::unordered_map<Identifier, T>& objects)
+{
+    WriteLock lock(_mutex);
+    
+    Identifier newIdentifier = generateIdentifier();
+    
+    T& newObject = objects[newIdentifier];
+    newObject = object;
+    newObject.id = newIdentifier;
+    
+    return newIdentifier;
+}
+
+template<class T>
+void MemoryDataLayer::templateModify(const T& object, boost::unordered_map<Identifier, T>& objects)
+{
+    WriteLock lock(_mutex);
+    objects[object.id] = object;
+}
+
+/**
+ * All objects of a bulk add are stored under one lock
+ */
+template<class T>
+void MemoryDataLayer::templateAdd(const std::vector<T>& newObjects, boost::unordered_map<Identifier, T>& objects, std::vector<Identifier>& newIDs)
+{
+    WriteLock lock(_mutex);
+    
+    newIDs.reserve(newIDs.size() + newObjects.size());
+    
+    BOOST_FOREACH(const T& object, newObjects)
+    {
+        Identifier newIdentifier = generateIdentifier();
+        
+        T& newObject = objects[newIdentifier];
+        newObject = object;
+        newObject.id = newIdentifier;
+        
+        newIDs.push_back(newIdentifier);
+    }
+}
+
+template<class T>
+void MemoryDataLayer::templateModify(const std::vector<T>& changedObjects, boost::unordered_map<Identifier, T>& objects)
+{
+    WriteLock lock(_mutex);
+    
+    BOOST_FOREACH(const T& object, changedObjects)
+    {
+        objects[object.id] = object;
+    }
+}
+
+/**
+ * Generates a new unique identifier laid out like the MongoDB object ID's: time, seed and counter, big endian.
+ * Must be called while holding the write lock.
+ */
+Identifier MemoryDataLayer::generateIdentifier()
+{
+    uint32_t parts[3] = { static_cast<uint32_t>(time(NULL)), _identifierSeed, ++_identifierCounter };
+    
+    Identifier result;
+    unsigned char* bytes = result.getBytes();
+    for(unsigned i = 0; i < Identifier::SIZE; ++i)
+    {
+        bytes[i] = static_cast<unsigned char>(parts[i / 4] >> (24 - 8 * (i % 4)));
+    }
+    
+    return result;
+}
+
+/**
+ * Saves the link and updates all indexes. Must be called while holding the write lock.
+ */
+void MemoryDataLayer::storeLink(const SymptomLink& symptomLink)
+{
+    SymptomLinkMap::iterator it = _symptomLinks.find(symptomLink.id);
+    if(it != _symptomLinks.end())
+    {
+        removeFromIndex(_symptomLinksByProblem, it->second.problemID, symptomLink.id);
+        removeFromIndex(_symptomLinksBySymptom, it->second.symptomID, symptomLink.id);
+    }
+    
+    _symptomLinks[symptomLink.id] = symptomLink;
+    addToIndex(_symptomLinksByProblem, symptomLink.problemID, symptomLink.id);
+    addToIndex(_symptomLinksBySymptom, symptomLink.symptomID, symptomLink.id);
+}
+
+/**
+ * Saves the link and updates all indexes. Must be called while holding the write lock.
+ */
+void MemoryDataLayer::storeLink(const SolutionLink& solutionLink)
+{
+    SolutionLinkMap::iterator it = _solutionLinks.find(solutionLink.id);
+    if(it != _solutionLinks.end())
+    {
+        removeFromIndex(_solutionLinksByProblem, it->second.problemID, solutionLink.id);
+        removeFromIndex(_solutionLinksBySolution, it->second.solutionID, solutionLink.id);
+    }
+    
+    _solutionLinks[solutionLink.id] = solutionLink;
+    addToIndex(_solutionLinksByProblem, solutionLink.problemID, solutionLink.id);
+    addToIndex(_solutionLinksBySolution, solutionLink.solutionID, solutionLink.id);
+}
+
+/**
+ * Removes the link and its index entries. Must be called while holding the write lock.
+ */
+void MemoryDataLayer::removeSymptomLink(CIdentifier symptomLinkID)
+{
+    SymptomLinkMap::iterator it = _symptomLinks.find(symptomLinkID);
+    if(it == _symptomLinks.end())
+        return;
+    
+    removeFromIndex(_symptomLinksByProblem, it->second.problemID, symptomLinkID);
+    removeFromIndex(_symptomLinksBySymptom, it->second.symptomID, symptomLinkID);
+    _symptomLinks.erase(it);
+}
+
+/**
+ * Removes the link and its index entries. Must be called while holding the write lock.
+ */
+void MemoryDataLayer::removeSolutionLink(CIdentifier solutionLinkID)
+{
+    SolutionLinkMap::iterator it = _solutionLinks.find(solutionLinkID);
+    if(it == _solutionLinks.end())
+        return;
+    
+    removeFromIndex(_solutionLinksByProblem, it->second.problemID, solutionLinkID);
+    removeFromIndex(_solutionLinksBySolution, it->second.solutionID, solutionLinkID);
+    _solutionLinks.erase(it);
+}
+
+void MemoryDataLayer::addToIndex(LinkIndex& index, CIdentifier objectID, CIdentifier linkID)
+{
+    index[objectID].insert(linkID);
+}
+
+void MemoryDataLayer::removeFromIndex(LinkIndex& index, CIdentifier objectID, CIdentifier linkID)
 {
+    LinkIndex::iterator it = index.find(objectID);
+    if(it == index.end())
+        return;
     
+    it->second.erase(linkID);
+    if(it->second.empty())
+        index.erase(it);
 }
 
 } // namespace ProblemSolver
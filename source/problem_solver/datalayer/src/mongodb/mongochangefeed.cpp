@@ -0,0 +1,171 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "mongochangefeed.h"
+
+#include "mongoconnection.h"
+#include "logger.h"
+
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace mongo;
+
+namespace ProblemSolver
+{
+
+const long long MongoChangeFeed::DEFAULT_COLLECTION_SIZE;
+
+MongoChangeFeed::MongoChangeFeed(const std::string& connectionString, const std::string& database, long long collectionSize):
+    _connectionString(connectionString),
+    _collection(database + ".changes")
+{
+    try
+    {
+        MongoConnection connection(_connectionString);
+        
+        // does nothing if the collection already exists
+        connection->createCollection(_collection, collectionSize, true);
+        
+        auto_ptr<DBClientCursor> lastChange = connection->query(_collection, Query().sort("$natural", -1), 1);
+        if(lastChange.get() && lastChange->more())
+            _lastId = lastChange->nextSafe()["_id"].__oid().str();
+        
+        connection.done();
+    }
+    catch(std::exception& e)
+    {
+        utils::Logger::log(utils::logError, "Error opening Mongo change feed %s! Error: %s", _collection.c_str(), e.what());
+        throw Exception(e.what());
+    }
+}
+
+MongoChangeFeed::~MongoChangeFeed()
+{
+    closeCursor();
+}
+
+void MongoChangeFeed::publish(const std::vector<DataChange>& changes)
+{
+    if(changes.empty())
+        return;
+    
+    std::vector<BSONObj> records;
+    BOOST_FOREACH(const DataChange& change, changes)
+    {
+        BSONObjBuilder record;
+        record.append("_id", OID::gen());
+        record.append("operation", std::string(DataChange::toString(change.operation)));
+        record.append("type", std::string(DataChange::toString(change.objectType)));
+        record.append("objectID", change.id.toString());
+        
+        records.push_back(record.obj());
+    }
+    
+    try
+    {
+        MongoConnection connection(_connectionString);
+        
+        connection->insert(_collection, records);
+        
+        connection.done();
+    }
+    catch(std::exception& e)
+    {
+        utils::Logger::log(utils::logError, "Error publishing changes to Mongo collection %s! Error: %s", _collection.c_str(), e.what());
+        throw Exception(e.what());
+    }
+}
+
+bool MongoChangeFeed::read(std::vector<DataChange>& changes, unsigned timeout)
+{
+    size_t startCount = changes.size();
+    
+    try
+    {
+        if(_cursor.get() == NULL)
+            openCursor();
+        
+        // with AwaitData the server holds more() for a while when there is nothing new,
+        // after the first document only what is already received is taken
+        if(_cursor->more())
+        {
+            do
+            {
+                BSONObj record = _cursor->nextSafe();
+                _lastId = record["_id"].__oid().str();
+                
+                DataChange change;
+                if(!Identifier::parse(record["objectID"].String(), change.id) ||
+                   !DataChange::fromString(record["operation"].String(), change.operation) ||
+                   !DataChange::fromString(record["type"].String(), change.objectType))
+                {
+                    utils::Logger::log(utils::logError, "Invalid change %s in Mongo collection %s", _lastId.c_str(), _collection.c_str());
+                    continue;
+                }
+                
+                changes.push_back(change);
+            }
+            while(_cursor->objsLeftInBatch() > 0);
+        }
+        
+        // e.g. the collection was empty when the cursor was opened
+        if(_cursor->isDead())
+            closeCursor();
+    }
+    catch(std::exception& e)
+    {
+        closeCursor();
+        
+        utils::Logger::log(utils::logError, "Error reading changes from Mongo collection %s! Error: %s", _collection.c_str(), e.what());
+        throw Exception(e.what());
+    }
+    
+    // a new cursor would return immediately, so wait here to avoid reopening it all the time
+    if(changes.size() == startCount && _cursor.get() == NULL && timeout > 0)
+        boost::this_thread::sleep(boost::posix_time::milliseconds(timeout));
+    
+    return changes.size() > startCount;
+}
+
+void MongoChangeFeed::openCursor()
+{
+    _readConnection.reset(new MongoConnection(_connectionString));
+    
+    Query query;
+    if(!_lastId.empty())
+    {
+        OID lastId;
+        lastId.init(_lastId);
+        query = Query(BSON("_id" << BSON(GT << lastId)));
+    }
+    
+    _cursor = (*_readConnection)->query(_collection, query, 0, 0, NULL, QueryOption_CursorTailable | QueryOption_AwaitData);
+    
+    if(!_cursor.get()) // it is possible to get here if the connection with the server breaks while executing the query
+    {
+        _readConnection.reset();
+        
+        utils::Logger::log(utils::logError, "Mongo server has gone away!");
+        throw Exception("Mongo server has gone away!");
+    }
+}
+
+/**
+ * A connection with a live cursor is not returned to the pool, it is closed
+ */
+void MongoChangeFeed::closeCursor()
+{
+    if(_readConnection.get() != NULL && _cursor.get() != NULL && _cursor->isDead())
+        _readConnection->done();
+    
+    _cursor.reset();
+    _readConnection.reset();
+}
+
+} // namespace ProblemSolver
@@ -8,7 +8,10 @@
 #include "mongodbdatalayer.h"
 
 #include "mongoconnection.h"
+#include "datalayerstatistics.h"
+#include "logger.h"
 
+#include <algorithm>
 #include <boost/format.hpp>
 #include <boost/foreach.hpp>
 
@@ -17,6 +20,113 @@ using namespace mongo;
 namespace ProblemSolver
 {
 
+namespace
+{
+
+/**
+ * Identifiers are stored in the database in their text form
+ */
+template<class T>
+void appendIdentifiers(BSONObjBuilder& builder, const std::string& name, const T& ids)
+{
+    std::vector<std::string> texts;
+    texts.reserve(ids.size());
+    
+    BOOST_FOREACH(CIdentifier id, ids)
+    {
+        texts.push_back(id.toString());
+    }
+    
+    builder.append(name, texts);
+}
+
+} // anonymous namespace
+
+/**
+ * Cursor that keeps its Mongo connection open until all records of a collection are read
+ */
+template<class T>
+class MongoDbDataLayer::Cursor: public IDataLayerCursor<T>
+{
+public:
+    
+    Cursor(MongoDbDataLayer& dataLayer, const std::string& collection, unsigned batchSize);
+    virtual ~Cursor(){}
+    
+public:
+    
+    virtual bool next(boost::unordered_map<Identifier, T>& result);
+    
+private:
+    
+    MongoDbDataLayer& _dataLayer;
+    std::string _collection;
+    unsigned _batchSize;
+    
+    MongoConnection _connection;
+    auto_ptr<DBClientCursor> _dbRecords;
+};
+
+template<class T>
+MongoDbDataLayer::Cursor<T>::Cursor(MongoDbDataLayer& dataLayer, const std::string& collection, unsigned batchSize):
+    _dataLayer(dataLayer),
+    _collection(collection),
+    _batchSize(batchSize > 0 ? batchSize : 1),
+    _connection(dataLayer._connectionString)
+{
+    DataLayerStatistics::RoundTrip roundTrip;
+    _dbRecords = _connection->query(_collection, Query(), 0, 0, NULL, 0, _batchSize);
+    
+    if(!_dbRecords.get()) // it is possible to get here if the connection with the server breaks while executing the query
+    {
+        utils::Logger::log(utils::logError, "Mongo server has gone away!");
+        throw Exception("Mongo server has gone away!");
+    }
+}
+
+template<class T>
+bool MongoDbDataLayer::Cursor<T>::next(boost::unordered_map<Identifier, T>& result)
+{
+    result.clear();
+    
+    if(!_dbRecords.get())
+        return false;
+    
+    try
+    {
+        DataLayerStatistics::RoundTrip roundTrip;
+        
+        while(result.size() < _batchSize && _dbRecords->more())
+        {
+            BSONObj singleRecord = _dbRecords->nextSafe();
+            Identifier id(singleRecord["_id"].String());
+            
+            _dataLayer.readBsonRecord(result[id], singleRecord);
+        }
+        
+        if(!_dbRecords->more())
+        {
+            // the whole collection is read, the connection can go back to the pool
+            _dbRecords.reset();
+            _connection.done();
+        }
+    }
+    catch(std::exception& e)
+    {
+        utils::Logger::log(utils::logError, "Error reading records from Mongo collection %s! Error: %s", _collection.c_str(), e.what());
+        throw Exception(e.what());
+    }
+    catch(...)
+    {
+        utils::Logger::log(utils::logError, "Error reading records from Mongo!");
+        throw Exception("Error reading records from Mongo");
+    }
+    
+    return !result.empty();
+}
+
+const unsigned MongoDbDataLayer::BULK_WRITE_SIZE;
+
 MongoDbDataLayer::MongoDbDataLayer(const std::string& connectionString, const std::string& database):
     _connectionString(connectionString)
 {
@@ -92,9 +202,51 @@ void MongoDbDataLayer::getLinksBySolution(Identifier solutionID, ProblemsWithSam
     templateGetLinks(solutionID, "solutionID", "problemID", result, found, _solutionLinksCollection);
 }
 
+void MongoDbDataLayer::openCursor(CategoryCursor& cursor, unsigned batchSize)
+{
+    cursor.reset(new Cursor<Category>(*this, _categoryCollection, batchSize));
+}
+void MongoDbDataLayer::openCursor(ProblemCursor& cursor, unsigned batchSize)
+{
+    cursor.reset(new Cursor<Problem>(*this, _problemCollection, batchSize));
+}
+void MongoDbDataLayer::openCursor(SymptomCursor& cursor, unsigned batchSize)
+{
+    cursor.reset(new Cursor<Symptom>(*this, _symptomCollection, batchSize));
+}
+void MongoDbDataLayer::openCursor(SolutionCursor& cursor, unsigned batchSize)
+{
+    cursor.reset(new Cursor<Solution>(*this, _solutionCollection, batchSize));
+}
+void MongoDbDataLayer::openCursor(SymptomLinkCursor& cursor, unsigned batchSize)
+{
+    cursor.reset(new Cursor<SymptomLink>(*this, _symptomLinksCollection, batchSize));
+}
+void MongoDbDataLayer::openCursor(SolutionLinkCursor& cursor, unsigned batchSize)
+{
+    cursor.reset(new Cursor<SolutionLink>(*this, _solutionLinksCollection, batchSize));
+}
+void MongoDbDataLayer::openCursor(InvestigationCursor& cursor, unsigned batchSize)
+{
+    cursor.reset(new Cursor<Investigation>(*this, _investigationCollection, batchSize));
+}
+
+void MongoDbDataLayer::openCursor(ExtendedProblemCursor& cursor, unsigned batchSize)
+{
+    cursor.reset(new Cursor<ExtendedProblem>(*this, _problemCollection, batchSize));
+}
+void MongoDbDataLayer::openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize)
+{
+    cursor.reset(new Cursor<ExtendedSymptom>(*this, _symptomCollection, batchSize));
+}
+void MongoDbDataLayer::openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize)
+{
+    cursor.reset(new Cursor<ExtendedSolution>(*this, _solutionCollection, batchSize));
+}
+
 Identifier MongoDbDataLayer::add(const Category& category)
 {
-    Identifier newIdentifier = OID::gen().str();
+    Identifier newIdentifier(OID::gen().str());
     
     BSONObjBuilder builder;
     makeBson(category, builder, &newIdentifier);
@@ -104,7 +256,7 @@ Identifier MongoDbDataLayer::add(const Category& category)
 }
 Identifier MongoDbDataLayer::add(const ExtendedProblem& problem)
 {
-    Identifier newIdentifier = OID::gen().str();
+    Identifier newIdentifier(OID::gen().str());
     
     BSONObjBuilder builder;
     makeExtendedInfo(problem, builder, &newIdentifier);
@@ -114,7 +266,7 @@ Identifier MongoDbDataLayer::add(const ExtendedProblem& problem)
 }
 Identifier MongoDbDataLayer::add(const ExtendedSymptom& symptom)
 {
-    Identifier newIdentifier = OID::gen().str();
+    Identifier newIdentifier(OID::gen().str());
     
     BSONObjBuilder builder;
     makeExtendedInfo(symptom, builder, &newIdentifier);
@@ -124,7 +276,7 @@ Identifier MongoDbDataLayer::add(const ExtendedSymptom& symptom)
 }
 Identifier MongoDbDataLayer::add(const ExtendedSolution& solution)
 {
-    Identifier newIdentifier = OID::gen().str();
+    Identifier newIdentifier(OID::gen().str());
     
     BSONObjBuilder builder;
     makeExtendedInfo(solution, builder, &newIdentifier);
@@ -134,7 +286,7 @@ Identifier MongoDbDataLayer::add(const ExtendedSolution& solution)
 }
 Identifier MongoDbDataLayer::add(const SymptomLink& symptomLink)
 {
-    Identifier newIdentifier = OID::gen().str();
+    Identifier newIdentifier(OID::gen().str());
     
     BSONObjBuilder builder;
     makeBson(symptomLink, builder, &newIdentifier);
@@ -144,7 +296,7 @@ Identifier MongoDbDataLayer::add(const SymptomLink& symptomLink)
 }
 Identifier MongoDbDataLayer::add(const SolutionLink& solutionLink)
 {
-    Identifier newIdentifier = OID::gen().str();
+    Identifier newIdentifier(OID::gen().str());
     
     BSONObjBuilder builder;
     makeBson(solutionLink, builder, &newIdentifier);
@@ -154,7 +306,7 @@ Identifier MongoDbDataLayer::add(const SolutionLink& solutionLink)
 }
 Identifier MongoDbDataLayer::add(const Investigation& investigation)
 {
-    Identifier newIdentifier = OID::gen().str();
+    Identifier newIdentifier(OID::gen().str());
     
     BSONObjBuilder builder;
     makeBson(investigation, builder, &newIdentifier);
@@ -206,37 +358,87 @@ void MongoDbDataLayer::modify(const Investigation& investigation)
     modifyObject(investigation.id, builder.done(), _investigationCollection, false);
 }
 
+void MongoDbDataLayer::add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs)
+{
+    templateAdd(categories, newIDs, _categoryCollection);
+}
+void MongoDbDataLayer::add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs)
+{
+    templateAdd(problems, newIDs, _problemCollection);
+}
+void MongoDbDataLayer::add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs)
+{
+    templateAdd(symptoms, newIDs, _symptomCollection);
+}
+void MongoDbDataLayer::add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs)
+{
+    templateAdd(solutions, newIDs, _solutionCollection);
+}
+void MongoDbDataLayer::add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs)
+{
+    templateAdd(symptomLinks, newIDs, _symptomLinksCollection);
+}
+void MongoDbDataLayer::add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs)
+{
+    templateAdd(solutionLinks, newIDs, _solutionLinksCollection);
+}
+
+void MongoDbDataLayer::modify(const std::vector<Category>& categories)
+{
+    templateModify(categories, _categoryCollection);
+}
+void MongoDbDataLayer::modify(const std::vector<ExtendedProblem>& problems)
+{
+    templateModify(problems, _problemCollection);
+}
+void MongoDbDataLayer::modify(const std::vector<ExtendedSymptom>& symptoms)
+{
+    templateModify(symptoms, _symptomCollection);
+}
+void MongoDbDataLayer::modify(const std::vector<ExtendedSolution>& solutions)
+{
+    templateModify(solutions, _solutionCollection);
+}
+void MongoDbDataLayer::modify(const std::vector<SymptomLink>& symptomLinks)
+{
+    templateModify(symptomLinks, _symptomLinksCollection);
+}
+void MongoDbDataLayer::modify(const std::vector<SolutionLink>& solutionLinks)
+{
+    templateModify(solutionLinks, _solutionLinksCollection);
+}
+
 void MongoDbDataLayer::remove(const Category& category)
 {
-    removeObject(BSON("_id" << category.id), _categoryCollection);
+    removeObject(BSON("_id" << category.id.toString()), _categoryCollection);
 }
 void MongoDbDataLayer::remove(const Problem& problem)
 {
-    removeObject(BSON("_id" << problem.id), _problemCollection);
-    removeObject(BSON("problemID" << problem.id), _symptomLinksCollection);
-    removeObject(BSON("problemID" << problem.id), _solutionLinksCollection);
+    removeObject(BSON("_id" << problem.id.toString()), _problemCollection);
+    removeObject(BSON("problemID" << problem.id.toString()), _symptomLinksCollection);
+    removeObject(BSON("problemID" << problem.id.toString()), _solutionLinksCollection);
 }
 void MongoDbDataLayer::remove(const Symptom& symptom)
 {
-    removeObject(BSON("_id" << symptom.id), _symptomCollection);
-    removeObject(BSON("symptomID" << symptom.id), _symptomLinksCollection);
+    removeObject(BSON("_id" << symptom.id.toString()), _symptomCollection);
+    removeObject(BSON("symptomID" << symptom.id.toString()), _symptomLinksCollection);
 }
 void MongoDbDataLayer::remove(const Solution& solution)
 {
-    removeObject(BSON("_id" << solution.id), _solutionCollection);
-    removeObject(BSON("solutionID" << solution.id), _solutionLinksCollection);
+    removeObject(BSON("_id" << solution.id.toString()), _solutionCollection);
+    removeObject(BSON("solutionID" << solution.id.toString()), _solutionLinksCollection);
 }
 void MongoDbDataLayer::remove(const SymptomLink& symptomLink)
 {
-    removeObject(BSON("_id" << symptomLink.id), _symptomLinksCollection);
+    removeObject(BSON("_id" << symptomLink.id.toString()), _symptomLinksCollection);
 }
 void MongoDbDataLayer::remove(const SolutionLink& solutionLink)
 {
-    removeObject(BSON("_id" << solutionLink.id), _solutionLinksCollection);
+    removeObject(BSON("_id" << solutionLink.id.toString()), _solutionLinksCollection);
 }
 void MongoDbDataLayer::remove(const Investigation& investigation)
 {
-    removeObject(BSON("_id" << investigation.id), _investigationCollection);
+    removeObject(BSON("_id" << investigation.id.toString()), _investigationCollection);
 }
 
 /**
@@ -248,6 +450,7 @@ void MongoDbDataLayer::templateGet(const std::vector<Identifier>& ids, boost::un
 {
     try
     {
+        DataLayerStatistics::RoundTrip roundTrip;
         MongoConnection connection(_connectionString);
         
         // some reusable variables
@@ -267,7 +470,7 @@ void MongoDbDataLayer::templateGet(const std::vector<Identifier>& ids, boost::un
                 missingIDs.insert(ids[i]);
                 
                 snprintf(index, sizeof(index)-1, "%d", i);
-                keysArray.append(index, ids[i]);
+                keysArray.append(index, ids[i].toString());
             }
             
             dbRecords = connection->query(collection, BSON("_id" << BSON("$in" << BSONArray(keysArray.done()))) );
@@ -279,14 +482,14 @@ void MongoDbDataLayer::templateGet(const std::vector<Identifier>& ids, boost::un
 
         if(!dbRecords.get()) // it is possible to get here if the connection with the server breaks while executing the query
         {
-            printf("Mongo server has gone away!\n");
+            utils::Logger::log(utils::logError, "Mongo server has gone away!");
             throw Exception("Mongo server has gone away!");
         }
         
         while(dbRecords->more())
         {
             BSONObj singleRecord = dbRecords->nextSafe();
-            Identifier id = singleRecord["_id"].String();
+            Identifier id(singleRecord["_id"].String());
             
             T& newObject = result[id];
             
@@ -315,12 +518,12 @@ void MongoDbDataLayer::templateGet(const std::vector<Identifier>& ids, boost::un
     }
     catch(std::exception& e)
     {
-        printf("Error getting records from Mongo collection %s! Error: %s\n", collection.c_str(), e.what());
+        utils::Logger::log(utils::logError, "Error getting records from Mongo collection %s! Error: %s", collection.c_str(), e.what());
         throw Exception(e.what());
     }
     catch(...)
     {
-        printf("Error getting records from Mongo!\n");
+        utils::Logger::log(utils::logError, "Error getting records from Mongo!");
         throw Exception("Error getting records from Mongo");
     }
 }
@@ -331,20 +534,21 @@ void MongoDbDataLayer::templateGetLinks(CIdentifier byId, const std::string& loo
 {
     try
     {
+        DataLayerStatistics::RoundTrip roundTrip;
         MongoConnection connection(_connectionString);
 
-        auto_ptr<DBClientCursor> dbRecords = connection->query(collection, BSON(lookupField << byId) );
+        auto_ptr<DBClientCursor> dbRecords = connection->query(collection, BSON(lookupField << byId.toString()) );
 
         if(!dbRecords.get()) // it is possible to get here if the connection with the server breaks while executing the query
         {
-            printf("Mongo server has gone away!\n");
+            utils::Logger::log(utils::logError, "Mongo server has gone away!");
             throw Exception("Mongo server has gone away!");
         }
         
         while(dbRecords->more())
         {
             BSONObj singleRecord = dbRecords->nextSafe();
-            Identifier id = singleRecord[organizeField].str();
+            Identifier id(singleRecord[organizeField].str());
             
             T& newObject = result[id];
             
@@ -355,12 +559,12 @@ void MongoDbDataLayer::templateGetLinks(CIdentifier byId, const std::string& loo
     }
     catch(std::exception& e)
     {
-        printf("Error getting records from Mongo collection %s! Error: %s\n", collection.c_str(), e.what());
+        utils::Logger::log(utils::logError, "Error getting records from Mongo collection %s! Error: %s", collection.c_str(), e.what());
         throw Exception(e.what());
     }
     catch(...)
     {
-        printf("Error getting records from Mongo!\n");
+        utils::Logger::log(utils::logError, "Error getting records from Mongo!");
         throw Exception("Error getting records from Mongo");
     }
     
@@ -371,8 +575,8 @@ void MongoDbDataLayer::templateGetLinks(CIdentifier byId, const std::string& loo
 template<class T>
 void MongoDbDataLayer::readGenericInfo(T& newObject, const BSONObj& singleRecord)
 {
-    newObject.id = singleRecord["_id"].String();
-    newObject.categoryID = singleRecord["categoryID"].String();
+    newObject.id = Identifier(singleRecord["_id"].String());
+    newObject.categoryID = Identifier(singleRecord["categoryID"].String());
     newObject.difficulty = static_cast<DifficultyLevel>(singleRecord["difficulty"].Int());
     newObject.confirmed = singleRecord["confirmed"].Bool();
 }
@@ -398,14 +602,14 @@ void MongoDbDataLayer::readExtendedInfo(T& newObject, const BSONObj& singleRecor
 
 void MongoDbDataLayer::readBsonRecord(Category& newObject, const BSONObj& singleRecord)
 {
-    newObject.id = singleRecord["_id"].String();
+    newObject.id = Identifier(singleRecord["_id"].String());
     newObject.name = singleRecord["name"].String();
     newObject.description = singleRecord["description"].String();
-    newObject.parent = singleRecord["parent"].String();
+    newObject.parent = Identifier(singleRecord["parent"].String());
     
     BSONForEach(child, singleRecord["childs"].Obj())
     {
-        newObject.childs.push_back(child.String());
+        newObject.childs.push_back(Identifier(child.String()));
     }
 }
 
@@ -441,9 +645,9 @@ void MongoDbDataLayer::readBsonRecord(ExtendedSolution& newObject, const BSONObj
 
 void MongoDbDataLayer::readBsonRecord(SymptomLink& newObject, const BSONObj& singleRecord)
 {
-    newObject.id = singleRecord["_id"].String();
-    newObject.problemID = singleRecord["problemID"].String();
-    newObject.symptomID = singleRecord["symptomID"].String();
+    newObject.id = Identifier(singleRecord["_id"].String());
+    newObject.problemID = Identifier(singleRecord["problemID"].String());
+    newObject.symptomID = Identifier(singleRecord["symptomID"].String());
     newObject.positiveChecks = singleRecord["positiveChecks"].Int();
     newObject.falsePositiveChecks = singleRecord["falsePositiveChecks"].Int();
     newObject.negativeChecks = singleRecord["negativeChecks"].Int();
@@ -452,9 +656,9 @@ void MongoDbDataLayer::readBsonRecord(SymptomLink& newObject, const BSONObj& sin
 
 void MongoDbDataLayer::readBsonRecord(SolutionLink& newObject, const BSONObj& singleRecord)
 {
-    newObject.id = singleRecord["_id"].String();
-    newObject.problemID = singleRecord["problemID"].String();
-    newObject.solutionID = singleRecord["solutionID"].String();
+    newObject.id = Identifier(singleRecord["_id"].String());
+    newObject.problemID = Identifier(singleRecord["problemID"].String());
+    newObject.solutionID = Identifier(singleRecord["solutionID"].String());
     newObject.positive = singleRecord["positive"].Int();
     newObject.negative = singleRecord["negative"].Int();
     newObject.confirmed = singleRecord["confirmed"].Bool();
@@ -462,40 +666,40 @@ void MongoDbDataLayer::readBsonRecord(SolutionLink& newObject, const BSONObj& si
 
 void MongoDbDataLayer::readBsonRecord(Investigation& newObject, const BSONObj& singleRecord)
 {
-    newObject.id = singleRecord["_id"].String();
+    newObject.id = Identifier(singleRecord["_id"].String());
     newObject.closed = singleRecord["closed"].Bool();
-    newObject.positiveProblem = singleRecord["positiveProblem"].String();
-    newObject.positiveSolution = singleRecord["positiveSolution"].String();
+    newObject.positiveProblem = Identifier(singleRecord["positiveProblem"].String());
+    newObject.positiveSolution = Identifier(singleRecord["positiveSolution"].String());
     
     BSONForEach(identifier, singleRecord["positiveSymptoms"].Obj())
     {
-        newObject.positiveSymptoms.push_back(identifier.String());
+        newObject.positiveSymptoms.push_back(Identifier(identifier.String()));
     }
     BSONForEach(identifier, singleRecord["negativeSymptoms"].Obj())
     {
-        newObject.negativeSymptoms.push_back(identifier.String());
+        newObject.negativeSymptoms.push_back(Identifier(identifier.String()));
     }
     BSONForEach(identifier, singleRecord["bannedSymptoms"].Obj())
     {
-        newObject.bannedSymptoms.push_back(identifier.String());
+        newObject.bannedSymptoms.push_back(Identifier(identifier.String()));
     }
     
     BSONForEach(identifier, singleRecord["negativeProblems"].Obj())
     {
-        newObject.negativeProblems.push_back(identifier.String());
+        newObject.negativeProblems.push_back(Identifier(identifier.String()));
     }
     BSONForEach(identifier, singleRecord["bannedProblems"].Obj())
     {
-        newObject.bannedProblems.push_back(identifier.String());
+        newObject.bannedProblems.push_back(Identifier(identifier.String()));
     }
     
     BSONForEach(identifier, singleRecord["negativeSolutions"].Obj())
     {
-        newObject.negativeSolutions.push_back(identifier.String());
+        newObject.negativeSolutions.push_back(Identifier(identifier.String()));
     }
     BSONForEach(identifier, singleRecord["bannedSolutions"].Obj())
     {
-        newObject.bannedSolutions.push_back(identifier.String());
+        newObject.bannedSolutions.push_back(Identifier(identifier.String()));
     }
 }
 
@@ -503,28 +707,121 @@ void MongoDbDataLayer::modifyObject(CIdentifier id, const mongo::BSONObj& object
 {
     try
     {
+        DataLayerStatistics::RoundTrip roundTrip;
         MongoConnection connection(_connectionString);
 
-        connection->update(collection, BSON("_id" << id), object, insert);
+        connection->update(collection, BSON("_id" << id.toString()), object, insert);
 
         connection.done();
     }
     catch(std::exception& e)
     {
-        printf("Error updating records in Mongo collection %s! Error: %s\n", collection.c_str(), e.what());
+        utils::Logger::log(utils::logError, "Error updating records in Mongo collection %s! Error: %s", collection.c_str(), e.what());
         throw Exception(e.what());
     }
     catch(...)
     {
-        printf("Error updating records in Mongo!\n");
+        utils::Logger::log(utils::logError, "Error updating records in Mongo!");
         throw Exception("Error updating records in Mongo");
     }
 }
 
+/**
+ * The objects are inserted BULK_WRITE_SIZE at a time, each insert is one round trip
+ */
+template<class T>
+void MongoDbDataLayer::templateAdd(const std::vector<T>& objects, std::vector<Identifier>& newIDs, const std::string& collection)
+{
+    newIDs.reserve(newIDs.size() + objects.size());
+    
+    std::vector<BSONObj> records;
+    records.reserve(std::min<size_t>(objects.size(), BULK_WRITE_SIZE));
+    
+    BOOST_FOREACH(const T& object, objects)
+    {
+        Identifier newIdentifier(OID::gen().str());
+        
+        BSONObjBuilder builder;
+        makeBson(object, builder, &newIdentifier);
+        records.push_back(builder.obj());
+        
+        newIDs.push_back(newIdentifier);
+        
+        if(records.size() == BULK_WRITE_SIZE)
+        {
+            insertObjects(records, collection);
+            records.clear();
+        }
+    }
+    
+    if(!records.empty())
+        insertObjects(records, collection);
+}
+
+/**
+ * The driver has no bulk update, all updates are sent through one connection without waiting for each other
+ */
+template<class T>
+void MongoDbDataLayer::templateModify(const std::vector<T>& objects, const std::string& collection)
+{
+    if(objects.empty())
+        return;
+    
+    try
+    {
+        DataLayerStatistics::RoundTrip roundTrip;
+        MongoConnection connection(_connectionString);
+        
+        BOOST_FOREACH(const T& object, objects)
+        {
+            BSONObjBuilder builder;
+            makeBson(object, builder);
+            
+            connection->update(collection, BSON("_id" << object.id.toString()), builder.obj(), false);
+        }
+        
+        connection.done();
+    }
+    catch(std::exception& e)
+    {
+        utils::Logger::log(utils::logError, "Error updating records in Mongo collection %s! Error: %s", collection.c_str(), e.what());
+        throw Exception(e.what());
+    }
+    catch(...)
+    {
+        utils::Logger::log(utils::logError, "Error updating records in Mongo!");
+        throw Exception("Error updating records in Mongo");
+    }
+}
+
+void MongoDbDataLayer::insertObjects(const std::vector<mongo::BSONObj>& objects, const std::string& collection)
+{
+    try
+    {
+        DataLayerStatistics::RoundTrip roundTrip;
+        MongoConnection connection(_connectionString);
+
+        connection->insert(collection, objects);
+
+        connection.done();
+    }
+    catch(std::exception& e)
+    {
+        utils::Logger::log(utils::logError, "Error inserting records in Mongo collection %s! Error: %s", collection.c_str(), e.what());
+        throw Exception(e.what());
+    }
+    catch(...)
+    {
+        utils::Logger::log(utils::logError, "Error inserting records in Mongo!");
+        throw Exception("Error inserting records in Mongo");
+    }
+}
+
 void MongoDbDataLayer::removeObject(const mongo::BSONObj& query, const std::string& collection)
 {
     try
     {
+        DataLayerStatistics::RoundTrip roundTrip;
         MongoConnection connection(_connectionString);
 
         connection->remove(collection, query);
@@ -533,12 +830,12 @@ void MongoDbDataLayer::removeObject(const mongo::BSONObj& query, const std::stri
     }
     catch(std::exception& e)
     {
-        printf("Error removing records from Mongo collection %s! Error: %s\n", collection.c_str(), e.what());
+        utils::Logger::log(utils::logError, "Error removing records from Mongo collection %s! Error: %s", collection.c_str(), e.what());
         throw Exception(e.what());
     }
     catch(...)
     {
-        printf("Error removing records from Mongo!\n");
+        utils::Logger::log(utils::logError, "Error removing records from Mongo!");
         throw Exception("Error removing records from Mongo");
     }
 }
@@ -547,11 +844,11 @@ template<class T>
 void MongoDbDataLayer::makeExtendedInfo(const T& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier)
 {
     if(customIdentifier != NULL)
-        singleRecord.append("_id", *customIdentifier);
+        singleRecord.append("_id", customIdentifier->toString());
     else
-        singleRecord.append("_id", newObject.id);
+        singleRecord.append("_id", newObject.id.toString());
     
-    singleRecord.append("categoryID", newObject.categoryID);
+    singleRecord.append("categoryID", newObject.categoryID.toString());
     singleRecord.append("difficulty", static_cast<int>(newObject.difficulty));
     singleRecord.append("confirmed", newObject.confirmed);
     
@@ -568,28 +865,43 @@ void MongoDbDataLayer::makeExtendedInfo(const T& newObject, mongo::BSONObjBuilde
     singleRecord.append("steps", newObject.steps);
 }
 
+void MongoDbDataLayer::makeBson(const ExtendedProblem& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier)
+{
+    makeExtendedInfo(newObject, singleRecord, customIdentifier);
+}
+
+void MongoDbDataLayer::makeBson(const ExtendedSymptom& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier)
+{
+    makeExtendedInfo(newObject, singleRecord, customIdentifier);
+}
+
+void MongoDbDataLayer::makeBson(const ExtendedSolution& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier)
+{
+    makeExtendedInfo(newObject, singleRecord, customIdentifier);
+}
+
 void MongoDbDataLayer::makeBson(const Category& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier)
 {
     if(customIdentifier != NULL)
-        singleRecord.append("_id", *customIdentifier);
+        singleRecord.append("_id", customIdentifier->toString());
     else
-        singleRecord.append("_id", newObject.id);
+        singleRecord.append("_id", newObject.id.toString());
     
     singleRecord.append("name", newObject.name);
     singleRecord.append("description", newObject.description);
-    singleRecord.append("parent", newObject.parent);
-    singleRecord.append("childs", newObject.childs);
+    singleRecord.append("parent", newObject.parent.toString());
+    appendIdentifiers(singleRecord, "childs", newObject.childs);
 }
 
 void MongoDbDataLayer::makeBson(const SymptomLink& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier)
 {
     if(customIdentifier != NULL)
-        singleRecord.append("_id", *customIdentifier);
+        singleRecord.append("_id", customIdentifier->toString());
     else
-        singleRecord.append("_id", newObject.id);
+        singleRecord.append("_id", newObject.id.toString());
     
-    singleRecord.append("problemID", newObject.problemID);
-    singleRecord.append("symptomID", newObject.symptomID);
+    singleRecord.append("problemID", newObject.problemID.toString());
+    singleRecord.append("symptomID", newObject.symptomID.toString());
     
     singleRecord.append("positiveChecks", newObject.positiveChecks);
     singleRecord.append("falsePositiveChecks", newObject.falsePositiveChecks);
@@ -601,12 +913,12 @@ void MongoDbDataLayer::makeBson(const SymptomLink& newObject, mongo::BSONObjBuil
 void MongoDbDataLayer::makeBson(const SolutionLink& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier)
 {
     if(customIdentifier != NULL)
-        singleRecord.append("_id", *customIdentifier);
+        singleRecord.append("_id", customIdentifier->toString());
     else
-        singleRecord.append("_id", newObject.id);
+        singleRecord.append("_id", newObject.id.toString());
     
-    singleRecord.append("problemID", newObject.problemID);
-    singleRecord.append("solutionID", newObject.solutionID);
+    singleRecord.append("problemID", newObject.problemID.toString());
+    singleRecord.append("solutionID", newObject.solutionID.toString());
     
     singleRecord.append("positive", newObject.positive);
     singleRecord.append("negative", newObject.negative);
@@ -617,24 +929,24 @@ void MongoDbDataLayer::makeBson(const SolutionLink& newObject, mongo::BSONObjBui
 void MongoDbDataLayer::makeBson(const Investigation& newObject, mongo::BSONObjBuilder& singleRecord, const Identifier* customIdentifier)
 {
     if(customIdentifier != NULL)
-        singleRecord.append("_id", *customIdentifier);
+        singleRecord.append("_id", customIdentifier->toString());
     else
-        singleRecord.append("_id", newObject.id);
+        singleRecord.append("_id", newObject.id.toString());
     
     singleRecord.append("closed", newObject.closed);
     
-    singleRecord.append("positiveProblem", newObject.positiveProblem);
-    singleRecord.append("positiveSolution", newObject.positiveSolution);
+    singleRecord.append("positiveProblem", newObject.positiveProblem.toString());
+    singleRecord.append("positiveSolution", newObject.positiveSolution.toString());
     
-    singleRecord.append("positiveSymptoms", newObject.positiveSymptoms);
-    singleRecord.append("negativeSymptoms", newObject.negativeSymptoms);
-    singleRecord.append("bannedSymptoms", newObject.bannedSymptoms);
+    appendIdentifiers(singleRecord, "positiveSymptoms", newObject.positiveSymptoms);
+    appendIdentifiers(singleRecord, "negativeSymptoms", newObject.negativeSymptoms);
+    appendIdentifiers(singleRecord, "bannedSymptoms", newObject.bannedSymptoms);
     
-    singleRecord.append("negativeProblems", newObject.negativeProblems);
-    singleRecord.append("bannedProblems", newObject.bannedProblems);
+    appendIdentifiers(singleRecord, "negativeProblems", newObject.negativeProblems);
+    appendIdentifiers(singleRecord, "bannedProblems", newObject.bannedProblems);
     
-    singleRecord.append("negativeSolutions", newObject.negativeSolutions);
-    singleRecord.append("bannedSolutions", newObject.bannedSolutions);
+    appendIdentifiers(singleRecord, "negativeSolutions", newObject.negativeSolutions);
+    appendIdentifiers(singleRecord, "bannedSolutions", newObject.bannedSolutions);
 }
 
 } // namespace ProblemSolver
@@ -64,31 +64,31 @@ void MySqlDataLayer::getLinksBySolution(Identifier solutionID, ProblemsWithSameS
 
 Identifier MySqlDataLayer::add(const Category& category)
 {
-    return "";
+    return Identifier();
 }
 Identifier MySqlDataLayer::add(const ExtendedProblem& problem)
 {
-    return "";
+    return Identifier();
 }
 Identifier MySqlDataLayer::add(const ExtendedSymptom& symptom)
 {
-    return "";
+    return Identifier();
 }
 Identifier MySqlDataLayer::add(const ExtendedSolution& solution)
 {
-    return "";
+    return Identifier();
 }
 Identifier MySqlDataLayer::add(const SymptomLink& symptomLink)
 {
-    return "";
+    return Identifier();
 }
 Identifier MySqlDataLayer::add(const SolutionLink& solutionLink)
 {
-    return "";
+    return Identifier();
 }
 Identifier MySqlDataLayer::add(const Investigation& solutionLink)
 {
-    return "";
+    return Identifier();
 }
 
 void MySqlDataLayer::modify(const Category& category)
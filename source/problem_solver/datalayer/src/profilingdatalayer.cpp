@@ -0,0 +1,455 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "profilingdatalayer.h"
+#include "utils.h"
+#include "fiberscheduler.h"
+
+namespace ProblemSolver
+{
+
+__thread DataLayerProfile* ProfilingDataLayer::_scopeProfile = NULL;
+
+bool ProfilingDataLayer::_fiberLocalAdded = utils::FiberScheduler::addLocal(&ProfilingDataLayer::swapFiberLocal);
+
+DataLayerProfile::Counters DataLayerProfile::getTotal() const
+{
+    Counters total;
+    
+    for(unsigned i = 0; i < profiledOperationCount; ++i)
+    {
+        total.calls += operations[i].calls;
+        total.requestedIDs += operations[i].requestedIDs;
+        total.returnedObjects += operations[i].returnedObjects;
+        total.nanoseconds += operations[i].nanoseconds;
+    }
+    
+    return total;
+}
+
+void DataLayerProfile::add(const DataLayerProfile& other)
+{
+    for(unsigned i = 0; i < profiledOperationCount; ++i)
+    {
+        operations[i].calls += other.operations[i].calls;
+        operations[i].requestedIDs += other.operations[i].requestedIDs;
+        operations[i].returnedObjects += other.operations[i].returnedObjects;
+        operations[i].nanoseconds += other.operations[i].nanoseconds;
+    }
+}
+
+const char* DataLayerProfile::getOperationName(ProfiledOperation operation)
+{
+    static const char* names[profiledOperationCount] =
+    {
+        "getCategories", "getProblems", "getSymptoms", "getSolutions", "getSymptomLinks", "getSolutionLinks", "getInvestigations",
+        "getExtendedProblems", "getExtendedSymptoms", "getExtendedSolutions",
+        "getSymptomLinksByProblem", "getSymptomLinksBySymptom", "getSolutionLinksByProblem", "getSolutionLinksBySolution",
+        "openCursor", "add", "modify", "remove"
+    };
+    
+    return names[operation];
+}
+
+ProfilingDataLayer::Scope::Scope():
+    _enclosingProfile(_scopeProfile)
+{
+    _scopeProfile = &_profile;
+}
+
+ProfilingDataLayer::Scope::~Scope()
+{
+    _scopeProfile = _enclosingProfile;
+    
+    if(_enclosingProfile != NULL)
+        _enclosingProfile->add(_profile);
+}
+
+ProfilingDataLayer::ProfilingDataLayer(IDataLayer* target):
+    ForwardingDataLayer(target)
+{
+}
+
+void ProfilingDataLayer::getTotals(DataLayerProfile& result) const
+{
+    for(unsigned i = 0; i < profiledOperationCount; ++i)
+    {
+        result.operations[i].calls = _totals[i].calls.get();
+        result.operations[i].requestedIDs = _totals[i].requestedIDs.get();
+        result.operations[i].returnedObjects = _totals[i].returnedObjects.get();
+        result.operations[i].nanoseconds = _totals[i].nanoseconds.get();
+    }
+}
+
+void ProfilingDataLayer::get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(profiledGetCategories, categoryIDs, result, notFound);
+}
+void ProfilingDataLayer::get(const std::vector<Identifier>& problemIDs, ProblemMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(profiledGetProblems, problemIDs, result, notFound);
+}
+void ProfilingDataLayer::get(const std::vector<Identifier>& symptomIDs, SymptomMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(profiledGetSymptoms, symptomIDs, result, notFound);
+}
+void ProfilingDataLayer::get(const std::vector<Identifier>& solutionIDs, SolutionMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(profiledGetSolutions, solutionIDs, result, notFound);
+}
+void ProfilingDataLayer::get(const std::vector<Identifier>& symptomLinkIDs, SymptomLinkMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(profiledGetSymptomLinks, symptomLinkIDs, result, notFound);
+}
+void ProfilingDataLayer::get(const std::vector<Identifier>& solutionLinkIDs, SolutionLinkMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(profiledGetSolutionLinks, solutionLinkIDs, result, notFound);
+}
+void ProfilingDataLayer::get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(profiledGetInvestigations, investigationIDs, result, notFound);
+}
+
+void ProfilingDataLayer::get(const std::vector<Identifier>& problemIDs, ExtendedProblemMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(profiledGetExtendedProblems, problemIDs, result, notFound);
+}
+void ProfilingDataLayer::get(const std::vector<Identifier>& symptomIDs, ExtendedSymptomMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(profiledGetExtendedSymptoms, symptomIDs, result, notFound);
+}
+void ProfilingDataLayer::get(const std::vector<Identifier>& solutionIDs, ExtendedSolutionMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(profiledGetExtendedSolutions, solutionIDs, result, notFound);
+}
+
+void ProfilingDataLayer::getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found)
+{
+    uint64_t startTime = utils::getMonotonicNanoseconds();
+    size_t startSize = result.size();
+    
+    _target->getLinksByProblem(problemID, result, found);
+    
+    record(profiledGetSymptomLinksByProblem, 1, result.size() - startSize, startTime);
+}
+
+void ProfilingDataLayer::getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found)
+{
+    uint64_t startTime = utils::getMonotonicNanoseconds();
+    size_t startSize = result.size();
+    
+    _target->getLinksBySymptom(symptomID, result, found);
+    
+    record(profiledGetSymptomLinksBySymptom, 1, result.size() - startSize, startTime);
+}
+
+void ProfilingDataLayer::getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found)
+{
+    uint64_t startTime = utils::getMonotonicNanoseconds();
+    size_t startSize = result.size();
+    
+    _target->getLinksByProblem(problemID, result, found);
+    
+    record(profiledGetSolutionLinksByProblem, 1, result.size() - startSize, startTime);
+}
+
+void ProfilingDataLayer::getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found)
+{
+    uint64_t startTime = utils::getMonotonicNanoseconds();
+    size_t startSize = result.size();
+    
+    _target->getLinksBySolution(solutionID, result, found);
+    
+    record(profiledGetSolutionLinksBySolution, 1, result.size() - startSize, startTime);
+}
+
+void ProfilingDataLayer::openCursor(CategoryCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void ProfilingDataLayer::openCursor(ProblemCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void ProfilingDataLayer::openCursor(SymptomCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void ProfilingDataLayer::openCursor(SolutionCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void ProfilingDataLayer::openCursor(SymptomLinkCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void ProfilingDataLayer::openCursor(SolutionLinkCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void ProfilingDataLayer::openCursor(InvestigationCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+
+void ProfilingDataLayer::openCursor(ExtendedProblemCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void ProfilingDataLayer::openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+void ProfilingDataLayer::openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(cursor, batchSize);
+}
+
+Identifier ProfilingDataLayer::add(const Category& category)
+{
+    return templateAdd(category);
+}
+Identifier ProfilingDataLayer::add(const ExtendedProblem& problem)
+{
+    return templateAdd(problem);
+}
+Identifier ProfilingDataLayer::add(const ExtendedSymptom& symptom)
+{
+    return templateAdd(symptom);
+}
+Identifier ProfilingDataLayer::add(const ExtendedSolution& solution)
+{
+    return templateAdd(solution);
+}
+Identifier ProfilingDataLayer::add(const SymptomLink& symptomLink)
+{
+    return templateAdd(symptomLink);
+}
+Identifier ProfilingDataLayer::add(const SolutionLink& solutionLink)
+{
+    return templateAdd(solutionLink);
+}
+Identifier ProfilingDataLayer::add(const Investigation& investigation)
+{
+    return templateAdd(investigation);
+}
+
+void ProfilingDataLayer::modify(const Category& category)
+{
+    templateModify(category);
+}
+void ProfilingDataLayer::modify(const ExtendedProblem& problem)
+{
+    templateModify(problem);
+}
+void ProfilingDataLayer::modify(const ExtendedSymptom& symptom)
+{
+    templateModify(symptom);
+}
+void ProfilingDataLayer::modify(const ExtendedSolution& solution)
+{
+    templateModify(solution);
+}
+void ProfilingDataLayer::modify(const SymptomLink& symptomLink)
+{
+    templateModify(symptomLink);
+}
+void ProfilingDataLayer::modify(const SolutionLink& solutionLink)
+{
+    templateModify(solutionLink);
+}
+void ProfilingDataLayer::modify(const Investigation& investigation)
+{
+    templateModify(investigation);
+}
+
+void ProfilingDataLayer::add(const std::vector<Category>& categories, std::vector<Identifier>& newIDs)
+{
+    templateAdd(categories, newIDs);
+}
+void ProfilingDataLayer::add(const std::vector<ExtendedProblem>& problems, std::vector<Identifier>& newIDs)
+{
+    templateAdd(problems, newIDs);
+}
+void ProfilingDataLayer::add(const std::vector<ExtendedSymptom>& symptoms, std::vector<Identifier>& newIDs)
+{
+    templateAdd(symptoms, newIDs);
+}
+void ProfilingDataLayer::add(const std::vector<ExtendedSolution>& solutions, std::vector<Identifier>& newIDs)
+{
+    templateAdd(solutions, newIDs);
+}
+void ProfilingDataLayer::add(const std::vector<SymptomLink>& symptomLinks, std::vector<Identifier>& newIDs)
+{
+    templateAdd(symptomLinks, newIDs);
+}
+void ProfilingDataLayer::add(const std::vector<SolutionLink>& solutionLinks, std::vector<Identifier>& newIDs)
+{
+    templateAdd(solutionLinks, newIDs);
+}
+
+void ProfilingDataLayer::modify(const std::vector<Category>& categories)
+{
+    templateModify(categories);
+}
+void ProfilingDataLayer::modify(const std::vector<ExtendedProblem>& problems)
+{
+    templateModify(problems);
+}
+void ProfilingDataLayer::modify(const std::vector<ExtendedSymptom>& symptoms)
+{
+    templateModify(symptoms);
+}
+void ProfilingDataLayer::modify(const std::vector<ExtendedSolution>& solutions)
+{
+    templateModify(solutions);
+}
+void ProfilingDataLayer::modify(const std::vector<SymptomLink>& symptomLinks)
+{
+    templateModify(symptomLinks);
+}
+void ProfilingDataLayer::modify(const std::vector<SolutionLink>& solutionLinks)
+{
+    templateModify(solutionLinks);
+}
+
+void ProfilingDataLayer::remove(const Category& category)
+{
+    templateRemove(category);
+}
+void ProfilingDataLayer::remove(const Problem& problem)
+{
+    templateRemove(problem);
+}
+void ProfilingDataLayer::remove(const Symptom& symptom)
+{
+    templateRemove(symptom);
+}
+void ProfilingDataLayer::remove(const Solution& solution)
+{
+    templateRemove(solution);
+}
+void ProfilingDataLayer::remove(const SymptomLink& symptomLink)
+{
+    templateRemove(symptomLink);
+}
+void ProfilingDataLayer::remove(const SolutionLink& solutionLink)
+{
+    templateRemove(solutionLink);
+}
+void ProfilingDataLayer::remove(const Investigation& investigation)
+{
+    templateRemove(investigation);
+}
+
+template<class T>
+void ProfilingDataLayer::templateGet(ProfiledOperation operation, const std::vector<Identifier>& ids,
+                                     boost::unordered_map<Identifier, T>& result, std::vector<Identifier>* notFound)
+{
+    uint64_t startTime = utils::getMonotonicNanoseconds();
+    size_t startSize = result.size();
+    
+    _target->get(ids, result, notFound);
+    
+    record(operation, ids.size(), result.size() - startSize, startTime);
+}
+
+template<class T>
+void ProfilingDataLayer::templateOpenCursor(std::auto_ptr<IDataLayerCursor<T> >& cursor, unsigned batchSize)
+{
+    uint64_t startTime = utils::getMonotonicNanoseconds();
+    
+    _target->openCursor(cursor, batchSize);
+    
+    record(profiledOpenCursor, 0, 0, startTime);
+}
+
+template<class T>
+Identifier ProfilingDataLayer::templateAdd(const T& object)
+{
+    uint64_t startTime = utils::getMonotonicNanoseconds();
+    
+    Identifier id = _target->add(object);
+    
+    record(profiledAdd, 0, 0, startTime);
+    return id;
+}
+
+template<class T>
+void ProfilingDataLayer::templateModify(const T& object)
+{
+    uint64_t startTime = utils::getMonotonicNanoseconds();
+    
+    _target->modify(object);
+    
+    record(profiledModify, 1, 0, startTime);
+}
+
+/**
+ * A bulk write is one call, the objects of a bulk modify are counted as requested IDs
+ */
+template<class T>
+void ProfilingDataLayer::templateAdd(const std::vector<T>& objects, std::vector<Identifier>& newIDs)
+{
+    uint64_t startTime = utils::getMonotonicNanoseconds();
+    
+    _target->add(objects, newIDs);
+    
+    record(profiledAdd, 0, 0, startTime);
+}
+
+template<class T>
+void ProfilingDataLayer::templateModify(const std::vector<T>& objects)
+{
+    uint64_t startTime = utils::getMonotonicNanoseconds();
+    
+    _target->modify(objects);
+    
+    record(profiledModify, objects.size(), 0, startTime);
+}
+
+template<class T>
+void ProfilingDataLayer::templateRemove(const T& object)
+{
+    uint64_t startTime = utils::getMonotonicNanoseconds();
+    
+    _target->remove(object);
+    
+    record(profiledRemove, 1, 0, startTime);
+}
+
+/**
+ * Failed calls are not recorded
+ */
+void ProfilingDataLayer::record(ProfiledOperation operation, uint64_t requestedIDs, uint64_t returnedObjects, uint64_t startTime)
+{
+    uint64_t time = utils::getMonotonicNanoseconds() - startTime;
+    
+    AtomicCounters& totals = _totals[operation];
+    totals.calls.add();
+    totals.requestedIDs.add(requestedIDs);
+    totals.returnedObjects.add(returnedObjects);
+    totals.nanoseconds.add(time);
+    
+    if(_scopeProfile != NULL)
+    {
+        DataLayerProfile::Counters& counters = _scopeProfile->operations[operation];
+        ++counters.calls;
+        counters.requestedIDs += requestedIDs;
+        counters.returnedObjects += returnedObjects;
+        counters.nanoseconds += time;
+    }
+}
+
+void ProfilingDataLayer::swapFiberLocal(uint64_t& saved)
+{
+    DataLayerProfile* scopeProfile = _scopeProfile;
+    _scopeProfile = reinterpret_cast<DataLayerProfile*>(static_cast<uintptr_t>(saved));
+    saved = reinterpret_cast<uintptr_t>(scopeProfile);
+}
+
+} // namespace ProblemSolver
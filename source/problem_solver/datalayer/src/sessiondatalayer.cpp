@@ -0,0 +1,286 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "sessiondatalayer.h"
+#include "utils.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <boost/foreach.hpp>
+
+namespace ProblemSolver
+{
+
+const unsigned SessionDataLayer::DEFAULT_FLUSH_DELAY;
+const unsigned SessionDataLayer::DEFAULT_IDLE_TIMEOUT;
+
+SessionDataLayer::SessionDataLayer(IDataLayer* target, unsigned flushDelay, unsigned idleTimeout):
+    ForwardingDataLayer(target),
+    _flushDelay(flushDelay * 1000000ULL),
+    _idleTimeout(idleTimeout * 1000000000ULL),
+    _checkInterval(std::max<uint64_t>(_flushDelay / 2, 1000000))
+{
+    _flushThread = boost::thread(&SessionDataLayer::flushLoop, this);
+}
+
+SessionDataLayer::~SessionDataLayer()
+{
+    _flushThread.interrupt();
+    _flushThread.join();
+    
+    writeSessions(true);
+}
+
+SessionDataLayer::Statistics SessionDataLayer::getStatistics() const
+{
+    Statistics result;
+    
+    {
+        boost::mutex::scoped_lock lock(_sessionsMutex);
+        result.sessions = _sessions.size();
+    }
+    
+    result.hits = _hits.get();
+    result.misses = _misses.get();
+    result.writes = _writes.get();
+    result.writeErrors = _writeErrors.get();
+    result.evictions = _evictions.get();
+    
+    return result;
+}
+
+unsigned SessionDataLayer::flush()
+{
+    return writeSessions(true);
+}
+
+/**
+ * Reading all investigations is passed to the target after the changes are written
+ */
+void SessionDataLayer::get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound)
+{
+    if(investigationIDs.empty())
+    {
+        flush();
+        getTarget().get(investigationIDs, result, notFound);
+        return;
+    }
+    
+    std::vector<Identifier> missingIDs;
+    uint64_t now = utils::getMonotonicNanoseconds();
+    
+    {
+        boost::mutex::scoped_lock lock(_sessionsMutex);
+        
+        BOOST_FOREACH(CIdentifier id, investigationIDs)
+        {
+            SessionMap::iterator it = _sessions.find(id);
+            if(it == _sessions.end())
+            {
+                missingIDs.push_back(id);
+                continue;
+            }
+            
+            it->second.useTime = now;
+            result[id] = it->second.investigation;
+        }
+    }
+    
+    _hits.add(investigationIDs.size() - missingIDs.size());
+    
+    if(missingIDs.empty())
+        return;
+    
+    _misses.add(missingIDs.size());
+    
+    InvestigationMap loaded;
+    getTarget().get(missingIDs, loaded, notFound);
+    
+    boost::mutex::scoped_lock lock(_sessionsMutex);
+    
+    BOOST_FOREACH(const InvestigationMap::value_type& pair, loaded)
+    {
+        result[pair.first] = pair.second;
+        
+        if(pair.second.closed)
+            continue;
+        
+        // a session started by another thread in the meantime is newer
+        Session session;
+        session.investigation = pair.second;
+        session.changed = false;
+        session.changeTime = now;
+        session.useTime = now;
+        
+        _sessions.insert(std::make_pair(pair.first, session));
+    }
+}
+
+/**
+ * Cursors read the target directly, so they get the changes after they are written
+ */
+void SessionDataLayer::openCursor(InvestigationCursor& cursor, unsigned batchSize)
+{
+    flush();
+    getTarget().openCursor(cursor, batchSize);
+}
+
+Identifier SessionDataLayer::add(const Investigation& investigation)
+{
+    Identifier id = getTarget().add(investigation);
+    
+    if(!investigation.closed)
+    {
+        uint64_t now = utils::getMonotonicNanoseconds();
+        
+        boost::mutex::scoped_lock lock(_sessionsMutex);
+        
+        Session& session = _sessions[id];
+        session.investigation = investigation;
+        session.investigation.id = id;
+        session.changed = false;
+        session.changeTime = now;
+        session.useTime = now;
+    }
+    
+    return id;
+}
+
+void SessionDataLayer::modify(const Investigation& investigation)
+{
+    if(investigation.closed)
+    {
+        // the session ends, the final state is written right away
+        boost::mutex::scoped_lock writeLock(_writeMutex);
+        
+        {
+            boost::mutex::scoped_lock lock(_sessionsMutex);
+            _sessions.erase(investigation.id);
+        }
+        
+        getTarget().modify(investigation);
+        return;
+    }
+    
+    uint64_t now = utils::getMonotonicNanoseconds();
+    
+    boost::mutex::scoped_lock lock(_sessionsMutex);
+    
+    std::pair<SessionMap::iterator, bool> inserted = _sessions.insert(std::make_pair(investigation.id, Session()));
+    Session& session = inserted.first->second;
+    
+    if(inserted.second || !session.changed)
+    {
+        session.changed = true;
+        session.changeTime = now;
+    }
+    
+    session.investigation = investigation;
+    session.useTime = now;
+}
+
+void SessionDataLayer::remove(const Investigation& investigation)
+{
+    boost::mutex::scoped_lock writeLock(_writeMutex);
+    
+    {
+        boost::mutex::scoped_lock lock(_sessionsMutex);
+        _sessions.erase(investigation.id);
+    }
+    
+    getTarget().remove(investigation);
+}
+
+/**
+ * Writes the sessions changed more than the flush delay ago (or all changed sessions) and drops the idle ones.
+ * Returns the number of failed writes, those sessions stay changed and are written again later.
+ */
+unsigned SessionDataLayer::writeSessions(bool all)
+{
+    // an investigation must not be left half written
+    boost::this_thread::disable_interruption disableInterruption;
+    
+    boost::mutex::scoped_lock writeLock(_writeMutex);
+    
+    std::vector<Investigation> changedInvestigations;
+    uint64_t now = utils::getMonotonicNanoseconds();
+    
+    {
+        boost::mutex::scoped_lock lock(_sessionsMutex);
+        
+        SessionMap::iterator it = _sessions.begin();
+        while(it != _sessions.end())
+        {
+            Session& session = it->second;
+            
+            // only sessions written before are dropped, so a read never misses a change that is still being written
+            if(!session.changed && !all && now - session.useTime >= _idleTimeout)
+            {
+                it = _sessions.erase(it);
+                _evictions.add();
+                continue;
+            }
+            
+            // sessions that would be late on the next check are written now
+            if(session.changed && (all || now + _checkInterval - session.changeTime >= _flushDelay))
+            {
+                changedInvestigations.push_back(session.investigation);
+                session.changed = false;
+            }
+            
+            ++it;
+        }
+    }
+    
+    unsigned errors = 0;
+    
+    BOOST_FOREACH(const Investigation& investigation, changedInvestigations)
+    {
+        try
+        {
+            getTarget().modify(investigation);
+            _writes.add();
+        }
+        catch(std::exception& e)
+        {
+            utils::Logger::log(utils::logError, "SessionDataLayer: ERROR writing investigation %s: %s", investigation.id.toString().c_str(), e.what());
+            _writeErrors.add();
+            ++errors;
+            
+            boost::mutex::scoped_lock lock(_sessionsMutex);
+            
+            SessionMap::iterator it = _sessions.find(investigation.id);
+            if(it != _sessions.end() && !it->second.changed)
+            {
+                it->second.changed = true;
+                it->second.changeTime = now;
+            }
+        }
+    }
+    
+    return errors;
+}
+
+/**
+ * Writes the changed sessions until the thread is interrupted
+ */
+void SessionDataLayer::flushLoop()
+{
+    try
+    {
+        while(true)
+        {
+            boost::this_thread::sleep(boost::posix_time::microseconds(_checkInterval / 1000));
+            writeSessions(false);
+        }
+    }
+    catch(boost::thread_interrupted&)
+    {
+    }
+}
+
+} // namespace ProblemSolver
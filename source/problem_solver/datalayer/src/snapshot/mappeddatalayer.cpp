@@ -0,0 +1,258 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "mappeddatalayer.h"
+#include "snapshotreader.h"
+
+#include <sys/stat.h>
+
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+
+namespace ProblemSolver
+{
+
+MappedDataLayer::MappedDataLayer(const std::string& fileName, bool verifyChecksum):
+    _fileName(fileName),
+    _verifyChecksum(verifyChecksum),
+    _snapshot(new SnapshotReader(fileName, verifyChecksum))
+{
+    if(_snapshot->getHeader().version < 2)
+        throw Exception((boost::format("Snapshot %s has no link indexes, it must be written again!") % fileName).str());
+}
+
+bool MappedDataLayer::refresh()
+{
+    struct stat fileInfo;
+    if(stat(_fileName.c_str(), &fileInfo) != 0)
+        throw Exception((boost::format("Snapshot %s is missing!") % _fileName).str());
+    
+    const struct stat& currentInfo = getSnapshot()->getFileInfo();
+    if(fileInfo.st_dev == currentInfo.st_dev && fileInfo.st_ino == currentInfo.st_ino &&
+       fileInfo.st_mtime == currentInfo.st_mtime && fileInfo.st_size == currentInfo.st_size)
+    {
+        return false;
+    }
+    
+    // the new snapshot is mapped without holding the lock, so readers are not blocked
+    boost::shared_ptr<const SnapshotReader> newSnapshot(new SnapshotReader(_fileName, _verifyChecksum));
+    if(newSnapshot->getHeader().version < 2)
+        throw Exception((boost::format("Snapshot %s has no link indexes, it must be written again!") % _fileName).str());
+    
+    boost::mutex::scoped_lock lock(_snapshotMutex);
+    _snapshot.swap(newSnapshot);
+    
+    return true;
+}
+
+boost::shared_ptr<const SnapshotReader> MappedDataLayer::getSnapshot() const
+{
+    boost::mutex::scoped_lock lock(_snapshotMutex);
+    return _snapshot;
+}
+
+void MappedDataLayer::get(const std::vector<Identifier>& categoryIDs, CategoryMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(snapshotSectionCategories, categoryIDs, result, notFound, "category");
+}
+void MappedDataLayer::get(const std::vector<Identifier>& problemIDs, ProblemMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(snapshotSectionProblems, problemIDs, result, notFound, "problem");
+}
+void MappedDataLayer::get(const std::vector<Identifier>& symptomIDs, SymptomMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(snapshotSectionSymptoms, symptomIDs, result, notFound, "symptom");
+}
+void MappedDataLayer::get(const std::vector<Identifier>& solutionIDs, SolutionMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(snapshotSectionSolutions, solutionIDs, result, notFound, "solution");
+}
+void MappedDataLayer::get(const std::vector<Identifier>& symptomLinkIDs, SymptomLinkMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(snapshotSectionSymptomLinks, symptomLinkIDs, result, notFound, "symptomLink");
+}
+void MappedDataLayer::get(const std::vector<Identifier>& solutionLinkIDs, SolutionLinkMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(snapshotSectionSolutionLinks, solutionLinkIDs, result, notFound, "solutionLink");
+}
+void MappedDataLayer::get(const std::vector<Identifier>& investigationIDs, InvestigationMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(snapshotSectionInvestigations, investigationIDs, result, notFound, "investigation");
+}
+
+void MappedDataLayer::get(const std::vector<Identifier>& problemIDs, ExtendedProblemMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(snapshotSectionProblems, problemIDs, result, notFound, "problem");
+}
+void MappedDataLayer::get(const std::vector<Identifier>& symptomIDs, ExtendedSymptomMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(snapshotSectionSymptoms, symptomIDs, result, notFound, "symptom");
+}
+void MappedDataLayer::get(const std::vector<Identifier>& solutionIDs, ExtendedSolutionMap& result, std::vector<Identifier>* notFound)
+{
+    templateGet(snapshotSectionSolutions, solutionIDs, result, notFound, "solution");
+}
+
+void MappedDataLayer::getLinksByProblem(Identifier problemID, SymptomsWithSameProblem& result, bool* found)
+{
+    templateGetLinks(snapshotSectionSymptomLinksByProblem, snapshotSectionProblems, problemID, &SymptomLink::symptomID, result, found);
+}
+void MappedDataLayer::getLinksBySymptom(Identifier symptomID, ProblemsWithSameSymptom& result, bool* found)
+{
+    templateGetLinks(snapshotSectionSymptomLinksBySymptom, snapshotSectionSymptoms, symptomID, &SymptomLink::problemID, result, found);
+}
+
+void MappedDataLayer::getLinksByProblem(Identifier problemID, SolutionsWithSameProblem& result, bool* found)
+{
+    templateGetLinks(snapshotSectionSolutionLinksByProblem, snapshotSectionProblems, problemID, &SolutionLink::solutionID, result, found);
+}
+void MappedDataLayer::getLinksBySolution(Identifier solutionID, ProblemsWithSameSolution& result, bool* found)
+{
+    templateGetLinks(snapshotSectionSolutionLinksBySolution, snapshotSectionSolutions, solutionID, &SolutionLink::problemID, result, found);
+}
+
+void MappedDataLayer::openCursor(CategoryCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(snapshotSectionCategories, cursor, batchSize);
+}
+void MappedDataLayer::openCursor(ProblemCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(snapshotSectionProblems, cursor, batchSize);
+}
+void MappedDataLayer::openCursor(SymptomCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(snapshotSectionSymptoms, cursor, batchSize);
+}
+void MappedDataLayer::openCursor(SolutionCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(snapshotSectionSolutions, cursor, batchSize);
+}
+void MappedDataLayer::openCursor(SymptomLinkCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(snapshotSectionSymptomLinks, cursor, batchSize);
+}
+void MappedDataLayer::openCursor(SolutionLinkCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(snapshotSectionSolutionLinks, cursor, batchSize);
+}
+void MappedDataLayer::openCursor(InvestigationCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(snapshotSectionInvestigations, cursor, batchSize);
+}
+
+void MappedDataLayer::openCursor(ExtendedProblemCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(snapshotSectionProblems, cursor, batchSize);
+}
+void MappedDataLayer::openCursor(ExtendedSymptomCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(snapshotSectionSymptoms, cursor, batchSize);
+}
+void MappedDataLayer::openCursor(ExtendedSolutionCursor& cursor, unsigned batchSize)
+{
+    templateOpenCursor(snapshotSectionSolutions, cursor, batchSize);
+}
+
+template<class T>
+MappedDataLayer::Cursor<T>::Cursor(boost::shared_ptr<const SnapshotReader> snapshot, SnapshotSectionType type, unsigned batchSize):
+    _snapshot(snapshot),
+    _position(0),
+    _count(snapshot->getRecordCount(type)),
+    _batchSize(batchSize > 0 ? batchSize : 1)
+{
+}
+
+template<class T>
+bool MappedDataLayer::Cursor<T>::next(boost::unordered_map<Identifier, T>& result)
+{
+    result.clear();
+    
+    for(; result.size() < _batchSize && _position < _count; ++_position)
+    {
+        T object;
+        _snapshot->read(_position, object);
+        result[object.id] = object;
+    }
+    
+    return !result.empty();
+}
+
+/**
+ * Reads the requested objects, all objects of the section if no IDs are given
+ */
+template<class T>
+void MappedDataLayer::templateGet(SnapshotSectionType type, const std::vector<Identifier>& ids, boost::unordered_map<Identifier, T>& result,
+                                  std::vector<Identifier>* notFound, const char* objectName)
+{
+    boost::shared_ptr<const SnapshotReader> snapshot = getSnapshot();
+    
+    if(ids.empty())
+    {
+        unsigned count = snapshot->getRecordCount(type);
+        for(unsigned i = 0; i < count; ++i)
+        {
+            T object;
+            snapshot->read(i, object);
+            result[object.id] = object;
+        }
+        
+        return;
+    }
+    
+    BOOST_FOREACH(CIdentifier id, ids)
+    {
+        int position = snapshot->findRecord(type, id);
+        if(position >= 0)
+        {
+            snapshot->read(position, result[id]);
+        }
+        else if(notFound == NULL)
+        {
+            throw Exception((boost::format("Missing ID %s of %s") % id % objectName).str());
+        }
+        else
+        {
+            notFound->push_back(id);
+        }
+    }
+}
+
+/**
+ * Reads all links of an object through the link index organizing them by the ID of the object at the other end of the link
+ */
+template<class T>
+void MappedDataLayer::templateGetLinks(SnapshotSectionType indexType, SnapshotSectionType ownerType, CIdentifier byId, Identifier T::* organizeField, boost::unordered_map<Identifier, T>& result, bool* found)
+{
+    boost::shared_ptr<const SnapshotReader> snapshot = getSnapshot();
+    
+    // having no links is not an error, same as in the other data layers
+    if(found != NULL)
+        *found = true;
+    
+    int ownerPosition = snapshot->findRecord(ownerType, byId);
+    if(ownerPosition < 0)
+        return;
+    
+    const uint32_t* begin = NULL;
+    const uint32_t* end = NULL;
+    snapshot->getLinkPositions(indexType, ownerPosition, begin, end);
+    
+    for(; begin != end; ++begin)
+    {
+        T link;
+        snapshot->read(*begin, link);
+        result[link.*organizeField] = link;
+    }
+}
+
+template<class T>
+void MappedDataLayer::templateOpenCursor(SnapshotSectionType type, std::auto_ptr<IDataLayerCursor<T> >& cursor, unsigned batchSize)
+{
+    cursor.reset(new Cursor<T>(getSnapshot(), type, batchSize));
+}
+
+} // namespace ProblemSolver
@@ -0,0 +1,443 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "snapshotreader.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <boost/crc.hpp>
+#include <boost/format.hpp>
+
+namespace ProblemSolver
+{
+
+const char* SnapshotFormat::MAGIC = "PSSNAP\0\0";
+
+const uint32_t SnapshotFormat::VERSION;
+const uint32_t SnapshotFormat::MIN_SUPPORTED_VERSION;
+const uint32_t SnapshotFormat::SECTION_ALIGNMENT;
+
+namespace
+{
+
+// record size of every section type, used to validate the section table
+const size_t SECTION_RECORD_SIZES[] =
+{
+    0,
+    1, // strings are counted in strings, but the data is in bytes
+    sizeof(SnapshotString),
+    sizeof(SnapshotCategory),
+    sizeof(SnapshotGenericInfo),
+    sizeof(SnapshotGenericInfo),
+    sizeof(SnapshotGenericInfo),
+    sizeof(SnapshotSymptomLink),
+    sizeof(SnapshotSolutionLink),
+    sizeof(SnapshotInvestigation),
+    sizeof(uint32_t),
+    sizeof(uint32_t),
+    sizeof(uint32_t),
+    sizeof(uint32_t)
+};
+
+const unsigned SECTION_TYPES_COUNT = sizeof(SECTION_RECORD_SIZES) / sizeof(SECTION_RECORD_SIZES[0]);
+
+} // anonymous namespace
+
+SnapshotReader::SnapshotReader(const std::string& fileName, bool verifyChecksum):
+    _fileName(fileName),
+    _file(-1),
+    _data(NULL),
+    _size(0),
+    _header(NULL),
+    _sections(SECTION_TYPES_COUNT, static_cast<const SnapshotSection*>(NULL))
+{
+    _file = open(fileName.c_str(), O_RDONLY);
+    if(_file < 0)
+        throw Exception((boost::format("Could not open snapshot file %s!") % fileName).str());
+    
+    if(fstat(_file, &_fileInfo) != 0 || static_cast<size_t>(_fileInfo.st_size) < sizeof(SnapshotHeader))
+    {
+        close(_file);
+        throw Exception((boost::format("Snapshot file %s is too small!") % fileName).str());
+    }
+    
+    _size = _fileInfo.st_size;
+    
+    void* mapping = mmap(NULL, _size, PROT_READ, MAP_SHARED, _file, 0);
+    if(mapping == MAP_FAILED)
+    {
+        close(_file);
+        throw Exception((boost::format("Could not map snapshot file %s!") % fileName).str());
+    }
+    
+    _data = static_cast<const char*>(mapping);
+    _header = reinterpret_cast<const SnapshotHeader*>(_data);
+    
+    try
+    {
+        validate(verifyChecksum);
+    }
+    catch(...)
+    {
+        munmap(const_cast<char*>(_data), _size);
+        close(_file);
+        throw;
+    }
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    munmap(const_cast<char*>(_data), _size);
+    close(_file);
+}
+
+unsigned SnapshotReader::getRecordCount(SnapshotSectionType type) const
+{
+    if(static_cast<unsigned>(type) >= _sections.size() || _sections[type] == NULL)
+        return 0;
+    
+    return _sections[type]->recordCount;
+}
+
+int SnapshotReader::findRecord(SnapshotSectionType type, CIdentifier id) const
+{
+    const SnapshotSection* section = _sections[type];
+    if(section == NULL || section->recordCount == 0)
+        return -1;
+    
+    // IDs are kept in their text form
+    char idText[Identifier::STRING_SIZE];
+    unsigned idLength = id.toString(idText);
+    
+    // every record starts with its ID
+    size_t recordSize = SECTION_RECORD_SIZES[type];
+    const char* records = _data + section->offset;
+    
+    unsigned first = 0;
+    unsigned last = section->recordCount;
+    while(first < last)
+    {
+        unsigned middle = first + (last - first) / 2;
+        int comparison = compareString(*reinterpret_cast<const SnapshotString*>(records + middle * recordSize), idText, idLength);
+        
+        if(comparison == 0)
+            return middle;
+        
+        if(comparison < 0)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    
+    return -1;
+}
+
+bool SnapshotReader::getLinkPositions(SnapshotSectionType indexType, unsigned ownerIndex, const uint32_t*& begin, const uint32_t*& end) const
+{
+    const SnapshotSection* section = _sections[indexType];
+    if(section == NULL)
+        return false;
+    
+    uint32_t ownerCount = 0;
+    switch(indexType)
+    {
+        case snapshotSectionSymptomLinksByProblem:
+        case snapshotSectionSolutionLinksByProblem:
+            ownerCount = getRecordCount(snapshotSectionProblems);
+            break;
+        case snapshotSectionSymptomLinksBySymptom:
+            ownerCount = getRecordCount(snapshotSectionSymptoms);
+            break;
+        case snapshotSectionSolutionLinksBySolution:
+            ownerCount = getRecordCount(snapshotSectionSolutions);
+            break;
+        default:
+            throw Exception((boost::format("Section %u is not a link index!") % indexType).str());
+    }
+    
+    if(ownerIndex >= ownerCount || static_cast<uint64_t>(ownerCount) + 1 > section->recordCount)
+        throw Exception((boost::format("Record %u is outside of index %u of snapshot %s!") % ownerIndex % indexType % _fileName).str());
+    
+    // the offsets are the first part of the index, the positions are after them
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(_data + section->offset);
+    const uint32_t* positions = offsets + ownerCount + 1;
+    uint64_t positionsCount = section->recordCount - (static_cast<uint64_t>(ownerCount) + 1);
+    
+    if(offsets[ownerIndex] > offsets[ownerIndex + 1] || offsets[ownerIndex + 1] > positionsCount)
+        throw Exception((boost::format("Index %u of snapshot %s is corrupted!") % indexType % _fileName).str());
+    
+    begin = positions + offsets[ownerIndex];
+    end = positions + offsets[ownerIndex + 1];
+    
+    return true;
+}
+
+void SnapshotReader::read(unsigned index, Problem& result) const
+{
+    readGeneric(getRecord<SnapshotGenericInfo>(snapshotSectionProblems, index), result);
+}
+
+void SnapshotReader::read(unsigned index, Symptom& result) const
+{
+    readGeneric(getRecord<SnapshotGenericInfo>(snapshotSectionSymptoms, index), result);
+}
+
+void SnapshotReader::read(unsigned index, Solution& result) const
+{
+    readGeneric(getRecord<SnapshotGenericInfo>(snapshotSectionSolutions, index), result);
+}
+
+void SnapshotReader::read(unsigned index, Category& result) const
+{
+    const SnapshotCategory& record = getRecord<SnapshotCategory>(snapshotSectionCategories, index);
+    
+    result.id = getIdentifier(record.id);
+    result.name = getString(record.name);
+    result.description = getString(record.description);
+    result.parent = getIdentifier(record.parent);
+    
+    result.childs.clear();
+    getList(record.childs, result.childs);
+}
+
+void SnapshotReader::read(unsigned index, ExtendedProblem& result) const
+{
+    readGeneric(getRecord<SnapshotGenericInfo>(snapshotSectionProblems, index), result, result);
+}
+
+void SnapshotReader::read(unsigned index, ExtendedSymptom& result) const
+{
+    readGeneric(getRecord<SnapshotGenericInfo>(snapshotSectionSymptoms, index), result, result);
+}
+
+void SnapshotReader::read(unsigned index, ExtendedSolution& result) const
+{
+    readGeneric(getRecord<SnapshotGenericInfo>(snapshotSectionSolutions, index), result, result);
+}
+
+void SnapshotReader::read(unsigned index, SymptomLink& result) const
+{
+    const SnapshotSymptomLink& record = getRecord<SnapshotSymptomLink>(snapshotSectionSymptomLinks, index);
+    
+    result.id = getIdentifier(record.id);
+    result.problemID = getIdentifier(record.problemID);
+    result.symptomID = getIdentifier(record.symptomID);
+    result.positiveChecks = record.positiveChecks;
+    result.falsePositiveChecks = record.falsePositiveChecks;
+    result.negativeChecks = record.negativeChecks;
+    result.confirmed = record.confirmed != 0;
+}
+
+void SnapshotReader::read(unsigned index, SolutionLink& result) const
+{
+    const SnapshotSolutionLink& record = getRecord<SnapshotSolutionLink>(snapshotSectionSolutionLinks, index);
+    
+    result.id = getIdentifier(record.id);
+    result.problemID = getIdentifier(record.problemID);
+    result.solutionID = getIdentifier(record.solutionID);
+    result.positive = record.positive;
+    result.negative = record.negative;
+    result.confirmed = record.confirmed != 0;
+}
+
+void SnapshotReader::read(unsigned index, Investigation& result) const
+{
+    const SnapshotInvestigation& record = getRecord<SnapshotInvestigation>(snapshotSectionInvestigations, index);
+    
+    result = Investigation();
+    result.id = getIdentifier(record.id);
+    result.closed = record.closed != 0;
+    result.positiveProblem = getIdentifier(record.positiveProblem);
+    result.positiveSolution = getIdentifier(record.positiveSolution);
+    
+    getList(record.positiveSymptoms, result.positiveSymptoms);
+    getList(record.negativeSymptoms, result.negativeSymptoms);
+    getList(record.bannedSymptoms, result.bannedSymptoms);
+    getList(record.negativeProblems, result.negativeProblems);
+    getList(record.bannedProblems, result.bannedProblems);
+    getList(record.negativeSolutions, result.negativeSolutions);
+    getList(record.bannedSolutions, result.bannedSolutions);
+}
+
+void SnapshotReader::load(IDataLayer& target, bool withInvestigations) const
+{
+    loadSection<Category>(snapshotSectionCategories, target);
+    loadSection<ExtendedProblem>(snapshotSectionProblems, target);
+    loadSection<ExtendedSymptom>(snapshotSectionSymptoms, target);
+    loadSection<ExtendedSolution>(snapshotSectionSolutions, target);
+    loadSection<SymptomLink>(snapshotSectionSymptomLinks, target);
+    loadSection<SolutionLink>(snapshotSectionSolutionLinks, target);
+    
+    if(withInvestigations)
+        loadSection<Investigation>(snapshotSectionInvestigations, target);
+}
+
+/**
+ * Checks everything that is later used without checking, so that corrupted files can not cause reads outside the mapping
+ */
+void SnapshotReader::validate(bool verifyChecksum)
+{
+    if(memcmp(_header->magic, SnapshotFormat::MAGIC, sizeof(_header->magic)) != 0)
+        throw Exception((boost::format("File %s is not a snapshot!") % _fileName).str());
+    
+    if(_header->version < SnapshotFormat::MIN_SUPPORTED_VERSION || _header->version > SnapshotFormat::VERSION)
+        throw Exception((boost::format("Snapshot %s has version %u, but only versions %u to %u are supported!")
+                         % _fileName % _header->version % SnapshotFormat::MIN_SUPPORTED_VERSION % SnapshotFormat::VERSION).str());
+    
+    if(_header->fileSize != _size)
+        throw Exception((boost::format("Snapshot %s is truncated!") % _fileName).str());
+    
+    uint64_t sectionTableEnd = sizeof(SnapshotHeader) + static_cast<uint64_t>(_header->sectionCount) * sizeof(SnapshotSection);
+    if(sectionTableEnd > _size)
+        throw Exception((boost::format("Snapshot %s has invalid section table!") % _fileName).str());
+    
+    if(verifyChecksum)
+    {
+        boost::crc_32_type checksum;
+        checksum.process_bytes(_data + sizeof(SnapshotHeader), _size - sizeof(SnapshotHeader));
+        
+        if(checksum.checksum() != _header->checksum)
+            throw Exception((boost::format("Snapshot %s is corrupted, checksum does not match!") % _fileName).str());
+    }
+    
+    const SnapshotSection* sections = reinterpret_cast<const SnapshotSection*>(_data + sizeof(SnapshotHeader));
+    for(unsigned i = 0; i < _header->sectionCount; ++i)
+    {
+        const SnapshotSection& section = sections[i];
+        
+        // unknown sections are skipped so newer writers can add data without breaking older readers
+        if(section.type == 0 || section.type >= SECTION_TYPES_COUNT)
+            continue;
+        
+        if(section.offset % SnapshotFormat::SECTION_ALIGNMENT != 0 ||
+           section.offset < sectionTableEnd || section.offset > _size || section.size > _size - section.offset ||
+           (section.type != snapshotSectionStrings && section.size != static_cast<uint64_t>(section.recordCount) * SECTION_RECORD_SIZES[section.type]))
+        {
+            throw Exception((boost::format("Snapshot %s has invalid section %u!") % _fileName % section.type).str());
+        }
+        
+        _sections[section.type] = &section;
+    }
+    
+    if(_sections[snapshotSectionStrings] == NULL || _sections[snapshotSectionLists] == NULL)
+        throw Exception((boost::format("Snapshot %s has no strings or lists!") % _fileName).str());
+}
+
+template<class R>
+const R& SnapshotReader::getRecord(SnapshotSectionType type, unsigned index) const
+{
+    if(index >= getRecordCount(type))
+        throw Exception((boost::format("Record %u is outside of section %u of snapshot %s!") % index % type % _fileName).str());
+    
+    return reinterpret_cast<const R*>(_data + _sections[type]->offset)[index];
+}
+
+template<class T>
+void SnapshotReader::loadSection(SnapshotSectionType type, IDataLayer& target) const
+{
+    unsigned count = getRecordCount(type);
+    for(unsigned i = 0; i < count; ++i)
+    {
+        T object;
+        read(i, object);
+        target.modify(object);
+    }
+}
+
+void SnapshotReader::readGeneric(const SnapshotGenericInfo& record, GenericInfo& info) const
+{
+    info.id = getIdentifier(record.id);
+    info.categoryID = getIdentifier(record.categoryID);
+    info.difficulty = static_cast<DifficultyLevel>(record.difficulty);
+    info.confirmed = record.confirmed != 0;
+}
+
+void SnapshotReader::readGeneric(const SnapshotGenericInfo& record, GenericInfo& info, ExtendedGenericInfo& extendedInfo) const
+{
+    readGeneric(record, info);
+    
+    extendedInfo.name = getString(record.name);
+    extendedInfo.description = getString(record.description);
+    
+    extendedInfo.tags.clear();
+    getList(record.tags, extendedInfo.tags);
+    
+    extendedInfo.steps.clear();
+    getList(record.steps, extendedInfo.steps);
+}
+
+std::string SnapshotReader::getString(const SnapshotString& value) const
+{
+    const SnapshotSection* strings = _sections[snapshotSectionStrings];
+    if(static_cast<uint64_t>(value.offset) + value.length >= strings->size)
+        throw Exception((boost::format("String outside of the strings of snapshot %s!") % _fileName).str());
+    
+    return std::string(_data + strings->offset + value.offset, value.length);
+}
+
+Identifier SnapshotReader::getIdentifier(const SnapshotString& value) const
+{
+    const SnapshotSection* strings = _sections[snapshotSectionStrings];
+    if(static_cast<uint64_t>(value.offset) + value.length >= strings->size)
+        throw Exception((boost::format("String outside of the strings of snapshot %s!") % _fileName).str());
+    
+    Identifier result;
+    if(!Identifier::parse(_data + strings->offset + value.offset, value.length, result))
+        throw Exception((boost::format("Invalid identifier in snapshot %s!") % _fileName).str());
+    
+    return result;
+}
+
+int SnapshotReader::compareString(const SnapshotString& value, const char* compare, size_t compareLength) const
+{
+    const SnapshotSection* strings = _sections[snapshotSectionStrings];
+    if(static_cast<uint64_t>(value.offset) + value.length >= strings->size)
+        throw Exception((boost::format("String outside of the strings of snapshot %s!") % _fileName).str());
+    
+    // same order as std::string comparison used by the writer
+    int result = memcmp(_data + strings->offset + value.offset, compare, std::min<size_t>(value.length, compareLength));
+    if(result != 0)
+        return result;
+    
+    if(value.length == compareLength)
+        return 0;
+    
+    return value.length < compareLength ? -1 : 1;
+}
+
+void SnapshotReader::getValue(const SnapshotString& value, std::string& result) const
+{
+    result = getString(value);
+}
+
+void SnapshotReader::getValue(const SnapshotString& value, Identifier& result) const
+{
+    result = getIdentifier(value);
+}
+
+template<class T>
+void SnapshotReader::getList(const SnapshotList& value, T& result) const
+{
+    const SnapshotSection* lists = _sections[snapshotSectionLists];
+    if(static_cast<uint64_t>(value.first) + value.count > lists->recordCount)
+        throw Exception((boost::format("List outside of the lists of snapshot %s!") % _fileName).str());
+    
+    const SnapshotString* values = reinterpret_cast<const SnapshotString*>(_data + lists->offset) + value.first;
+    for(unsigned i = 0; i < value.count; ++i)
+    {
+        typename T::value_type item;
+        getValue(values[i], item);
+        result.insert(result.end(), item);
+    }
+}
+
+} // namespace ProblemSolver
@@ -0,0 +1,381 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "snapshotwriter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <boost/crc.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+
+namespace ProblemSolver
+{
+
+const unsigned SnapshotWriter::DEFAULT_BATCH_SIZE;
+
+namespace
+{
+
+/**
+ * Orders objects by their ID
+ */
+template<class T>
+bool compareByID(const T& first, const T& second)
+{
+    return first.id < second.id;
+}
+
+/**
+ * Adds zeros to data until its size is aligned
+ */
+void alignData(std::string& data, size_t alignment)
+{
+    data.resize((data.size() + alignment - 1) / alignment * alignment, '\0');
+}
+
+} // anonymous namespace
+
+uint64_t SnapshotWriter::write(IDataLayerRead& dataLayer, const std::string& fileName, unsigned batchSize)
+{
+    clear();
+    
+    // objects first, as they fill the strings and the lists
+    addSection<Category, SnapshotCategory>(dataLayer, snapshotSectionCategories, batchSize);
+    addSection<ExtendedProblem, SnapshotGenericInfo>(dataLayer, snapshotSectionProblems, batchSize);
+    addSection<ExtendedSymptom, SnapshotGenericInfo>(dataLayer, snapshotSectionSymptoms, batchSize);
+    addSection<ExtendedSolution, SnapshotGenericInfo>(dataLayer, snapshotSectionSolutions, batchSize);
+    addSection<SymptomLink, SnapshotSymptomLink>(dataLayer, snapshotSectionSymptomLinks, batchSize);
+    addSection<SolutionLink, SnapshotSolutionLink>(dataLayer, snapshotSectionSolutionLinks, batchSize);
+    addSection<Investigation, SnapshotInvestigation>(dataLayer, snapshotSectionInvestigations, batchSize);
+    
+    addLinkIndex(snapshotSectionSymptomLinksByProblem, snapshotSectionProblems, snapshotSectionSymptomLinks, &SnapshotSymptomLink::problemID);
+    addLinkIndex(snapshotSectionSymptomLinksBySymptom, snapshotSectionSymptoms, snapshotSectionSymptomLinks, &SnapshotSymptomLink::symptomID);
+    addLinkIndex(snapshotSectionSolutionLinksByProblem, snapshotSectionProblems, snapshotSectionSolutionLinks, &SnapshotSolutionLink::problemID);
+    addLinkIndex(snapshotSectionSolutionLinksBySolution, snapshotSectionSolutions, snapshotSectionSolutionLinks, &SnapshotSolutionLink::solutionID);
+    
+    PendingSection strings;
+    strings.type = snapshotSectionStrings;
+    strings.recordCount = _stringIndex.size();
+    strings.data.swap(_strings);
+    _sections.insert(_sections.begin(), strings);
+    
+    PendingSection lists;
+    lists.type = snapshotSectionLists;
+    lists.recordCount = _lists.size();
+    if(!_lists.empty())
+        lists.data.assign(reinterpret_cast<const char*>(&_lists[0]), _lists.size() * sizeof(SnapshotString));
+    _sections.insert(_sections.begin() + 1, lists);
+    
+    // everything after the header is assembled in memory so the checksum can be calculated before writing
+    std::vector<SnapshotSection> sectionTable(_sections.size());
+    uint64_t offset = sizeof(SnapshotHeader) + sectionTable.size() * sizeof(SnapshotSection);
+    offset = (offset + SnapshotFormat::SECTION_ALIGNMENT - 1) / SnapshotFormat::SECTION_ALIGNMENT * SnapshotFormat::SECTION_ALIGNMENT;
+    
+    for(unsigned i = 0; i < _sections.size(); ++i)
+    {
+        sectionTable[i].type = _sections[i].type;
+        sectionTable[i].recordCount = _sections[i].recordCount;
+        sectionTable[i].offset = offset;
+        sectionTable[i].size = _sections[i].data.size();
+        
+        offset += (_sections[i].data.size() + SnapshotFormat::SECTION_ALIGNMENT - 1) / SnapshotFormat::SECTION_ALIGNMENT * SnapshotFormat::SECTION_ALIGNMENT;
+    }
+    
+    std::string body(reinterpret_cast<const char*>(&sectionTable[0]), sectionTable.size() * sizeof(SnapshotSection));
+    body.reserve(offset - sizeof(SnapshotHeader));
+    alignData(body, SnapshotFormat::SECTION_ALIGNMENT);
+    
+    BOOST_FOREACH(PendingSection& section, _sections)
+    {
+        body.append(section.data);
+        alignData(body, SnapshotFormat::SECTION_ALIGNMENT);
+        
+        std::string().swap(section.data);
+    }
+    
+    boost::crc_32_type checksum;
+    checksum.process_bytes(body.data(), body.size());
+    
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SnapshotFormat::MAGIC, sizeof(header.magic));
+    header.version = SnapshotFormat::VERSION;
+    header.sectionCount = sectionTable.size();
+    header.fileSize = sizeof(header) + body.size();
+    header.createdAt = time(NULL);
+    header.checksum = checksum.checksum();
+    
+    std::string temporaryFileName = fileName + ".tmp";
+    
+    FILE* file = fopen(temporaryFileName.c_str(), "wb");
+    if(file == NULL)
+        throw Exception((boost::format("Could not create snapshot file %s!") % temporaryFileName).str());
+    
+    bool written = (fwrite(&header, sizeof(header), 1, file) == 1 &&
+                    fwrite(body.data(), 1, body.size(), file) == body.size() &&
+                    fflush(file) == 0 &&
+                    fsync(fileno(file)) == 0);
+    
+    if(fclose(file) != 0 || !written)
+    {
+        unlink(temporaryFileName.c_str());
+        throw Exception((boost::format("Could not write snapshot file %s!") % temporaryFileName).str());
+    }
+    
+    if(rename(temporaryFileName.c_str(), fileName.c_str()) != 0)
+    {
+        unlink(temporaryFileName.c_str());
+        throw Exception((boost::format("Could not rename snapshot file %s to %s!") % temporaryFileName % fileName).str());
+    }
+    
+    clear();
+    
+    return header.fileSize;
+}
+
+/**
+ * Reads all objects of type T and converts them into a section of R records sorted by ID
+ */
+template<class T, class R>
+void SnapshotWriter::addSection(IDataLayerRead& dataLayer, SnapshotSectionType type, unsigned batchSize)
+{
+    typedef boost::unordered_map<Identifier, T> ValueMap;
+    
+    std::vector<T> objects;
+    
+    std::auto_ptr<IDataLayerCursor<T> > cursor;
+    dataLayer.openCursor(cursor, batchSize);
+    
+    ValueMap batch;
+    while(cursor->next(batch))
+    {
+        BOOST_FOREACH(const typename ValueMap::value_type& pair, batch)
+        {
+            objects.push_back(pair.second);
+        }
+    }
+    
+    std::sort(objects.begin(), objects.end(), compareByID<T>);
+    
+    std::vector<R> records(objects.size());
+    for(unsigned i = 0; i < objects.size(); ++i)
+    {
+        memset(&records[i], 0, sizeof(R));
+        fillRecord(objects[i], records[i]);
+    }
+    
+    _sections.push_back(PendingSection());
+    _sections.back().type = type;
+    _sections.back().recordCount = records.size();
+    if(!records.empty())
+        _sections.back().data.assign(reinterpret_cast<const char*>(&records[0]), records.size() * sizeof(R));
+}
+
+void SnapshotWriter::fillRecord(const Category& category, SnapshotCategory& record)
+{
+    record.id = addString(category.id);
+    record.name = addString(category.name);
+    record.description = addString(category.description);
+    record.parent = addString(category.parent);
+    record.childs = addList(category.childs);
+}
+
+void SnapshotWriter::fillRecord(const ExtendedProblem& problem, SnapshotGenericInfo& record)
+{
+    fillGenericRecord(problem, problem, record);
+}
+
+void SnapshotWriter::fillRecord(const ExtendedSymptom& symptom, SnapshotGenericInfo& record)
+{
+    fillGenericRecord(symptom, symptom, record);
+}
+
+void SnapshotWriter::fillRecord(const ExtendedSolution& solution, SnapshotGenericInfo& record)
+{
+    fillGenericRecord(solution, solution, record);
+}
+
+void SnapshotWriter::fillRecord(const SymptomLink& symptomLink, SnapshotSymptomLink& record)
+{
+    record.id = addString(symptomLink.id);
+    record.problemID = addString(symptomLink.problemID);
+    record.symptomID = addString(symptomLink.symptomID);
+    record.positiveChecks = symptomLink.positiveChecks;
+    record.falsePositiveChecks = symptomLink.falsePositiveChecks;
+    record.negativeChecks = symptomLink.negativeChecks;
+    record.confirmed = symptomLink.confirmed;
+}
+
+void SnapshotWriter::fillRecord(const SolutionLink& solutionLink, SnapshotSolutionLink& record)
+{
+    record.id = addString(solutionLink.id);
+    record.problemID = addString(solutionLink.problemID);
+    record.solutionID = addString(solutionLink.solutionID);
+    record.positive = solutionLink.positive;
+    record.negative = solutionLink.negative;
+    record.confirmed = solutionLink.confirmed;
+}
+
+void SnapshotWriter::fillRecord(const Investigation& investigation, SnapshotInvestigation& record)
+{
+    record.id = addString(investigation.id);
+    record.positiveProblem = addString(investigation.positiveProblem);
+    record.positiveSolution = addString(investigation.positiveSolution);
+    record.positiveSymptoms = addList(investigation.positiveSymptoms);
+    record.negativeSymptoms = addList(investigation.negativeSymptoms);
+    record.bannedSymptoms = addList(investigation.bannedSymptoms);
+    record.negativeProblems = addList(investigation.negativeProblems);
+    record.bannedProblems = addList(investigation.bannedProblems);
+    record.negativeSolutions = addList(investigation.negativeSolutions);
+    record.bannedSolutions = addList(investigation.bannedSolutions);
+    record.closed = investigation.closed;
+}
+
+void SnapshotWriter::fillGenericRecord(const GenericInfo& info, const ExtendedGenericInfo& extendedInfo, SnapshotGenericInfo& record)
+{
+    record.id = addString(info.id);
+    record.categoryID = addString(info.categoryID);
+    record.difficulty = info.difficulty;
+    record.confirmed = info.confirmed;
+    
+    record.name = addString(extendedInfo.name);
+    record.description = addString(extendedInfo.description);
+    
+    // keep the snapshot the same for the same data
+    std::vector<std::string> sortedTags(extendedInfo.tags.begin(), extendedInfo.tags.end());
+    std::sort(sortedTags.begin(), sortedTags.end());
+    
+    record.tags = addList(sortedTags);
+    record.steps = addList(extendedInfo.steps);
+}
+
+/**
+ * Builds the CSR index of the links by the object they point to with ownerField.
+ * Strings are kept only once, so an ID can be matched just by the offset of its string.
+ */
+template<class R>
+void SnapshotWriter::addLinkIndex(SnapshotSectionType type, SnapshotSectionType ownerType, SnapshotSectionType linkType, SnapshotString R::* ownerField)
+{
+    const PendingSection& owners = getPendingSection(ownerType);
+    const PendingSection& links = getPendingSection(linkType);
+    
+    const SnapshotGenericInfo* ownerRecords = reinterpret_cast<const SnapshotGenericInfo*>(owners.data.data());
+    const R* linkRecords = reinterpret_cast<const R*>(links.data.data());
+    
+    // string offset of an owner ID -> position of the owner record
+    boost::unordered_map<uint32_t, uint32_t> ownerPositions;
+    for(uint32_t i = 0; i < owners.recordCount; ++i)
+    {
+        ownerPositions[ownerRecords[i].id.offset] = i;
+    }
+    
+    // count the links of every owner, the counts are then turned into offsets
+    std::vector<uint32_t> offsets(owners.recordCount + 1, 0);
+    std::vector<int64_t> linkOwners(links.recordCount, -1);
+    for(uint32_t i = 0; i < links.recordCount; ++i)
+    {
+        boost::unordered_map<uint32_t, uint32_t>::const_iterator owner = ownerPositions.find((linkRecords[i].*ownerField).offset);
+        if(owner != ownerPositions.end())
+        {
+            linkOwners[i] = owner->second;
+            ++offsets[owner->second + 1];
+        }
+    }
+    
+    for(uint32_t i = 1; i < offsets.size(); ++i)
+    {
+        offsets[i] += offsets[i - 1];
+    }
+    
+    std::vector<uint32_t> index(offsets);
+    index.resize(offsets.size() + offsets.back());
+    
+    std::vector<uint32_t> nextPosition(offsets.begin(), offsets.end() - 1);
+    for(uint32_t i = 0; i < links.recordCount; ++i)
+    {
+        if(linkOwners[i] >= 0)
+            index[offsets.size() + nextPosition[linkOwners[i]]++] = i;
+    }
+    
+    _sections.push_back(PendingSection());
+    _sections.back().type = type;
+    _sections.back().recordCount = index.size();
+    _sections.back().data.assign(reinterpret_cast<const char*>(&index[0]), index.size() * sizeof(uint32_t));
+}
+
+const SnapshotWriter::PendingSection& SnapshotWriter::getPendingSection(SnapshotSectionType type) const
+{
+    BOOST_FOREACH(const PendingSection& section, _sections)
+    {
+        if(section.type == type)
+            return section;
+    }
+    
+    throw Exception((boost::format("Missing snapshot section %u!") % type).str());
+}
+
+/**
+ * Adds the string in the strings section if it is not already there
+ */
+SnapshotString SnapshotWriter::addString(const std::string& value)
+{
+    boost::unordered_map<std::string, SnapshotString>::const_iterator it = _stringIndex.find(value);
+    if(it != _stringIndex.end())
+        return it->second;
+    
+    if(_strings.size() + value.size() + 1 > 0xFFFFFFFFu)
+        throw Exception("Snapshot strings exceed 4GB!");
+    
+    SnapshotString result;
+    result.offset = _strings.size();
+    result.length = value.size();
+    
+    _strings.append(value);
+    _strings.push_back('\0');
+    
+    _stringIndex[value] = result;
+    
+    return result;
+}
+
+/**
+ * Identifiers are kept in their text form, in the same order as the records sorted by ID
+ */
+SnapshotString SnapshotWriter::addString(CIdentifier value)
+{
+    return addString(value.toString());
+}
+
+template<class T>
+SnapshotList SnapshotWriter::addList(const T& values)
+{
+    SnapshotList result;
+    result.first = _lists.size();
+    result.count = values.size();
+    
+    BOOST_FOREACH(const typename T::value_type& value, values)
+    {
+        _lists.push_back(addString(value));
+    }
+    
+    return result;
+}
+
+void SnapshotWriter::clear()
+{
+    std::string().swap(_strings);
+    _stringIndex.clear();
+    std::vector<SnapshotString>().swap(_lists);
+    _sections.clear();
+}
+
+} // namespace ProblemSolver
@@ -7,7 +7,188 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <string.h>
 #include <string>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
 
-typedef std::string Identifier;
-typedef const std::string& CIdentifier;
\ No newline at end of file
+/**
+ * Identifier of an object: 12 bytes, the size of a Mongo ObjectId.
+ * It is a plain value, copies and comparisons never allocate. The text form (24 lower case hex digits)
+ * is used only in JSON, BSON and other external formats. An identifier with all bytes 0 is empty,
+ * its text form is an empty string.
+ */
+class Identifier
+{
+public:
+    
+    static const unsigned SIZE = 12; // bytes
+    static const unsigned STRING_SIZE = 2 * SIZE; // hex digits
+    
+public:
+    
+    Identifier() { clear(); }
+    
+    /**
+     * Parses the text form, throws std::invalid_argument if the text is not empty or 24 hex digits
+     */
+    explicit Identifier(const std::string& text)
+    {
+        if(!parse(text, *this))
+            throw std::invalid_argument("Invalid identifier " + text);
+    }
+    
+public:
+    
+    /**
+     * Parses the text form, returns false if the text is not empty or 24 hex digits
+     */
+    static bool parse(const std::string& text, Identifier& result)
+    {
+        return parse(text.data(), text.size(), result);
+    }
+    
+    static bool parse(const char* text, size_t length, Identifier& result)
+    {
+        if(length == 0)
+        {
+            result.clear();
+            return true;
+        }
+        
+        if(length != STRING_SIZE)
+            return false;
+        
+        unsigned char* bytes = result.getBytes();
+        for(unsigned i = 0; i < SIZE; ++i)
+        {
+            int high = getDigitValue(text[2 * i]);
+            int low = getDigitValue(text[2 * i + 1]);
+            if(high < 0 || low < 0)
+                return false;
+            
+            bytes[i] = static_cast<unsigned char>((high << 4) | low);
+        }
+        
+        return true;
+    }
+    
+    /**
+     * Makes an identifier of SIZE bytes
+     */
+    static Identifier fromBytes(const void* bytes)
+    {
+        Identifier result;
+        memcpy(result._words, bytes, SIZE);
+        return result;
+    }
+    
+public:
+    
+    std::string toString() const
+    {
+        char text[STRING_SIZE];
+        return std::string(text, toString(text));
+    }
+    
+    /**
+     * Writes the text form without a terminating zero to result (of at least STRING_SIZE chars), returns its length
+     */
+    unsigned toString(char* result) const
+    {
+        if(empty())
+            return 0;
+        
+        static const char digits[] = "0123456789abcdef";
+        
+        const unsigned char* bytes = getBytes();
+        for(unsigned i = 0; i < SIZE; ++i)
+        {
+            result[2 * i] = digits[bytes[i] >> 4];
+            result[2 * i + 1] = digits[bytes[i] & 0x0f];
+        }
+        
+        return STRING_SIZE;
+    }
+    
+    const unsigned char* getBytes() const { return reinterpret_cast<const unsigned char*>(_words); }
+    unsigned char* getBytes() { return reinterpret_cast<unsigned char*>(_words); }
+    
+    bool empty() const { return (_words[0] | _words[1] | _words[2]) == 0; }
+    void clear() { _words[0] = _words[1] = _words[2] = 0; }
+    
+public:
+    
+    bool operator == (const Identifier& compare) const
+    {
+        return (_words[0] == compare._words[0] &&
+                _words[1] == compare._words[1] &&
+                _words[2] == compare._words[2]);
+    }
+    
+    bool operator != (const Identifier& compare) const { return !operator==(compare); }
+    
+    /**
+     * Orders identifiers like their text forms
+     */
+    bool operator < (const Identifier& compare) const { return memcmp(_words, compare._words, SIZE) < 0; }
+    
+    /**
+     * The last bytes of an ObjectId (the counter) differ the most, they are mixed into all bits of the hash
+     */
+    friend size_t hash_value(const Identifier& id)
+    {
+        uint64_t hash = (static_cast<uint64_t>(id._words[2]) << 32) ^ (static_cast<uint64_t>(id._words[1]) << 16) ^ id._words[0];
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return static_cast<size_t>(hash);
+    }
+    
+private:
+    
+    static int getDigitValue(char digit)
+    {
+        if(digit >= '0' && digit <= '9')
+            return digit - '0';
+        if(digit >= 'a' && digit <= 'f')
+            return digit - 'a' + 10;
+        if(digit >= 'A' && digit <= 'F')
+            return digit - 'A' + 10;
+        
+        return -1;
+    }
+    
+private:
+    
+    uint32_t _words[SIZE / sizeof(uint32_t)];
+};
+
+typedef const Identifier& CIdentifier;
+
+inline std::ostream& operator << (std::ostream& stream, const Identifier& id)
+{
+    return stream << id.toString();
+}
+
+/**
+ * Reads the text form, an invalid identifier sets the failbit of the stream.
+ * Nothing (the end of the stream) is read as the empty identifier.
+ */
+inline std::istream& operator >> (std::istream& stream, Identifier& id)
+{
+    if(stream.peek() == std::char_traits<char>::eof())
+    {
+        id.clear();
+        return stream;
+    }
+    
+    std::string text;
+    stream >> text;
+    if(!Identifier::parse(text, id))
+        stream.setstate(std::ios::failbit);
+    
+    return stream;
+}
@@ -0,0 +1,127 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "identifier.h"
+
+#include <vector>
+#include <algorithm>
+#include <boost/unordered_set.hpp>
+
+/**
+ * Ordered list of identifiers with a fast contains.
+ * The identifiers keep the order they were added in (it is the order they are serialized in). Short lists are
+ * searched linearly, once a list grows over INDEX_THRESHOLD identifiers it also keeps a hashed index of them.
+ * Like a vector it can hold the same identifier more than once. The identifiers can not be changed in place,
+ * only added and removed, so the index is always up to date.
+ */
+class IdentifierList
+{
+public:
+
+    static const unsigned INDEX_THRESHOLD = 16;
+
+    typedef Identifier value_type;
+    typedef std::vector<Identifier>::const_iterator const_iterator;
+    typedef const_iterator iterator;
+
+public:
+
+    IdentifierList(){}
+
+    explicit IdentifierList(const std::vector<Identifier>& items):
+        _items(items)
+    {
+        updateIndex();
+    }
+
+public:
+
+    void push_back(CIdentifier id)
+    {
+        _items.push_back(id);
+
+        if(!_index.empty())
+            _index.insert(id);
+        else
+            updateIndex();
+    }
+
+    const_iterator insert(const_iterator position, CIdentifier id)
+    {
+        std::vector<Identifier>::iterator result = _items.insert(_items.begin() + (position - _items.begin()), id);
+
+        if(!_index.empty())
+            _index.insert(id);
+        else
+            updateIndex();
+
+        return result;
+    }
+
+    /**
+     * Removes the first occurrence of id, returns false if there was none
+     */
+    bool remove(CIdentifier id)
+    {
+        std::vector<Identifier>::iterator it = std::find(_items.begin(), _items.end(), id);
+        if(it == _items.end())
+            return false;
+
+        _items.erase(it);
+
+        if(!_index.empty())
+            _index.erase(_index.find(id));
+
+        return true;
+    }
+
+    void clear()
+    {
+        _items.clear();
+        _index.clear();
+    }
+
+    void reserve(size_t size) { _items.reserve(size); }
+
+public:
+
+    bool contains(CIdentifier id) const
+    {
+        if(!_index.empty())
+            return _index.find(id) != _index.end();
+
+        return std::find(_items.begin(), _items.end(), id) != _items.end();
+    }
+
+    size_t size() const { return _items.size(); }
+    bool empty() const { return _items.empty(); }
+
+    CIdentifier operator [] (size_t position) const { return _items[position]; }
+
+    const_iterator begin() const { return _items.begin(); }
+    const_iterator end() const { return _items.end(); }
+
+    const std::vector<Identifier>& getItems() const { return _items; }
+
+    bool operator == (const IdentifierList& compare) const { return _items == compare._items; }
+    bool operator != (const IdentifierList& compare) const { return _items != compare._items; }
+
+private:
+
+    void updateIndex()
+    {
+        if(_items.size() > INDEX_THRESHOLD)
+            _index.insert(_items.begin(), _items.end());
+    }
+
+private:
+
+    std::vector<Identifier> _items;
+    boost::unordered_multiset<Identifier> _index; // empty while the list is short
+};
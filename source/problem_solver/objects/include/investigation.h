@@ -7,16 +7,15 @@
 
 #pragma once
 
-#include "identifier.h"
-
-#include <vector>
+#include "identifierlist.h"
 
 namespace ProblemSolver
 {
 
 /**
  * Holds information about one investigation that has been performed.
- * It is related to some problem we need to identify and/or fix
+ * It is related to some problem we need to identify and/or fix.
+ * The lists keep the order the objects were checked in and answer contains without searching.
  */
 struct Investigation
 {
@@ -27,15 +26,15 @@ struct Investigation
     Identifier positiveProblem; // if this is empty it will mean the problem causing the symptoms has been identified
     Identifier positiveSolution; // if this is empty it will mean the solution that fixes the problem has been identified
     
-    std::vector<Identifier> positiveSymptoms; // symptoms that have been verified as positive
-    std::vector<Identifier> negativeSymptoms; // symptoms that have been verified as negative
-    std::vector<Identifier> bannedSymptoms; // symptoms that the user did not wish to verify
+    IdentifierList positiveSymptoms; // symptoms that have been verified as positive
+    IdentifierList negativeSymptoms; // symptoms that have been verified as negative
+    IdentifierList bannedSymptoms; // symptoms that the user did not wish to verify
     
-    std::vector<Identifier> negativeProblems; // problems that have been verified as negative
-    std::vector<Identifier> bannedProblems; // problems that the user did not wish to verify
+    IdentifierList negativeProblems; // problems that have been verified as negative
+    IdentifierList bannedProblems; // problems that the user did not wish to verify
     
-    std::vector<Identifier> negativeSolutions; // solutions that have been verified as non-working
-    std::vector<Identifier> bannedSolutions; // solutions that the user did not wish to verify
+    IdentifierList negativeSolutions; // solutions that have been verified as non-working
+    IdentifierList bannedSolutions; // solutions that the user did not wish to verify
 
     Investigation():closed(false){}
     
@@ -10,6 +10,7 @@
 #include "datalayer.h"
 #include "systemmanager.h"
 #include "solvingmachine.h"
+#include "profilingdatalayer.h"
 
 #include <string>
 #include <vector>
@@ -45,6 +46,8 @@ public:
     
     std::string serialize(const SystemManager::SearchResult& searchResult);
     std::string serialize(const SolvingMachine::Suggestion& suggestion);
+    
+    std::string serialize(const DataLayerProfile& profile);
 
 private:
     
@@ -54,6 +57,8 @@ private:
     template<class T>
     void addGenericInfo(const T& object);
     
+    void addCounters(const DataLayerProfile::Counters& counters);
+    
 private:
     
     void addValue(const std::string& value)
@@ -63,6 +68,11 @@ private:
         _result += "\"";
     }
     
+    void addValue(const Identifier& value)
+    {
+        addValue(value.toString());
+    }
+    
     void addValue(bool value)
     {
         _result += value ? "true" : "false";
@@ -173,6 +183,17 @@ public:
         }
     }
     
+    void getArray(IdentifierList& array, const std::string& name, const boost::property_tree::ptree& json)
+    {
+        const boost::property_tree::ptree& node = json.get_child(name);
+        
+        array.reserve(node.size());
+        BOOST_FOREACH(const boost::property_tree::ptree::value_type& value, node)
+        {
+            array.push_back(value.second.get_value<Identifier>());
+        }
+    }
+    
 };
 
 } // namespace ProblemSolver
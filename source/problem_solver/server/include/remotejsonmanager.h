@@ -9,14 +9,25 @@
 
 #include "baseexception.h"
 #include "identifier.h"
+#include "serverstatistics.h"
+#include "requestscheduler.h"
+#include "fibersharedmutex.h"
 
 #include <vector>
+#include <algorithm>
 #include <boost/property_tree/ptree.hpp>
 
+namespace utils
+{
+class FiberScheduler;
+}
+
 namespace ProblemSolver
 {
 
 class SystemManager;
+class IResponseWriter;
+struct Investigation;
     
 /**
  * This class groups all functionality connected with making suggestions about how to identify unknown problems
@@ -25,8 +36,51 @@ class RemoteJsonManager
 {
 public:
     
-    RemoteJsonManager(SystemManager& systemManager);
-    ~RemoteJsonManager(){}
+    /**
+     * Default number of objects read from the data layer at once when all objects of a type are requested
+     */
+    static const unsigned DEFAULT_GET_BATCH_SIZE = 1000;
+    
+    /**
+     * Default number of threads running the independent requests of a parallel batch
+     */
+    static const unsigned DEFAULT_BATCH_THREADS = 4;
+    
+    /**
+     * Default limit of the size of a request in bytes, including the headers
+     */
+    static const unsigned DEFAULT_MAX_REQUEST_SIZE = 1000000;
+    
+    /**
+     * Deepest nesting of objects and arrays accepted in a request. The JSON parser recurses once per level,
+     * so a deeper request could overflow the stack of the thread or fiber parsing it
+     */
+    static const unsigned MAX_JSON_DEPTH = 64;
+    
+    /**
+     * Default milliseconds a client has to send its whole request
+     */
+    static const unsigned DEFAULT_READ_TIMEOUT = 1000;
+    
+    /**
+     * Default milliseconds a client may take no data of its response, the lock of the request is held meanwhile
+     */
+    static const unsigned DEFAULT_WRITE_TIMEOUT = 10000;
+    
+    /**
+     * Default number of threads processing the requests, 0 processes them in the thread accepting the connections
+     */
+    static const unsigned DEFAULT_WORKER_THREADS = 4;
+    
+    /**
+     * Default number of connections the system queues before they are accepted
+     */
+    static const int DEFAULT_LISTEN_BACKLOG = 128;
+    
+public:
+    
+    RemoteJsonManager(SystemManager& systemManager, unsigned getBatchSize = DEFAULT_GET_BATCH_SIZE);
+    ~RemoteJsonManager();
     
 public:
     
@@ -39,13 +93,74 @@ public:
         explicit Exception(const std::string& errorMessage):
             BaseException(errorMessage){}
             
-        virtual ExceptionCode getCode() const { return exceptionCodeSystemManager; }
+        virtual ExceptionCode getCode() const { return exceptionCodeRemoteJsonManager; }
     };
     
 public:
     
     void run(const std::string& host, int port);
     
+    /**
+     * Latencies and counters of all requests processed so far, also returned by the "stats" request
+     */
+    const ServerStatistics& getStatistics() const;
+    
+    /**
+     * Request bodies are logged at debug level. With an interval above 0 every interval-th body is also logged at info level
+     */
+    void setRequestLogInterval(unsigned interval) { _requestLogInterval = interval; }
+    
+    /**
+     * Up to threads requests of a parallel batch run at once. 1 runs every batch in order
+     */
+    void setBatchThreads(unsigned threads) { _batchThreads = std::max(threads, 1u); }
+    
+    /**
+     * Longer requests are rejected
+     */
+    void setMaxRequestSize(unsigned size) { _maxRequestSize = size; }
+    
+    /**
+     * Requests not read in time are rejected, so a slow client does not hold up the thread accepting the connections
+     * or keep its fiber in flight. 0 waits for the clients forever
+     */
+    void setReadTimeout(unsigned timeout) { _readTimeout = timeout; }
+    
+    /**
+     * The response of a client that takes no data for this long is dropped, so a client that stops reading does not keep
+     * the change lock held and stall the other requests. 0 waits for the clients forever
+     */
+    void setWriteTimeout(unsigned timeout) { _writeTimeout = timeout; }
+    
+    /**
+     * Set before run. With 0 threads the requests are processed one by one as they are accepted and nothing is rejected
+     */
+    void setWorkerThreads(unsigned threads) { _workerThreads = threads; }
+    void setListenBacklog(int backlog) { _listenBacklog = backlog; }
+    
+    /**
+     * Set before run. How many requests of the priority can wait for a worker thread and for how long
+     */
+    void setQueueLimits(RequestScheduler::Priority priority, const RequestScheduler::Limits& limits) { _queueLimits[priority] = limits; }
+    
+    /**
+     * Set before run. Above 0 every worker thread runs its requests as fibers instead of taking them from the queues,
+     * and up to fibers requests are in flight at once. A request waiting for its socket or its data layer lets the other
+     * requests of the thread run, so the data layer must suspend the fiber instead of blocking, see FiberDataLayer.
+     */
+    void setFibers(unsigned fibers) { _fibers = fibers; }
+    
+    /**
+     * Milliseconds the solver has for a suggestion that does not set its own "deadline", 0 is unlimited
+     */
+    void setSuggestDeadline(unsigned deadline) { _suggestDeadline = deadline; }
+    
+    /**
+     * Set before run. The events are acknowledged when they are in the journal file and run in parallel with the read only
+     * requests, they are applied to the data layer later one at a time, see SystemManager::setEventJournal
+     */
+    void setEventJournal(const std::string& fileName);
+    
 public:
     
     static void stopAll();
@@ -53,20 +168,45 @@ public:
 protected:
     
     void onNewConnection(int clientSocket);
+    bool readRequest(int clientSocket, std::string& request);
+    void serveRequest(int clientSocket, const std::string& request);
     std::string processRequest(const std::string& request);
+    void processRequest(const std::string& request, IResponseWriter& output);
     void sendResponseAndClose(int clientSocket, const std::string& response, bool error);
     
 private:
     
-    void printMessage(const char* message);
+    void handleRequest(const std::string& request, IResponseWriter& output, ServerStatistics::Request& statistics);
+    void handleJson(const boost::property_tree::ptree& json, IResponseWriter& output, ServerStatistics::Request& statistics);
+    
+    bool isSharedRequest(const boost::property_tree::ptree& json) const;
+    
+private:
+    
+    void scheduleConnection(int clientSocket, RequestScheduler& scheduler);
+    void runWorker(RequestScheduler* scheduler);
+    void rejectRequest(const RequestScheduler::Job& job, const std::string& reason);
+    void rejectExpired(const std::vector<RequestScheduler::Job>& expired);
+    
+    void spawnConnection(int clientSocket, utils::FiberScheduler& fibers);
+    void runFiber(int clientSocket);
+    
+private:
+    
+    typedef std::vector<const boost::property_tree::ptree*> BatchRequests;
+    
+    void performBatch(const boost::property_tree::ptree& json, IResponseWriter& output);
+    void performBatchRequests(const BatchRequests& requests, unsigned begin, unsigned end, std::vector<std::string>& results);
+    void runBatchWorker(const BatchRequests& requests, unsigned begin, unsigned end, std::vector<std::string>& results, utils::AtomicCounter* taken);
+    void performBatchRequest(const boost::property_tree::ptree& json, std::string& result);
     
 private:
     
     template<class T>
-    std::string performDatabaseOperation(const boost::property_tree::ptree& json);
+    void performDatabaseOperation(const boost::property_tree::ptree& json, IResponseWriter& output);
     
     template<class T>
-    std::string performGet(const std::vector<Identifier>& identifiers);
+    void performGet(const std::vector<Identifier>& identifiers, unsigned batchSize, IResponseWriter& output);
     
     template<class T>
     std::string performDelete(const std::vector<Identifier>& identifiers);
@@ -74,10 +214,53 @@ private:
     template<class T>
     std::string performAddOrModify(bool isAdd, const boost::property_tree::ptree& json);
     
+    template<class T>
+    std::string performBulkAddOrModify(bool isAdd, const boost::property_tree::ptree& json);
+    
+    template<class T>
+    void bulkAdd(const std::vector<T>& objects, std::vector<Identifier>& newIds);
+    void bulkAdd(const std::vector<Investigation>& investigations, std::vector<Identifier>& newIds);
+    
+    template<class T>
+    void bulkModify(const std::vector<T>& objects);
+    void bulkModify(const std::vector<Investigation>& investigations);
+    
+    /**
+     * Drops the solver states that can depend on the changed object
+     */
+    template<class T>
+    void onObjectChanged(const T& object);
+    void onObjectChanged(const Investigation& investigation);
+    
+    template<class T>
+    std::string serialize(const T& result, ServerStatistics::Request& statistics);
+    
 private:
     
     SystemManager& _systemManager;
+    unsigned _getBatchSize;
+    unsigned _batchThreads;
+    unsigned _maxRequestSize;
+    unsigned _readTimeout;
+    unsigned _writeTimeout;
+    unsigned _workerThreads;
+    int _listenBacklog;
+    RequestScheduler::Limits _queueLimits[RequestScheduler::priorityCount];
+    unsigned _suggestDeadline;
+    unsigned _fibers;
+    utils::AtomicCounter _fibersInFlight;
+    bool _eventJournal;
+    
+    /**
+     * Requests that change nothing hold it shared and run in parallel, the other requests run alone
+     */
+    utils::FiberSharedMutex _changeMutex;
 
+    ServerStatistics _statistics;
+    
+    unsigned _requestLogInterval;
+    utils::AtomicCounter _requestCount;
+    
 private:
     
     static bool _stopAllManagers;
@@ -0,0 +1,126 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "serverstatistics.h"
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace ProblemSolver
+{
+
+/**
+ * Bounded queues of the requests waiting for a worker thread, one queue per priority.
+ * A worker always takes the oldest request of the highest priority that has one, and requests below the interactive
+ * priority never take the last free worker, so suggestions are not stuck behind imports and exports.
+ * A request is rejected when the queue of its priority is full, and it is dropped when it waited for a worker
+ * longer than its priority allows. The client is told right away in both cases.
+ */
+class RequestScheduler
+{
+public:
+    
+    enum Priority
+    {
+        priorityInteractive = 0, // search, suggest, event, eventSuggest and stats
+        priorityDatabase = 1, // database operations on the listed objects
+        priorityBulk = 2, // batches, bulk writes and reads of all objects of a type
+        priorityCount = 3
+    };
+    
+    struct Limits
+    {
+        Limits(unsigned maxQueued = 0, unsigned maxWait = 0):
+            maxQueued(maxQueued), maxWait(maxWait){}
+        
+        unsigned maxQueued; // requests waiting at once, 0 is unlimited
+        unsigned maxWait; // milliseconds a request may wait for a worker, 0 waits forever
+    };
+    
+    static const Limits DEFAULT_LIMITS[priorityCount];
+    
+    /**
+     * A request read from a client and waiting for a worker
+     */
+    struct Job
+    {
+        int clientSocket;
+        std::string request;
+        Priority priority;
+        ServerStatistics::RequestKind kind;
+        uint64_t queueTime; // monotonic nanoseconds
+    };
+    
+public:
+    
+    explicit RequestScheduler(unsigned workerCount);
+    ~RequestScheduler(){}
+    
+public:
+    
+    void setLimits(Priority priority, const Limits& limits);
+    
+    /**
+     * Finds the priority and kind of a request without parsing it
+     */
+    static Priority classify(const std::string& request, ServerStatistics::RequestKind& kind);
+    
+    static const char* getPriorityName(Priority priority);
+    
+public:
+    
+    /**
+     * Queues the job, returns false if the queue of its priority is full.
+     * The jobs that waited too long are moved to expired and must be answered by the caller.
+     */
+    bool push(const Job& job, std::vector<Job>& expired);
+    
+    /**
+     * Waits for the next job a worker can run and marks it running until finish is called.
+     * The jobs that waited too long are moved to expired and must be answered by the caller.
+     * Returns false if there is no job to run, then without expired jobs the scheduler is stopped and nothing is queued.
+     */
+    bool pop(Job& job, std::vector<Job>& expired);
+    
+    void finish();
+    
+    /**
+     * Moves the jobs that waited too long to expired, for when no worker is free to pop them
+     */
+    void expire(std::vector<Job>& expired);
+    
+    /**
+     * The workers still run the queued jobs, then pop returns false
+     */
+    void stop();
+    
+    unsigned getQueued(Priority priority) const;
+    
+private:
+    
+    bool canRun(Priority priority) const;
+    void removeExpired(uint64_t now, std::vector<Job>& expired);
+    
+private:
+    
+    unsigned _workerCount;
+    Limits _limits[priorityCount];
+    
+    std::deque<Job> _queues[priorityCount];
+    unsigned _running;
+    bool _stopped;
+    
+    mutable boost::mutex _mutex;
+    boost::condition_variable _changed;
+};
+
+} // namespace ProblemSolver
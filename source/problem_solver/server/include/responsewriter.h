@@ -0,0 +1,117 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+namespace ProblemSolver
+{
+
+/**
+ * Destination of a response.
+ * Allows big responses to be sent in parts while they are still being generated.
+ */
+class IResponseWriter
+{
+public:
+    
+    virtual ~IResponseWriter(){}
+    
+public:
+    
+    virtual void write(const std::string& data) = 0;
+    
+    /**
+     * Returns how many bytes have been written so far
+     */
+    virtual size_t getBytesWritten() const = 0;
+};
+
+/**
+ * Collects the whole response in memory
+ */
+class StringResponseWriter: public IResponseWriter
+{
+public:
+    
+    StringResponseWriter(){}
+    virtual ~StringResponseWriter(){}
+    
+public:
+    
+    virtual void write(const std::string& data);
+    virtual size_t getBytesWritten() const;
+    
+    const std::string& getResponse() const;
+    
+private:
+    
+    std::string _response;
+};
+
+/**
+ * Sends the response directly to a socket.
+ * Does not take ownership of the socket. In a fiber the socket can be non-blocking.
+ * A client that takes no data for timeout milliseconds fails the writer, so it does not hold the request forever.
+ */
+class SocketResponseWriter: public IResponseWriter
+{
+public:
+    
+    /**
+     * A timeout of 0 waits for the client forever
+     */
+    explicit SocketResponseWriter(int clientSocket, unsigned timeout = 0);
+    virtual ~SocketResponseWriter(){}
+    
+public:
+    
+    /**
+     * If the client is gone all further writes are silently skipped, check hasFailed()
+     */
+    virtual void write(const std::string& data);
+    virtual size_t getBytesWritten() const;
+    
+    bool hasFailed() const;
+    
+private:
+    
+    int _clientSocket;
+    unsigned _timeout;
+    size_t _bytesWritten;
+    bool _failed;
+};
+
+/**
+ * Passes everything to another writer and measures how long the writes take
+ */
+class TimingResponseWriter: public IResponseWriter
+{
+public:
+    
+    explicit TimingResponseWriter(IResponseWriter& output);
+    virtual ~TimingResponseWriter(){}
+    
+public:
+    
+    virtual void write(const std::string& data);
+    virtual size_t getBytesWritten() const;
+    
+    /**
+     * Returns the nanoseconds spent in all writes so far
+     */
+    uint64_t getWriteTime() const;
+    
+private:
+    
+    IResponseWriter& _output;
+    uint64_t _writeTime;
+};
+
+} // namespace ProblemSolver
@@ -0,0 +1,145 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "baseexception.h"
+#include "atomiccounter.h"
+#include "latencyhistogram.h"
+
+#include <string>
+
+namespace ProblemSolver
+{
+
+/**
+ * Latencies and counters of the requests served by a RemoteJsonManager.
+ * Requests can be recorded from many threads at once, nothing is locked.
+ */
+class ServerStatistics
+{
+public:
+    
+    enum RequestKind
+    {
+        requestDatabase = 0,
+        requestSearch = 1,
+        requestSuggest = 2,
+        requestEvent = 3,
+        requestEventSuggest = 4,
+        requestBatch = 5, // the requests of a batch are also recorded as requests of their own kind
+        requestStats = 6,
+        requestInvalid = 7, // the request type is unknown or could not be parsed
+        requestKindCount = 8
+    };
+    
+    /**
+     * Parts of the time of a request. The data layer stage is the time spent in database round trips
+     * and it is not included in the other stages.
+     */
+    enum Stage
+    {
+        stageParse = 0,
+        stageDataLayer = 1,
+        stageSolver = 2, // the work of the SystemManager for searches, suggestions and events
+        stageSerialize = 3, // of search results and suggestions
+        stageWrite = 4,
+        stageCount = 5
+    };
+    
+    static const unsigned ERROR_CODE_COUNT = BaseException::exceptionCodeRemoteJsonManager + 2; // the last one is for other exceptions
+    
+public:
+    
+    ServerStatistics();
+    ~ServerStatistics(){}
+    
+public:
+    
+    /**
+     * Measures one request and records it on destruction
+     */
+    class Request
+    {
+    public:
+    
+        explicit Request(ServerStatistics& statistics);
+        ~Request();
+    
+    public:
+    
+        void setKind(RequestKind kind) { _kind = kind; }
+        void setError(const std::exception& error);
+        
+        void addStageTime(Stage stage, uint64_t time);
+    
+    private:
+    
+        ServerStatistics& _statistics;
+        
+        RequestKind _kind;
+        int _errorCode; // -1 without error
+        
+        uint64_t _startTime;
+        uint64_t _startRoundTripTime;
+        
+        uint64_t _stageTimes[stageCount];
+        bool _measuredStages[stageCount];
+    };
+    
+    /**
+     * Adds the time from its construction to its destruction to a stage of the request, without database round trips
+     */
+    class StageTimer
+    {
+    public:
+    
+        StageTimer(Request& request, Stage stage);
+        ~StageTimer();
+    
+    private:
+    
+        Request& _request;
+        Stage _stage;
+        
+        uint64_t _startTime;
+        uint64_t _startRoundTripTime;
+    };
+    
+public:
+    
+    static RequestKind getRequestKind(const std::string& requestType);
+    
+    /**
+     * Records a request that was not processed because the server was overloaded
+     */
+    void addRejected(RequestKind kind) { _rejected[kind].add(); }
+    
+    /**
+     * Records the time a request waited for a worker thread
+     */
+    void addQueueTime(uint64_t time) { _queueTimes.record(time); }
+    
+    /**
+     * Returns all statistics and the data layer counters as a JSON object, latencies are in microseconds
+     */
+    std::string toJson() const;
+    
+private:
+    
+    uint64_t _startTime;
+    
+    utils::ConcurrentLatencyHistogram _latencies[requestKindCount];
+    utils::AtomicCounter _errors[requestKindCount];
+    utils::AtomicCounter _rejected[requestKindCount];
+    utils::ConcurrentLatencyHistogram _queueTimes;
+    
+    utils::ConcurrentLatencyHistogram _stages[stageCount];
+    utils::AtomicCounter _errorsByCode[ERROR_CODE_COUNT];
+};
+
+} // namespace ProblemSolver
@@ -146,7 +146,56 @@ std::string JsonSerializer::serialize(const SolvingMachine::Suggestion& suggesti
     addArray("problemValues", suggestion.problemValues);
     
     addArray("solutions", suggestion.solutions);
-    addArray("solutionValues", suggestion.solutionValues, false);
+    addArray("solutionValues", suggestion.solutionValues, suggestion.partial || suggestion.approximate);
+    
+    // only cut short and approximate suggestions have the flags
+    if(suggestion.partial)
+        addKeyValue("partial", true, suggestion.approximate);
+    
+    if(suggestion.approximate)
+    {
+        addKeyValue("approximate", true);
+        addArray("exactSymptoms", suggestion.exactSymptoms, false);
+    }
+    
+    endObject();
+    
+    return _result;
+}
+
+/**
+ * Only the operations that were called are listed
+ */
+std::string JsonSerializer::serialize(const DataLayerProfile& profile)
+{
+    _result.clear();
+    
+    startObject();
+    
+    addCounters(profile.getTotal());
+    _result += ",\"operations\":";
+    
+    startObject();
+    bool first = true;
+    for(unsigned i = 0; i < profiledOperationCount; ++i)
+    {
+        if(profile.operations[i].calls == 0)
+            continue;
+        
+        if(!first)
+            _result += ",";
+        
+        _result += "\"";
+        _result += DataLayerProfile::getOperationName(static_cast<ProfiledOperation>(i));
+        _result += "\":";
+        
+        startObject();
+        addCounters(profile.operations[i]);
+        endObject();
+        
+        first = false;
+    }
+    endObject();
     
     endObject();
     
@@ -163,6 +212,14 @@ void JsonSerializer::endObject()
     _result += "}";
 }
 
+void JsonSerializer::addCounters(const DataLayerProfile::Counters& counters)
+{
+    addKeyValue("calls", counters.calls);
+    addKeyValue("requestedIDs", counters.requestedIDs);
+    addKeyValue("returnedObjects", counters.returnedObjects);
+    addKeyValue("nanoseconds", counters.nanoseconds, false);
+}
+
 template<class T>
 void JsonSerializer::addGenericInfo(const T& object)
 {
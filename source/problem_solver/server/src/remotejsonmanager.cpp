@@ -8,16 +8,28 @@
 #include "remotejsonmanager.h"
 #include "systemmanager.h"
 #include "jsonserialization.h"
+#include "responsewriter.h"
+#include "profilingdatalayer.h"
+#include "fiberscheduler.h"
+#include "utils.h"
+#include "logger.h"
 
 #include <sys/types.h> 
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <errno.h>
 
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/bind.hpp>
 
 using namespace boost::property_tree;
 
@@ -25,33 +37,71 @@ namespace ProblemSolver
 {
 
 bool RemoteJsonManager::_stopAllManagers = false;
+const unsigned RemoteJsonManager::DEFAULT_GET_BATCH_SIZE;
+const unsigned RemoteJsonManager::DEFAULT_BATCH_THREADS;
+const unsigned RemoteJsonManager::DEFAULT_MAX_REQUEST_SIZE;
+const unsigned RemoteJsonManager::DEFAULT_READ_TIMEOUT;
+const unsigned RemoteJsonManager::DEFAULT_WRITE_TIMEOUT;
+const unsigned RemoteJsonManager::MAX_JSON_DEPTH;
+const unsigned RemoteJsonManager::DEFAULT_WORKER_THREADS;
+const int RemoteJsonManager::DEFAULT_LISTEN_BACKLOG;
     
-RemoteJsonManager::RemoteJsonManager(SystemManager& systemManager):
-    _systemManager(systemManager)
+RemoteJsonManager::RemoteJsonManager(SystemManager& systemManager, unsigned getBatchSize):
+    _systemManager(systemManager),
+    _getBatchSize(getBatchSize),
+    _batchThreads(DEFAULT_BATCH_THREADS),
+    _maxRequestSize(DEFAULT_MAX_REQUEST_SIZE),
+    _readTimeout(DEFAULT_READ_TIMEOUT),
+    _writeTimeout(DEFAULT_WRITE_TIMEOUT),
+    _workerThreads(DEFAULT_WORKER_THREADS),
+    _listenBacklog(DEFAULT_LISTEN_BACKLOG),
+    _suggestDeadline(0),
+    _fibers(0),
+    _eventJournal(false),
+    _requestLogInterval(0)
 {
+    for(unsigned i = 0; i < RequestScheduler::priorityCount; ++i)
+    {
+        _queueLimits[i] = RequestScheduler::DEFAULT_LIMITS[i];
+    }
+}
+
+/**
+ * The journal applies its events holding the change mutex, so it is closed before the mutex is destroyed
+ */
+RemoteJsonManager::~RemoteJsonManager()
+{
+    if(_eventJournal)
+        _systemManager.closeEventJournal();
+}
+
+void RemoteJsonManager::setEventJournal(const std::string& fileName)
+{
+    _systemManager.setEventJournal(fileName, &_changeMutex);
+    _eventJournal = true;
 }
 
 void RemoteJsonManager::run(const std::string& host, int port)
 {
-    printf("RemoteJsonManager: Starting instance on %s:%d\n", host.c_str(), port);
+    utils::Logger::log(utils::logInfo, "RemoteJsonManager: Starting instance on %s:%d", host.c_str(), port);
     
     int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
     if(serverSocket < 0)
     {
-        printMessage("RemoteJsonManager: ERROR opening socket");
+        utils::Logger::log(utils::logError, "RemoteJsonManager: ERROR opening socket");
         return;
     }
 
     int flags = fcntl(serverSocket, F_GETFL, 0);
     if(flags < 0)
     {
-        printMessage("RemoteJsonManager: ERROR getting socket options");
+        utils::Logger::log(utils::logError, "RemoteJsonManager: ERROR getting socket options");
         return;
     }
     flags = (flags|O_NONBLOCK);
     if(fcntl(serverSocket, F_SETFL, flags) != 0)
     {
-        printMessage("RemoteJsonManager: ERROR setting socket options");
+        utils::Logger::log(utils::logError, "RemoteJsonManager: ERROR setting socket options");
         return;
     }
     
@@ -63,11 +113,41 @@ void RemoteJsonManager::run(const std::string& host, int port)
 
     if(bind(serverSocket, (sockaddr*)&serverAddress, sizeof(serverAddress)) < 0)
     {
-        printMessage("RemoteJsonManager: ERROR binding socket");
+        utils::Logger::log(utils::logError, "RemoteJsonManager: ERROR binding socket");
         return;
     }
     
-    listen(serverSocket,5);
+    listen(serverSocket, _listenBacklog);
+    
+    // the requests are read in this thread and queued for the workers by priority
+    RequestScheduler scheduler(_workerThreads);
+    for(unsigned i = 0; i < RequestScheduler::priorityCount; ++i)
+    {
+        scheduler.setLimits(static_cast<RequestScheduler::Priority>(i), _queueLimits[i]);
+    }
+    
+    // with fibers every worker thread runs a scheduler and the connections are spread over them in turn
+    std::vector<boost::shared_ptr<utils::FiberScheduler> > fiberSchedulers;
+    unsigned acceptedCount = 0;
+    
+    std::vector<RequestScheduler::Job> expired;
+    
+    boost::thread_group workers;
+    if(_fibers > 0)
+    {
+        for(unsigned i = 0; i < std::max(_workerThreads, 1u); ++i)
+        {
+            fiberSchedulers.push_back(boost::shared_ptr<utils::FiberScheduler>(new utils::FiberScheduler()));
+            workers.create_thread(boost::bind(&utils::FiberScheduler::run, fiberSchedulers.back().get()));
+        }
+    }
+    else
+    {
+        for(unsigned i = 0; i < _workerThreads; ++i)
+        {
+            workers.create_thread(boost::bind(&RemoteJsonManager::runWorker, this, &scheduler));
+        }
+    }
     
     while(!_stopAllManagers)
     {
@@ -75,22 +155,48 @@ void RemoteJsonManager::run(const std::string& host, int port)
         if(newSocket < 0)
         {
             if(errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // while every worker is busy nobody else answers the requests that waited too long
+                if(fiberSchedulers.empty() && _workerThreads > 0)
+                {
+                    expired.clear();
+                    scheduler.expire(expired);
+                    rejectExpired(expired);
+                }
+                
                 usleep(10000); // sleep 10ms
+            }
             else
             {
-                printMessage("RemoteJsonManager: ERROR during accept");
+                utils::Logger::log(utils::logError, "RemoteJsonManager: ERROR during accept");
                 break; // exit the server
             }
         }
-        else
+        else if(!fiberSchedulers.empty())
+        {
+            spawnConnection(newSocket, *fiberSchedulers[acceptedCount++ % fiberSchedulers.size()]);
+        }
+        else if(_workerThreads == 0)
         {
-            /** \todo Lubo: server should be multithreaded some day */
             onNewConnection(newSocket);
         }
+        else
+        {
+            scheduleConnection(newSocket, scheduler);
+        }
     }
     
-    printf("RemoteJsonManager: Stopping instance on %s:%d\n", host.c_str(), port);
+    utils::Logger::log(utils::logInfo, "RemoteJsonManager: Stopping instance on %s:%d", host.c_str(), port);
     close(serverSocket);
+    
+    // the queued requests and the fibers in flight are still processed
+    scheduler.stop();
+    BOOST_FOREACH(const boost::shared_ptr<utils::FiberScheduler>& fibers, fiberSchedulers)
+    {
+        fibers->stop();
+    }
+    
+    workers.join_all();
 }
 
 /**
@@ -102,65 +208,479 @@ void RemoteJsonManager::stopAll()
 }
 
 /**
- * Reads the request and calls processRequest on it then closes the socket
+ * Returns the size of the whole request from its Content-Length header,
+ * or 0 if the headers are not read yet or there is no such header
+ */
+static size_t getExpectedRequestSize(const std::string& request)
+{
+    size_t headersEnd = request.find("\r\n\r\n");
+    size_t separatorSize = 4;
+    if(headersEnd == std::string::npos)
+    {
+        headersEnd = request.find("\n\n");
+        separatorSize = 2;
+    }
+    
+    if(headersEnd == std::string::npos)
+        return 0;
+    
+    std::string headers = request.substr(0, headersEnd);
+    boost::algorithm::to_lower(headers);
+    
+    static const std::string contentLength = "\ncontent-length:";
+    size_t position = headers.find(contentLength);
+    if(position == std::string::npos)
+        return 0;
+    
+    return headersEnd + separatorSize + strtoul(headers.c_str() + position + contentLength.size(), NULL, 10);
+}
+
+/**
+ * Reads the request and processes it then closes the socket
  */
 void RemoteJsonManager::onNewConnection(int clientSocket)
 {
-    std::string fullRequest;
-    std::string response;
+    std::string request;
+    if(readRequest(clientSocket, request))
+        serveRequest(clientSocket, request);
+}
+
+/**
+ * Reads the request and queues it for the workers, the client gets an error right away if the queue of its priority is full
+ */
+void RemoteJsonManager::scheduleConnection(int clientSocket, RequestScheduler& scheduler)
+{
+    RequestScheduler::Job job;
+    job.clientSocket = clientSocket;
+    
+    if(!readRequest(clientSocket, job.request))
+        return;
+    
+    job.priority = RequestScheduler::classify(job.request, job.kind);
+    job.queueTime = utils::getMonotonicNanoseconds();
+    
+    std::vector<RequestScheduler::Job> expired;
+    bool queued = scheduler.push(job, expired);
+    
+    rejectExpired(expired);
+    
+    if(!queued)
+        rejectRequest(job, "too many waiting requests");
+}
+
+/**
+ * Processes the queued requests until the scheduler is stopped and empty
+ */
+void RemoteJsonManager::runWorker(RequestScheduler* scheduler)
+{
+    RequestScheduler::Job job;
+    std::vector<RequestScheduler::Job> expired;
+    
+    while(true)
+    {
+        expired.clear();
+        bool found = scheduler->pop(job, expired);
+        
+        rejectExpired(expired);
+        
+        if(found)
+        {
+            _statistics.addQueueTime(utils::getMonotonicNanoseconds() - job.queueTime);
+            
+            serveRequest(job.clientSocket, job.request);
+            scheduler->finish();
+        }
+        else if(expired.empty())
+        {
+            return;
+        }
+    }
+}
+
+void RemoteJsonManager::rejectExpired(const std::vector<RequestScheduler::Job>& expired)
+{
+    BOOST_FOREACH(const RequestScheduler::Job& job, expired)
+    {
+        rejectRequest(job, "the request waited too long");
+    }
+}
+
+/**
+ * Reads what the client has sent so far without waiting for the rest, at most maxSize bytes
+ */
+static void readArrived(int clientSocket, unsigned maxSize, std::string& request)
+{
+    char buffer[4096];
+    
+    while(request.size() < maxSize)
+    {
+        ssize_t bytesRead = recv(clientSocket, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if(bytesRead <= 0)
+            return;
+        
+        request.append(buffer, bytesRead);
+    }
+}
+
+/**
+ * Starts a fiber for the connection, the client gets an error right away if too many requests are in flight
+ */
+void RemoteJsonManager::spawnConnection(int clientSocket, utils::FiberScheduler& fibers)
+{
+    if(_fibersInFlight.get() >= _fibers)
+    {
+        // the server is overloaded, so only the part of the request that has already arrived is used
+        RequestScheduler::Job job;
+        job.clientSocket = clientSocket;
+        readArrived(clientSocket, _maxRequestSize, job.request);
+        
+        job.priority = RequestScheduler::classify(job.request, job.kind);
+        rejectRequest(job, "too many requests in flight");
+        return;
+    }
+    
+    // the fiber waits for the socket instead of blocking its thread
+    int flags = fcntl(clientSocket, F_GETFL, 0);
+    if(flags < 0 || fcntl(clientSocket, F_SETFL, flags | O_NONBLOCK) != 0)
+    {
+        utils::Logger::log(utils::logError, "RemoteJsonManager: ERROR setting socket options");
+        close(clientSocket);
+        return;
+    }
+    
+    _fibersInFlight.add();
+    
+    try
+    {
+        fibers.spawn(boost::bind(&RemoteJsonManager::runFiber, this, clientSocket));
+    }
+    catch(std::exception& e)
+    {
+        _fibersInFlight.subtract();
+        
+        utils::Logger::log(utils::logError, "RemoteJsonManager: ERROR starting a fiber - %s", e.what());
+        close(clientSocket);
+    }
+}
+
+void RemoteJsonManager::runFiber(int clientSocket)
+{
+    try
+    {
+        onNewConnection(clientSocket);
+    }
+    catch(...)
+    {
+        _fibersInFlight.subtract();
+        throw;
+    }
+    
+    _fibersInFlight.subtract();
+}
+
+/**
+ * Answers a request that is not processed because the server is overloaded, the client can try it again later
+ */
+void RemoteJsonManager::rejectRequest(const RequestScheduler::Job& job, const std::string& reason)
+{
+    _statistics.addRejected(job.kind);
+    
+    // not logged as a warning, that would only add to the load
+    utils::Logger::log(utils::logDebug, "RemoteJsonManager: Rejected %s request - %s", RequestScheduler::getPriorityName(job.priority), reason.c_str());
     
-    char buffer[256];
+    sendResponseAndClose(job.clientSocket, "RemoteJsonManager: ERROR 503 Server overloaded - " + reason, true);
+}
+
+/**
+ * Waits until the socket has data or the deadline in monotonic nanoseconds passes.
+ * Returns false when the deadline passes.
+ */
+static bool waitForRequestData(int clientSocket, uint64_t deadline)
+{
+    while(true)
+    {
+        uint64_t now = utils::getMonotonicNanoseconds();
+        if(now >= deadline)
+            return false;
+        
+        pollfd descriptor;
+        descriptor.fd = clientSocket;
+        descriptor.events = POLLIN;
+        descriptor.revents = 0;
+        
+        int result = poll(&descriptor, 1, static_cast<int>((deadline - now + 999999) / 1000000));
+        if(result > 0 || (result < 0 && errno != EINTR))
+            return true; // the errors are reported by the read
+    }
+}
+
+/**
+ * Reads the whole request, on error the client is answered and false is returned.
+ * The request ends with a short read, or when its Content-Length is read for requests that arrive in parts.
+ * The whole request must arrive within the read timeout.
+ */
+bool RemoteJsonManager::readRequest(int clientSocket, std::string& fullRequest)
+{
+    static const std::string timeoutError = "RemoteJsonManager: ERROR request not received in time.";
+    
+    char buffer[4096];
     int bytesRead = 0;
+    size_t expectedSize = 0;
+    
+    uint64_t deadline = 0;
+    if(_readTimeout > 0)
+        deadline = utils::getMonotonicNanoseconds() + _readTimeout * 1000000ULL;
+    
+    // a fiber waits for its non-blocking socket through the scheduler instead
+    bool inFiber = utils::FiberScheduler::isInFiber();
     
     do
     {
-        bytesRead = read(clientSocket, buffer, 255);
+        if(deadline != 0 && !inFiber && !waitForRequestData(clientSocket, deadline))
+        {
+            utils::Logger::log(utils::logDebug, "%s", timeoutError.c_str());
+            sendResponseAndClose(clientSocket, timeoutError, true);
+            return false;
+        }
+        
+        bytesRead = read(clientSocket, buffer, sizeof(buffer));
+        
+        // a fiber waits until its socket has more data, a client that sends nothing must not keep its fiber forever
+        while(bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            if(deadline != 0 && utils::getMonotonicNanoseconds() >= deadline)
+            {
+                utils::Logger::log(utils::logDebug, "%s", timeoutError.c_str());
+                sendResponseAndClose(clientSocket, timeoutError, true);
+                return false;
+            }
+            
+            if(!utils::FiberScheduler::waitReadable(clientSocket, deadline))
+                break;
+            
+            bytesRead = read(clientSocket, buffer, sizeof(buffer));
+        }
+        
         if(bytesRead < 0)
         {
             static const std::string error = "RemoteJsonManager: ERROR reading request.";
-            printMessage(error.c_str());
+            utils::Logger::log(utils::logError, "%s", error.c_str());
             sendResponseAndClose(clientSocket, error, true);
-            return;
+            return false;
         }
         
         fullRequest.append(buffer, bytesRead);
         
-        if(fullRequest.size() > 10000)
+        if(fullRequest.size() > _maxRequestSize)
         {
             static const std::string error = "RemoteJsonManager: ERROR too long request.";
-            printMessage(error.c_str());
+            utils::Logger::log(utils::logError, "%s", error.c_str());
             sendResponseAndClose(clientSocket, error, true);
-            return;
+            return false;
         }
         
-    }while(bytesRead == 255);
+        if(expectedSize == 0)
+            expectedSize = getExpectedRequestSize(fullRequest);
+        
+    }while(bytesRead == static_cast<int>(sizeof(buffer)) || (bytesRead > 0 && fullRequest.size() < expectedSize));
+    
+    return true;
+}
 
-    bool error = true;
+/**
+ * Calls processRequest on the request then closes the socket
+ */
+void RemoteJsonManager::serveRequest(int clientSocket, const std::string& request)
+{
+    std::string response;
+    
+    // the response is written directly to the socket while it is being generated
+    SocketResponseWriter output(clientSocket, _writeTimeout);
+    
     try
     {
-        response = processRequest(fullRequest);
-        error = false;
+        processRequest(request, output);
+        
+        if(output.hasFailed())
+            utils::Logger::log(utils::logError, "RemoteJsonManager: ERROR sending response");
+        
+        close(clientSocket);
+        return;
     }
     catch(BaseException& exception)
     {
         response = exception.what();
-        printMessage(response.c_str());
+        utils::Logger::log(utils::logWarning, "%s", response.c_str());
     }
     catch(...)
     {
         response = "Unknown error";
-        printMessage(response.c_str());
+        utils::Logger::log(utils::logWarning, "%s", response.c_str());
+    }
+    
+    if(output.getBytesWritten() > 0)
+    {
+        // part of the response is already sent, there is no way to report the error in it
+        utils::Logger::log(utils::logError, "RemoteJsonManager: ERROR response interrupted");
+        close(clientSocket);
+        return;
     }
     
-    sendResponseAndClose(clientSocket, response, error);
+    sendResponseAndClose(clientSocket, response, true);
 }
 
 /**
- * Processes the supplied request
+ * Processes the supplied request and returns the whole response
  */
 std::string RemoteJsonManager::processRequest(const std::string& request)
 {
-    printf("Processing request: %s\n", request.c_str());
+    StringResponseWriter output;
+    processRequest(request, output);
+    
+    return output.getResponse();
+}
+
+/**
+ * Processes the supplied request writing the response to output and records its statistics
+ */
+void RemoteJsonManager::processRequest(const std::string& request, IResponseWriter& output)
+{
+    ServerStatistics::Request statistics(_statistics);
+    TimingResponseWriter timedOutput(output);
+    
+    try
+    {
+        handleRequest(request, timedOutput, statistics);
+    }
+    catch(...)
+    {
+        statistics.addStageTime(ServerStatistics::stageWrite, timedOutput.getWriteTime());
+        throw;
+    }
+    
+    statistics.addStageTime(ServerStatistics::stageWrite, timedOutput.getWriteTime());
+}
+
+const ServerStatistics& RemoteJsonManager::getStatistics() const
+{
+    return _statistics;
+}
+
+/**
+ * Reads the "events" array of a request: [{"event": "symptom", "object": ID, "result": true}, ...]
+ */
+static void getEvents(const ptree& json, std::vector<SystemManager::Event>& events)
+{
+    BOOST_FOREACH(const ptree::value_type& jsonEvent, json.get_child("events"))
+    {
+        SystemManager::Event event;
+        
+        std::string eventName = jsonEvent.second.get<std::string>("event");
+        if(eventName == "symptom")
+            event.type = SystemManager::eventSymptomChecked;
+        else if(eventName == "problem")
+            event.type = SystemManager::eventProblemChecked;
+        else if(eventName == "solution")
+            event.type = SystemManager::eventSolutionChecked;
+        else
+            throw RemoteJsonManager::Exception("Unknown event " + eventName);
+        
+        event.objectID = jsonEvent.second.get<Identifier>("object");
+        event.checkResult = jsonEvent.second.get<bool>("result");
+        
+        events.push_back(event);
+    }
+}
+
+/**
+ * Requests that change nothing can run in parallel with each other
+ */
+static bool isReadOnlyRequest(const ptree& json)
+{
+    std::string type = json.get<std::string>("RequestType", "");
+    
+    if(type == "database")
+        return json.get<std::string>("operation", "") == "get";
+    
+    return type == "search" || type == "suggest" || type == "stats";
+}
+
+static bool isEventRequest(const ptree& json)
+{
+    std::string type = json.get<std::string>("RequestType", "");
+    return type == "event" || type == "eventSuggest";
+}
+
+/**
+ * Returns true if the objects and arrays of the JSON text are nested deeper than maxDepth, the brackets in strings are skipped
+ */
+static bool isNestedDeeper(const std::string& json, unsigned maxDepth)
+{
+    unsigned depth = 0;
+    bool inString = false;
+    
+    for(size_t i = 0; i < json.size(); ++i)
+    {
+        char character = json[i];
+        
+        if(inString)
+        {
+            if(character == '\\')
+                ++i; // the escaped character can be a quote
+            else if(character == '"')
+                inString = false;
+            
+            continue;
+        }
+        
+        if(character == '"')
+        {
+            inString = true;
+        }
+        else if(character == '{' || character == '[')
+        {
+            if(++depth > maxDepth)
+                return true;
+        }
+        else if((character == '}' || character == ']') && depth > 0)
+        {
+            --depth;
+        }
+    }
+    
+    return false;
+}
+
+/**
+ * Requests that can hold the change mutex shared. Journaled events change only the journal and the pending
+ * investigations, which have their own locks. A batch is shared when all of its requests are.
+ */
+bool RemoteJsonManager::isSharedRequest(const ptree& json) const
+{
+    if(json.get<std::string>("RequestType", "") == "batch")
+    {
+        boost::optional<const ptree&> requests = json.get_child_optional("requests");
+        if(!requests)
+            return true; // fails without changing anything
+        
+        BOOST_FOREACH(const ptree::value_type& request, *requests)
+        {
+            // a nested batch fails, it is not checked any deeper
+            if(request.second.get<std::string>("RequestType", "") == "batch" || !isSharedRequest(request.second))
+                return false;
+        }
+        
+        return true;
+    }
+    
+    return isReadOnlyRequest(json) || (_eventJournal && isEventRequest(json));
+}
+
+void RemoteJsonManager::handleRequest(const std::string& request, IResponseWriter& output, ServerStatistics::Request& statistics)
+{
+    utils::Logger::log(utils::logDebug, "Processing request: %s", request.c_str());
+    
+    uint64_t parseStartTime = utils::getMonotonicNanoseconds();
     
     std::vector<std::string> lines;
     boost::algorithm::split(lines, request, boost::algorithm::is_any_of("\n"));
@@ -181,115 +701,335 @@ std::string RemoteJsonManager::processRequest(const std::string& request)
         requestBody.append(lines[i]);
     }
     
-    printf("Request Body: %s\n", requestBody.c_str());
+    uint64_t requestNumber = _requestCount.add();
+    if(utils::Logger::isEnabled(utils::logDebug))
+        utils::Logger::log(utils::logDebug, "Request Body: %s", requestBody.c_str());
+    else if(_requestLogInterval > 0 && requestNumber % _requestLogInterval == 0)
+        utils::Logger::log(utils::logInfo, "Request Body: %s", requestBody.c_str());
     
     std::stringstream jsonStream;
     jsonStream << requestBody;
     ptree jsonTree;
     try
     {
-        /** \todo Lubo: implement all requests and responses! */
+        if(isNestedDeeper(requestBody, MAX_JSON_DEPTH))
+            throw Exception("too deeply nested request");
         
         json_parser::read_json(jsonStream, jsonTree);
+        statistics.addStageTime(ServerStatistics::stageParse, utils::getMonotonicNanoseconds() - parseStartTime);
         
-        std::string type = jsonTree.get<std::string>("RequestType");
-        if(type == "database")
+        if(isSharedRequest(jsonTree))
         {
-            // these requests are linked with get/add/modify/delete
-            std::string objectType = jsonTree.get<std::string>("ObjectType");
-            
-            if(objectType == "category")
-            {
-                return performDatabaseOperation<Category>(jsonTree);
-            }
-            else if(objectType == "symptom")
-            {
-                return performDatabaseOperation<ExtendedSymptom>(jsonTree);
-            }
-            else if(objectType == "problem")
-            {
-                return performDatabaseOperation<ExtendedProblem>(jsonTree);
-            }
-            else if(objectType == "solution")
-            {
-                return performDatabaseOperation<ExtendedSolution>(jsonTree);
-            }
-            else if(objectType == "symptomLink")
-            {
-                return performDatabaseOperation<SymptomLink>(jsonTree);
-            }
-            else if(objectType == "solutionLink")
-            {
-                return performDatabaseOperation<SolutionLink>(jsonTree);
-            }
-            else if(objectType == "investigation")
-            {
-                return performDatabaseOperation<Investigation>(jsonTree);
-            }
+            boost::shared_lock<utils::FiberSharedMutex> lock(_changeMutex);
+            handleJson(jsonTree, output, statistics);
+        }
+        else
+        {
+            boost::unique_lock<utils::FiberSharedMutex> lock(_changeMutex);
+            handleJson(jsonTree, output, statistics);
+        }
+    }
+    catch (std::exception& err)
+    {
+        statistics.setError(err);
+        
+        std::string message = "RemoteJsonManager: ERROR Invalid JSON - ";
+        message += err.what();
+        throw Exception(message);
+    }
+}
 
-            throw Exception("Unknown ObjectType");
+/**
+ * Performs the request parsed from the body, the errors are thrown
+ */
+void RemoteJsonManager::handleJson(const ptree& jsonTree, IResponseWriter& output, ServerStatistics::Request& statistics)
+{
+    /** \todo Lubo: implement all requests and responses! */
+    
+    std::string type = jsonTree.get<std::string>("RequestType");
+    statistics.setKind(ServerStatistics::getRequestKind(type));
+    
+    if(type == "database")
+    {
+        // these requests are linked with get/add/modify/delete
+        std::string objectType = jsonTree.get<std::string>("ObjectType");
+        
+        if(objectType == "category")
+        {
+            performDatabaseOperation<Category>(jsonTree, output);
+            return;
         }
-        else if(type == "search")
+        else if(objectType == "symptom")
         {
-            std::string searchPhrase = jsonTree.get<std::string>("search");
-            
-            JsonSerializer serializer;
-            return serializer.serialize(_systemManager.performSearch(searchPhrase));
+            performDatabaseOperation<ExtendedSymptom>(jsonTree, output);
+            return;
         }
-        else if(type == "suggest")
+        else if(objectType == "problem")
         {
-            std::string investigationID = jsonTree.get<std::string>("investigation");
+            performDatabaseOperation<ExtendedProblem>(jsonTree, output);
+            return;
+        }
+        else if(objectType == "solution")
+        {
+            performDatabaseOperation<ExtendedSolution>(jsonTree, output);
+            return;
+        }
+        else if(objectType == "symptomLink")
+        {
+            performDatabaseOperation<SymptomLink>(jsonTree, output);
+            return;
+        }
+        else if(objectType == "solutionLink")
+        {
+            performDatabaseOperation<SolutionLink>(jsonTree, output);
+            return;
+        }
+        else if(objectType == "investigation")
+        {
+            performDatabaseOperation<Investigation>(jsonTree, output);
+            return;
+        }
 
-            JsonSerializer serializer;
-            return serializer.serialize(_systemManager.makeSuggestion(investigationID));
+        throw Exception("Unknown ObjectType");
+    }
+    else if(type == "search")
+    {
+        std::string searchPhrase = jsonTree.get<std::string>("search");
+        
+        SystemManager::SearchResult result;
+        {
+            ServerStatistics::StageTimer timer(statistics, ServerStatistics::stageSolver);
+            result = _systemManager.performSearch(searchPhrase);
         }
-        else if(type == "event")
+        
+        output.write(serialize(result, statistics));
+        return;
+    }
+    else if(type == "suggest" || type == "eventSuggest")
+    {
+        // eventSuggest applies the events of the client and returns the next suggestion in one request
+        Identifier investigationID = jsonTree.get<Identifier>("investigation");
+        bool profile = jsonTree.get<bool>("profile", false);
+        
+        SolvingMachine::Options options;
+        
+        // milliseconds the solver has for the suggestion, after them a partial suggestion is returned
+        unsigned deadline = jsonTree.get<unsigned>("deadline", _suggestDeadline);
+        if(deadline > 0)
+            options.deadline = utils::getMonotonicNanoseconds() + deadline * 1000000ULL;
+        
+        // approximate mode, only this many symptoms are valued exactly
+        options.exactSymptoms = jsonTree.get<unsigned>("approximate", 0);
+        
+        std::vector<SystemManager::Event> events;
+        if(type == "eventSuggest")
+            getEvents(jsonTree, events);
+
+        // collects the calls to a ProfilingDataLayer, the profile stays empty if the data layer is not profiled
+        ProfilingDataLayer::Scope profileScope;
+        
+        SolvingMachine::Suggestion suggestion;
         {
-            std::string investigation = jsonTree.get<std::string>("investigation");
-            std::string event = jsonTree.get<std::string>("event");
-            std::string object = jsonTree.get<std::string>("object");
-            bool result = jsonTree.get<bool>("result");
+            ServerStatistics::StageTimer timer(statistics, ServerStatistics::stageSolver);
             
-            if(event == "symptom")
-            {
-                _systemManager.onSymptomChecked(object, result, investigation);
-                return "{ \"result\":\"done\"}";
-            }
-            else if(event == "problem")
-            {
-                _systemManager.onProblemChecked(object, result, investigation);
-                return "{ \"result\":\"done\"}";
-            }
-            else if(event == "solution")
-            {
-                _systemManager.onSolutionChecked(object, result, investigation);
-                return "{ \"result\":\"done\"}";
-            }
-            
-            throw Exception("Unknown event");
+            if(type == "eventSuggest")
+                suggestion = _systemManager.onEventsAndSuggest(events, investigationID, options);
+            else
+                suggestion = _systemManager.makeSuggestion(investigationID, options);
         }
-        else
+        
+        if(!profile)
         {
-            std::string message = "Unknown RequestType " + type;
-            throw std::runtime_error(message);
+            output.write(serialize(suggestion, statistics));
+            return;
         }
+        
+        output.write("{\"suggestion\":");
+        output.write(serialize(suggestion, statistics));
+        output.write(",\"profile\":");
+        output.write(serialize(profileScope.getProfile(), statistics));
+        output.write("}");
+        return;
     }
-    catch (std::exception& err)
+    else if(type == "event")
     {
-        std::string message = "RemoteJsonManager: ERROR Invalid JSON - ";
-        message += err.what();
-        throw Exception(message);
+        Identifier investigation = jsonTree.get<Identifier>("investigation");
+        std::string event = jsonTree.get<std::string>("event");
+        Identifier object = jsonTree.get<Identifier>("object");
+        bool result = jsonTree.get<bool>("result");
+        
+        ServerStatistics::StageTimer timer(statistics, ServerStatistics::stageSolver);
+        
+        if(event == "symptom")
+        {
+            _systemManager.onSymptomChecked(object, result, investigation);
+            output.write("{ \"result\":\"done\"}");
+            return;
+        }
+        else if(event == "problem")
+        {
+            _systemManager.onProblemChecked(object, result, investigation);
+            output.write("{ \"result\":\"done\"}");
+            return;
+        }
+        else if(event == "solution")
+        {
+            _systemManager.onSolutionChecked(object, result, investigation);
+            output.write("{ \"result\":\"done\"}");
+            return;
+        }
+        
+        throw Exception("Unknown event");
+    }
+    else if(type == "batch")
+    {
+        performBatch(jsonTree, output);
+        return;
+    }
+    else if(type == "stats")
+    {
+        output.write(_statistics.toJson());
+        return;
+    }
+    else
+    {
+        std::string message = "Unknown RequestType " + type;
+        throw std::runtime_error(message);
     }
     
     throw Exception("Unknown RequestType");
 }
 
+/**
+ * Performs the requests of the "requests" array in order and returns {"results": [...]} with the response of every request,
+ * a failed request has {"error": "..."} as its response and the next requests are still performed.
+ * With "parallel": true the consecutive requests that change nothing run at once, each run ends before the next change.
+ */
+void RemoteJsonManager::performBatch(const ptree& json, IResponseWriter& output)
+{
+    bool parallel = json.get<bool>("parallel", false);
+    
+    BatchRequests requests;
+    BOOST_FOREACH(const ptree::value_type& request, json.get_child("requests"))
+    {
+        requests.push_back(&request.second);
+    }
+    
+    std::vector<std::string> results(requests.size());
+    
+    unsigned begin = 0;
+    while(begin < requests.size())
+    {
+        unsigned end = begin + 1;
+        
+        if(parallel && isReadOnlyRequest(*requests[begin]))
+        {
+            while(end < requests.size() && isReadOnlyRequest(*requests[end]))
+                ++end;
+        }
+        
+        performBatchRequests(requests, begin, end, results);
+        begin = end;
+    }
+    
+    output.write("{ \"results\":[");
+    
+    for(unsigned i = 0; i < results.size(); ++i)
+    {
+        if(i > 0)
+            output.write(",");
+        
+        output.write(results[i]);
+    }
+    
+    output.write("]}");
+}
+
+/**
+ * Performs the requests [begin, end) on up to _batchThreads threads
+ */
+void RemoteJsonManager::performBatchRequests(const BatchRequests& requests, unsigned begin, unsigned end, std::vector<std::string>& results)
+{
+    unsigned threadCount = std::min(_batchThreads, end - begin);
+    
+    utils::AtomicCounter taken;
+    
+    if(threadCount <= 1)
+    {
+        runBatchWorker(requests, begin, end, results, &taken);
+        return;
+    }
+    
+    boost::thread_group workers;
+    for(unsigned i = 0; i < threadCount; ++i)
+    {
+        workers.create_thread(boost::bind(&RemoteJsonManager::runBatchWorker, this, boost::cref(requests), begin, end, boost::ref(results), &taken));
+    }
+    workers.join_all();
+}
+
+/**
+ * Takes the next request that nobody has taken until all of [begin, end) are performed
+ */
+void RemoteJsonManager::runBatchWorker(const BatchRequests& requests, unsigned begin, unsigned end, std::vector<std::string>& results, utils::AtomicCounter* taken)
+{
+    for(uint64_t i = begin + taken->add() - 1; i < end; i = begin + taken->add() - 1)
+    {
+        performBatchRequest(*requests[i], results[i]);
+    }
+}
+
+/**
+ * Performs one request of a batch, it is recorded in the statistics like a request of its own
+ */
+void RemoteJsonManager::performBatchRequest(const ptree& json, std::string& result)
+{
+    ServerStatistics::Request statistics(_statistics);
+    StringResponseWriter output;
+    
+    std::string error;
+    try
+    {
+        if(json.get<std::string>("RequestType", "") == "batch")
+            throw Exception("Batches can not be nested");
+        
+        handleJson(json, output, statistics);
+        
+        result = output.getResponse();
+        return;
+    }
+    catch(std::exception& err)
+    {
+        statistics.setError(err);
+        error = err.what();
+    }
+    catch(...)
+    {
+        error = "Unknown error";
+    }
+    
+    // the message is a JSON string, while the response of a single request is sent as it is
+    boost::algorithm::replace_all(error, "\\", "\\\\");
+    boost::algorithm::replace_all(error, "\"", "\\\"");
+    
+    result = "{\"error\": \"" + error + "\"}";
+}
+
+template<class T>
+std::string RemoteJsonManager::serialize(const T& result, ServerStatistics::Request& statistics)
+{
+    ServerStatistics::StageTimer timer(statistics, ServerStatistics::stageSerialize);
+    
+    JsonSerializer serializer;
+    return serializer.serialize(result);
+}
+
 /**
  * Sends a response to the client and closes the socket
  */
 void RemoteJsonManager::sendResponseAndClose(int clientSocket, const std::string& response, bool error)
 {
-    int written = 0;
+    SocketResponseWriter output(clientSocket, _writeTimeout);
     if(error)
     {
         std::string actualMessage;
@@ -299,42 +1039,41 @@ void RemoteJsonManager::sendResponseAndClose(int clientSocket, const std::string
         actualMessage.append(response);
         actualMessage.append("\"}");
         
-        written = write(clientSocket, actualMessage.c_str(), actualMessage.size());
+        output.write(actualMessage);
     }
     else
     {
-        written = write(clientSocket, response.c_str(), response.size());
+        output.write(response);
     }
     
-    
-    if (written < 0)
-        printf("RemoteJsonManager: ERROR sending response %s\n", response.c_str());
+    if(output.hasFailed())
+        utils::Logger::log(utils::logError, "RemoteJsonManager: ERROR sending response %s", response.c_str());
     
     close(clientSocket);
 }
 
-/**
- * Prints messages
- */
-void RemoteJsonManager::printMessage(const char* message)
-{
-    printf("%s\n", message);
-}
-
 template<class T>
-std::string RemoteJsonManager::performDatabaseOperation(const boost::property_tree::ptree& json)
+void RemoteJsonManager::performDatabaseOperation(const boost::property_tree::ptree& json, IResponseWriter& output)
 {
     std::string operation = json.get<std::string>("operation");
     
     if(operation == "add")
     {
         const ptree& jsonObject = json.get_child("object");
-        return performAddOrModify<T>(true, jsonObject);
+        output.write(performAddOrModify<T>(true, jsonObject));
+        return;
     }
     else if(operation == "modify")
     {
         const ptree& jsonObject = json.get_child("object");
-        return performAddOrModify<T>(false, jsonObject);
+        output.write(performAddOrModify<T>(false, jsonObject));
+        return;
+    }
+    else if(operation == "bulkAdd" || operation == "bulkModify")
+    {
+        const ptree& jsonObjects = json.get_child("objects");
+        output.write(performBulkAddOrModify<T>(operation == "bulkAdd", jsonObjects));
+        return;
     }
     else if(operation == "get")
     {
@@ -342,7 +1081,10 @@ std::string RemoteJsonManager::performDatabaseOperation(const boost::property_tr
         std::vector<Identifier> ids;
         deserializer.getArray(ids, "ids", json);
         
-        return performGet<T>(ids);
+        unsigned batchSize = json.get<unsigned>("batchSize", _getBatchSize);
+        
+        performGet<T>(ids, batchSize, output);
+        return;
     }
     else if(operation == "delete")
     {
@@ -350,31 +1092,34 @@ std::string RemoteJsonManager::performDatabaseOperation(const boost::property_tr
         std::vector<Identifier> ids;
         deserializer.getArray(ids, "ids", json);
         
-        return performDelete<T>(ids);
+        output.write(performDelete<T>(ids));
+        return;
     }
 
     throw Exception("Unknown operation");
 }
 
 /**
- * Retrieves the corresponding objects from the database
+ * Retrieves the corresponding objects from the database.
+ * If no identifiers are supplied all objects are streamed to the output in batches of batchSize.
  */
 template<class T>
-std::string RemoteJsonManager::performGet(const std::vector<Identifier>& identifiers)
+void RemoteJsonManager::performGet(const std::vector<Identifier>& identifiers, unsigned batchSize, IResponseWriter& output)
 {
     std::string response;
     
     typedef boost::unordered_map<Identifier, T> ValueMap;
     ValueMap objectsToBeRetrieved;
-    _systemManager.getDataLayer().get(identifiers, objectsToBeRetrieved);
     
     JsonSerializer serializer;
     
-    response = "{ \"result\":[";
-    
     bool first = true;
     if(!identifiers.empty())
     {
+        _systemManager.getDataLayer().get(identifiers, objectsToBeRetrieved);
+        
+        response = "{ \"result\":[";
+        
         BOOST_FOREACH(CIdentifier id, identifiers)
         {
             if(!first)
@@ -383,22 +1128,55 @@ std::string RemoteJsonManager::performGet(const std::vector<Identifier>& identif
             response += serializer.serialize(objectsToBeRetrieved[id]);
             first = false;
         }
+        
+        response += "]}";
+        
+        output.write(response);
     }
     else
     {
-        BOOST_FOREACH(typename ValueMap::value_type pair, objectsToBeRetrieved)
+        std::auto_ptr<IDataLayerCursor<T> > cursor;
+        _systemManager.getDataLayer().openCursor(cursor, batchSize);
+        
+        // the first batch is read before anything is sent so errors can still be reported properly
+        bool hasMore = cursor->next(objectsToBeRetrieved);
+        
+        output.write("{ \"result\":[");
+        
+        while(hasMore)
         {
-            if(!first)
-                response += ",";
+            response.clear();
             
-            response += serializer.serialize(pair.second);
-            first = false;
+            BOOST_FOREACH(const typename ValueMap::value_type& pair, objectsToBeRetrieved)
+            {
+                if(!first)
+                    response += ",";
+                
+                response += serializer.serialize(pair.second);
+                first = false;
+            }
+            
+            output.write(response);
+            
+            hasMore = cursor->next(objectsToBeRetrieved);
         }
+        
+        output.write("]}");
     }
-    
-    response += "]}";
-    
-    return response;
+}
+
+/**
+ * Any change of the knowledge base can change the subject problems and symptoms of every investigation
+ */
+template<class T>
+void RemoteJsonManager::onObjectChanged(const T& object)
+{
+    _systemManager.clearSolverStates();
+}
+
+void RemoteJsonManager::onObjectChanged(const Investigation& investigation)
+{
+    _systemManager.clearSolverState(investigation.id);
 }
 
 /**
@@ -416,6 +1194,7 @@ std::string RemoteJsonManager::performDelete(const std::vector<Identifier>& iden
     BOOST_FOREACH(typename ValueMap::value_type pair, objectsToBeDeleted)
     {
         _systemManager.getDataLayer().remove(pair.second);
+        onObjectChanged(pair.second);
     }
     
     response = "{ \"result\":\"done\"}";
@@ -441,15 +1220,92 @@ std::string RemoteJsonManager::performAddOrModify(bool isAdd, const boost::prope
     if(isAdd)
     {
         Identifier newId = _systemManager.getDataLayer().add(deserializedObject);
-        response = "{ \"result\":\"" + newId + "\"}";
+        onObjectChanged(deserializedObject);
+        response = "{ \"result\":\"" + newId.toString() + "\"}";
     }
     else
     {
         _systemManager.getDataLayer().modify(deserializedObject);
+        onObjectChanged(deserializedObject);
         response = "{ \"result\":\"done\"}";
     }
     
     return response;
 }
 
+
+/**
+ * Handles bulk adds and modifications of objects of one type, all objects are read before anything is written.
+ * A bulk add returns the IDs of the new objects in the order of the objects.
+ */
+template<class T>
+std::string RemoteJsonManager::performBulkAddOrModify(bool isAdd, const boost::property_tree::ptree& json)
+{
+    std::string response;
+    
+    std::vector<T> deserializedObjects;
+    deserializedObjects.reserve(json.size());
+    
+    bool getID = !isAdd;
+    
+    JsonDeserializer jsonDeserializer;
+    BOOST_FOREACH(const ptree::value_type& jsonObject, json)
+    {
+        deserializedObjects.push_back(T());
+        jsonDeserializer.deserialize(jsonObject.second, getID, deserializedObjects.back());
+    }
+    
+    if(isAdd)
+    {
+        std::vector<Identifier> newIds;
+        bulkAdd(deserializedObjects, newIds);
+        
+        response = "{ \"result\":[";
+        for(size_t i = 0; i < newIds.size(); ++i)
+        {
+            if(i > 0)
+                response += ",";
+            
+            response += "\"" + newIds[i].toString() + "\"";
+        }
+        response += "]}";
+    }
+    else
+    {
+        bulkModify(deserializedObjects);
+        response = "{ \"result\":\"done\"}";
+    }
+    
+    // any change of the knowledge base drops all solver states
+    _systemManager.clearSolverStates();
+    
+    return response;
+}
+
+template<class T>
+void RemoteJsonManager::bulkAdd(const std::vector<T>& objects, std::vector<Identifier>& newIds)
+{
+    _systemManager.getDataLayer().add(objects, newIds);
+}
+
+template<class T>
+void RemoteJsonManager::bulkModify(const std::vector<T>& objects)
+{
+    _systemManager.getDataLayer().modify(objects);
+}
+
+/**
+ * Bulk operations reject investigations, they are added and modified one at a time with the "add" and "modify"
+ * operations as the data layers have no bulk writes for them
+ */
+void RemoteJsonManager::bulkAdd(const std::vector<Investigation>& investigations, std::vector<Identifier>& newIds)
+{
+    throw Exception("Bulk operations are not supported for investigations");
+}
+
+void RemoteJsonManager::bulkModify(const std::vector<Investigation>& investigations)
+{
+    throw Exception("Bulk operations are not supported for investigations");
+}
+
 } // namespace ProblemSolver
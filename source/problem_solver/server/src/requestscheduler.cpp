@@ -0,0 +1,234 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "requestscheduler.h"
+#include "utils.h"
+
+namespace ProblemSolver
+{
+
+const RequestScheduler::Limits RequestScheduler::DEFAULT_LIMITS[RequestScheduler::priorityCount] =
+{
+    RequestScheduler::Limits(1000, 1000),
+    RequestScheduler::Limits(1000, 5000),
+    RequestScheduler::Limits(16, 0)
+};
+
+static const char* priorityNames[RequestScheduler::priorityCount] = { "interactive", "database", "bulk" };
+
+static const char* WHITESPACE = " \t\r\n";
+
+/**
+ * Returns the position after the JSON key name and the colon after it, or npos if the key is not in the text
+ */
+static size_t findValue(const std::string& text, const std::string& name)
+{
+    std::string key = "\"" + name + "\"";
+    
+    size_t position = text.find(key);
+    if(position == std::string::npos)
+        return std::string::npos;
+    
+    position = text.find_first_not_of(WHITESPACE, position + key.size());
+    if(position == std::string::npos || text[position] != ':')
+        return std::string::npos;
+    
+    return text.find_first_not_of(WHITESPACE, position + 1);
+}
+
+/**
+ * Returns the string value of the first JSON key name in the text, or "" if there is no such key
+ */
+static std::string findStringValue(const std::string& text, const std::string& name)
+{
+    size_t position = findValue(text, name);
+    if(position == std::string::npos || text[position] != '"')
+        return "";
+    
+    size_t end = text.find('"', position + 1);
+    if(end == std::string::npos)
+        return "";
+    
+    return text.substr(position + 1, end - position - 1);
+}
+
+RequestScheduler::RequestScheduler(unsigned workerCount):
+    _workerCount(workerCount),
+    _running(0),
+    _stopped(false)
+{
+    for(unsigned i = 0; i < priorityCount; ++i)
+    {
+        _limits[i] = DEFAULT_LIMITS[i];
+    }
+}
+
+void RequestScheduler::setLimits(Priority priority, const Limits& limits)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    _limits[priority] = limits;
+}
+
+/**
+ * The request is only scanned for its first "RequestType", "operation" and "ids" keys. A request that is not
+ * recognized gets the interactive priority, it fails quickly when it is parsed.
+ */
+RequestScheduler::Priority RequestScheduler::classify(const std::string& request, ServerStatistics::RequestKind& kind)
+{
+    std::string type = findStringValue(request, "RequestType");
+    kind = ServerStatistics::getRequestKind(type);
+    
+    if(type == "batch")
+        return priorityBulk;
+    
+    if(type != "database")
+        return priorityInteractive;
+    
+    std::string operation = findStringValue(request, "operation");
+    if(operation == "bulkAdd" || operation == "bulkModify")
+        return priorityBulk;
+    
+    if(operation == "get")
+    {
+        // get without identifiers returns all objects of the type
+        size_t position = findValue(request, "ids");
+        if(position == std::string::npos)
+            return priorityBulk;
+        
+        if(request[position] == '[')
+        {
+            position = request.find_first_not_of(WHITESPACE, position + 1);
+            if(position != std::string::npos && request[position] == ']')
+                return priorityBulk;
+        }
+    }
+    
+    return priorityDatabase;
+}
+
+const char* RequestScheduler::getPriorityName(Priority priority)
+{
+    return priorityNames[priority];
+}
+
+bool RequestScheduler::push(const Job& job, std::vector<Job>& expired)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    
+    // while every worker is busy nothing pops the expired jobs, and they must not count against the limit
+    removeExpired(utils::getMonotonicNanoseconds(), expired);
+    
+    std::deque<Job>& queue = _queues[job.priority];
+    unsigned maxQueued = _limits[job.priority].maxQueued;
+    
+    if(maxQueued > 0 && queue.size() >= maxQueued)
+        return false;
+    
+    queue.push_back(job);
+    _changed.notify_one();
+    
+    return true;
+}
+
+bool RequestScheduler::pop(Job& job, std::vector<Job>& expired)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    
+    while(true)
+    {
+        removeExpired(utils::getMonotonicNanoseconds(), expired);
+        
+        bool queued = false;
+        for(unsigned i = 0; i < priorityCount; ++i)
+        {
+            if(_queues[i].empty())
+                continue;
+            
+            queued = true;
+            
+            if(!canRun(static_cast<Priority>(i)))
+                continue;
+            
+            job = _queues[i].front();
+            _queues[i].pop_front();
+            ++_running;
+            
+            return true;
+        }
+        
+        if(!queued && _stopped)
+            return false;
+        
+        // the expired jobs are answered before waiting, the waiting can be long
+        if(!expired.empty())
+            return false;
+        
+        _changed.wait(lock);
+    }
+}
+
+void RequestScheduler::finish()
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    
+    --_running;
+    
+    // a job that could not run while this one was running may run now
+    _changed.notify_all();
+}
+
+void RequestScheduler::expire(std::vector<Job>& expired)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    removeExpired(utils::getMonotonicNanoseconds(), expired);
+}
+
+void RequestScheduler::stop()
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    
+    _stopped = true;
+    _changed.notify_all();
+}
+
+unsigned RequestScheduler::getQueued(Priority priority) const
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _queues[priority].size();
+}
+
+/**
+ * Only interactive jobs can take the last free worker
+ */
+bool RequestScheduler::canRun(Priority priority) const
+{
+    if(priority == priorityInteractive || _workerCount <= 1)
+        return true;
+    
+    return _running + 1 < _workerCount;
+}
+
+void RequestScheduler::removeExpired(uint64_t now, std::vector<Job>& expired)
+{
+    for(unsigned i = 0; i < priorityCount; ++i)
+    {
+        if(_limits[i].maxWait == 0)
+            continue;
+        
+        uint64_t maxWait = _limits[i].maxWait * 1000000ULL;
+        
+        // the oldest jobs are at the front
+        std::deque<Job>& queue = _queues[i];
+        while(!queue.empty() && now - queue.front().queueTime > maxWait)
+        {
+            expired.push_back(queue.front());
+            queue.pop_front();
+        }
+    }
+}
+
+} // namespace ProblemSolver
@@ -0,0 +1,134 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "responsewriter.h"
+#include "utils.h"
+#include "fiberscheduler.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace ProblemSolver
+{
+
+void StringResponseWriter::write(const std::string& data)
+{
+    _response.append(data);
+}
+
+size_t StringResponseWriter::getBytesWritten() const
+{
+    return _response.size();
+}
+
+const std::string& StringResponseWriter::getResponse() const
+{
+    return _response;
+}
+
+SocketResponseWriter::SocketResponseWriter(int clientSocket, unsigned timeout):
+    _clientSocket(clientSocket),
+    _timeout(timeout),
+    _bytesWritten(0),
+    _failed(false)
+{
+}
+
+/**
+ * The data is sent without blocking, the writer waits for the socket to take more data only until the timeout
+ * passes since the last data it took. A fiber waits for the socket through its scheduler.
+ */
+void SocketResponseWriter::write(const std::string& data)
+{
+    uint64_t deadline = 0;
+    if(_timeout > 0)
+        deadline = utils::getMonotonicNanoseconds() + _timeout * 1000000ULL;
+    
+    size_t offset = 0;
+    while(!_failed && offset < data.size())
+    {
+        ssize_t written = send(_clientSocket, data.c_str() + offset, data.size() - offset, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                uint64_t now = utils::getMonotonicNanoseconds();
+                if(deadline != 0 && now >= deadline)
+                {
+                    _failed = true;
+                    break;
+                }
+                
+                if(utils::FiberScheduler::isInFiber())
+                {
+                    if(utils::FiberScheduler::waitWritable(_clientSocket, deadline))
+                        continue;
+                }
+                else
+                {
+                    pollfd descriptor;
+                    descriptor.fd = _clientSocket;
+                    descriptor.events = POLLOUT;
+                    descriptor.revents = 0;
+                    
+                    if(poll(&descriptor, 1, deadline != 0 ? static_cast<int>((deadline - now + 999999) / 1000000) : -1) >= 0 || errno == EINTR)
+                        continue;
+                }
+            }
+            
+            _failed = true;
+            break;
+        }
+        
+        offset += written;
+        _bytesWritten += written;
+        
+        if(_timeout > 0)
+            deadline = utils::getMonotonicNanoseconds() + _timeout * 1000000ULL;
+    }
+}
+
+size_t SocketResponseWriter::getBytesWritten() const
+{
+    return _bytesWritten;
+}
+
+bool SocketResponseWriter::hasFailed() const
+{
+    return _failed;
+}
+
+TimingResponseWriter::TimingResponseWriter(IResponseWriter& output):
+    _output(output),
+    _writeTime(0)
+{
+}
+
+void TimingResponseWriter::write(const std::string& data)
+{
+    uint64_t startTime = utils::getMonotonicNanoseconds();
+    _output.write(data);
+    _writeTime += utils::getMonotonicNanoseconds() - startTime;
+}
+
+size_t TimingResponseWriter::getBytesWritten() const
+{
+    return _output.getBytesWritten();
+}
+
+uint64_t TimingResponseWriter::getWriteTime() const
+{
+    return _writeTime;
+}
+
+} // namespace ProblemSolver
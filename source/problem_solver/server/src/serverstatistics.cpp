@@ -0,0 +1,159 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "serverstatistics.h"
+#include "datalayerstatistics.h"
+#include "utils.h"
+
+#include <boost/format.hpp>
+
+namespace ProblemSolver
+{
+
+const unsigned ServerStatistics::ERROR_CODE_COUNT;
+
+static const char* requestKindNames[ServerStatistics::requestKindCount] = { "database", "search", "suggest", "event", "eventSuggest", "batch", "stats", "invalid" };
+static const char* stageNames[ServerStatistics::stageCount] = { "parse", "dataLayer", "solver", "serialize", "write" };
+static const char* errorCodeNames[ServerStatistics::ERROR_CODE_COUNT] = { "dataLayer", "solvingMachine", "systemManager", "remoteJsonManager", "other" };
+
+/**
+ * Returns the percentiles of the histogram in microseconds as a JSON object
+ */
+static std::string latencyToJson(const utils::ConcurrentLatencyHistogram& histogram)
+{
+    utils::LatencyHistogram snapshot;
+    histogram.getSnapshot(snapshot);
+    
+    return (boost::format("{\"count\":%llu,\"mean\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}")
+            % static_cast<unsigned long long>(snapshot.getCount()) % (snapshot.getMean() / 1000)
+            % (snapshot.getPercentile(0.5) / 1000.0) % (snapshot.getPercentile(0.9) / 1000.0)
+            % (snapshot.getPercentile(0.99) / 1000.0) % (snapshot.getPercentile(0.999) / 1000.0)
+            % (snapshot.getMax() / 1000.0)).str();
+}
+
+ServerStatistics::ServerStatistics():
+    _startTime(utils::getMonotonicNanoseconds())
+{
+}
+
+ServerStatistics::Request::Request(ServerStatistics& statistics):
+    _statistics(statistics),
+    _kind(requestInvalid),
+    _errorCode(-1),
+    _startTime(utils::getMonotonicNanoseconds()),
+    _startRoundTripTime(DataLayerStatistics::getThreadRoundTripTime())
+{
+    for(unsigned i = 0; i < stageCount; ++i)
+    {
+        _stageTimes[i] = 0;
+        _measuredStages[i] = false;
+    }
+}
+
+ServerStatistics::Request::~Request()
+{
+    addStageTime(stageDataLayer, DataLayerStatistics::getThreadRoundTripTime() - _startRoundTripTime);
+    
+    _statistics._latencies[_kind].record(utils::getMonotonicNanoseconds() - _startTime);
+    
+    for(unsigned i = 0; i < stageCount; ++i)
+    {
+        if(_measuredStages[i])
+            _statistics._stages[i].record(_stageTimes[i]);
+    }
+    
+    if(_errorCode >= 0)
+    {
+        _statistics._errors[_kind].add();
+        _statistics._errorsByCode[_errorCode].add();
+    }
+}
+
+void ServerStatistics::Request::setError(const std::exception& error)
+{
+    const BaseException* baseException = dynamic_cast<const BaseException*>(&error);
+    
+    _errorCode = baseException != NULL ? baseException->getCode() : ERROR_CODE_COUNT - 1;
+}
+
+void ServerStatistics::Request::addStageTime(Stage stage, uint64_t time)
+{
+    _stageTimes[stage] += time;
+    _measuredStages[stage] = true;
+}
+
+ServerStatistics::StageTimer::StageTimer(Request& request, Stage stage):
+    _request(request),
+    _stage(stage),
+    _startTime(utils::getMonotonicNanoseconds()),
+    _startRoundTripTime(DataLayerStatistics::getThreadRoundTripTime())
+{
+}
+
+ServerStatistics::StageTimer::~StageTimer()
+{
+    uint64_t time = utils::getMonotonicNanoseconds() - _startTime;
+    uint64_t roundTripTime = DataLayerStatistics::getThreadRoundTripTime() - _startRoundTripTime;
+    
+    _request.addStageTime(_stage, time > roundTripTime ? time - roundTripTime : 0);
+}
+
+ServerStatistics::RequestKind ServerStatistics::getRequestKind(const std::string& requestType)
+{
+    for(unsigned i = 0; i < requestInvalid; ++i)
+    {
+        if(requestType == requestKindNames[i])
+            return static_cast<RequestKind>(i);
+    }
+    
+    return requestInvalid;
+}
+
+std::string ServerStatistics::toJson() const
+{
+    std::string result = (boost::format("{\"uptime\":%.3f,\"requests\":{") % ((utils::getMonotonicNanoseconds() - _startTime) / 1e9)).str();
+    
+    for(unsigned i = 0; i < requestKindCount; ++i)
+    {
+        if(i > 0)
+            result += ",";
+        
+        result += (boost::format("\"%s\":{\"errors\":%llu,\"rejected\":%llu,\"latency\":%s}") % requestKindNames[i]
+                   % static_cast<unsigned long long>(_errors[i].get()) % static_cast<unsigned long long>(_rejected[i].get())
+                   % latencyToJson(_latencies[i])).str();
+    }
+    
+    result += "},\"queue\":" + latencyToJson(_queueTimes) + ",\"stages\":{";
+    
+    for(unsigned i = 0; i < stageCount; ++i)
+    {
+        if(i > 0)
+            result += ",";
+        
+        result += (boost::format("\"%s\":%s") % stageNames[i] % latencyToJson(_stages[i])).str();
+    }
+    
+    result += "},\"errors\":{";
+    
+    for(unsigned i = 0; i < ERROR_CODE_COUNT; ++i)
+    {
+        if(i > 0)
+            result += ",";
+        
+        result += (boost::format("\"%s\":%llu") % errorCodeNames[i] % static_cast<unsigned long long>(_errorsByCode[i].get())).str();
+    }
+    
+    result += (boost::format("},\"dataLayer\":{\"cacheHits\":%llu,\"cacheMisses\":%llu,\"roundTrips\":%llu,\"roundTripLatency\":%s}}")
+               % static_cast<unsigned long long>(DataLayerStatistics::cacheHits.get())
+               % static_cast<unsigned long long>(DataLayerStatistics::cacheMisses.get())
+               % static_cast<unsigned long long>(DataLayerStatistics::roundTrips.get())
+               % latencyToJson(DataLayerStatistics::roundTripLatency)).str();
+    
+    return result;
+}
+
+} // namespace ProblemSolver
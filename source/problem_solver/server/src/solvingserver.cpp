@@ -6,13 +6,35 @@
  */
 
 #include "mongodbdatalayer.h"
+#include "memorydatalayer.h"
+#include "cachingdatalayer.h"
+#include "snapshotreader.h"
+#include "snapshotwriter.h"
+#include "mappeddatalayer.h"
+#include "changepublishingdatalayer.h"
+#include "filechangefeed.h"
+#include "mongochangefeed.h"
+#include "profilingdatalayer.h"
+#include "sessiondatalayer.h"
+#include "fiberdatalayer.h"
 
 #include "systemmanager.h"
 #include "remotejsonmanager.h"
+#include "jsonserialization.h"
+
+#include "utils.h"
+#include "logger.h"
 
 #include <stdio.h>
 #include <signal.h>
+#include <stdexcept>
 #include <boost/program_options.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
 
 using namespace ProblemSolver;
 namespace po = boost::program_options;
@@ -22,7 +44,7 @@ namespace po = boost::program_options;
  */
 void interruptHandler(int signal)
 {
-    printf("Caught signal %d\n", signal);
+    utils::Logger::log(utils::logInfo, "Caught signal %d", signal);
     RemoteJsonManager::stopAll();
 }
 
@@ -32,14 +54,230 @@ void interruptHandler(int signal)
 void initHandlers()
 {
     struct sigaction sigIntHandler;
-
+    
     sigIntHandler.sa_handler = interruptHandler;
     sigemptyset(&sigIntHandler.sa_mask);
     sigIntHandler.sa_flags = 0;
-
+    
     sigaction(SIGINT, &sigIntHandler, NULL);
 }
 
+/**
+ * Writes a snapshot of the data layer, errors are only reported as the server can continue without it
+ */
+void writeSnapshot(IDataLayerRead& dataLayer, const std::string& fileName)
+{
+    // the data layer can use interruption points, the snapshot must not be left half written
+    boost::this_thread::disable_interruption disableInterruption;
+    
+    try
+    {
+        double startTime = utils::getCurrentSeconds();
+        uint64_t size = SnapshotWriter().write(dataLayer, fileName);
+        
+        utils::Logger::log(utils::logInfo, "Snapshot written to %s: %.1f MB in %.3f seconds",
+                           fileName.c_str(), size / (1024.0 * 1024.0), utils::getCurrentSeconds() - startTime);
+    }
+    catch(std::exception& e)
+    {
+        utils::Logger::log(utils::logError, "Writing snapshot %s failed! Error: %s", fileName.c_str(), e.what());
+    }
+}
+
+/**
+ * Writes a snapshot every interval seconds until the thread is interrupted
+ */
+void snapshotLoop(IDataLayerRead* dataLayer, std::string fileName, unsigned interval)
+{
+    try
+    {
+        while(true)
+        {
+            boost::this_thread::sleep(boost::posix_time::seconds(interval));
+            writeSnapshot(*dataLayer, fileName);
+        }
+    }
+    catch(boost::thread_interrupted&)
+    {
+    }
+}
+
+/**
+ * Checks for a new knowledge snapshot every interval seconds until the thread is interrupted
+ */
+void knowledgeRefreshLoop(MappedDataLayer* knowledgeDataLayer, unsigned interval)
+{
+    try
+    {
+        while(true)
+        {
+            boost::this_thread::sleep(boost::posix_time::seconds(interval));
+            
+            try
+            {
+                if(knowledgeDataLayer->refresh())
+                    utils::Logger::log(utils::logInfo, "New knowledge snapshot mapped");
+            }
+            catch(DataLayerException& e)
+            {
+                utils::Logger::log(utils::logError, "Knowledge snapshot refresh failed, the old one is still used! Error: %s", e.what());
+            }
+        }
+    }
+    catch(boost::thread_interrupted&)
+    {
+    }
+}
+
+/**
+ * Applies the changes made by other nodes to the cache until the thread is interrupted
+ */
+void changeFeedLoop(boost::shared_ptr<IChangeFeed> changeFeed, CachingDataLayer* cachingDataLayer, unsigned pollInterval)
+{
+    try
+    {
+        while(true)
+        {
+            try
+            {
+                std::vector<DataChange> changes;
+                if(changeFeed->read(changes, pollInterval))
+                    cachingDataLayer->applyChanges(changes);
+            }
+            catch(DataLayerException& e)
+            {
+                utils::Logger::log(utils::logError, "Applying changes from the change feed failed! Error: %s", e.what());
+                boost::this_thread::sleep(boost::posix_time::milliseconds(pollInterval));
+            }
+        }
+    }
+    catch(boost::thread_interrupted&)
+    {
+    }
+}
+
+/**
+ * Prints the statistics of the server every interval seconds until the thread is interrupted.
+ * The data layer calls are printed too when they are profiled and the investigation sessions when they are kept.
+ */
+void statisticsLoop(const RemoteJsonManager* remoteJsonManager, const ProfilingDataLayer* profilingDataLayer,
+                    const SessionDataLayer* sessionDataLayer, const SystemManager* systemManager, unsigned interval)
+{
+    try
+    {
+        while(true)
+        {
+            boost::this_thread::sleep(boost::posix_time::seconds(interval));
+            utils::Logger::log(utils::logInfo, "Statistics: %s", remoteJsonManager->getStatistics().toJson().c_str());
+            
+            if(profilingDataLayer != NULL)
+            {
+                DataLayerProfile totals;
+                profilingDataLayer->getTotals(totals);
+                utils::Logger::log(utils::logInfo, "Data layer profile: %s", JsonSerializer().serialize(totals).c_str());
+            }
+            
+            if(sessionDataLayer != NULL)
+            {
+                SessionDataLayer::Statistics sessions = sessionDataLayer->getStatistics();
+                utils::Logger::log(utils::logInfo, "Investigation sessions: %u open, %llu hits, %llu misses, %llu writes, %llu write errors, %llu evictions",
+                                   sessions.sessions, (unsigned long long)sessions.hits, (unsigned long long)sessions.misses,
+                                   (unsigned long long)sessions.writes, (unsigned long long)sessions.writeErrors, (unsigned long long)sessions.evictions);
+            }
+            
+            if(systemManager->hasEventJournal())
+            {
+                utils::Logger::log(utils::logInfo, "Event journal: %llu events not applied",
+                                   (unsigned long long)systemManager->getUnappliedEventCount());
+            }
+        }
+    }
+    catch(boost::thread_interrupted&)
+    {
+    }
+}
+
+/**
+ * Creates the change feed named on the command line: "mongo" or "file:<path>"
+ */
+IChangeFeed* createChangeFeed(const std::string& name, const std::string& mongoConnectionString, const std::string& mongoDatabase)
+{
+    const std::string filePrefix = "file:";
+    
+    if(name == "mongo")
+        return new MongoChangeFeed(mongoConnectionString, mongoDatabase);
+    
+    if(name.compare(0, filePrefix.size(), filePrefix) == 0)
+        return new FileChangeFeed(name.substr(filePrefix.size()));
+    
+    throw std::invalid_argument("Unknown change feed " + name);
+}
+
+/**
+ * Reads one number for each request priority (interactive, database and bulk) from a comma separated list
+ */
+std::vector<unsigned> parsePriorityValues(const std::string& text)
+{
+    std::vector<std::string> parts;
+    boost::algorithm::split(parts, text, boost::algorithm::is_any_of(","));
+    
+    if(parts.size() != RequestScheduler::priorityCount)
+        throw std::invalid_argument("Expected a value for each priority (interactive,database,bulk) in " + text);
+    
+    std::vector<unsigned> values;
+    BOOST_FOREACH(const std::string& part, parts)
+    {
+        values.push_back(boost::lexical_cast<unsigned>(part));
+    }
+    
+    return values;
+}
+
+/**
+ * Returns the default queue sizes or waits of the request priorities as a comma separated list
+ */
+std::string formatDefaultLimits(bool waits)
+{
+    const RequestScheduler::Limits* limits = RequestScheduler::DEFAULT_LIMITS;
+    
+    if(waits)
+        return (boost::format("%u,%u,%u") % limits[0].maxWait % limits[1].maxWait % limits[2].maxWait).str();
+    
+    return (boost::format("%u,%u,%u") % limits[0].maxQueued % limits[1].maxQueued % limits[2].maxQueued).str();
+}
+
+/**
+ * Loads the snapshot into a new memory data layer, returns NULL if the snapshot can not be used
+ */
+MemoryDataLayer* loadSnapshot(const std::string& fileName)
+{
+    std::auto_ptr<MemoryDataLayer> memoryDataLayer(new MemoryDataLayer());
+    
+    try
+    {
+        double startTime = utils::getCurrentSeconds();
+        long startMemory = utils::getResidentMemory();
+        
+        SnapshotReader snapshot(fileName);
+        snapshot.load(*memoryDataLayer, false); // investigations are never cached
+        
+        utils::Logger::log(utils::logInfo, "Loaded %u categories, %u problems, %u symptoms, %u solutions, %u symptom links and %u solution links from snapshot %s",
+                           snapshot.getRecordCount(snapshotSectionCategories), snapshot.getRecordCount(snapshotSectionProblems),
+                           snapshot.getRecordCount(snapshotSectionSymptoms), snapshot.getRecordCount(snapshotSectionSolutions),
+                           snapshot.getRecordCount(snapshotSectionSymptomLinks), snapshot.getRecordCount(snapshotSectionSolutionLinks),
+                           fileName.c_str());
+        utils::Logger::log(utils::logInfo, "Load time: %.3f seconds, memory footprint: %.1f MB",
+                           utils::getCurrentSeconds() - startTime, (utils::getResidentMemory() - startMemory) / (1024.0 * 1024.0));
+    }
+    catch(std::exception& e)
+    {
+        utils::Logger::log(utils::logError, "Snapshot %s can not be used! Error: %s", fileName.c_str(), e.what());
+        return NULL;
+    }
+    
+    return memoryDataLayer.release();
+}
+
 #include "boost/property_tree/json_parser.hpp"
 #include "boost/property_tree/info_parser.hpp"
 
@@ -51,6 +289,37 @@ int main(int argc, const char* argv[])
     int port;
     std::string mongoConnectionString;
     std::string mongoDatabase;
+    unsigned getBatchSize;
+    unsigned batchThreads;
+    unsigned maxRequestSize;
+    unsigned readTimeout;
+    unsigned writeTimeout;
+    unsigned workerThreads;
+    int listenBacklog;
+    std::vector<unsigned> maxQueued;
+    std::vector<unsigned> maxQueueWait;
+    unsigned suggestDeadline;
+    bool warmStart;
+    unsigned preloadBatchSize;
+    std::string snapshotFile;
+    unsigned snapshotInterval;
+    std::string knowledgeSnapshot;
+    unsigned knowledgeRefreshInterval;
+    std::string changeFeedName;
+    unsigned changeFeedPollInterval;
+    unsigned statisticsInterval;
+    bool profileDataLayer;
+    bool investigationSessions;
+    unsigned sessionFlushDelay;
+    unsigned sessionIdleTimeout;
+    unsigned solverStates;
+    unsigned solverStateMaxAge;
+    unsigned readThreads;
+    unsigned fibers;
+    unsigned ioThreads;
+    std::string eventJournal;
+    std::string logLevelName;
+    unsigned logRequestInterval;
     
     po::variables_map optionsMap;
     try
@@ -61,8 +330,88 @@ int main(int argc, const char* argv[])
             ("host", po::value<std::string>()->required(), "Required. Server IP")
             ("port", po::value<int>()->required(), "Required. Server Port")
             ("mongoConnection", po::value<std::string>()->required(), "Required. Mongo Connection string. E.g: host:port")
-            ("mongoDatabase", po::value<std::string>()->required(), "Required. Mongo Database name. E.g: kb");
-
+            ("mongoDatabase", po::value<std::string>()->required(), "Required. Mongo Database name. E.g: kb")
+            ("getBatchSize", po::value<unsigned>()->default_value(RemoteJsonManager::DEFAULT_GET_BATCH_SIZE),
+                "Optional. How many objects are read at once when a get request asks for all objects")
+            ("batchThreads", po::value<unsigned>()->default_value(RemoteJsonManager::DEFAULT_BATCH_THREADS),
+                "Optional. How many requests of a parallel batch run at once. 1 runs every batch in order")
+            ("maxRequestSize", po::value<unsigned>()->default_value(RemoteJsonManager::DEFAULT_MAX_REQUEST_SIZE),
+                "Optional. Longest accepted request in bytes, batches of many requests need a big limit")
+            ("readTimeout", po::value<unsigned>()->default_value(RemoteJsonManager::DEFAULT_READ_TIMEOUT),
+                "Optional. Milliseconds a client has to send its whole request, slower requests are rejected so they do not "
+                "hold up the accepting of the other connections. 0 waits forever")
+            ("writeTimeout", po::value<unsigned>()->default_value(RemoteJsonManager::DEFAULT_WRITE_TIMEOUT),
+                "Optional. Milliseconds a client may take none of its response before it is dropped, so a client that stops "
+                "reading does not stall the other requests. 0 waits forever")
+            ("workerThreads", po::value<unsigned>()->default_value(RemoteJsonManager::DEFAULT_WORKER_THREADS),
+                "Optional. How many requests are processed at once, by priority: interactive (search, suggest, events), "
+                "database and bulk (batches, bulk writes, reads of whole collections). 0 processes them one by one in the accepting thread")
+            ("listenBacklog", po::value<int>()->default_value(RemoteJsonManager::DEFAULT_LISTEN_BACKLOG),
+                "Optional. How many new connections the system keeps before they are accepted")
+            ("maxQueued", po::value<std::string>()->default_value(formatDefaultLimits(false)),
+                "Optional. How many interactive, database and bulk requests can wait for a worker. "
+                "More are rejected right away with an overloaded error. 0 is unlimited")
+            ("maxQueueWait", po::value<std::string>()->default_value(formatDefaultLimits(true)),
+                "Optional. Milliseconds an interactive, database and bulk request can wait for a worker, "
+                "then it is rejected with an overloaded error. 0 waits forever")
+            ("suggestDeadline", po::value<unsigned>()->default_value(0),
+                "Optional. Milliseconds the solver has for a suggestion, then the best suggestion so far is returned with \"partial\": true. "
+                "Requests can set their own with \"deadline\". 0 is unlimited")
+            ("warmStart", po::bool_switch()->default_value(false),
+                "Optional. Load the whole knowledge base in memory before accepting connections. Writes still go to Mongo")
+            ("preloadBatchSize", po::value<unsigned>()->default_value(CachingDataLayer::DEFAULT_PRELOAD_BATCH_SIZE),
+                "Optional. How many objects are read at once by each collection loader during warm start")
+            ("snapshotFile", po::value<std::string>()->default_value(""),
+                "Optional. Snapshot of the knowledge base written on shutdown. With warmStart it is loaded instead of reading Mongo, "
+                "so it must not be older than the database")
+            ("snapshotInterval", po::value<unsigned>()->default_value(0),
+                "Optional. Seconds between snapshots while running. 0 writes a snapshot only on shutdown")
+            ("knowledgeSnapshot", po::value<std::string>()->default_value(""),
+                "Optional. Serve searches and suggestions directly from this snapshot mapped in memory and shared with other processes. "
+                "Link updates are written to Mongo and are seen only after a new snapshot is published")
+            ("knowledgeRefreshInterval", po::value<unsigned>()->default_value(10),
+                "Optional. Seconds between checks for a new knowledge snapshot")
+            ("changeFeed", po::value<std::string>()->default_value(""),
+                "Optional. Publish knowledge base changes to other nodes and, with warmStart, apply their changes to the memory cache. "
+                "\"mongo\" uses the changes collection of the database, \"file:<path>\" a local file (for tests)")
+            ("changeFeedPollInterval", po::value<unsigned>()->default_value(500),
+                "Optional. Milliseconds to wait for new changes when the change feed is empty")
+            ("statisticsInterval", po::value<unsigned>()->default_value(0),
+                "Optional. Seconds between prints of the request statistics (also returned by the \"stats\" request). 0 never prints them")
+            ("profileDataLayer", po::bool_switch()->default_value(false),
+                "Optional. Count the calls and time of every data layer operation. Printed with the statistics "
+                "and returned for each suggestion requested with \"profile\": true")
+            ("investigationSessions", po::bool_switch()->default_value(false),
+                "Optional. Keep open investigations in memory and write their changes to Mongo in the background. "
+                "Changes of the last sessionFlushDelay milliseconds are lost on a crash and each investigation must be served by one node only")
+            ("sessionFlushDelay", po::value<unsigned>()->default_value(SessionDataLayer::DEFAULT_FLUSH_DELAY),
+                "Optional. Milliseconds after which a change of an investigation session is written to Mongo")
+            ("sessionIdleTimeout", po::value<unsigned>()->default_value(SessionDataLayer::DEFAULT_IDLE_TIMEOUT),
+                "Optional. Seconds after which an unused investigation session is dropped from memory")
+            ("solverStates", po::value<unsigned>()->default_value(SystemManager::DEFAULT_MAX_SOLVER_STATES),
+                "Optional. How many investigations keep the solver state between suggestions, so a suggestion after an event "
+                "loads and scores only what the event changed. 0 builds every suggestion from scratch")
+            ("solverStateMaxAge", po::value<unsigned>()->default_value(SystemManager::DEFAULT_SOLVER_STATE_MAX_AGE),
+                "Optional. Seconds after which a solver state is built again, so it sees the link changes of other investigations")
+            ("readThreads", po::value<unsigned>()->default_value(0),
+                "Optional. Threads that read the knowledge for suggestions, so their independent lookups (e.g. the links of "
+                "the subject problems) wait for Mongo at the same time. Useful when the links are not preloaded. "
+                "0 reads them one after another in the request thread")
+            ("fibers", po::value<unsigned>()->default_value(0),
+                "Optional. Run the requests as fibers on the worker threads, up to this many requests in flight at once. "
+                "A request waiting for Mongo or its client lets the other requests of the thread run. "
+                "More requests are rejected right away with an overloaded error. 0 queues the requests for the worker threads")
+            ("ioThreads", po::value<unsigned>()->default_value(FiberDataLayer::DEFAULT_THREAD_COUNT),
+                "Optional. With fibers, how many Mongo operations of the suspended requests run at once")
+            ("eventJournal", po::value<std::string>()->default_value(""),
+                "Optional. Acknowledge the events once they are synced to this local file and apply them to Mongo in the background, "
+                "so event requests do not wait for Mongo. The events left in the file are applied on startup. Empty applies them "
+                "before they are acknowledged")
+            ("logLevel", po::value<std::string>()->default_value("info"),
+                "Optional. Lowest level of the logged messages: debug, info, warning or error. Request bodies are logged at debug level")
+            ("logRequestInterval", po::value<unsigned>()->default_value(0),
+                "Optional. Log every N-th request body at info level too. 0 logs them only at debug level");
+        
         po::store(po::parse_command_line(argc, argv, allowedOptions), optionsMap, true);
         
         if (optionsMap.count("help") || optionsMap.empty())
@@ -70,13 +419,44 @@ int main(int argc, const char* argv[])
             std::cout << allowedOptions << "\n";
             return 1;
         }
-
+        
         po::notify(optionsMap);
         
         host = optionsMap["host"].as<std::string>();
         port = optionsMap["port"].as<int>();
         mongoConnectionString = optionsMap["mongoConnection"].as<std::string>();
         mongoDatabase = optionsMap["mongoDatabase"].as<std::string>();
+        getBatchSize = optionsMap["getBatchSize"].as<unsigned>();
+        batchThreads = optionsMap["batchThreads"].as<unsigned>();
+        maxRequestSize = optionsMap["maxRequestSize"].as<unsigned>();
+        readTimeout = optionsMap["readTimeout"].as<unsigned>();
+        writeTimeout = optionsMap["writeTimeout"].as<unsigned>();
+        workerThreads = optionsMap["workerThreads"].as<unsigned>();
+        listenBacklog = optionsMap["listenBacklog"].as<int>();
+        maxQueued = parsePriorityValues(optionsMap["maxQueued"].as<std::string>());
+        maxQueueWait = parsePriorityValues(optionsMap["maxQueueWait"].as<std::string>());
+        suggestDeadline = optionsMap["suggestDeadline"].as<unsigned>();
+        warmStart = optionsMap["warmStart"].as<bool>();
+        preloadBatchSize = optionsMap["preloadBatchSize"].as<unsigned>();
+        snapshotFile = optionsMap["snapshotFile"].as<std::string>();
+        snapshotInterval = optionsMap["snapshotInterval"].as<unsigned>();
+        knowledgeSnapshot = optionsMap["knowledgeSnapshot"].as<std::string>();
+        knowledgeRefreshInterval = optionsMap["knowledgeRefreshInterval"].as<unsigned>();
+        changeFeedName = optionsMap["changeFeed"].as<std::string>();
+        changeFeedPollInterval = optionsMap["changeFeedPollInterval"].as<unsigned>();
+        statisticsInterval = optionsMap["statisticsInterval"].as<unsigned>();
+        profileDataLayer = optionsMap["profileDataLayer"].as<bool>();
+        investigationSessions = optionsMap["investigationSessions"].as<bool>();
+        sessionFlushDelay = optionsMap["sessionFlushDelay"].as<unsigned>();
+        sessionIdleTimeout = optionsMap["sessionIdleTimeout"].as<unsigned>();
+        solverStates = optionsMap["solverStates"].as<unsigned>();
+        solverStateMaxAge = optionsMap["solverStateMaxAge"].as<unsigned>();
+        readThreads = optionsMap["readThreads"].as<unsigned>();
+        fibers = optionsMap["fibers"].as<unsigned>();
+        ioThreads = optionsMap["ioThreads"].as<unsigned>();
+        eventJournal = optionsMap["eventJournal"].as<std::string>();
+        logLevelName = optionsMap["logLevel"].as<std::string>();
+        logRequestInterval = optionsMap["logRequestInterval"].as<unsigned>();
     }
     catch(std::exception& e)
     {
@@ -84,12 +464,179 @@ int main(int argc, const char* argv[])
         return 1;
     }
     
-    /** \todo Lubo: in the future the caching must be implemented */
-    // SystemManager systemManager(new CachingDataLayer(new MongoDbDataLayer(), new MemoryDataLayer()));
-    SystemManager systemManager(new MongoDbDataLayer(mongoConnectionString, mongoDatabase));
+    utils::LogLevel logLevel;
+    if(!utils::Logger::parseLevel(logLevelName, logLevel))
+    {
+        std::cout << "Error: unknown log level " << logLevelName << "\n";
+        return 1;
+    }
+    
+    // a session write holds a lock across its Mongo write, a fiber would block its thread on it
+    if(fibers > 0 && investigationSessions)
+    {
+        std::cout << "Error: fibers can not be used with investigationSessions\n";
+        return 1;
+    }
+    
+    // the messages left in the buffer are written when the process exits
+    utils::Logger::start(logLevel);
+    
+    IDataLayer* dataLayer = new MongoDbDataLayer(mongoConnectionString, mongoDatabase);
+    
+    // created before the cache is filled, so changes made during the load are applied after it
+    boost::shared_ptr<IChangeFeed> changeFeed;
+    if(!changeFeedName.empty())
+    {
+        try
+        {
+            changeFeed.reset(createChangeFeed(changeFeedName, mongoConnectionString, mongoDatabase));
+        }
+        catch(std::exception& e)
+        {
+            utils::Logger::log(utils::logError, "Change feed can not be used! Error: %s", e.what());
+            delete dataLayer;
+            return 1;
+        }
+        
+        dataLayer = new ChangePublishingDataLayer(dataLayer, changeFeed);
+    }
+    
+    // only the operations that reach Mongo leave the fiber, the cache above is read in place
+    if(fibers > 0)
+        dataLayer = new FiberDataLayer(dataLayer, ioThreads);
+    
+    MemoryDataLayer* snapshotDataLayer = NULL;
+    if(warmStart && !snapshotFile.empty())
+        snapshotDataLayer = loadSnapshot(snapshotFile);
+    
+    CachingDataLayer* cachingDataLayer = NULL;
+    if(snapshotDataLayer != NULL)
+    {
+        cachingDataLayer = new CachingDataLayer(dataLayer, snapshotDataLayer, true);
+        dataLayer = cachingDataLayer;
+    }
+    else if(warmStart)
+    {
+        cachingDataLayer = new CachingDataLayer(dataLayer, new MemoryDataLayer());
+        dataLayer = cachingDataLayer;
+        
+        utils::Logger::log(utils::logInfo, "Loading knowledge base in memory...");
+        
+        try
+        {
+            CachingDataLayer::PreloadReport report = cachingDataLayer->preload(preloadBatchSize);
+            
+            utils::Logger::log(utils::logInfo, "Loaded %u categories, %u problems, %u symptoms, %u solutions, %u symptom links and %u solution links",
+                               report.categories, report.problems, report.symptoms, report.solutions, report.symptomLinks, report.solutionLinks);
+            utils::Logger::log(utils::logInfo, "Load time: %.3f seconds, memory footprint: %.1f MB", report.seconds, report.memoryBytes / (1024.0 * 1024.0));
+        }
+        catch(std::exception& e)
+        {
+            utils::Logger::log(utils::logError, "Warm start failed! Error: %s", e.what());
+            delete dataLayer;
+            return 1;
+        }
+    }
+    
+    MappedDataLayer* knowledgeDataLayer = NULL;
+    if(!knowledgeSnapshot.empty())
+    {
+        try
+        {
+            knowledgeDataLayer = new MappedDataLayer(knowledgeSnapshot);
+        }
+        catch(std::exception& e)
+        {
+            utils::Logger::log(utils::logError, "Knowledge snapshot can not be used! Error: %s", e.what());
+            delete dataLayer;
+            return 1;
+        }
+    }
+    
+    SessionDataLayer* sessionDataLayer = NULL;
+    if(investigationSessions)
+    {
+        sessionDataLayer = new SessionDataLayer(dataLayer, sessionFlushDelay, sessionIdleTimeout);
+        dataLayer = sessionDataLayer;
+    }
+    
+    ProfilingDataLayer* profilingDataLayer = NULL;
+    if(profileDataLayer)
+    {
+        profilingDataLayer = new ProfilingDataLayer(dataLayer);
+        dataLayer = profilingDataLayer;
+    }
+    
+    SystemManager systemManager(dataLayer, knowledgeDataLayer);
+    systemManager.setSolverStateLimits(solverStates, solverStateMaxAge);
+    systemManager.setReadThreads(readThreads);
+    
+    RemoteJsonManager remoteJsonManager(systemManager, getBatchSize);
+    remoteJsonManager.setRequestLogInterval(logRequestInterval);
+    remoteJsonManager.setBatchThreads(batchThreads);
+    remoteJsonManager.setMaxRequestSize(maxRequestSize);
+    remoteJsonManager.setReadTimeout(readTimeout);
+    remoteJsonManager.setWriteTimeout(writeTimeout);
+    remoteJsonManager.setWorkerThreads(workerThreads);
+    remoteJsonManager.setListenBacklog(listenBacklog);
+    remoteJsonManager.setSuggestDeadline(suggestDeadline);
+    remoteJsonManager.setFibers(fibers);
+    
+    for(unsigned i = 0; i < RequestScheduler::priorityCount; ++i)
+    {
+        remoteJsonManager.setQueueLimits(static_cast<RequestScheduler::Priority>(i), RequestScheduler::Limits(maxQueued[i], maxQueueWait[i]));
+    }
+    
+    if(!eventJournal.empty())
+    {
+        try
+        {
+            remoteJsonManager.setEventJournal(eventJournal);
+        }
+        catch(std::exception& e)
+        {
+            utils::Logger::log(utils::logError, "Event journal can not be used! Error: %s", e.what());
+            return 1;
+        }
+    }
+    
+    boost::thread knowledgeRefreshThread;
+    if(knowledgeDataLayer != NULL && knowledgeRefreshInterval > 0)
+        knowledgeRefreshThread = boost::thread(knowledgeRefreshLoop, knowledgeDataLayer, knowledgeRefreshInterval);
+    
+    boost::thread changeFeedThread;
+    if(changeFeed && cachingDataLayer != NULL)
+        changeFeedThread = boost::thread(changeFeedLoop, changeFeed, cachingDataLayer, changeFeedPollInterval);
+    
+    boost::thread snapshotThread;
+    if(!snapshotFile.empty() && snapshotInterval > 0)
+        snapshotThread = boost::thread(snapshotLoop, &systemManager.getDataLayer(), snapshotFile, snapshotInterval);
+    
+    boost::thread statisticsThread;
+    if(statisticsInterval > 0)
+        statisticsThread = boost::thread(statisticsLoop, &remoteJsonManager, profilingDataLayer, sessionDataLayer, &systemManager, statisticsInterval);
     
-    RemoteJsonManager remoteJsonManager(systemManager);
     remoteJsonManager.run(host, port);
     
+    // the snapshot gets the events applied until now, the rest are applied on the next start
+    systemManager.closeEventJournal();
+    
+    statisticsThread.interrupt();
+    statisticsThread.join();
+    
+    knowledgeRefreshThread.interrupt();
+    knowledgeRefreshThread.join();
+    
+    changeFeedThread.interrupt();
+    changeFeedThread.join();
+    
+    if(!snapshotFile.empty())
+    {
+        snapshotThread.interrupt();
+        snapshotThread.join();
+        
+        writeSnapshot(systemManager.getDataLayer(), snapshotFile);
+    }
+    
     return 0;
 }
@@ -0,0 +1,147 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "systemmanager.h"
+#include "fiberscheduler.h"
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <utility>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace ProblemSolver
+{
+
+/**
+ * Write-ahead journal of the events of investigations, kept in a local text file.
+ * An event is acknowledged as soon as it is on the disk and is applied to the data layer later by a background thread,
+ * so a slow or unavailable database does not slow down or fail the events.
+ * The events appended while the disk is busy are written and synced together (group commit).
+ * Each event is applied by the apply function, which is called again after a delay while it throws, and then
+ * an "applied" line is appended. The events not marked as applied are applied again when the journal is opened,
+ * so the apply function must tolerate an event that was already applied. An event that can never be applied,
+ * e.g. of a deleted investigation, must be skipped by the apply function, as the events after it wait for it.
+ * One line per event: "event <sequence> <investigation id> <symptom|problem|solution> <object id> <1|0>",
+ * the file is emptied when all its events are applied and it is longer than the maximum size.
+ * A write error stops the journal, all later appends fail.
+ */
+class EventJournal
+{
+public:
+    
+    static const unsigned DEFAULT_MAX_SIZE = 64 * 1024 * 1024; // bytes
+    static const unsigned RETRY_DELAY = 1000; // milliseconds
+    static const unsigned MAX_REPLAY_ATTEMPTS = 10; // of an event left in the file, then opening the journal fails
+    
+    typedef boost::function<void (CIdentifier investigationID, const SystemManager::Event& event)> ApplyFunction;
+    
+public:
+    
+    /**
+     * Applies the events left unapplied in the file before it returns. Throws an Exception if one of them still
+     * fails after MAX_REPLAY_ATTEMPTS, it stays in the file with the events after it.
+     */
+    EventJournal(const std::string& fileName, const ApplyFunction& apply, unsigned maxSize = DEFAULT_MAX_SIZE);
+    
+    /**
+     * Writes the appended events, the events that are not applied yet are applied when the journal is opened again
+     */
+    ~EventJournal();
+    
+public:
+    
+    /**
+     * Exception thrown when the journal file can not be used
+     */
+    class Exception: public SystemManager::Exception
+    {
+    public:
+        explicit Exception(const std::string& errorMessage):
+            SystemManager::Exception(errorMessage){}
+    };
+    
+public:
+    
+    /**
+     * Thread safe. Queues the events for writing and returns the sequence number of the last one,
+     * they are on the disk when waitWritten for it returns
+     */
+    uint64_t append(CIdentifier investigationID, const std::vector<SystemManager::Event>& events);
+    
+    /**
+     * Waits until the event with the sequence number is on the disk, a fiber is suspended instead.
+     * Throws an Exception if the journal could not write it.
+     */
+    void waitWritten(uint64_t sequence);
+    
+    /**
+     * Events that are written or queued but not applied yet
+     */
+    uint64_t getUnappliedCount() const;
+    
+private:
+    
+    struct Record
+    {
+        uint64_t sequence;
+        Identifier investigationID;
+        SystemManager::Event event;
+    };
+    
+private:
+    
+    EventJournal(const EventJournal&);
+    EventJournal& operator=(const EventJournal&);
+    
+    void replay();
+    bool parseLine(const std::string& line, Record& record, uint64_t& appliedSequence);
+    
+    bool applyWithRetry(const Record& record, unsigned maxAttempts = 0);
+    
+    void writeLoop();
+    void applyLoop();
+    
+    bool writeText(const std::string& text);
+    
+private:
+    
+    std::string _fileName;
+    int _file; // opened for appending
+    unsigned _maxSize;
+    ApplyFunction _apply;
+    
+    uint64_t _lastSequence; // of the last appended event
+    uint64_t _writtenSequence; // all events up to it are on the disk
+    uint64_t _appliedSequence; // all events up to it are applied
+    
+    std::string _buffer; // lines waiting for the writer
+    std::vector<Record> _bufferRecords; // events in the buffer, they are applied after they are written
+    bool _failed;
+    std::string _error;
+    bool _stopped; // stops the applier
+    bool _writeStopped; // stops the writer after the applier is stopped
+    
+    std::deque<Record> _applyQueue;
+    std::vector<std::pair<uint64_t, utils::FiberScheduler::Handle> > _waitingFibers;
+    
+    mutable boost::mutex _mutex;
+    boost::condition_variable _bufferChanged;
+    boost::condition_variable _written;
+    boost::condition_variable _applyQueueChanged;
+    
+    boost::thread _writeThread;
+    boost::thread _applyThread;
+    
+};
+
+} // namespace ProblemSolver
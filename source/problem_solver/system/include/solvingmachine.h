@@ -8,6 +8,8 @@
 #pragma once
 
 #include "datalayerread.h"
+#include "asyncdatalayerread.h"
+#include "symptomlinktable.h"
 
 #include <vector>
 #include <boost/unordered_set.hpp>
@@ -40,10 +42,36 @@ public:
      * E.g. if we have 4 problems with values 75, 50, 44, 30 then the upper bound problems are those with values 75 and 50.
      */
     static const double UPPER_BOUND_PROBLEM_RANGE = 20; 
+    static const unsigned CATEGORY_BATCH_SIZE = 1000; // how many categories are read at once to build a category branch
     
 public:
     
-    SolvingMachine(IDataLayerRead& dataLayer);
+    /**
+     * How a suggestion is made, the defaults make a complete and exact suggestion
+     */
+    struct Options
+    {
+        Options():
+            deadline(0), exactSymptoms(0), reader(NULL){}
+        
+        uint64_t deadline; // monotonic nanoseconds, a suggestion still running then stops early and is partial. 0 for none
+        
+        /**
+         * Approximate mode: the subject symptoms are ranked by an estimate of their value and only this many
+         * of the best are valued exactly, the others get their estimates. 0 values all symptoms exactly.
+         */
+        unsigned exactSymptoms;
+        
+        /**
+         * Reads the data layer of the machine with many reads in flight, independent lookups are then started together.
+         * NULL runs every read in the calling thread, one after another.
+         */
+        AsyncDataLayerRead* reader;
+    };
+    
+public:
+    
+    SolvingMachine(IDataLayerRead& dataLayer, const Options& options = Options());
     ~SolvingMachine(){}
 
 public:
@@ -68,6 +96,9 @@ public:
      */
     struct Suggestion
     {
+        Suggestion():
+            partial(false), approximate(false){}
+        
         std::vector<Identifier> symptoms; // list of symptoms that can be checked
         std::vector<int> symptomValues; // numeric representation of how worth it is to check a symptom
         
@@ -76,22 +107,185 @@ public:
         
         std::vector<Identifier> solutions; // list of solutions that can be applied
         std::vector<int> solutionValues; // numeric representation of how worth it is to apply a solution
+        
+        /**
+         * The deadline passed before all subject problems were loaded and all values calculated.
+         * The suggestion has only the objects valued so far and their values can differ from a full suggestion.
+         */
+        bool partial;
+        
+        /**
+         * Some symptom values are estimates, the symptoms valued exactly are in exactSymptoms.
+         * An estimate is never above the value of an exactly valued symptom, so they keep the ranking.
+         */
+        bool approximate;
+        std::vector<Identifier> exactSymptoms;
     };
     
-public:
-    
-    Suggestion makeSuggestion(const Investigation& Investigation);
-    
 private:
     
     // set of all the category IDs that define a working branch
     typedef boost::unordered_set<Identifier> CategoryBranch;
     
-    // key is symptom ID, value is all the problems linked to the symptom
-    typedef boost::unordered_map<Identifier, ProblemsWithSameSymptom> SymptomToLinks;
+    /**
+     * The positive symptoms of an investigation by their number in a SymptomLinkTable
+     */
+    struct PositiveSymptoms
+    {
+        enum State
+        {
+            stateNotPositive = 0,
+            statePositive = 1,
+            statePositiveConfirmed = 2
+        };
+        
+        PositiveSymptoms(unsigned symptomCount):
+            states(symptomCount, stateNotPositive), confirmedCount(0), unconfirmedCount(0){}
+        
+        /**
+         * Adds a positive symptom, symptom is -1 for a symptom without links in the table
+         */
+        void add(int symptom, bool confirmed);
+        
+        std::vector<unsigned char> states; // by symptom number
+        unsigned confirmedCount; // of all positive symptoms, also those without links
+        unsigned unconfirmedCount;
+    };
     
-    // key is problem ID, value is all the symptoms linked to the problem
-    typedef boost::unordered_map<Identifier, SymptomsWithSameProblem> ProblemToLinks;
+    /**
+     * What the links of a subject problem to the positive symptoms add up to
+     */
+    struct ProblemScore
+    {
+        ProblemScore():
+            maxHint(0), totalValue(0), coveredCount(0), coveredConfirmedCount(0){}
+        
+        double maxHint;
+        double totalValue;
+        unsigned coveredCount; // positive symptoms linked to the problem
+        unsigned coveredConfirmedCount;
+    };
+    
+    /**
+     * The subject problems of a suggestion and what the values of the subject symptoms are calculated from.
+     * A theoretical positive symptom changes the score only of the problems linked to it, the other problems
+     * just miss one more symptom, so their theoretical values are the same for every symptom and are calculated once.
+     */
+    struct SubjectProblems
+    {
+        std::vector<unsigned> numbers; // in the state
+        std::vector<int> values;
+        std::vector<int> difficultyCosts;
+        
+        // the original upper bound
+        int highestValue;
+        std::vector<unsigned char> upper;
+        unsigned upperCount;
+        int upperDifficultyCost;
+        
+        /**
+         * The values of the problems after a positive symptom not linked to them, by whether the symptom is confirmed.
+         * order has the problems by descending value, difficultyCostSums[i] is the cost of the first i problems in that order.
+         */
+        struct TheoreticalValues
+        {
+            std::vector<int> values;
+            std::vector<unsigned> order;
+            std::vector<int> sortedValues;
+            std::vector<int> difficultyCostSums;
+        };
+        
+        TheoreticalValues theoreticalValues[2];
+        
+        // the links of the problems by symptom number, the links of symptom s are [symptomLinksBegin[s], symptomLinksBegin[s + 1])
+        std::vector<unsigned> symptomLinksBegin;
+        std::vector<unsigned> linkProblems; // index in numbers
+        std::vector<unsigned> links; // position in the SymptomLinkTable
+        
+        std::vector<unsigned char> linked; // by index in numbers, kept clear between symptoms
+    };
+    
+public:
+    
+    /**
+     * The working set of the solver for one investigation, kept between its suggestions.
+     * It holds the checked objects, the category branch, the subject problems with their symptom links
+     * and the score of every subject problem. When the investigation only gained checked or banned objects
+     * since the last suggestion, only the new objects are loaded and only the subject problems linked to
+     * new positive symptoms are scored again. Any other change (e.g. a different category branch) rebuilds the state.
+     * The knowledge base is not read again for objects already in the state, so the owner should drop old states.
+     */
+    struct State
+    {
+        State():
+            built(false), allProblems(false), positiveSymptomNumbers(0){}
+        
+        enum SymptomState
+        {
+            symptomNotLoaded = 0,
+            symptomLoaded = 1,
+            symptomRejected = 2 // not found or outside of the category branch
+        };
+        
+        bool built;
+        Investigation investigation; // of the last update
+        
+        // the checked objects that were found
+        SymptomMap positiveSymptoms;
+        SymptomMap negativeSymptoms;
+        ProblemMap negativeProblems;
+        SolutionMap negativeSolutions;
+        
+        CategoryBranch partialCategoryBranch;
+        CategoryBranch categoryBranch;
+        
+        // problems linked to the positive symptoms, the new ones are not loaded yet
+        boost::unordered_set<Identifier> candidateProblems;
+        std::vector<Identifier> newCandidateProblems;
+        boost::unordered_set<Identifier> rejectedProblems; // not found or outside of the category branch
+        
+        /**
+         * Without candidate problems all problems of the branch are subjects, even the checked ones.
+         * Such a state is rebuilt on every update.
+         */
+        bool allProblems;
+        
+        // the subject problems by their number in problemLinks
+        SymptomLinkTable problemLinks;
+        std::vector<Problem> problems;
+        std::vector<unsigned char> activeProblems; // not checked and not banned
+        std::vector<ProblemScore> problemScores;
+        
+        // the symptoms of problemLinks by their number
+        PositiveSymptoms positiveSymptomNumbers;
+        std::vector<Symptom> symptoms;
+        std::vector<unsigned char> symptomStates; // SymptomState
+        std::vector<unsigned> symptomProblems; // active problems linked to the symptom
+    };
+    
+public:
+    
+    Suggestion makeSuggestion(const Investigation& investigation);
+    
+    /**
+     * Makes the suggestion starting from the state of the previous suggestion for the same investigation
+     * and updates the state. A default constructed state is built from scratch.
+     * A state that was not brought up to date before the deadline is cleared.
+     */
+    Suggestion makeSuggestion(const Investigation& investigation, State& state);
+    
+private:
+    
+    bool isPastDeadline() const;
+    
+    bool updateState(const Investigation& investigation, State& state);
+    bool isContinuation(const Investigation& previous, const Investigation& investigation);
+    bool addProblems(const ProblemMap& subjectProblems, State& state, std::vector<unsigned>& changedProblems);
+    void addProblem(const Problem& problem, const SymptomsWithSameProblem& relatedSymptoms, State& state, std::vector<unsigned>& changedProblems);
+    void setProblemActive(unsigned problem, bool active, State& state);
+    Suggestion makeSymptomSuggestion(const Investigation& investigation, State& state);
+    void addApproximateSymptoms(const std::vector<unsigned>& symptoms, State& state, SubjectProblems& subjectProblems, Suggestion& suggestion);
+    void prepareSubjectProblems(const State& state, SubjectProblems& subjectProblems);
     
 private:
     
@@ -106,18 +300,27 @@ private:
 private:
     
     double getDifficultyPenalty(DifficultyLevel level);
+    int getDifficultyCost(DifficultyLevel level);
     double calculateAccuracity(int firstReferences, int secondReferences);
     double calculateReduction(int firstReferences, int secondReferences);
     double calculateValue(int positiveReferences, int negativeReferences);
     
     int calculateValue(const GenericInfo& object, const SolutionLink& link);
-    int calculateValue(const Symptom& symptom, const ProblemMap& subjectProblems, const ProblemToLinks& allProblemLinks,
-                       const SymptomMap& positiveSymptoms, const Suggestion& suggestion);
-    int calculateValue(const Problem& problem, const SymptomsWithSameProblem& connectedSymptoms, const SymptomMap& positiveSymptoms);
+    int calculateValue(const Symptom& symptom, const State& state, SubjectProblems& subjectProblems);
+    int estimateValue(unsigned symptomNumber, const State& state, const SubjectProblems& subjectProblems);
+    double calculateUpperChance(int symptomNumber, const State& state, const SubjectProblems& subjectProblems);
+    int calculateValue(const Problem& problem, const ProblemScore& score, unsigned positiveConfirmedCount, unsigned positiveUnconfirmedCount);
+    
+    ProblemScore calculateScore(const SymptomLinkTable& problemLinks, unsigned problemNumber, const PositiveSymptoms& positiveSymptoms,
+                                int theoreticalSymptom = -1, bool theoreticalConfirmed = false);
     
 private:
     
     IDataLayerRead& _dataLayer;
+    Options _options;
+    
+    AsyncDataLayerRead _inlineReader;
+    AsyncDataLayerRead& _reader; // the reader of the options or the inline reader
     
 };
 
@@ -0,0 +1,99 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "datalayerread.h"
+
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+namespace ProblemSolver
+{
+
+/**
+ * The symptom links of a set of problems, laid out for scoring the problems.
+ * Every field of the links is kept in its own array (structure of arrays) and the links of a problem
+ * are contiguous and sorted by symptom. Symptoms are numbered by the table, so walking the links of a problem
+ * reads only a packed array of symptom numbers, and the counters are read only for the links that matter.
+ * The IDs are kept apart and are needed only to translate between IDs and numbers.
+ */
+class SymptomLinkTable
+{
+public:
+    
+    SymptomLinkTable();
+    ~SymptomLinkTable(){}
+    
+public:
+    
+    /**
+     * Adds the links of the next problem, returns the number of the problem (0, 1, 2 ...)
+     */
+    unsigned addProblem(CIdentifier problemID, const SymptomsWithSameProblem& links);
+    
+    unsigned getProblemCount() const { return _problemIDs.size(); }
+    unsigned getSymptomCount() const { return _symptomIDs.size(); }
+    
+    CIdentifier getProblemID(unsigned problem) const { return _problemIDs[problem]; }
+    CIdentifier getSymptomID(unsigned symptom) const { return _symptomIDs[symptom]; }
+    
+    /**
+     * Returns the number of the problem or -1 if it is not in the table
+     */
+    int findProblem(CIdentifier problemID) const;
+    
+    /**
+     * Returns the number of the symptom or -1 if no problem of the table is linked to it
+     */
+    int findSymptom(CIdentifier symptomID) const;
+    
+    /**
+     * Returns the position of the link between problem and symptom or -1 if they are not linked
+     */
+    int findLink(unsigned problem, unsigned symptom) const;
+    
+public:
+    
+    /**
+     * The links of a problem are at positions [getLinksBegin(problem), getLinksEnd(problem))
+     */
+    unsigned getLinksBegin(unsigned problem) const { return _linksBegin[problem]; }
+    unsigned getLinksEnd(unsigned problem) const { return _linksBegin[problem + 1]; }
+    
+    unsigned getSymptom(unsigned link) const { return _symptoms[link]; }
+    int getPositiveChecks(unsigned link) const { return _positiveChecks[link]; }
+    int getFalsePositiveChecks(unsigned link) const { return _falsePositiveChecks[link]; }
+    int getNegativeChecks(unsigned link) const { return _negativeChecks[link]; }
+    bool isConfirmed(unsigned link) const { return _confirmed[link] != 0; }
+    
+    CIdentifier getLinkID(unsigned link) const { return _linkIDs[link]; }
+    
+private:
+    
+    unsigned getSymptomNumber(CIdentifier symptomID);
+    
+private:
+    
+    // hot fields, by link position
+    std::vector<unsigned> _symptoms;
+    std::vector<int> _positiveChecks;
+    std::vector<int> _falsePositiveChecks;
+    std::vector<int> _negativeChecks;
+    std::vector<unsigned char> _confirmed;
+    
+    std::vector<unsigned> _linksBegin; // by problem, with one more element for the end of the last problem
+    
+    // cold fields
+    std::vector<Identifier> _linkIDs; // by link position
+    std::vector<Identifier> _problemIDs; // by problem number
+    std::vector<Identifier> _symptomIDs; // by symptom number
+    boost::unordered_map<Identifier, unsigned> _problemNumbers;
+    boost::unordered_map<Identifier, unsigned> _symptomNumbers;
+};
+
+} // namespace ProblemSolver
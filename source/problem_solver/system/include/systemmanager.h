@@ -9,24 +9,40 @@
 
 #include "solvingmachine.h"
 #include "datalayer.h"
+#include "fibersharedmutex.h"
 
 #include <auto_ptr.h>
 #include <vector>
 #include <string>
 #include <boost/unordered_map.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace ProblemSolver
 {
 
+class EventJournal;
+
 /**
  * This is the main class used to perform tasks in the system.
- * It takes ownership on the supplied data layer and works with it.
+ * It takes ownership on the supplied data layers and works with them.
+ * Searches and suggestions can read the knowledge base from a separate read-only data layer
+ * (e.g. a MappedDataLayer shared by many processes). Investigations and link updates always use the main data layer,
+ * so link changes are seen by suggestions only after the knowledge data layer is refreshed.
+ * The solver state of an investigation is kept between its suggestions while its problem is unknown,
+ * so the knowledge base read by it can be up to the maximum age of the states old.
  */
 class SystemManager
 {
 public:
     
-    SystemManager(IDataLayer* dataLayer);
+    static const unsigned SEARCH_BATCH_SIZE = 1000; // how many objects are searched at once
+    static const unsigned DEFAULT_MAX_SOLVER_STATES = 1000; // investigations that keep their solver state
+    static const unsigned DEFAULT_SOLVER_STATE_MAX_AGE = 30; // seconds
+    
+public:
+    
+    SystemManager(IDataLayer* dataLayer, IDataLayerRead* knowledgeDataLayer = NULL);
     ~SystemManager(){};
     
 public:
@@ -70,8 +86,78 @@ public:
     void onSymptomChecked(CIdentifier symptomID, bool checkResult, CIdentifier investigationID);
     void onSolutionChecked(CIdentifier solutionID, bool checkResult, CIdentifier investigationID);
     
-    SolvingMachine::Suggestion makeSuggestion(CIdentifier investigationID);
+    /**
+     * The options can set a deadline or the approximate mode of the solver
+     */
+    SolvingMachine::Suggestion makeSuggestion(CIdentifier investigationID, const SolvingMachine::Options& options = SolvingMachine::Options());
+    
+    enum EventType
+    {
+        eventSymptomChecked,
+        eventProblemChecked,
+        eventSolutionChecked
+    };
+    
+    /**
+     * An object checked in an investigation
+     */
+    struct Event
+    {
+        EventType type;
+        Identifier objectID;
+        bool checkResult;
+    };
+    
+    /**
+     * Applies the events to the investigation as the on...Checked functions do, one after another,
+     * and returns the suggestion for the updated investigation. The investigation is read and saved only once.
+     * The options apply only to the suggestion, the events are always applied.
+     */
+    SolvingMachine::Suggestion onEventsAndSuggest(const std::vector<Event>& events, CIdentifier investigationID,
+                                                  const SolvingMachine::Options& options = SolvingMachine::Options());
+    
+    /**
+     * Sets how many investigations keep the solver state between their suggestions and after how many seconds
+     * a state is built again from the knowledge base. No states are kept when maxStates is 0.
+     */
+    void setSolverStateLimits(unsigned maxStates, unsigned maxAge);
+    
+    /**
+     * Suggestions read the knowledge data layer with this many threads, so their independent lookups are in flight
+     * at once. With 0 threads they are read one after another by the thread making the suggestion.
+     * Must be called before suggestions are made.
+     */
+    void setReadThreads(unsigned threadCount);
+    
+    /**
+     * Events are validated, written to the journal file and acknowledged, then applied to the links and the investigation
+     * in the background. Searches and suggestions see the investigation with the events that are not applied yet.
+     * The events left in the file by the last run are applied before it returns.
+     * The events are applied holding the change mutex alone, if there is one, as the data layer is not safe for a change
+     * while it is read. Must be called before events are sent.
+     */
+    void setEventJournal(const std::string& fileName, utils::FiberSharedMutex* changeMutex = NULL);
+    
+    /**
+     * Writes the journaled events and stops applying them, the rest are applied when the journal is opened again.
+     * Must be called before the change mutex is destroyed.
+     */
+    void closeEventJournal();
+    
+    /**
+     * Events that are journaled but not applied to the data layer yet, 0 without a journal
+     */
+    uint64_t getUnappliedEventCount() const;
+    bool hasEventJournal() const { return _eventJournal.get() != NULL; }
+    
+    /**
+     * Drops the solver states, they must be dropped when the knowledge base is changed
+     */
+    void clearSolverStates();
+    void clearSolverState(CIdentifier investigationID);
+    
     IDataLayer& getDataLayer();
+    IDataLayerRead& getKnowledgeDataLayer();
     
 private:
     
@@ -103,7 +189,45 @@ private:
     void updateLinks(bool byProblem, CIdentifier relatedID, const std::vector<Identifier>& inputLinks,
                      boost::unordered_map<Identifier, SolutionLink>& allLinks, SolutionLinkAction action);
     
+    /**
+     * Without saveLinks only the investigation is checked and updated
+     */
+    void applyProblemChecked(CIdentifier problemID, bool checkResult, Investigation& investigation, bool saveLinks = true);
+    void applySymptomChecked(CIdentifier symptomID, bool checkResult, Investigation& investigation, bool saveLinks = true);
+    void applySolutionChecked(CIdentifier solutionID, bool checkResult, Investigation& investigation, bool saveLinks = true);
+    void applyEvent(const Event& event, Investigation& investigation, bool saveLinks = true);
+    
+    SolvingMachine::Suggestion makeSuggestion(const Investigation& investigation, const SolvingMachine::Options& options);
+    
     Investigation getInvestigation(CIdentifier investigationID);
+    Investigation readInvestigation(CIdentifier investigationID);
+    
+    Investigation journalEvents(const std::vector<Event>& events, CIdentifier investigationID);
+    void applyJournaledEvent(CIdentifier investigationID, const Event& event);
+    void saveJournaledEvent(CIdentifier investigationID, const Event& event);
+    
+    /**
+     * An investigation with events that are journaled but not applied yet, as it is after them
+     */
+    struct PendingInvestigation
+    {
+        Investigation investigation;
+        unsigned eventCount;
+    };
+    
+    typedef boost::unordered_map<Identifier, PendingInvestigation> PendingInvestigationMap;
+    
+    struct SolverState
+    {
+        boost::shared_ptr<SolvingMachine::State> state;
+        uint64_t createTime;
+        uint64_t useTime;
+    };
+    
+    typedef boost::unordered_map<Identifier, SolverState> SolverStateMap;
+    
+    SolverState takeSolverState(CIdentifier investigationID);
+    void returnSolverState(CIdentifier investigationID, const SolverState& solverState);
     
     template<class T>
     void populateSearchResult(const std::vector<std::string> searchWords, std::vector<Identifier>& objectIDs, std::vector<int>& objectRelevance);
@@ -111,6 +235,24 @@ private:
 private:
     
     std::auto_ptr<IDataLayer> _dataLayer;
+    std::auto_ptr<IDataLayerRead> _knowledgeDataLayer; // can be NULL, then the main data layer is used
+    std::auto_ptr<AsyncDataLayerRead> _knowledgeReader; // can be NULL, then suggestions read in their own thread
+    
+    /**
+     * Solver states of the investigations by ID. A state being used is taken out of the map,
+     * so a concurrent suggestion for the same investigation builds a new one.
+     */
+    SolverStateMap _solverStates;
+    boost::mutex _solverStatesMutex;
+    unsigned _maxSolverStates;
+    uint64_t _solverStateMaxAge; // nanoseconds
+    
+    PendingInvestigationMap _pendingInvestigations;
+    uint64_t _pendingRemovals; // tells a request that read an investigation that its pending events were applied meanwhile
+    mutable boost::mutex _pendingMutex;
+    utils::FiberSharedMutex* _journalChangeMutex; // can be NULL
+    
+    boost::shared_ptr<EventJournal> _eventJournal; // can be NULL, then events are applied before they are acknowledged
 
 };
 
@@ -0,0 +1,451 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "eventjournal.h"
+#include "logger.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include <sstream>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+
+namespace ProblemSolver
+{
+
+const unsigned EventJournal::DEFAULT_MAX_SIZE;
+const unsigned EventJournal::RETRY_DELAY;
+const unsigned EventJournal::MAX_REPLAY_ATTEMPTS;
+
+static const char* getEventName(SystemManager::EventType type)
+{
+    switch(type)
+    {
+    case SystemManager::eventSymptomChecked:
+        return "symptom";
+    case SystemManager::eventProblemChecked:
+        return "problem";
+    case SystemManager::eventSolutionChecked:
+        return "solution";
+    }
+    
+    return "unknown";
+}
+
+static bool parseEventName(const std::string& name, SystemManager::EventType& type)
+{
+    if(name == "symptom")
+        type = SystemManager::eventSymptomChecked;
+    else if(name == "problem")
+        type = SystemManager::eventProblemChecked;
+    else if(name == "solution")
+        type = SystemManager::eventSolutionChecked;
+    else
+        return false;
+    
+    return true;
+}
+
+EventJournal::EventJournal(const std::string& fileName, const ApplyFunction& apply, unsigned maxSize):
+    _fileName(fileName),
+    _file(-1),
+    _maxSize(maxSize),
+    _apply(apply),
+    _lastSequence(0),
+    _writtenSequence(0),
+    _appliedSequence(0),
+    _failed(false),
+    _stopped(false),
+    _writeStopped(false)
+{
+    _file = open(fileName.c_str(), O_RDWR | O_APPEND | O_CREAT, 0644);
+    if(_file < 0)
+        throw Exception((boost::format("Could not open event journal file %s!") % fileName).str());
+    
+    try
+    {
+        replay();
+    }
+    catch(...)
+    {
+        close(_file);
+        throw;
+    }
+    
+    _writeThread = boost::thread(&EventJournal::writeLoop, this);
+    _applyThread = boost::thread(&EventJournal::applyLoop, this);
+}
+
+EventJournal::~EventJournal()
+{
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _stopped = true;
+        _applyQueueChanged.notify_all();
+    }
+    
+    _applyThread.join();
+    
+    // the applier is stopped, so its last "applied" line is written too
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _writeStopped = true;
+        _bufferChanged.notify_all();
+    }
+    
+    _writeThread.join();
+    close(_file);
+}
+
+uint64_t EventJournal::append(CIdentifier investigationID, const std::vector<SystemManager::Event>& events)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    
+    if(_failed)
+        throw Exception(_error);
+    
+    BOOST_FOREACH(const SystemManager::Event& event, events)
+    {
+        Record record;
+        record.sequence = ++_lastSequence;
+        record.investigationID = investigationID;
+        record.event = event;
+        
+        _buffer += (boost::format("event %s %s %s %s %s\n") % record.sequence % investigationID % getEventName(event.type) %
+                    event.objectID % (event.checkResult ? 1 : 0)).str();
+        _bufferRecords.push_back(record);
+    }
+    
+    _bufferChanged.notify_one();
+    return _lastSequence;
+}
+
+void EventJournal::waitWritten(uint64_t sequence)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    
+    if(_writtenSequence < sequence && !_failed && utils::FiberScheduler::isInFiber())
+    {
+        _waitingFibers.push_back(std::make_pair(sequence, utils::FiberScheduler::getRunning()));
+        
+        lock.unlock();
+        utils::FiberScheduler::suspend();
+        lock.lock();
+    }
+    
+    while(_writtenSequence < sequence && !_failed)
+    {
+        _written.wait(lock);
+    }
+    
+    if(_writtenSequence < sequence)
+        throw Exception(_error);
+}
+
+uint64_t EventJournal::getUnappliedCount() const
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _lastSequence - _appliedSequence;
+}
+
+/**
+ * Reads the whole file and applies the events after the last applied one.
+ * A line left incomplete by a crash is cut, its event was never acknowledged.
+ */
+void EventJournal::replay()
+{
+    std::string text;
+    
+    char buffer[64 * 1024];
+    ssize_t size;
+    while((size = pread(_file, buffer, sizeof(buffer), text.size())) > 0)
+    {
+        text.append(buffer, size);
+    }
+    
+    if(size < 0)
+        throw Exception((boost::format("Could not read event journal file %s!") % _fileName).str());
+    
+    size_t completeSize = text.rfind('\n') + 1; // 0 without any new line
+    if(completeSize < text.size())
+    {
+        if(ftruncate(_file, completeSize) != 0)
+            throw Exception((boost::format("Could not repair event journal file %s!") % _fileName).str());
+        
+        text.resize(completeSize);
+    }
+    
+    std::vector<Record> records;
+    
+    size_t lineStart = 0;
+    size_t lineEnd;
+    while((lineEnd = text.find('\n', lineStart)) != std::string::npos)
+    {
+        Record record;
+        if(parseLine(text.substr(lineStart, lineEnd - lineStart), record, _appliedSequence))
+        {
+            records.push_back(record);
+            _lastSequence = std::max(_lastSequence, record.sequence);
+        }
+        
+        lineStart = lineEnd + 1;
+    }
+    
+    _lastSequence = std::max(_lastSequence, _appliedSequence);
+    _writtenSequence = _lastSequence;
+    
+    unsigned unappliedCount = 0;
+    BOOST_FOREACH(const Record& record, records)
+    {
+        if(record.sequence > _appliedSequence)
+            ++unappliedCount;
+    }
+    
+    if(unappliedCount == 0)
+        return;
+    
+    utils::Logger::log(utils::logInfo, "EventJournal: Applying %u events left in %s", unappliedCount, _fileName.c_str());
+    
+    BOOST_FOREACH(const Record& record, records)
+    {
+        if(record.sequence <= _appliedSequence)
+            continue;
+        
+        // nothing can stop the journal while it is opened, so a database that stays down fails the opening
+        if(!applyWithRetry(record, MAX_REPLAY_ATTEMPTS))
+            throw Exception((boost::format("Could not apply event %s left in event journal file %s!") % record.sequence % _fileName).str());
+        
+        _appliedSequence = record.sequence;
+        
+        if(!writeText((boost::format("applied %s\n") % record.sequence).str()))
+            throw Exception((boost::format("Could not write to event journal file %s!") % _fileName).str());
+    }
+}
+
+/**
+ * Returns true for an event line, an "applied" line only raises appliedSequence.
+ * Lines that can not be parsed are reported and skipped.
+ */
+bool EventJournal::parseLine(const std::string& line, Record& record, uint64_t& appliedSequence)
+{
+    std::istringstream stream(line);
+    std::string kind;
+    std::string investigationID;
+    std::string eventName;
+    std::string objectID;
+    uint64_t sequence;
+    int checkResult;
+    
+    if(line.empty())
+        return false;
+    
+    if(!(stream >> kind))
+    {
+        // reported below
+    }
+    else if(kind == "applied" && stream >> sequence)
+    {
+        appliedSequence = std::max(appliedSequence, sequence);
+        return false;
+    }
+    else if(kind == "event" && stream >> record.sequence >> investigationID >> eventName >> objectID >> checkResult &&
+            Identifier::parse(investigationID, record.investigationID) && Identifier::parse(objectID, record.event.objectID) &&
+            parseEventName(eventName, record.event.type))
+    {
+        record.event.checkResult = checkResult != 0;
+        return true;
+    }
+    
+    utils::Logger::log(utils::logError, "Invalid line in event journal file %s: %s", _fileName.c_str(), line.c_str());
+    return false;
+}
+
+/**
+ * The database can be unavailable for a while, the event is kept until it is applied.
+ * Returns false if the journal is stopped first or the event failed maxAttempts times, 0 tries until it is stopped.
+ */
+bool EventJournal::applyWithRetry(const Record& record, unsigned maxAttempts)
+{
+    for(unsigned attempt = 1; ; ++attempt)
+    {
+        std::string error;
+        
+        try
+        {
+            _apply(record.investigationID, record.event);
+            return true;
+        }
+        catch(std::exception& e)
+        {
+            error = e.what();
+        }
+        catch(...)
+        {
+            error = "Unknown error";
+        }
+        
+        if(maxAttempts > 0 && attempt >= maxAttempts)
+        {
+            utils::Logger::log(utils::logError, "EventJournal: Applying event %llu failed %u times - %s",
+                               static_cast<unsigned long long>(record.sequence), attempt, error.c_str());
+            return false;
+        }
+        
+        utils::Logger::log(utils::logWarning, "EventJournal: Applying event %llu failed, trying again in %u ms - %s",
+                           static_cast<unsigned long long>(record.sequence), RETRY_DELAY, error.c_str());
+        
+        boost::mutex::scoped_lock lock(_mutex);
+        
+        if(!_stopped)
+            _applyQueueChanged.timed_wait(lock, boost::posix_time::milliseconds(RETRY_DELAY));
+        
+        if(_stopped)
+            return false;
+    }
+}
+
+/**
+ * Writes the queued lines, syncs them if they have events and passes the events to the applier.
+ * Many appends are written and synced together while the previous sync runs.
+ */
+void EventJournal::writeLoop()
+{
+    while(true)
+    {
+        std::string text;
+        std::vector<Record> records;
+        bool allApplied;
+        
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            
+            while(_buffer.empty() && !_writeStopped)
+            {
+                _bufferChanged.wait(lock);
+            }
+            
+            if(_buffer.empty())
+                return;
+            
+            text.swap(_buffer);
+            records.swap(_bufferRecords);
+            allApplied = _appliedSequence == _lastSequence;
+        }
+        
+        // nothing has to be replayed, so the file starts again and the "applied" lines are not needed
+        struct stat fileInfo;
+        if(allApplied && fstat(_file, &fileInfo) == 0 && fileInfo.st_size > static_cast<off_t>(_maxSize) && ftruncate(_file, 0) == 0)
+            continue;
+        
+        bool written = writeText(text) && (records.empty() || fdatasync(_file) == 0);
+        
+        std::vector<utils::FiberScheduler::Handle> writtenFibers;
+        
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            
+            if(written && !records.empty())
+            {
+                _writtenSequence = records.back().sequence;
+                _applyQueue.insert(_applyQueue.end(), records.begin(), records.end());
+                _applyQueueChanged.notify_one();
+            }
+            else if(!written)
+            {
+                _failed = true;
+                _error = (boost::format("Could not write to event journal file %s!") % _fileName).str();
+                utils::Logger::log(utils::logError, "EventJournal: %s Events are not accepted any more", _error.c_str());
+            }
+            
+            for(unsigned i = 0; i < _waitingFibers.size();)
+            {
+                if(_failed || _waitingFibers[i].first <= _writtenSequence)
+                {
+                    writtenFibers.push_back(_waitingFibers[i].second);
+                    _waitingFibers[i] = _waitingFibers.back();
+                    _waitingFibers.pop_back();
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+            
+            _written.notify_all();
+        }
+        
+        BOOST_FOREACH(const utils::FiberScheduler::Handle& fiber, writtenFibers)
+        {
+            fiber.resume();
+        }
+        
+        if(!written)
+            return;
+    }
+}
+
+/**
+ * Applies the written events in order until the journal is stopped, the rest are applied when it is opened again
+ */
+void EventJournal::applyLoop()
+{
+    while(true)
+    {
+        Record record;
+        
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            
+            while(_applyQueue.empty() && !_stopped)
+            {
+                _applyQueueChanged.wait(lock);
+            }
+            
+            if(_stopped)
+                return;
+            
+            record = _applyQueue.front();
+        }
+        
+        if(!applyWithRetry(record))
+            return;
+        
+        boost::mutex::scoped_lock lock(_mutex);
+        
+        _applyQueue.pop_front();
+        _appliedSequence = record.sequence;
+        
+        // not synced, an event applied again after a crash is rejected as already checked
+        _buffer += (boost::format("applied %s\n") % record.sequence).str();
+        _bufferChanged.notify_one();
+    }
+}
+
+bool EventJournal::writeText(const std::string& text)
+{
+    size_t offset = 0;
+    while(offset < text.size())
+    {
+        ssize_t written = write(_file, text.data() + offset, text.size() - offset);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            
+            return false;
+        }
+        
+        offset += written;
+    }
+    
+    return true;
+}
+
+} // namespace ProblemSolver
@@ -9,14 +9,37 @@
 #include "datalayerread.h"
 #include "utils.h"
 
+#include <algorithm>
+#include <functional>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
 
 namespace ProblemSolver
 {
 
-SolvingMachine::SolvingMachine(IDataLayerRead& dataLayer):
-    _dataLayer(dataLayer)
+namespace
+{
+
+/**
+ * Orders indexes of values by descending value
+ */
+struct DescendingValue
+{
+    explicit DescendingValue(const std::vector<int>& values):
+        values(values){}
+    
+    bool operator () (unsigned first, unsigned second) const { return values[first] > values[second]; }
+    
+    const std::vector<int>& values;
+};
+
+} // anonymous namespace
+
+SolvingMachine::SolvingMachine(IDataLayerRead& dataLayer, const Options& options):
+    _dataLayer(dataLayer),
+    _options(options),
+    _inlineReader(dataLayer, 0),
+    _reader(options.reader != NULL ? *options.reader : _inlineReader)
 {
 }
 
@@ -25,24 +48,80 @@ SolvingMachine::SolvingMachine(IDataLayerRead& dataLayer):
  */
 SolvingMachine::Suggestion SolvingMachine::makeSuggestion(const Investigation& investigation)
 {
+    State state;
+    return makeSuggestion(investigation, state);
+}
+
+/**
+ * Returns a suggested continue path for identifying the input unknown problem.
+ * The state is used and updated only while the problem is not known.
+ */
+SolvingMachine::Suggestion SolvingMachine::makeSuggestion(const Investigation& investigation, State& state)
+{
+    if(investigation.positiveProblem.empty() && investigation.positiveSolution.empty())
+    {
+        // we don't know the problem yet, so we must make a more complex suggestion
+        bool complete = updateState(investigation, state);
+        
+        Suggestion suggestion = makeSymptomSuggestion(investigation, state);
+        
+        if(!complete)
+        {
+            // some subject problems are missing from the state, the next suggestion builds it again
+            suggestion.partial = true;
+            state = State();
+        }
+        
+        return suggestion;
+    }
+    
     Suggestion suggestion;
     
-    // look up the standard things
     SymptomMap positiveSymptoms;
+    SymptomMap negativeSymptoms;
+    ProblemMap negativeProblems;
+    SolutionMap negativeSolutions;
+    
+    ProblemMap positiveProblems;
+    SymptomsWithSameProblem relatedSymptoms;
+    SolutionsWithSameProblem relatedSolutions;
+    
+    SolutionMap positiveSolutions;
+    ProblemsWithSameSolution relatedProblems;
+    
+    // look up the standard things, the positive objects and their links at once, none of them depends on another
+    AsyncDataLayerRead::ReadGroup reads;
+    
     if(!investigation.positiveSymptoms.empty())
-        _dataLayer.get(investigation.positiveSymptoms, positiveSymptoms);
+        reads.add(_reader.get(investigation.positiveSymptoms.getItems(), positiveSymptoms));
     
-    SymptomMap negativeSymptoms;
     if(!investigation.negativeSymptoms.empty())
-        _dataLayer.get(investigation.negativeSymptoms, negativeSymptoms);
+        reads.add(_reader.get(investigation.negativeSymptoms.getItems(), negativeSymptoms));
     
-    ProblemMap negativeProblems;
     if(!investigation.negativeProblems.empty())
-        _dataLayer.get(investigation.negativeProblems, negativeProblems);
+        reads.add(_reader.get(investigation.negativeProblems.getItems(), negativeProblems));
     
-    SolutionMap negativeSolutions;
     if(!investigation.negativeSolutions.empty())
-        _dataLayer.get(investigation.negativeSolutions, negativeSolutions);
+        reads.add(_reader.get(investigation.negativeSolutions.getItems(), negativeSolutions));
+    
+    if(!investigation.positiveProblem.empty())
+    {
+        reads.add(_reader.get(std::vector<Identifier>(1, investigation.positiveProblem), positiveProblems));
+        reads.add(_reader.getLinksByProblem(investigation.positiveProblem, relatedSymptoms));
+        
+        if(investigation.positiveSolution.empty())
+            reads.add(_reader.getLinksByProblem(investigation.positiveProblem, relatedSolutions));
+    }
+    
+    if(!investigation.positiveSolution.empty())
+    {
+        reads.add(_reader.get(std::vector<Identifier>(1, investigation.positiveSolution), positiveSolutions));
+        
+        if(investigation.positiveProblem.empty())
+            reads.add(_reader.getLinksBySolution(investigation.positiveSolution, relatedProblems));
+    }
+    
+    reads.wait();
     
     CategoryBranch partialCategoryBranch;
     
@@ -71,12 +150,6 @@ SolvingMachine::Suggestion SolvingMachine::makeSuggestion(const Investigation& i
     
     if(!investigation.positiveProblem.empty())
     {
-        // look up the positive problem
-        ProblemMap positiveProblems;
-        std::vector<Identifier> positiveID;
-        positiveID.push_back(investigation.positiveProblem);
-        
-        _dataLayer.get(positiveID, positiveProblems);
         positiveProblem = positiveProblems.begin()->second;
         
         partialCategoryBranch.insert(positiveProblem.categoryID);
@@ -86,12 +159,6 @@ SolvingMachine::Suggestion SolvingMachine::makeSuggestion(const Investigation& i
     
     if(!investigation.positiveSolution.empty())
     {
-        // look up the positive solution
-        SolutionMap positiveSolutions;
-        std::vector<Identifier> positiveID;
-        positiveID.push_back(investigation.positiveSolution);
-        
-        _dataLayer.get(positiveID, positiveSolutions);
         positiveSolution = positiveSolutions.begin()->second;
         
         partialCategoryBranch.insert(positiveSolution.categoryID);
@@ -102,9 +169,6 @@ SolvingMachine::Suggestion SolvingMachine::makeSuggestion(const Investigation& i
     if(!investigation.positiveProblem.empty())
     {
         // handle the case where we have already identified the problem
-        SymptomsWithSameProblem relatedSymptoms;
-        _dataLayer.getLinksByProblem(investigation.positiveProblem, relatedSymptoms);
-        
         SymptomMap relevantSymptoms;
         filterByBranch(relatedSymptoms, fullCategoryBranch, relevantSymptoms);
         
@@ -116,7 +180,7 @@ SolvingMachine::Suggestion SolvingMachine::makeSuggestion(const Investigation& i
             // check if the symptom is already checked or banned
             if(positiveSymptoms.find(symptom.id) != positiveSymptoms.end() ||
                negativeSymptoms.find(symptom.id) != negativeSymptoms.end() ||
-               utils::contains(investigation.bannedSymptoms, symptom.id))
+               investigation.bannedSymptoms.contains(symptom.id))
             {
                 continue;
             }
@@ -129,9 +193,6 @@ SolvingMachine::Suggestion SolvingMachine::makeSuggestion(const Investigation& i
         if(investigation.positiveSolution.empty())
         {
             // in case we have no working solution yet, suggest new ones
-            SolutionsWithSameProblem relatedSolutions;
-            _dataLayer.getLinksByProblem(investigation.positiveProblem, relatedSolutions);
-
             SolutionMap relevantSolutions;
             filterByBranch(relatedSolutions, fullCategoryBranch, relevantSolutions);
             
@@ -141,7 +202,7 @@ SolvingMachine::Suggestion SolvingMachine::makeSuggestion(const Investigation& i
                 
                 // check if the solution is already checked or banned
                 if(negativeSolutions.find(solution.id) != negativeSolutions.end() ||
-                   utils::contains(investigation.bannedSolutions, solution.id))
+                   investigation.bannedSolutions.contains(solution.id))
                 {
                     continue;
                 }
@@ -155,12 +216,9 @@ SolvingMachine::Suggestion SolvingMachine::makeSuggestion(const Investigation& i
         }
         
     }
-    else if(!investigation.positiveSolution.empty())
+    else
     {
         // in case we have no working solution yet, suggest new ones
-        ProblemsWithSameSolution relatedProblems;
-        _dataLayer.getLinksBySolution(investigation.positiveSolution, relatedProblems);
-
         ProblemMap relevantProblems;
         filterByBranch(relatedProblems, fullCategoryBranch, relevantProblems);
         
@@ -170,7 +228,7 @@ SolvingMachine::Suggestion SolvingMachine::makeSuggestion(const Investigation& i
             
             // check if the problem is already checked or banned
             if(negativeProblems.find(problem.id) != negativeProblems.end() ||
-               utils::contains(investigation.bannedProblems, problem.id))
+               investigation.bannedProblems.contains(problem.id))
             {
                 continue;
             }
@@ -182,131 +240,637 @@ SolvingMachine::Suggestion SolvingMachine::makeSuggestion(const Investigation& i
             suggestion.problemValues.push_back(calculateValue(problem, link));
         }
     }
-    else
+    
+    return suggestion;
+}
+
+/**
+ * Checked between the steps of long loops, the work left after the deadline is skipped
+ */
+bool SolvingMachine::isPastDeadline() const
+{
+    return _options.deadline != 0 && utils::getMonotonicNanoseconds() >= _options.deadline;
+}
+
+/**
+ * Brings the state up to date with the investigation.
+ * Only the objects checked since the last update are loaded and only the changed problems are scored again.
+ * Returns false if the deadline passed while the subject problems were loaded, then only some of them are in the state.
+ */
+bool SolvingMachine::updateState(const Investigation& investigation, State& state)
+{
+    if(state.built && (state.allProblems || !isContinuation(state.investigation, investigation)))
+        state = State();
+    
+    const Investigation& previous = state.investigation;
+    
+    // look up the objects checked since the last update, all at once
+    std::vector<Identifier> objectsToBeLoaded;
+    
+    SymptomMap positiveSymptoms;
+    SymptomMap negativeSymptoms;
+    ProblemMap negativeProblems;
+    SolutionMap negativeSolutions;
+    
     {
-        // we don't know the problem yet, so we must make a more complex suggestion
+        AsyncDataLayerRead::ReadGroup reads;
         
-        // we will load all information that we need
+        objectsToBeLoaded.assign(investigation.positiveSymptoms.begin() + previous.positiveSymptoms.size(), investigation.positiveSymptoms.end());
+        if(!objectsToBeLoaded.empty())
+            reads.add(_reader.get(objectsToBeLoaded, positiveSymptoms));
         
-        // these are the problems we are considering for suggestion
-        ProblemMap subjectProblems;
+        objectsToBeLoaded.assign(investigation.negativeSymptoms.begin() + previous.negativeSymptoms.size(), investigation.negativeSymptoms.end());
+        if(!objectsToBeLoaded.empty())
+            reads.add(_reader.get(objectsToBeLoaded, negativeSymptoms));
         
-        // these are the symptoms we are considering for suggestion
-        SymptomMap subjectSymptoms;
+        objectsToBeLoaded.assign(investigation.negativeProblems.begin() + previous.negativeProblems.size(), investigation.negativeProblems.end());
+        if(!objectsToBeLoaded.empty())
+            reads.add(_reader.get(objectsToBeLoaded, negativeProblems));
         
-        // this will hold all symptom-to-problem links by symptom ID
-        SymptomToLinks allSymptomLinks;
+        objectsToBeLoaded.assign(investigation.negativeSolutions.begin() + previous.negativeSolutions.size(), investigation.negativeSolutions.end());
+        if(!objectsToBeLoaded.empty())
+            reads.add(_reader.get(objectsToBeLoaded, negativeSolutions));
         
-        // this will hold all problem-to-symptom links by problem ID
-        ProblemToLinks allProblemLinks;
+        reads.wait();
+    }
+    
+    objectsToBeLoaded.clear();
+    
+    // extend the partial category branch, the full branch is built again only when it has new categories
+    bool newCategories = false;
+    
+    BOOST_FOREACH(const SymptomMap::value_type& pair, positiveSymptoms)
+    {
+        newCategories |= state.partialCategoryBranch.insert(pair.second.categoryID).second;
+    }
+    
+    BOOST_FOREACH(const SymptomMap::value_type& pair, negativeSymptoms)
+    {
+        newCategories |= state.partialCategoryBranch.insert(pair.second.categoryID).second;
+    }
+    
+    BOOST_FOREACH(const ProblemMap::value_type& pair, negativeProblems)
+    {
+        newCategories |= state.partialCategoryBranch.insert(pair.second.categoryID).second;
+    }
+    
+    BOOST_FOREACH(const SolutionMap::value_type& pair, negativeSolutions)
+    {
+        newCategories |= state.partialCategoryBranch.insert(pair.second.categoryID).second;
+    }
+    
+    if(!state.built || newCategories)
+    {
+        CategoryBranch fullCategoryBranch = buildCategoryBranch(state.partialCategoryBranch);
         
-        // this will be used only while retrieving any objects
-        boost::unordered_set<Identifier> aggregationOfObjects;
-        std::vector<Identifier> objectsToBeLoaded;
-        /** \todo Lubo: Everywhere where there are connections check if positive != 0 !!! (and in the above) */
-        // retrieve symptoms links and aggregate related problems
-        BOOST_FOREACH(const SymptomMap::value_type& pair, positiveSymptoms)
+        if(state.built && fullCategoryBranch != state.categoryBranch)
         {
-            ProblemsWithSameSymptom& relatedProblems = allSymptomLinks[pair.second.id];
-            _dataLayer.getLinksBySymptom(pair.second.id, relatedProblems);
-            
-            // aggregate all related problems
-            BOOST_FOREACH(const ProblemsWithSameSymptom::value_type& pair, relatedProblems)
-            {
-                aggregationOfObjects.insert(pair.second.problemID);
-            }
+            // the subject problems and symptoms were filtered by the old branch
+            state = State();
+            return updateState(investigation, state);
         }
         
+        state.categoryBranch.swap(fullCategoryBranch);
+    }
+    
+    state.positiveSymptoms.insert(positiveSymptoms.begin(), positiveSymptoms.end());
+    state.negativeSymptoms.insert(negativeSymptoms.begin(), negativeSymptoms.end());
+    state.negativeProblems.insert(negativeProblems.begin(), negativeProblems.end());
+    state.negativeSolutions.insert(negativeSolutions.begin(), negativeSolutions.end());
+    
+    // the problems which score must be calculated again
+    std::vector<unsigned> changedProblems;
+    
+    // the problems related to the new positive symptoms become candidates, their links are looked up at once
+    std::vector<ProblemsWithSameSymptom> symptomLinks(positiveSymptoms.size());
+    AsyncDataLayerRead::ReadGroup symptomLinkReads;
+    
+    unsigned symptomIndex = 0;
+    BOOST_FOREACH(const SymptomMap::value_type& pair, positiveSymptoms)
+    {
+        symptomLinkReads.add(_reader.getLinksBySymptom(pair.second.id, symptomLinks[symptomIndex++]));
+    }
+    
+    symptomLinkReads.wait();
+    
+    symptomIndex = 0;
+    BOOST_FOREACH(const SymptomMap::value_type& pair, positiveSymptoms)
+    {
+        int symptom = state.problemLinks.findSymptom(pair.second.id);
+        state.positiveSymptomNumbers.add(symptom, pair.second.confirmed);
+        
+        const ProblemsWithSameSymptom& relatedProblems = symptomLinks[symptomIndex++];
         
-        // retrieve the subject problems
-        BOOST_FOREACH(CIdentifier problemID, aggregationOfObjects)
+        BOOST_FOREACH(const ProblemsWithSameSymptom::value_type& pair, relatedProblems)
         {
-            // check if the problem is already checked or banned
-            if(negativeProblems.find(problemID) != negativeProblems.end() ||
-               utils::contains(investigation.bannedProblems, problemID))
+            if(state.candidateProblems.insert(pair.second.problemID).second)
             {
+                state.newCandidateProblems.push_back(pair.second.problemID);
                 continue;
             }
             
-            objectsToBeLoaded.push_back(problemID);
+            // the problem is already a subject linked to a symptom that is now positive
+            int problem = (symptom < 0 ? -1 : state.problemLinks.findProblem(pair.second.problemID));
+            if(problem >= 0)
+                changedProblems.push_back(problem);
+        }
+    }
+    
+    // checked and banned problems are no longer subjects
+    BOOST_FOREACH(const ProblemMap::value_type& pair, negativeProblems)
+    {
+        int problem = state.problemLinks.findProblem(pair.second.id);
+        if(problem >= 0)
+            setProblemActive(problem, false, state);
+    }
+    
+    BOOST_FOREACH(CIdentifier problemID, investigation.bannedProblems)
+    {
+        int problem = state.problemLinks.findProblem(problemID);
+        if(problem >= 0)
+            setProblemActive(problem, false, state);
+    }
+    
+    // problems that are no longer banned are subjects again
+    BOOST_FOREACH(CIdentifier problemID, previous.bannedProblems)
+    {
+        if(investigation.bannedProblems.contains(problemID) || state.negativeProblems.find(problemID) != state.negativeProblems.end())
+            continue;
+        
+        int problem = state.problemLinks.findProblem(problemID);
+        if(problem >= 0)
+            setProblemActive(problem, true, state);
+        else if(state.candidateProblems.find(problemID) != state.candidateProblems.end())
+            state.newCandidateProblems.push_back(problemID);
+    }
+    
+    // retrieve the new subject problems
+    BOOST_FOREACH(CIdentifier problemID, state.newCandidateProblems)
+    {
+        // check if the problem is already checked or banned, it is loaded if it is no longer banned
+        if(state.negativeProblems.find(problemID) != state.negativeProblems.end() ||
+           investigation.bannedProblems.contains(problemID))
+        {
+            continue;
         }
         
-        /** \todo Lubo: ALL OF THESE SHOULD FILTER BY HAVING AT LEAST 1 POSITIVE (after denominating) */
+        if(state.problemLinks.findProblem(problemID) >= 0 || state.rejectedProblems.find(problemID) != state.rejectedProblems.end())
+            continue;
+        
+        objectsToBeLoaded.push_back(problemID);
+    }
+    
+    state.newCandidateProblems.clear();
+    
+    bool complete = true;
+    
+    /** \todo Lubo: ALL OF THESE SHOULD FILTER BY HAVING AT LEAST 1 POSITIVE (after denominating) */
+    if(!objectsToBeLoaded.empty() || !state.built)
+    {
+        // reading no IDs reads all problems
+        state.allProblems = objectsToBeLoaded.empty();
+        
+        ProblemMap subjectProblems;
         _dataLayer.get(objectsToBeLoaded, subjectProblems);
-        filterByBranch(fullCategoryBranch, subjectProblems);
+        filterByBranch(state.categoryBranch, subjectProblems);
+        
+        BOOST_FOREACH(CIdentifier problemID, objectsToBeLoaded)
+        {
+            if(subjectProblems.find(problemID) == subjectProblems.end())
+                state.rejectedProblems.insert(problemID);
+        }
         
-        // clear the buffers
-        aggregationOfObjects.clear();
-        objectsToBeLoaded.clear();
+        complete = addProblems(subjectProblems, state, changedProblems);
+    }
+    
+    BOOST_FOREACH(unsigned problem, changedProblems)
+    {
+        state.problemScores[problem] = calculateScore(state.problemLinks, problem, state.positiveSymptomNumbers);
+    }
+    
+    state.investigation = investigation;
+    state.built = true;
+    
+    return complete;
+}
+
+/**
+ * Checks if the investigation only gained checked objects since previous, banned objects can change freely
+ */
+bool SolvingMachine::isContinuation(const Investigation& previous, const Investigation& investigation)
+{
+    return previous.positiveSymptoms.size() <= investigation.positiveSymptoms.size() &&
+           std::equal(previous.positiveSymptoms.begin(), previous.positiveSymptoms.end(), investigation.positiveSymptoms.begin()) &&
+           previous.negativeSymptoms.size() <= investigation.negativeSymptoms.size() &&
+           std::equal(previous.negativeSymptoms.begin(), previous.negativeSymptoms.end(), investigation.negativeSymptoms.begin()) &&
+           previous.negativeProblems.size() <= investigation.negativeProblems.size() &&
+           std::equal(previous.negativeProblems.begin(), previous.negativeProblems.end(), investigation.negativeProblems.begin()) &&
+           previous.negativeSolutions.size() <= investigation.negativeSolutions.size() &&
+           std::equal(previous.negativeSolutions.begin(), previous.negativeSolutions.end(), investigation.negativeSolutions.begin());
+}
 
+/**
+ * Retrieves the links of the subject problems and adds them to the state, the table also aggregates the related symptoms.
+ * The links of the next problems are read while the links of the current one are added, as many as the reader
+ * has threads for. Returns false if the deadline passed, the problems added so far are still scored.
+ */
+bool SolvingMachine::addProblems(const ProblemMap& subjectProblems, State& state, std::vector<unsigned>& changedProblems)
+{
+    std::vector<const Problem*> problems;
+    problems.reserve(subjectProblems.size());
+    
+    BOOST_FOREACH(const ProblemMap::value_type& pair, subjectProblems)
+    {
+        problems.push_back(&pair.second);
+    }
+    
+    // the links are read into a ring of slots, a slot is reused after its problem was added
+    unsigned slotCount = std::max(2 * _reader.getThreadCount(), 1U);
+    std::vector<SymptomsWithSameProblem> slots(std::min<size_t>(slotCount, problems.size()));
+    std::vector<AsyncDataLayerRead::Read> slotReads(slots.size());
+    
+    AsyncDataLayerRead::ReadGroup reads;
+    unsigned started = 0;
+    
+    for(unsigned i = 0; i < problems.size(); ++i)
+    {
+        // a partial suggestion has the values of the problems loaded so far
+        if(isPastDeadline())
+        {
+            reads.drain();
+            return false;
+        }
         
-        // retrieve problem links and aggregate related symptoms
-        BOOST_FOREACH(const ProblemMap::value_type& pair, subjectProblems)
+        for(; started < problems.size() && started < i + slots.size(); ++started)
         {
-            SymptomsWithSameProblem& relatedSymptoms = allProblemLinks[pair.second.id];
-            _dataLayer.getLinksByProblem(pair.second.id, relatedSymptoms);
+            SymptomsWithSameProblem& slot = slots[started % slots.size()];
+            slot.clear();
             
-            // aggregate all related symptoms
-            BOOST_FOREACH(const SymptomsWithSameProblem::value_type& pair, relatedSymptoms)
+            slotReads[started % slots.size()] = reads.add(_reader.getLinksByProblem(problems[started]->id, slot));
+        }
+        
+        slotReads[i % slots.size()].wait();
+        addProblem(*problems[i], slots[i % slots.size()], state, changedProblems);
+    }
+    
+    return true;
+}
+
+/**
+ * Adds a subject problem with its symptom links to the state
+ */
+void SolvingMachine::addProblem(const Problem& problem, const SymptomsWithSameProblem& relatedSymptoms, State& state,
+                                std::vector<unsigned>& changedProblems)
+{
+    unsigned firstNewSymptom = state.problemLinks.getSymptomCount();
+    unsigned problemNumber = state.problemLinks.addProblem(problem.id, relatedSymptoms);
+    
+    state.problems.push_back(problem);
+    state.activeProblems.push_back(false);
+    state.problemScores.push_back(ProblemScore());
+    
+    // the symptoms numbered by the new links can already be positive
+    for(unsigned symptom = firstNewSymptom; symptom < state.problemLinks.getSymptomCount(); ++symptom)
+    {
+        unsigned char positiveState = PositiveSymptoms::stateNotPositive;
+        
+        SymptomMap::const_iterator it = state.positiveSymptoms.find(state.problemLinks.getSymptomID(symptom));
+        if(it != state.positiveSymptoms.end())
+            positiveState = (it->second.confirmed ? PositiveSymptoms::statePositiveConfirmed : PositiveSymptoms::statePositive);
+        
+        state.positiveSymptomNumbers.states.push_back(positiveState);
+        state.symptoms.push_back(Symptom());
+        state.symptomStates.push_back(State::symptomNotLoaded);
+        state.symptomProblems.push_back(0);
+    }
+    
+    setProblemActive(problemNumber, true, state);
+    changedProblems.push_back(problemNumber);
+}
+
+/**
+ * Adds or removes a problem from the subject problems, counting the active problems of its symptoms
+ */
+void SolvingMachine::setProblemActive(unsigned problem, bool active, State& state)
+{
+    if(state.activeProblems[problem] == active)
+        return;
+    
+    state.activeProblems[problem] = active;
+    
+    unsigned end = state.problemLinks.getLinksEnd(problem);
+    for(unsigned link = state.problemLinks.getLinksBegin(problem); link != end; ++link)
+    {
+        if(active)
+            ++state.symptomProblems[state.problemLinks.getSymptom(link)];
+        else
+            --state.symptomProblems[state.problemLinks.getSymptom(link)];
+    }
+}
+
+/**
+ * Suggests the subject problems and symptoms of an up to date state
+ */
+SolvingMachine::Suggestion SolvingMachine::makeSymptomSuggestion(const Investigation& investigation, State& state)
+{
+    Suggestion suggestion;
+    
+    // add problems to the suggestion
+    SubjectProblems subjectProblems;
+    prepareSubjectProblems(state, subjectProblems);
+    
+    if(subjectProblems.numbers.empty())
+        return suggestion;
+    
+    for(unsigned i = 0; i < subjectProblems.numbers.size(); ++i)
+    {
+        suggestion.problems.push_back(state.problems[subjectProblems.numbers[i]].id);
+        suggestion.problemValues.push_back(subjectProblems.values[i]);
+    }
+    
+    // the subject symptoms are linked to a subject problem
+    std::vector<unsigned> subjectSymptoms;
+    std::vector<Identifier> objectsToBeLoaded;
+    
+    for(unsigned symptom = 0; symptom < state.symptoms.size(); ++symptom)
+    {
+        if(state.symptomProblems[symptom] == 0)
+            continue;
+        
+        CIdentifier symptomID = state.problemLinks.getSymptomID(symptom);
+        
+        // check if the symptom is already checked or banned
+        if(state.positiveSymptoms.find(symptomID) != state.positiveSymptoms.end() ||
+           state.negativeSymptoms.find(symptomID) != state.negativeSymptoms.end() ||
+           investigation.bannedSymptoms.contains(symptomID))
+        {
+            continue;
+        }
+        
+        subjectSymptoms.push_back(symptom);
+        
+        if(state.symptomStates[symptom] == State::symptomNotLoaded)
+            objectsToBeLoaded.push_back(symptomID);
+    }
+    
+    if(subjectSymptoms.empty())
+    {
+        // reading no IDs reads all symptoms, they are not kept in the state
+        SymptomMap allSymptoms;
+        _dataLayer.get(objectsToBeLoaded, allSymptoms);
+        filterByBranch(state.categoryBranch, allSymptoms);
+        
+        BOOST_FOREACH(const SymptomMap::value_type& pair, allSymptoms)
+        {
+            if(isPastDeadline())
             {
-                aggregationOfObjects.insert(pair.second.symptomID);
+                suggestion.partial = true;
+                break;
             }
+            
+            int symptomValue = calculateValue(pair.second, state, subjectProblems);
+            suggestion.symptoms.push_back(pair.second.id);
+            suggestion.symptomValues.push_back(symptomValue);
         }
         
+        return suggestion;
+    }
+    
+    if(!objectsToBeLoaded.empty())
+    {
+        SymptomMap newSymptoms;
+        _dataLayer.get(objectsToBeLoaded, newSymptoms);
+        filterByBranch(state.categoryBranch, newSymptoms);
         
-        // retrieve the subject symptoms
-        BOOST_FOREACH(CIdentifier symptomID, aggregationOfObjects)
+        BOOST_FOREACH(CIdentifier symptomID, objectsToBeLoaded)
         {
-            // check if the symptom is already checked or banned
-            if(positiveSymptoms.find(symptomID) != positiveSymptoms.end() ||
-               negativeSymptoms.find(symptomID) != negativeSymptoms.end() ||
-               utils::contains(investigation.bannedSymptoms, symptomID))
+            unsigned symptom = state.problemLinks.findSymptom(symptomID);
+            
+            SymptomMap::const_iterator it = newSymptoms.find(symptomID);
+            if(it == newSymptoms.end())
             {
+                state.symptomStates[symptom] = State::symptomRejected;
                 continue;
             }
             
-            objectsToBeLoaded.push_back(symptomID);
+            state.symptoms[symptom] = it->second;
+            state.symptomStates[symptom] = State::symptomLoaded;
         }
+    }
+    
+    if(_options.exactSymptoms > 0 && subjectSymptoms.size() > _options.exactSymptoms)
+    {
+        addApproximateSymptoms(subjectSymptoms, state, subjectProblems, suggestion);
+        return suggestion;
+    }
+    
+    // add symptoms to the suggestion
+    BOOST_FOREACH(unsigned symptom, subjectSymptoms)
+    {
+        if(state.symptomStates[symptom] != State::symptomLoaded)
+            continue;
         
-        _dataLayer.get(objectsToBeLoaded, subjectSymptoms);
-        filterByBranch(fullCategoryBranch, subjectSymptoms);
+        if(isPastDeadline())
+        {
+            suggestion.partial = true;
+            break;
+        }
         
-        // clear the buffers
-        aggregationOfObjects.clear();
-        objectsToBeLoaded.clear();
+        int symptomValue = calculateValue(state.symptoms[symptom], state, subjectProblems);
+        suggestion.symptoms.push_back(state.symptoms[symptom].id);
+        suggestion.symptomValues.push_back(symptomValue);
+    }
+    
+    /** \todo Lubo: This could also suggest solutions without having a positive problem */
+    
+    return suggestion;
+}
+
+/**
+ * Adds the loaded symptoms to the suggestion in approximate mode. The symptoms with the highest estimates are valued
+ * exactly and the others get their estimates, capped by the lowest exact value as an estimate can be higher than
+ * the value of its symptom. The symptoms are added in the same order as in exact mode.
+ */
+void SolvingMachine::addApproximateSymptoms(const std::vector<unsigned>& symptoms, State& state, SubjectProblems& subjectProblems, Suggestion& suggestion)
+{
+    std::vector<unsigned> candidates;
+    std::vector<int> values;
+    
+    BOOST_FOREACH(unsigned symptom, symptoms)
+    {
+        if(state.symptomStates[symptom] != State::symptomLoaded)
+            continue;
         
-        if(!subjectProblems.empty())
+        candidates.push_back(symptom);
+        values.push_back(estimateValue(symptom, state, subjectProblems));
+    }
+    
+    std::vector<unsigned> order;
+    for(unsigned i = 0; i < candidates.size(); ++i)
+        order.push_back(i);
+    
+    std::stable_sort(order.begin(), order.end(), DescendingValue(values));
+    
+    unsigned exactCount = std::min<unsigned>(_options.exactSymptoms, order.size());
+    int lowestExactValue = 0;
+    
+    for(unsigned j = 0; j < exactCount; ++j)
+    {
+        // the symptoms not valued yet keep their estimates
+        if(isPastDeadline())
         {
-            // add problems to the suggestion
-            BOOST_FOREACH(const ProblemMap::value_type& pair, subjectProblems)
-            {
-                int problemValue = calculateValue(pair.second, allProblemLinks[pair.second.id], positiveSymptoms);
-                suggestion.problems.push_back(pair.second.id);
-                suggestion.problemValues.push_back(problemValue);
-            }
-            
-            // add symptoms to the suggestion
-            BOOST_FOREACH(const SymptomMap::value_type& pair, subjectSymptoms)
-            {
-                int symptomValue = calculateValue(pair.second, subjectProblems, allProblemLinks, positiveSymptoms, suggestion);
-                suggestion.symptoms.push_back(pair.second.id);
-                suggestion.symptomValues.push_back(symptomValue);
-            }
+            suggestion.partial = true;
+            exactCount = j;
+            break;
+        }
+        
+        const Symptom& symptom = state.symptoms[candidates[order[j]]];
+        
+        int symptomValue = calculateValue(symptom, state, subjectProblems);
+        values[order[j]] = symptomValue;
+        suggestion.exactSymptoms.push_back(symptom.id);
+        
+        if(j == 0 || lowestExactValue > symptomValue)
+            lowestExactValue = symptomValue;
+    }
+    
+    for(unsigned j = exactCount; j < order.size() && exactCount > 0; ++j)
+    {
+        if(values[order[j]] > lowestExactValue)
+            values[order[j]] = lowestExactValue;
+    }
+    
+    for(unsigned i = 0; i < candidates.size(); ++i)
+    {
+        suggestion.symptoms.push_back(state.symptoms[candidates[i]].id);
+        suggestion.symptomValues.push_back(values[i]);
+    }
+    
+    suggestion.approximate = true;
+}
 
-            /** \todo Lubo: This could also suggest solutions without having a positive problem */
+/**
+ * Calculates the values of the active problems of the state and prepares the calculation of the symptom values
+ */
+void SolvingMachine::prepareSubjectProblems(const State& state, SubjectProblems& subjectProblems)
+{
+    const SymptomLinkTable& problemLinks = state.problemLinks;
+    const PositiveSymptoms& positiveSymptoms = state.positiveSymptomNumbers;
+    
+    subjectProblems.highestValue = 0;
+    
+    for(unsigned problem = 0; problem < state.problems.size(); ++problem)
+    {
+        if(!state.activeProblems[problem])
+            continue;
+        
+        int problemValue = calculateValue(state.problems[problem], state.problemScores[problem],
+                                          positiveSymptoms.confirmedCount, positiveSymptoms.unconfirmedCount);
+        
+        subjectProblems.numbers.push_back(problem);
+        subjectProblems.values.push_back(problemValue);
+        subjectProblems.difficultyCosts.push_back(getDifficultyCost(state.problems[problem].difficulty));
+        
+        if(subjectProblems.highestValue < problemValue)
+            subjectProblems.highestValue = problemValue;
+    }
+    
+    unsigned count = subjectProblems.numbers.size();
+    
+    // find the original upper problems
+    subjectProblems.upper.assign(count, false);
+    subjectProblems.upperCount = 0;
+    subjectProblems.upperDifficultyCost = 0;
+    
+    for(unsigned i = 0; i < count; ++i)
+    {
+        if(subjectProblems.values[i] < (subjectProblems.highestValue - UPPER_BOUND_PROBLEM_RANGE))
+            continue;
+        
+        subjectProblems.upper[i] = true;
+        ++subjectProblems.upperCount;
+        subjectProblems.upperDifficultyCost += subjectProblems.difficultyCosts[i];
+    }
+    
+    // the values after an unlinked unconfirmed [0] or confirmed [1] positive symptom
+    for(unsigned confirmed = 0; confirmed < 2; ++confirmed)
+    {
+        SubjectProblems::TheoreticalValues& theoretical = subjectProblems.theoreticalValues[confirmed];
+        
+        for(unsigned i = 0; i < count; ++i)
+        {
+            unsigned problem = subjectProblems.numbers[i];
+            theoretical.values.push_back(calculateValue(state.problems[problem], state.problemScores[problem],
+                                                        positiveSymptoms.confirmedCount + confirmed, positiveSymptoms.unconfirmedCount + 1 - confirmed));
+            theoretical.order.push_back(i);
+        }
+        
+        std::stable_sort(theoretical.order.begin(), theoretical.order.end(), DescendingValue(theoretical.values));
+        
+        theoretical.difficultyCostSums.push_back(0);
+        BOOST_FOREACH(unsigned i, theoretical.order)
+        {
+            theoretical.sortedValues.push_back(theoretical.values[i]);
+            theoretical.difficultyCostSums.push_back(theoretical.difficultyCostSums.back() + subjectProblems.difficultyCosts[i]);
         }
     }
     
-    return suggestion;
+    // index the links of the problems by symptom
+    subjectProblems.symptomLinksBegin.assign(problemLinks.getSymptomCount() + 1, 0);
+    
+    BOOST_FOREACH(unsigned problem, subjectProblems.numbers)
+    {
+        unsigned end = problemLinks.getLinksEnd(problem);
+        for(unsigned link = problemLinks.getLinksBegin(problem); link != end; ++link)
+            ++subjectProblems.symptomLinksBegin[problemLinks.getSymptom(link) + 1];
+    }
+    
+    for(unsigned symptom = 0; symptom < problemLinks.getSymptomCount(); ++symptom)
+        subjectProblems.symptomLinksBegin[symptom + 1] += subjectProblems.symptomLinksBegin[symptom];
+    
+    std::vector<unsigned> position(subjectProblems.symptomLinksBegin.begin(), subjectProblems.symptomLinksBegin.end() - 1);
+    subjectProblems.linkProblems.resize(subjectProblems.symptomLinksBegin.back());
+    subjectProblems.links.resize(subjectProblems.symptomLinksBegin.back());
+    
+    for(unsigned i = 0; i < count; ++i)
+    {
+        unsigned problem = subjectProblems.numbers[i];
+        
+        unsigned end = problemLinks.getLinksEnd(problem);
+        for(unsigned link = problemLinks.getLinksBegin(problem); link != end; ++link)
+        {
+            unsigned& next = position[problemLinks.getSymptom(link)];
+            subjectProblems.linkProblems[next] = i;
+            subjectProblems.links[next] = link;
+            ++next;
+        }
+    }
+    
+    subjectProblems.linked.assign(count, false);
 }
 
 /**
- * Builds a full category branch based on partial categories from the branch
+ * Builds a full category branch based on partial categories from the branch.
+ * The categories are read in batches and only their place in the tree is kept, not their names and descriptions.
  */
 SolvingMachine::CategoryBranch SolvingMachine::buildCategoryBranch(CategoryBranch partialBranch)
 {
     CategoryMap allCategories;
-    _dataLayer.get(std::vector<Identifier>(), allCategories);
+    
+    CategoryCursor cursor;
+    _dataLayer.openCursor(cursor, CATEGORY_BATCH_SIZE);
+    
+    CategoryMap categories;
+    while(cursor->next(categories))
+    {
+        BOOST_FOREACH(CategoryMap::value_type& pair, categories)
+        {
+            Category& category = allCategories[pair.first];
+            category.id = pair.second.id;
+            category.parent = pair.second.parent;
+            category.childs.swap(pair.second.childs);
+        }
+    }
 
     // generate "root" branch for each category and check if all categories in the partialBranch are in it
     BOOST_FOREACH(CIdentifier categoryID, partialBranch)
@@ -467,6 +1031,14 @@ double SolvingMachine::getDifficultyPenalty(DifficultyLevel level)
     return expertPenalties[level];
 }
 
+/**
+ * Calculates what the difficulty takes from a value (1 - the penalty) in thousandths, so the costs add up exactly
+ */
+int SolvingMachine::getDifficultyCost(DifficultyLevel level)
+{
+    return (1 - getDifficultyPenalty(level)) * 1000 + 0.5;
+}
+
 /**
  * Calculates a number between 0 and 100 that represents the accuracy of the references
  */
@@ -529,82 +1101,90 @@ int SolvingMachine::calculateValue(const GenericInfo& object, const SolutionLink
  * In case the upper bound of problems is smaller than the initial one, then this symptom brings value.
  * The value is the chance of this problem being active.
  */
-int SolvingMachine::calculateValue(const Symptom& symptom, const ProblemMap& subjectProblems, const ProblemToLinks& allProblemLinks,
-                                   const SymptomMap& positiveSymptoms, const Suggestion& suggestion)
+int SolvingMachine::calculateValue(const Symptom& symptom, const State& state, SubjectProblems& subjectProblems)
 {
     /** \todo Lubo: this should also take in account negative symptoms and problems!!! */
     
-    /** \todo Lubo: OPTIMIZE symptom value, it has too much excessive work done */
-    SymptomMap theoreticalSymptoms = positiveSymptoms;
-    theoreticalSymptoms[symptom.id] = symptom;
+    const SymptomLinkTable& problemLinks = state.problemLinks;
+    int symptomNumber = problemLinks.findSymptom(symptom.id);
     
-    std::vector<int> originalUpperProblems;
-    std::vector<double> originalProblemChances;
-    int originalHighestProblemValue = 0;
-    double originalUpperDifficultyPenalty = 0;
+    // the symptom is added to the positive symptoms only in theory
+    unsigned theoreticalConfirmedCount = state.positiveSymptomNumbers.confirmedCount + (symptom.confirmed ? 1 : 0);
+    unsigned theoreticalUnconfirmedCount = state.positiveSymptomNumbers.unconfirmedCount + (symptom.confirmed ? 0 : 1);
     
-    // find the original highest problem value
-    for(uint i = 0; i < suggestion.problems.size(); ++i)
-    {
-        if(originalHighestProblemValue < suggestion.problemValues[i])
-            originalHighestProblemValue = suggestion.problemValues[i];
-        
-        const SymptomsWithSameProblem& symptomsWithThisProblem = allProblemLinks.find(suggestion.problems[i])->second;
-        SymptomsWithSameProblem::const_iterator it = symptomsWithThisProblem.find(symptom.id);
-        
-        if(it != symptomsWithThisProblem.end())
-        {
-            double chanceOfProblemCausingSymptom = calculateValue(it->second.positiveChecks, it->second.negativeChecks);
-            if(!it->second.confirmed)
-                chanceOfProblemCausingSymptom *= UNCONFIRMED_PENALTY;
-
-            originalProblemChances.push_back(chanceOfProblemCausingSymptom);
-        }
-        else
-            originalProblemChances.push_back(0); // this problem has no chance to cause this symptom
-    }
+    const SubjectProblems::TheoreticalValues& theoretical = subjectProblems.theoreticalValues[symptom.confirmed ? 1 : 0];
     
-    // find the original upper problems
-    for(uint i = 0; i < suggestion.problems.size(); ++i)
+    unsigned linksBegin = 0;
+    unsigned linksEnd = 0;
+    
+    if(symptomNumber >= 0)
     {
-        if(suggestion.problemValues[i] < (originalHighestProblemValue - UPPER_BOUND_PROBLEM_RANGE))
-            continue;
-        
-        originalUpperProblems.push_back(i);
-        originalUpperDifficultyPenalty += (1 - getDifficultyPenalty(subjectProblems.find(suggestion.problems[i])->second.difficulty));
+        linksBegin = subjectProblems.symptomLinksBegin[symptomNumber];
+        linksEnd = subjectProblems.symptomLinksBegin[symptomNumber + 1];
     }
-
-    std::vector<Identifier> newProblems;
-    std::vector<int> newProblemValues;
     
-    std::vector<int> newUpperProblems;
+    std::vector<int> newLinkedValues;
     int newHighestProblemValue = 0;
-    double newUpperDifficultyPenalty = 0;
     
-    // find all new values and the highest value
-    BOOST_FOREACH(const ProblemMap::value_type& pair, subjectProblems)
+    // only the problems linked to the symptom score differently
+    for(unsigned k = linksBegin; k < linksEnd; ++k)
     {
-        int problemValue = calculateValue(pair.second, allProblemLinks.find(pair.second.id)->second, theoreticalSymptoms);
-        newProblems.push_back(pair.second.id);
-        newProblemValues.push_back(problemValue);
+        unsigned i = subjectProblems.linkProblems[k];
+        unsigned problem = subjectProblems.numbers[i];
+        
+        ProblemScore score = calculateScore(problemLinks, problem, state.positiveSymptomNumbers, symptomNumber, symptom.confirmed);
+        int problemValue = calculateValue(state.problems[problem], score, theoreticalConfirmedCount, theoreticalUnconfirmedCount);
+        newLinkedValues.push_back(problemValue);
         
         if(newHighestProblemValue < problemValue)
             newHighestProblemValue = problemValue;
+        
+        subjectProblems.linked[i] = true;
     }
-
-    // find the new upper problems
-    for(uint i = 0; i < newProblems.size(); ++i)
+    
+    // the highest of the other problems
+    for(unsigned j = 0; j < theoretical.order.size(); ++j)
     {
-        if(newProblemValues[i] < (newHighestProblemValue - UPPER_BOUND_PROBLEM_RANGE))
+        if(subjectProblems.linked[theoretical.order[j]])
             continue;
         
-        newUpperProblems.push_back(i);
-        newUpperDifficultyPenalty += (1 - getDifficultyPenalty(subjectProblems.find(newProblems[i])->second.difficulty));
+        if(newHighestProblemValue < theoretical.sortedValues[j])
+            newHighestProblemValue = theoretical.sortedValues[j];
+        
+        break;
     }
     
-    double difficultyGain = originalUpperDifficultyPenalty - newUpperDifficultyPenalty;
-    double symptomDifficulty = (1 - getDifficultyPenalty(symptom.difficulty));
-    int fewerProblems = originalUpperProblems.size() - newUpperProblems.size();
+    // find the new upper problems, counting the linked problems with their new values
+    double newUpperBound = newHighestProblemValue - UPPER_BOUND_PROBLEM_RANGE;
+    
+    unsigned newUpperEnd = std::upper_bound(theoretical.sortedValues.begin(), theoretical.sortedValues.end(), newUpperBound, std::greater<double>()) -
+                           theoretical.sortedValues.begin();
+    
+    int newUpperCount = newUpperEnd;
+    int newUpperDifficultyCost = theoretical.difficultyCostSums[newUpperEnd];
+    
+    for(unsigned k = linksBegin; k < linksEnd; ++k)
+    {
+        unsigned i = subjectProblems.linkProblems[k];
+        
+        if(theoretical.values[i] >= newUpperBound)
+        {
+            --newUpperCount;
+            newUpperDifficultyCost -= subjectProblems.difficultyCosts[i];
+        }
+        
+        if(newLinkedValues[k - linksBegin] >= newUpperBound)
+        {
+            ++newUpperCount;
+            newUpperDifficultyCost += subjectProblems.difficultyCosts[i];
+        }
+        
+        subjectProblems.linked[i] = false;
+    }
+    
+    int difficultyGain = subjectProblems.upperDifficultyCost - newUpperDifficultyCost;
+    int symptomDifficulty = getDifficultyCost(symptom.difficulty);
+    int fewerProblems = subjectProblems.upperCount - newUpperCount;
     
     if(difficultyGain < 0 || fewerProblems >= 0)
     {
@@ -612,14 +1192,10 @@ int SolvingMachine::calculateValue(const Symptom& symptom, const ProblemMap& sub
     }
     
     /** \todo Lubo: this probably needs rework and be based only on the GAIN! */
-    // there is value in this symptom, calculate the chance of having it
-    double totalValue = 0;
-    for(uint i = 0; i < originalUpperProblems.size(); ++i)
-    {
-        totalValue += originalProblemChances[originalUpperProblems[i]];
-    }
+    // there is value in this symptom, calculate the chance of having it, the problems not linked to it have no chance
+    double totalValue = calculateUpperChance(symptomNumber, state, subjectProblems);
     
-    double symptomValue = totalValue/originalUpperProblems.size();
+    double symptomValue = totalValue/subjectProblems.upperCount;
     if(difficultyGain > symptomDifficulty)
     {
         // there is definite value in checking this symptom, no need to diminish it by the difficulty
@@ -635,74 +1211,126 @@ int SolvingMachine::calculateValue(const Symptom& symptom, const ProblemMap& sub
 }
 
 /**
- * Calculates the value of a subject problem by the probability it has to be positive based on the positive symptoms.
+ * Estimates the value of a symptom without scoring the problems again. The estimate is the value the symptom
+ * would have if checking it had a gain and no difficulty, so it is never below the value.
  */
-int SolvingMachine::calculateValue(const Problem& problem, const SymptomsWithSameProblem& connectedSymptoms, const SymptomMap& positiveSymptoms)
+int SolvingMachine::estimateValue(unsigned symptomNumber, const State& state, const SubjectProblems& subjectProblems)
 {
-    /** \todo Lubo: this should also take in account negative symptoms and problems!!! */
-    int valueOfProblem = 0;
+    return calculateUpperChance(symptomNumber, state, subjectProblems) / subjectProblems.upperCount;
+}
+
+/**
+ * Adds up the chances of the original upper problems causing the symptom, symptomNumber is -1 for a symptom without links
+ */
+double SolvingMachine::calculateUpperChance(int symptomNumber, const State& state, const SubjectProblems& subjectProblems)
+{
+    if(symptomNumber < 0)
+        return 0;
     
-    boost::unordered_set<Identifier> missingSymptoms;
-    BOOST_FOREACH(const SymptomMap::value_type& pair, positiveSymptoms)
-    {
-        missingSymptoms.insert(pair.second.id);
-    }
+    const SymptomLinkTable& problemLinks = state.problemLinks;
     
-    double maxHint = 0;
     double totalValue = 0;
     
-    int coveredSymptomsCount = 0;
-    
-    BOOST_FOREACH(const SymptomsWithSameProblem::value_type& pair, connectedSymptoms)
+    unsigned linksEnd = subjectProblems.symptomLinksBegin[symptomNumber + 1];
+    for(unsigned k = subjectProblems.symptomLinksBegin[symptomNumber]; k < linksEnd; ++k)
     {
-        SymptomMap::const_iterator it = positiveSymptoms.find(pair.second.symptomID);
-        if(it == positiveSymptoms.end())
+        if(!subjectProblems.upper[subjectProblems.linkProblems[k]])
             continue;
         
-        ++coveredSymptomsCount;
-        missingSymptoms.erase(pair.second.symptomID);
+        unsigned link = subjectProblems.links[k];
         
-        const SymptomLink& link = pair.second;
+        double chanceOfProblemCausingSymptom = calculateValue(problemLinks.getPositiveChecks(link), problemLinks.getNegativeChecks(link));
+        if(!problemLinks.isConfirmed(link))
+            chanceOfProblemCausingSymptom *= UNCONFIRMED_PENALTY;
         
-        double chanceOfSymptomHintingProblem = calculateValue(link.positiveChecks, link.falsePositiveChecks);
-        double chanceOfProblemCausingSymptom = calculateValue(link.positiveChecks, link.negativeChecks);
+        totalValue += chanceOfProblemCausingSymptom;
+    }
+    
+    return totalValue;
+}
+
+/**
+ * Adds up the links of a subject problem to the positive symptoms.
+ * The theoretical symptom is treated as positive, whatever its state is.
+ */
+SolvingMachine::ProblemScore SolvingMachine::calculateScore(const SymptomLinkTable& problemLinks, unsigned problemNumber,
+                                                            const PositiveSymptoms& positiveSymptoms, int theoreticalSymptom, bool theoreticalConfirmed)
+{
+    ProblemScore score;
+    
+    // only the symptom numbers are read for links to symptoms that are not positive
+    unsigned end = problemLinks.getLinksEnd(problemNumber);
+    for(unsigned link = problemLinks.getLinksBegin(problemNumber); link != end; ++link)
+    {
+        unsigned symptom = problemLinks.getSymptom(link);
+        
+        unsigned char state = positiveSymptoms.states[symptom];
+        if((int)symptom == theoreticalSymptom)
+            state = (theoreticalConfirmed ? PositiveSymptoms::statePositiveConfirmed : PositiveSymptoms::statePositive);
+        
+        if(state == PositiveSymptoms::stateNotPositive)
+            continue;
         
-        if(!it->second.confirmed)
+        ++score.coveredCount;
+        
+        int positiveChecks = problemLinks.getPositiveChecks(link);
+        double chanceOfSymptomHintingProblem = calculateValue(positiveChecks, problemLinks.getFalsePositiveChecks(link));
+        double chanceOfProblemCausingSymptom = calculateValue(positiveChecks, problemLinks.getNegativeChecks(link));
+        
+        if(state == PositiveSymptoms::statePositiveConfirmed)
+        {
+            ++score.coveredConfirmedCount;
+        }
+        else
         {
             chanceOfSymptomHintingProblem *= UNCONFIRMED_PENALTY;
             chanceOfProblemCausingSymptom *= UNCONFIRMED_PENALTY;
         }
         
-        if(!link.confirmed)
+        if(!problemLinks.isConfirmed(link))
         {
             chanceOfSymptomHintingProblem *= UNCONFIRMED_PENALTY;
             chanceOfProblemCausingSymptom *= UNCONFIRMED_PENALTY;
         }
         
-        if(chanceOfSymptomHintingProblem > maxHint)
+        if(chanceOfSymptomHintingProblem > score.maxHint)
         {
-            maxHint = chanceOfSymptomHintingProblem;
+            score.maxHint = chanceOfSymptomHintingProblem;
         }
         
-        totalValue += std::max(chanceOfSymptomHintingProblem, chanceOfProblemCausingSymptom);
+        score.totalValue += std::max(chanceOfSymptomHintingProblem, chanceOfProblemCausingSymptom);
     }
+    
+    return score;
+}
 
-    if(coveredSymptomsCount > 2)
-        totalValue /= coveredSymptomsCount;
+/**
+ * Calculates the value of a subject problem by the probability it has to be positive based on the positive symptoms.
+ */
+int SolvingMachine::calculateValue(const Problem& problem, const ProblemScore& score, unsigned positiveConfirmedCount, unsigned positiveUnconfirmedCount)
+{
+    /** \todo Lubo: this should also take in account negative symptoms and problems!!! */
+    int valueOfProblem = 0;
+    
+    double totalValue = score.totalValue;
+    
+    if(score.coveredCount > 2)
+        totalValue /= score.coveredCount;
     else
         totalValue = 1;
     
-    valueOfProblem = maxHint*0.5 + totalValue*0.5; // equal weights
+    valueOfProblem = score.maxHint*0.5 + totalValue*0.5; // equal weights
     valueOfProblem *= getDifficultyPenalty(problem.difficulty);
     
-    BOOST_FOREACH(CIdentifier missingSymptomID, missingSymptoms)
-    {
-        SymptomMap::const_iterator it = positiveSymptoms.find(missingSymptomID);
-        if(it->second.confirmed)
-            valueOfProblem *= MISSING_SYMPTOM_PENALTY;
-        else
-            valueOfProblem *= MISSING_UNCONFIRMED_SYMPTOM_PENALTY;
-    }
+    // penalties for the positive symptoms not linked to the problem
+    unsigned missingConfirmedCount = positiveConfirmedCount - score.coveredConfirmedCount;
+    unsigned missingUnconfirmedCount = positiveUnconfirmedCount - (score.coveredCount - score.coveredConfirmedCount);
+    
+    for(unsigned i = 0; i < missingConfirmedCount; ++i)
+        valueOfProblem *= MISSING_SYMPTOM_PENALTY;
+    
+    for(unsigned i = 0; i < missingUnconfirmedCount; ++i)
+        valueOfProblem *= MISSING_UNCONFIRMED_SYMPTOM_PENALTY;
     
     if(!problem.confirmed)
         valueOfProblem *= UNCONFIRMED_PENALTY;
@@ -710,4 +1338,15 @@ int SolvingMachine::calculateValue(const Problem& problem, const SymptomsWithSam
     return valueOfProblem;
 }
 
+void SolvingMachine::PositiveSymptoms::add(int symptom, bool confirmed)
+{
+    if(symptom >= 0)
+        states[symptom] = (confirmed ? statePositiveConfirmed : statePositive);
+    
+    if(confirmed)
+        ++confirmedCount;
+    else
+        ++unconfirmedCount;
+}
+
 } // namespace ProblemSolver
@@ -0,0 +1,97 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "symptomlinktable.h"
+
+#include <algorithm>
+#include <boost/foreach.hpp>
+
+namespace ProblemSolver
+{
+
+SymptomLinkTable::SymptomLinkTable()
+{
+    _linksBegin.push_back(0);
+}
+
+unsigned SymptomLinkTable::addProblem(CIdentifier problemID, const SymptomsWithSameProblem& links)
+{
+    // sort the links by symptom number, so findLink can do a binary search
+    std::vector<std::pair<unsigned, const SymptomLink*> > sortedLinks;
+    sortedLinks.reserve(links.size());
+    
+    BOOST_FOREACH(const SymptomsWithSameProblem::value_type& pair, links)
+    {
+        sortedLinks.push_back(std::make_pair(getSymptomNumber(pair.second.symptomID), &pair.second));
+    }
+    
+    std::sort(sortedLinks.begin(), sortedLinks.end());
+    
+    for(unsigned i = 0; i < sortedLinks.size(); ++i)
+    {
+        const SymptomLink& link = *sortedLinks[i].second;
+        
+        _symptoms.push_back(sortedLinks[i].first);
+        _positiveChecks.push_back(link.positiveChecks);
+        _falsePositiveChecks.push_back(link.falsePositiveChecks);
+        _negativeChecks.push_back(link.negativeChecks);
+        _confirmed.push_back(link.confirmed);
+        _linkIDs.push_back(link.id);
+    }
+    
+    _problemNumbers[problemID] = _problemIDs.size();
+    _problemIDs.push_back(problemID);
+    _linksBegin.push_back(_symptoms.size());
+    
+    return _problemIDs.size() - 1;
+}
+
+int SymptomLinkTable::findProblem(CIdentifier problemID) const
+{
+    boost::unordered_map<Identifier, unsigned>::const_iterator it = _problemNumbers.find(problemID);
+    if(it == _problemNumbers.end())
+        return -1;
+    
+    return it->second;
+}
+
+int SymptomLinkTable::findSymptom(CIdentifier symptomID) const
+{
+    boost::unordered_map<Identifier, unsigned>::const_iterator it = _symptomNumbers.find(symptomID);
+    if(it == _symptomNumbers.end())
+        return -1;
+    
+    return it->second;
+}
+
+int SymptomLinkTable::findLink(unsigned problem, unsigned symptom) const
+{
+    std::vector<unsigned>::const_iterator begin = _symptoms.begin() + getLinksBegin(problem);
+    std::vector<unsigned>::const_iterator end = _symptoms.begin() + getLinksEnd(problem);
+    
+    std::vector<unsigned>::const_iterator it = std::lower_bound(begin, end, symptom);
+    if(it == end || *it != symptom)
+        return -1;
+    
+    return it - _symptoms.begin();
+}
+
+/**
+ * Returns the number of the symptom, numbering it if it is new
+ */
+unsigned SymptomLinkTable::getSymptomNumber(CIdentifier symptomID)
+{
+    std::pair<boost::unordered_map<Identifier, unsigned>::iterator, bool> inserted =
+        _symptomNumbers.insert(std::make_pair(symptomID, _symptomIDs.size()));
+    
+    if(inserted.second)
+        _symptomIDs.push_back(symptomID);
+    
+    return inserted.first->second;
+}
+
+} // namespace ProblemSolver
@@ -6,18 +6,30 @@
  */
 
 #include "systemmanager.h"
+#include "eventjournal.h"
+#include "utils.h"
+#include "logger.h"
 
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
 #include <boost/algorithm/string.hpp>
 
 namespace ProblemSolver
 {
 
+const unsigned SystemManager::DEFAULT_MAX_SOLVER_STATES;
+const unsigned SystemManager::DEFAULT_SOLVER_STATE_MAX_AGE;
+
 /**
  * Returns a suggested continue path for identifying the input unknown problem.
  */
-SystemManager::SystemManager(IDataLayer* dataLayer):
-    _dataLayer(dataLayer)
+SystemManager::SystemManager(IDataLayer* dataLayer, IDataLayerRead* knowledgeDataLayer):
+    _dataLayer(dataLayer),
+    _knowledgeDataLayer(knowledgeDataLayer),
+    _maxSolverStates(DEFAULT_MAX_SOLVER_STATES),
+    _solverStateMaxAge(DEFAULT_SOLVER_STATE_MAX_AGE * 1000000000ULL),
+    _pendingRemovals(0),
+    _journalChangeMutex(NULL)
 {
     if(dataLayer == NULL)
         throw Exception("SystemManager: Cannot use NULL dataLayer");
@@ -64,24 +76,38 @@ SystemManager::SearchResult SystemManager::performSearch(const std::string& sear
  */
 void SystemManager::onProblemChecked(CIdentifier problemID, bool checkResult, CIdentifier investigationID)
 {
+    if(_eventJournal.get() != NULL)
+    {
+        Event event = {eventProblemChecked, problemID, checkResult};
+        journalEvents(std::vector<Event>(1, event), investigationID);
+        return;
+    }
+    
     Investigation investigation = getInvestigation(investigationID);
     
+    applyProblemChecked(problemID, checkResult, investigation);
+    
+    _dataLayer->modify(investigation);
+}
+
+/**
+ * Checks the problem in the investigation and updates the related links, the investigation is not saved
+ */
+void SystemManager::applyProblemChecked(CIdentifier problemID, bool checkResult, Investigation& investigation, bool saveLinks)
+{
     // check if the investigation has positive problem
     if(checkResult == true && !investigation.positiveProblem.empty())
         throw Exception("SystemManager: Investigation already has a positive problem!");
     
     // check if the investigation has this negative problem
-    for(uint i = 0; i < investigation.negativeProblems.size(); ++i)
-    {
-        if(problemID == investigation.negativeProblems[i])
-            throw Exception("SystemManager: Investigation has already checked this problem!");
-    }
+    if(investigation.negativeProblems.contains(problemID))
+        throw Exception("SystemManager: Investigation has already checked this problem!");
     
     if(problemID == investigation.positiveProblem)
         throw Exception("SystemManager: Investigation has already checked this problem!");
     
     // always update positive symptoms, update negative symptoms only if the problem was positive
-    if(!investigation.positiveSymptoms.empty() || (checkResult == true && !investigation.negativeSymptoms.empty()))
+    if(saveLinks && (!investigation.positiveSymptoms.empty() || (checkResult == true && !investigation.negativeSymptoms.empty())))
     {
         SymptomsWithSameProblem relatedSymptoms;
         _dataLayer->getLinksByProblem(problemID, relatedSymptoms);
@@ -89,20 +115,20 @@ void SystemManager::onProblemChecked(CIdentifier problemID, bool checkResult, CI
         if(checkResult == false)
         {
             // increment the false-positive value of links to positive symptoms
-            updateLinks(true, problemID, investigation.positiveSymptoms, relatedSymptoms, symptomLinkAddFalsePositive);
+            updateLinks(true, problemID, investigation.positiveSymptoms.getItems(), relatedSymptoms, symptomLinkAddFalsePositive);
         }
         else
         {
             // increment the positive value of links to positive symptoms
-            updateLinks(true, problemID, investigation.positiveSymptoms, relatedSymptoms, symptomLinkAddPositive);
+            updateLinks(true, problemID, investigation.positiveSymptoms.getItems(), relatedSymptoms, symptomLinkAddPositive);
             
             // increment the negative value of links to negative symptoms
-            updateLinks(true, problemID, investigation.negativeSymptoms, relatedSymptoms, symptomLinkAddNegative);
+            updateLinks(true, problemID, investigation.negativeSymptoms.getItems(), relatedSymptoms, symptomLinkAddNegative);
         }
     }
     
     // solutions links are only updated when we have a problem
-    if(checkResult == true && (!investigation.positiveSolution.empty() || !investigation.negativeSolutions.empty()))
+    if(saveLinks && checkResult == true && (!investigation.positiveSolution.empty() || !investigation.negativeSolutions.empty()))
     {
         SolutionsWithSameProblem relatedSolutions;
         _dataLayer->getLinksByProblem(problemID, relatedSolutions);
@@ -115,7 +141,7 @@ void SystemManager::onProblemChecked(CIdentifier problemID, bool checkResult, CI
             updateLinks(true, problemID, positiveSolution, relatedSolutions, solutionLinkAddPositive);
         }
         
-        updateLinks(true, problemID, investigation.negativeSolutions, relatedSolutions, solutionLinkAddNegative);
+        updateLinks(true, problemID, investigation.negativeSolutions.getItems(), relatedSolutions, solutionLinkAddNegative);
     }
     
     // update the investigation itself
@@ -125,16 +151,7 @@ void SystemManager::onProblemChecked(CIdentifier problemID, bool checkResult, CI
         investigation.negativeProblems.push_back(problemID);
     
     // clear the problem from the "banned" symptoms
-    for(uint i = 0; i < investigation.bannedProblems.size(); ++i)
-    {
-        if(problemID == investigation.bannedProblems[i])
-        {
-            investigation.bannedProblems.erase(investigation.bannedProblems.begin() + i);
-            break;
-        }
-    }
-    
-    _dataLayer->modify(investigation);
+    investigation.bannedProblems.remove(problemID);
 }
 
 /**
@@ -143,24 +160,35 @@ void SystemManager::onProblemChecked(CIdentifier problemID, bool checkResult, CI
  */
 void SystemManager::onSymptomChecked(CIdentifier symptomID, bool checkResult, CIdentifier investigationID)
 {
+    if(_eventJournal.get() != NULL)
+    {
+        Event event = {eventSymptomChecked, symptomID, checkResult};
+        journalEvents(std::vector<Event>(1, event), investigationID);
+        return;
+    }
+    
     Investigation investigation = getInvestigation(investigationID);
     
+    applySymptomChecked(symptomID, checkResult, investigation);
+    
+    _dataLayer->modify(investigation);
+}
+
+/**
+ * Checks the symptom in the investigation and updates the related links, the investigation is not saved
+ */
+void SystemManager::applySymptomChecked(CIdentifier symptomID, bool checkResult, Investigation& investigation, bool saveLinks)
+{
     // check if the investigation has this positive symptom
-    for(uint i = 0; i < investigation.positiveSymptoms.size(); ++i)
-    {
-        if(symptomID == investigation.positiveSymptoms[i])
-            throw Exception("SystemManager: Investigation has already checked this symptom!");
-    }
+    if(investigation.positiveSymptoms.contains(symptomID))
+        throw Exception("SystemManager: Investigation has already checked this symptom!");
     
     // check if the investigation has this negative symptom
-    for(uint i = 0; i < investigation.negativeSymptoms.size(); ++i)
-    {
-        if(symptomID == investigation.negativeSymptoms[i])
-            throw Exception("SystemManager: Investigation has already checked this symptom!");
-    }
+    if(investigation.negativeSymptoms.contains(symptomID))
+        throw Exception("SystemManager: Investigation has already checked this symptom!");
     
     // always update positive problem, update negative problems only if the symptom was positive
-    if(!investigation.positiveProblem.empty() || (checkResult == true && !investigation.negativeProblems.empty()))
+    if(saveLinks && (!investigation.positiveProblem.empty() || (checkResult == true && !investigation.negativeProblems.empty())))
     {
         ProblemsWithSameSymptom relatedProblems;
         _dataLayer->getLinksBySymptom(symptomID, relatedProblems);
@@ -177,7 +205,7 @@ void SystemManager::onSymptomChecked(CIdentifier symptomID, bool checkResult, CI
         if(checkResult == true)
         {
             // increment the false-positive value of links to negative problems
-            updateLinks(false, symptomID, investigation.negativeProblems, relatedProblems, symptomLinkAddFalsePositive);
+            updateLinks(false, symptomID, investigation.negativeProblems.getItems(), relatedProblems, symptomLinkAddFalsePositive);
         }
     }
     
@@ -188,16 +216,7 @@ void SystemManager::onSymptomChecked(CIdentifier symptomID, bool checkResult, CI
         investigation.negativeSymptoms.push_back(symptomID);
     
     // clear the symptom from the "banned" symptoms
-    for(uint i = 0; i < investigation.bannedSymptoms.size(); ++i)
-    {
-        if(symptomID == investigation.bannedSymptoms[i])
-        {
-            investigation.bannedSymptoms.erase(investigation.bannedSymptoms.begin() + i);
-            break;
-        }
-    }
-    
-    _dataLayer->modify(investigation);
+    investigation.bannedSymptoms.remove(symptomID);
 }
 
 /**
@@ -206,8 +225,25 @@ void SystemManager::onSymptomChecked(CIdentifier symptomID, bool checkResult, CI
  */
 void SystemManager::onSolutionChecked(CIdentifier solutionID, bool checkResult, CIdentifier investigationID)
 {
+    if(_eventJournal.get() != NULL)
+    {
+        Event event = {eventSolutionChecked, solutionID, checkResult};
+        journalEvents(std::vector<Event>(1, event), investigationID);
+        return;
+    }
+    
     Investigation investigation = getInvestigation(investigationID);
     
+    applySolutionChecked(solutionID, checkResult, investigation);
+    
+    _dataLayer->modify(investigation);
+}
+
+/**
+ * Checks the solution in the investigation and updates the related links, the investigation is not saved
+ */
+void SystemManager::applySolutionChecked(CIdentifier solutionID, bool checkResult, Investigation& investigation, bool saveLinks)
+{
     // check if the investigation has positive solution
     if(checkResult == true && !investigation.positiveSolution.empty())
         throw Exception("SystemManager: Investigation already has a positive solution!");
@@ -217,14 +253,11 @@ void SystemManager::onSolutionChecked(CIdentifier solutionID, bool checkResult,
         throw Exception("SystemManager: Investigation has already checked this solution!");
     
     // check if the investigation has this negative solution
-    for(uint i = 0; i < investigation.negativeSolutions.size(); ++i)
-    {
-        if(solutionID == investigation.negativeSolutions[i])
-            throw Exception("SystemManager: Investigation has already checked this solution!");
-    }
+    if(investigation.negativeSolutions.contains(solutionID))
+        throw Exception("SystemManager: Investigation has already checked this solution!");
     
     // update only when we have a positive problem
-    if(!investigation.positiveProblem.empty())
+    if(saveLinks && !investigation.positiveProblem.empty())
     {
         ProblemsWithSameSolution relatedProblems;
         _dataLayer->getLinksBySolution(solutionID, relatedProblems);
@@ -243,27 +276,279 @@ void SystemManager::onSolutionChecked(CIdentifier solutionID, bool checkResult,
         investigation.negativeSolutions.push_back(solutionID);
     
     // clear the solution from the "banned" solutions
-    for(uint i = 0; i < investigation.bannedSolutions.size(); ++i)
+    investigation.bannedSolutions.remove(solutionID);
+}
+
+/**
+ * Returns a suggested course of action based on the current state of an unknown problem
+ */
+SolvingMachine::Suggestion SystemManager::makeSuggestion(CIdentifier investigationID, const SolvingMachine::Options& options)
+{
+    return makeSuggestion(getInvestigation(investigationID), options);
+}
+
+/**
+ * Applies the events in order and returns the suggestion for the updated investigation.
+ * The investigation is read and saved once. If an event fails the events before it are still saved.
+ */
+SolvingMachine::Suggestion SystemManager::onEventsAndSuggest(const std::vector<Event>& events, CIdentifier investigationID,
+                                                             const SolvingMachine::Options& options)
+{
+    if(_eventJournal.get() != NULL)
+        return makeSuggestion(journalEvents(events, investigationID), options);
+    
+    Investigation investigation = getInvestigation(investigationID);
+    
+    unsigned appliedEvents = 0;
+    try
     {
-        if(solutionID == investigation.bannedSolutions[i])
+        BOOST_FOREACH(const Event& event, events)
         {
-            investigation.bannedSolutions.erase(investigation.bannedSolutions.begin() + i);
+            applyEvent(event, investigation);
+            ++appliedEvents;
+        }
+    }
+    catch(...)
+    {
+        // the links of the applied events are already updated, so the investigation must be saved with them
+        if(appliedEvents > 0)
+            _dataLayer->modify(investigation);
+        
+        throw;
+    }
+    
+    if(appliedEvents > 0)
+        _dataLayer->modify(investigation);
+    
+    return makeSuggestion(investigation, options);
+}
+
+/**
+ * Checks the object of the event in the investigation as the matching on...Checked function does
+ */
+void SystemManager::applyEvent(const Event& event, Investigation& investigation, bool saveLinks)
+{
+    switch(event.type)
+    {
+    case eventSymptomChecked:
+        applySymptomChecked(event.objectID, event.checkResult, investigation, saveLinks);
+        break;
+    case eventProblemChecked:
+        applyProblemChecked(event.objectID, event.checkResult, investigation, saveLinks);
+        break;
+    case eventSolutionChecked:
+        applySolutionChecked(event.objectID, event.checkResult, investigation, saveLinks);
+        break;
+    default:
+        throw Exception("SystemManager: Unknown event type!");
+    }
+}
+
+/**
+ * Validates the events on the investigation as it is after the pending events, journals the valid ones
+ * and waits until they are on the disk. If an event fails the events before it are still journaled.
+ * Returns the investigation with the events.
+ */
+Investigation SystemManager::journalEvents(const std::vector<Event>& events, CIdentifier investigationID)
+{
+    Investigation investigation;
+    std::string error;
+    uint64_t sequence = 0;
+    
+    while(true)
+    {
+        uint64_t removals;
+        bool pending;
+        
+        {
+            boost::mutex::scoped_lock lock(_pendingMutex);
+            removals = _pendingRemovals;
+            pending = _pendingInvestigations.find(investigationID) != _pendingInvestigations.end();
+        }
+        
+        // the database is read without the lock, a fiber can be suspended meanwhile
+        if(!pending)
+            investigation = readInvestigation(investigationID);
+        
+        boost::mutex::scoped_lock lock(_pendingMutex);
+        
+        PendingInvestigationMap::iterator found = _pendingInvestigations.find(investigationID);
+        if(found != _pendingInvestigations.end())
+            investigation = found->second.investigation;
+        else if(pending || removals != _pendingRemovals)
+            continue; // events were applied meanwhile, the investigation read can be older than them
+        
+        // only the investigation is checked, the links are updated when the events are applied
+        std::vector<Event> validEvents;
+        try
+        {
+            BOOST_FOREACH(const Event& event, events)
+            {
+                applyEvent(event, investigation, false);
+                validEvents.push_back(event);
+            }
+        }
+        catch(Exception& e)
+        {
+            error = e.what();
+        }
+        
+        if(validEvents.empty())
             break;
+        
+        sequence = _eventJournal->append(investigationID, validEvents);
+        
+        if(found == _pendingInvestigations.end())
+        {
+            PendingInvestigation& pendingInvestigation = _pendingInvestigations[investigationID];
+            pendingInvestigation.investigation = investigation;
+            pendingInvestigation.eventCount = validEvents.size();
         }
+        else
+        {
+            found->second.investigation = investigation;
+            found->second.eventCount += validEvents.size();
+        }
+        
+        break;
     }
     
-    _dataLayer->modify(investigation);
+    if(sequence != 0)
+        _eventJournal->waitWritten(sequence);
+    
+    if(!error.empty())
+        throw Exception(error);
+    
+    return investigation;
+}
+
+/**
+ * Called by the journal in its own thread, in the order of the events
+ */
+void SystemManager::applyJournaledEvent(CIdentifier investigationID, const Event& event)
+{
+    if(_journalChangeMutex == NULL)
+    {
+        saveJournaledEvent(investigationID, event);
+        return;
+    }
+    
+    boost::unique_lock<utils::FiberSharedMutex> lock(*_journalChangeMutex);
+    saveJournaledEvent(investigationID, event);
+}
+
+/**
+ * The data layer errors are thrown, so the event is applied again later. An event that is not valid any more,
+ * usually because it was already applied before a restart or its investigation was deleted, is skipped.
+ */
+void SystemManager::saveJournaledEvent(CIdentifier investigationID, const Event& event)
+{
+    try
+    {
+        // a missing investigation would fail the event forever and hold up the events after it
+        InvestigationMap investigations;
+        std::vector<Identifier> notFound;
+        _dataLayer->get(std::vector<Identifier>(1, investigationID), investigations, &notFound);
+        
+        if(!notFound.empty())
+            throw Exception("SystemManager: Investigation was deleted!");
+        
+        Investigation& investigation = investigations.begin()->second;
+        applyEvent(event, investigation);
+        _dataLayer->modify(investigation);
+    }
+    catch(Exception& e)
+    {
+        utils::Logger::log(utils::logWarning, "SystemManager: Journaled event of investigation %s skipped - %s",
+                           investigationID.toString().c_str(), e.what());
+    }
+    
+    boost::mutex::scoped_lock lock(_pendingMutex);
+    
+    // the events replayed when the journal is opened have no pending investigation
+    PendingInvestigationMap::iterator found = _pendingInvestigations.find(investigationID);
+    if(found != _pendingInvestigations.end() && --found->second.eventCount == 0)
+    {
+        _pendingInvestigations.erase(found);
+        ++_pendingRemovals;
+    }
 }
 
 /**
  * Returns a suggested course of action based on the current state of an unknown problem
  */
-SolvingMachine::Suggestion SystemManager::makeSuggestion(CIdentifier investigationID)
+SolvingMachine::Suggestion SystemManager::makeSuggestion(const Investigation& investigation, const SolvingMachine::Options& options)
 {
-    Investigation investigation = getInvestigation(investigationID);
+    SolvingMachine::Options machineOptions = options;
+    if(machineOptions.reader == NULL)
+        machineOptions.reader = _knowledgeReader.get();
+    
+    SolvingMachine machine(getKnowledgeDataLayer(), machineOptions);
     
-    SolvingMachine machine(*_dataLayer.get());
-    return machine.makeSuggestion(investigation);
+    if(_maxSolverStates == 0)
+        return machine.makeSuggestion(investigation);
+    
+    // the state is needed only while the problem is unknown
+    if(!investigation.positiveProblem.empty() || !investigation.positiveSolution.empty())
+    {
+        clearSolverState(investigation.id);
+        return machine.makeSuggestion(investigation);
+    }
+    
+    // a state is not returned if the suggestion fails, it can be half updated
+    SolverState solverState = takeSolverState(investigation.id);
+    SolvingMachine::Suggestion suggestion = machine.makeSuggestion(investigation, *solverState.state);
+    returnSolverState(investigation.id, solverState);
+    
+    return suggestion;
+}
+
+void SystemManager::setSolverStateLimits(unsigned maxStates, unsigned maxAge)
+{
+    boost::mutex::scoped_lock lock(_solverStatesMutex);
+    
+    _maxSolverStates = maxStates;
+    _solverStateMaxAge = maxAge * 1000000000ULL;
+    _solverStates.clear();
+}
+
+void SystemManager::setReadThreads(unsigned threadCount)
+{
+    _knowledgeReader.reset(threadCount > 0 ? new AsyncDataLayerRead(getKnowledgeDataLayer(), threadCount) : NULL);
+}
+
+void SystemManager::setEventJournal(const std::string& fileName, utils::FiberSharedMutex* changeMutex)
+{
+    _eventJournal.reset();
+    _journalChangeMutex = changeMutex;
+    _eventJournal.reset(new EventJournal(fileName, boost::bind(&SystemManager::applyJournaledEvent, this, _1, _2)));
+}
+
+void SystemManager::closeEventJournal()
+{
+    _eventJournal.reset();
+    
+    // the events that were not applied are in the journal file, the data layer has the investigations without them
+    boost::mutex::scoped_lock lock(_pendingMutex);
+    _pendingInvestigations.clear();
+    ++_pendingRemovals;
+}
+
+uint64_t SystemManager::getUnappliedEventCount() const
+{
+    return _eventJournal.get() != NULL ? _eventJournal->getUnappliedCount() : 0;
+}
+
+void SystemManager::clearSolverStates()
+{
+    boost::mutex::scoped_lock lock(_solverStatesMutex);
+    _solverStates.clear();
+}
+
+void SystemManager::clearSolverState(CIdentifier investigationID)
+{
+    boost::mutex::scoped_lock lock(_solverStatesMutex);
+    _solverStates.erase(investigationID);
 }
 
 /**
@@ -274,6 +559,84 @@ IDataLayer& SystemManager::getDataLayer()
     return *_dataLayer;
 }
 
+/**
+ * The data layer used to read the knowledge base for searches and suggestions
+ */
+IDataLayerRead& SystemManager::getKnowledgeDataLayer()
+{
+    if(_knowledgeDataLayer.get() != NULL)
+        return *_knowledgeDataLayer;
+    
+    return *_dataLayer;
+}
+
+/**
+ * Takes the solver state of the investigation out of the map, returns a new state if there is none or it is too old
+ */
+SystemManager::SolverState SystemManager::takeSolverState(CIdentifier investigationID)
+{
+    uint64_t now = utils::getMonotonicNanoseconds();
+    
+    SolverState solverState;
+    
+    {
+        boost::mutex::scoped_lock lock(_solverStatesMutex);
+        
+        SolverStateMap::iterator it = _solverStates.find(investigationID);
+        if(it != _solverStates.end())
+        {
+            solverState = it->second;
+            _solverStates.erase(it);
+        }
+    }
+    
+    if(!solverState.state || now - solverState.createTime >= _solverStateMaxAge)
+    {
+        solverState.state.reset(new SolvingMachine::State());
+        solverState.createTime = now;
+    }
+    
+    return solverState;
+}
+
+/**
+ * Puts the solver state back in the map, dropping the expired states and then the least recently used ones when it is full
+ */
+void SystemManager::returnSolverState(CIdentifier investigationID, const SolverState& solverState)
+{
+    uint64_t now = utils::getMonotonicNanoseconds();
+    
+    boost::mutex::scoped_lock lock(_solverStatesMutex);
+    
+    SolverState& newState = _solverStates[investigationID];
+    newState = solverState;
+    newState.useTime = now;
+    
+    if(_solverStates.size() <= _maxSolverStates)
+        return;
+    
+    SolverStateMap::iterator it = _solverStates.begin();
+    while(it != _solverStates.end())
+    {
+        if(now - it->second.createTime >= _solverStateMaxAge)
+            it = _solverStates.erase(it);
+        else
+            ++it;
+    }
+    
+    while(_solverStates.size() > _maxSolverStates)
+    {
+        SolverStateMap::iterator oldest = _solverStates.begin();
+        for(it = _solverStates.begin(); it != _solverStates.end(); ++it)
+        {
+            if(it->second.useTime < oldest->second.useTime)
+                oldest = it;
+        }
+        
+        _solverStates.erase(oldest);
+    }
+}
+
 /**
  * Updates the correct attribute of a link based on the action enum
  */
@@ -406,9 +769,26 @@ void SystemManager::updateLinks(bool byProblem, CIdentifier relatedID, const std
 }
 
 /**
- * Returns the investigation that corresponds to the supplied ID
+ * Returns the investigation that corresponds to the supplied ID, with the events that are journaled but not applied yet
  */
 Investigation SystemManager::getInvestigation(CIdentifier investigationID)
+{
+    if(_eventJournal.get() != NULL)
+    {
+        boost::mutex::scoped_lock lock(_pendingMutex);
+        
+        PendingInvestigationMap::const_iterator found = _pendingInvestigations.find(investigationID);
+        if(found != _pendingInvestigations.end())
+            return found->second.investigation;
+    }
+    
+    return readInvestigation(investigationID);
+}
+
+/**
+ * Returns the investigation as it is saved in the data layer
+ */
+Investigation SystemManager::readInvestigation(CIdentifier investigationID)
 {
     std::vector<Identifier> ids;
     ids.push_back(investigationID);
@@ -422,27 +802,32 @@ Investigation SystemManager::getInvestigation(CIdentifier investigationID)
 /**
  * Populates the provided vectors with the IDs and relevance of all objects of type T that have at least
  * one tag matching the input search words.
+ * Objects are read in batches so the whole collection is never kept in memory.
  */
 template<class T>
 void SystemManager::populateSearchResult(const std::vector<std::string> searchWords, std::vector<Identifier>& objectIDs, std::vector<int>& objectRelevance)
 {
     // search through all objects
-    T allObjects;
-    _dataLayer->get(std::vector<Identifier>(), allObjects);
+    std::auto_ptr<IDataLayerCursor<typename T::mapped_type> > cursor;
+    getKnowledgeDataLayer().openCursor(cursor, SEARCH_BATCH_SIZE);
     
-    BOOST_FOREACH(typename T::value_type& pair, allObjects)
+    T objects;
+    while(cursor->next(objects))
     {
-        int matchingWords = 0;
-        BOOST_FOREACH(const std::string& searchWord, searchWords)
-        {
-            if(pair.second.tags.find(searchWord) != pair.second.tags.end())
-                ++matchingWords;
-        }
-        
-        if(matchingWords > 0)
+        BOOST_FOREACH(typename T::value_type& pair, objects)
         {
-            objectIDs.push_back(pair.second.id);
-            objectRelevance.push_back(100*((double)matchingWords / (double)searchWords.size()));
+            int matchingWords = 0;
+            BOOST_FOREACH(const std::string& searchWord, searchWords)
+            {
+                if(pair.second.tags.find(searchWord) != pair.second.tags.end())
+                    ++matchingWords;
+            }
+            
+            if(matchingWords > 0)
+            {
+                objectIDs.push_back(pair.second.id);
+                objectRelevance.push_back(100*((double)matchingWords / (double)searchWords.size()));
+            }
         }
     }
 }
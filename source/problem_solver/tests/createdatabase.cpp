@@ -15,7 +15,7 @@ using namespace ProblemSolver;
 void addSymptomLink(const ExtendedSymptom& symptom, const ExtendedProblem& problem, int positive, int falsePositive, int negative, IDataLayer& layer)
 {
     SymptomLink newSymptomLink;
-    newSymptomLink.id = "";
+    newSymptomLink.id.clear();
     newSymptomLink.problemID = problem.id;
     newSymptomLink.symptomID = symptom.id;
     newSymptomLink.positiveChecks = positive;
@@ -29,7 +29,7 @@ void addSymptomLink(const ExtendedSymptom& symptom, const ExtendedProblem& probl
 void addSolutionLink(const ExtendedSolution& solution, const ExtendedProblem& problem, int positive, int negative, IDataLayer& layer)
 {
     SolutionLink newLink;
-    newLink.id = "";
+    newLink.id.clear();
     newLink.problemID = problem.id;
     newLink.solutionID = solution.id;
     newLink.positive = positive;
@@ -101,15 +101,15 @@ int main(int argc, const char* argv[])
     
     
     Category categoryGeneral;
-    categoryGeneral.id = "";
+    categoryGeneral.id.clear();
     categoryGeneral.name = "General";
     categoryGeneral.description = "General category for everything shared between child categories";
-    categoryGeneral.parent = "";
+    categoryGeneral.parent.clear();
 
     categoryGeneral.id = dataLayer.add(categoryGeneral);
     
     Category categoryLan;
-    categoryLan.id = "";
+    categoryLan.id.clear();
     categoryLan.name = "Lan";
     categoryLan.description = "Cable Lan related symptoms/problems/solutions";
     categoryLan.parent = categoryGeneral.id;
@@ -117,7 +117,7 @@ int main(int argc, const char* argv[])
     categoryLan.id = dataLayer.add(categoryLan);
     
     Category categoryWireless;
-    categoryWireless.id = "";
+    categoryWireless.id.clear();
     categoryWireless.name = "Wireless";
     categoryWireless.description = "Wireless related symptoms/problems/solutions";
     categoryWireless.parent = categoryGeneral.id;
@@ -145,7 +145,7 @@ int main(int argc, const char* argv[])
     //    11. network icon missing
     
     ExtendedSymptom symptom1;
-    symptom1.id = "";
+    symptom1.id.clear();
     symptom1.categoryID = categoryGeneral.id;
     symptom1.difficulty = difficultySomeExplanation;
     symptom1.confirmed = true;
@@ -161,7 +161,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSymptom symptom2;
-    symptom2.id = "";
+    symptom2.id.clear();
     symptom2.categoryID = categoryGeneral.id;
     symptom2.difficulty = difficultyJustByIntuition;
     symptom2.confirmed = true;
@@ -178,7 +178,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSymptom symptom3;
-    symptom3.id = "";
+    symptom3.id.clear();
     symptom3.categoryID = categoryGeneral.id;
     symptom3.difficulty = difficultyJustByIntuition;
     symptom3.confirmed = true;
@@ -193,7 +193,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSymptom symptom4;
-    symptom4.id = "";
+    symptom4.id.clear();
     symptom4.categoryID = categoryGeneral.id;
     symptom4.difficulty = difficultyModerateExplanation;
     symptom4.confirmed = true;
@@ -212,7 +212,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSymptom symptom5;
-    symptom5.id = "";
+    symptom5.id.clear();
     symptom5.categoryID = categoryGeneral.id;
     symptom5.difficulty = difficultyJustByLogic;
     symptom5.confirmed = true;
@@ -229,7 +229,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSymptom symptom6;
-    symptom6.id = "";
+    symptom6.id.clear();
     symptom6.categoryID = categoryGeneral.id;
     symptom6.difficulty = difficultyOneLook;
     symptom6.confirmed = true;
@@ -243,7 +243,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSymptom symptom7;
-    symptom7.id = "";
+    symptom7.id.clear();
     symptom7.categoryID = categoryLan.id;
     symptom7.difficulty = difficultyJustByLogic;
     symptom7.confirmed = true;
@@ -260,7 +260,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSymptom symptom8;
-    symptom8.id = "";
+    symptom8.id.clear();
     symptom8.categoryID = categoryGeneral.id;
     symptom8.difficulty = difficultySomeExplanation;
     symptom8.confirmed = true;
@@ -277,7 +277,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSymptom symptom9;
-    symptom9.id = "";
+    symptom9.id.clear();
     symptom9.categoryID = categoryGeneral.id;
     symptom9.difficulty = difficultyJustByIntuition;
     symptom9.confirmed = true;
@@ -294,7 +294,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSymptom symptom10;
-    symptom10.id = "";
+    symptom10.id.clear();
     symptom10.categoryID = categoryWireless.id;
     symptom10.difficulty = difficultyJustByIntuition;
     symptom10.confirmed = true;
@@ -310,7 +310,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSymptom symptom11;
-    symptom11.id = "";
+    symptom11.id.clear();
     symptom11.categoryID = categoryGeneral.id;
     symptom11.difficulty = difficultyJustByIntuition;
     symptom11.confirmed = true;
@@ -340,7 +340,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedProblem problem1;
-    problem1.id = "";
+    problem1.id.clear();
     problem1.categoryID = categoryGeneral.id;
     problem1.difficulty = difficultyModerateExplanation;
     problem1.confirmed = true;
@@ -358,7 +358,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedProblem problem2;
-    problem2.id = "";
+    problem2.id.clear();
     problem2.categoryID = categoryGeneral.id;
     problem2.difficulty = difficultyJustByIntuition;
     problem2.confirmed = true;
@@ -372,7 +372,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedProblem problem3;
-    problem3.id = "";
+    problem3.id.clear();
     problem3.categoryID = categoryGeneral.id;
     problem3.difficulty = difficultyJustByLogic;
     problem3.confirmed = true;
@@ -390,7 +390,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedProblem problem4;
-    problem4.id = "";
+    problem4.id.clear();
     problem4.categoryID = categoryGeneral.id;
     problem4.difficulty = difficultyModerateExplanation;
     problem4.confirmed = true;
@@ -408,7 +408,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedProblem problem5;
-    problem5.id = "";
+    problem5.id.clear();
     problem5.categoryID = categoryGeneral.id;
     problem5.difficulty = difficultyJustByLogic;
     problem5.confirmed = true;
@@ -423,7 +423,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedProblem problem6;
-    problem6.id = "";
+    problem6.id.clear();
     problem6.categoryID = categoryGeneral.id;
     problem6.difficulty = difficultyJustByLogic;
     problem6.confirmed = true;
@@ -441,7 +441,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedProblem problem7;
-    problem7.id = "";
+    problem7.id.clear();
     problem7.categoryID = categoryGeneral.id;
     problem7.difficulty = difficultyModerateExplanation;
     problem7.confirmed = true;
@@ -458,7 +458,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedProblem problem8;
-    problem8.id = "";
+    problem8.id.clear();
     problem8.categoryID = categoryGeneral.id;
     problem8.difficulty = difficultyJustByLogic;
     problem8.confirmed = true;
@@ -475,7 +475,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedProblem problem9;
-    problem9.id = "";
+    problem9.id.clear();
     problem9.categoryID = categoryGeneral.id;
     problem9.difficulty = difficultyJustByLogic;
     problem9.confirmed = true;
@@ -490,7 +490,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedProblem problem10;
-    problem10.id = "";
+    problem10.id.clear();
     problem10.categoryID = categoryWireless.id;
     problem10.difficulty = difficultyJustByLogic;
     problem10.confirmed = true;
@@ -505,7 +505,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedProblem problem11;
-    problem11.id = "";
+    problem11.id.clear();
     problem11.categoryID = categoryGeneral.id;
     problem11.difficulty = difficultySomeExplanation;
     problem11.confirmed = true;
@@ -533,7 +533,7 @@ int main(int argc, const char* argv[])
     // 10. install drivers for the device - 11
     
     ExtendedSolution solution1;
-    solution1.id = "";
+    solution1.id.clear();
     solution1.categoryID = categoryGeneral.id;
     solution1.difficulty = difficultyModerateExplanation;
     solution1.confirmed = true;
@@ -549,7 +549,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSolution solution2;
-    solution2.id = "";
+    solution2.id.clear();
     solution2.categoryID = categoryGeneral.id;
     solution2.difficulty = difficultyJustByIntuition;
     solution2.confirmed = true;
@@ -563,7 +563,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSolution solution3;
-    solution3.id = "";
+    solution3.id.clear();
     solution3.categoryID = categoryGeneral.id;
     solution3.difficulty = difficultyJustByIntuition;
     solution3.confirmed = true;
@@ -580,7 +580,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSolution solution4;
-    solution4.id = "";
+    solution4.id.clear();
     solution4.categoryID = categoryGeneral.id;
     solution4.difficulty = difficultyModerateExplanation;
     solution4.confirmed = true;
@@ -599,7 +599,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSolution solution5;
-    solution5.id = "";
+    solution5.id.clear();
     solution5.categoryID = categoryGeneral.id;
     solution5.difficulty = difficultyJustByLogic;
     solution5.confirmed = true;
@@ -614,7 +614,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSolution solution6;
-    solution6.id = "";
+    solution6.id.clear();
     solution6.categoryID = categoryGeneral.id;
     solution6.difficulty = difficultySomeExplanation;
     solution6.confirmed = true;
@@ -631,7 +631,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSolution solution7;
-    solution7.id = "";
+    solution7.id.clear();
     solution7.categoryID = categoryGeneral.id;
     solution7.difficulty = difficultyJustByIntuition;
     solution7.confirmed = true;
@@ -646,7 +646,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSolution solution8;
-    solution8.id = "";
+    solution8.id.clear();
     solution8.categoryID = categoryGeneral.id;
     solution8.difficulty = difficultyJustByIntuition;
     solution8.confirmed = true;
@@ -661,7 +661,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSolution solution9;
-    solution9.id = "";
+    solution9.id.clear();
     solution9.categoryID = categoryWireless.id;
     solution9.difficulty = difficultySomeExplanation;
     solution9.confirmed = true;
@@ -677,7 +677,7 @@ int main(int argc, const char* argv[])
     
     
     ExtendedSolution solution10;
-    solution10.id = "";
+    solution10.id.clear();
     solution10.categoryID = categoryGeneral.id;
     solution10.difficulty = difficultyModerateExplanation;
     solution10.confirmed = true;
@@ -814,7 +814,7 @@ int main(int argc, const char* argv[])
     SystemManager manager(new MongoDbDataLayer("localhost:22222", "isp_kb"));
     
     Investigation firstInvestigation;
-    firstInvestigation.id = "";
+    firstInvestigation.id.clear();
     firstInvestigation.closed = false;
     firstInvestigation.positiveSymptoms.push_back(symptom4.id);
     
@@ -825,21 +825,21 @@ int main(int argc, const char* argv[])
     printf("Symptoms:\n");
     for(uint i = 0; i < suggestion.symptoms.size(); ++i)
     {
-        printf("%s (%d)  -   ", suggestion.symptoms[i].c_str(), suggestion.symptomValues[i]);
+        printf("%s (%d)  -   ", suggestion.symptoms[i].toString().c_str(), suggestion.symptomValues[i]);
     }
     printf("\n");
     
     printf("Problems:\n");
     for(uint i = 0; i < suggestion.problems.size(); ++i)
     {
-        printf("%s (%d)  -   ", suggestion.problems[i].c_str(), suggestion.problemValues[i]);
+        printf("%s (%d)  -   ", suggestion.problems[i].toString().c_str(), suggestion.problemValues[i]);
     }
     printf("\n");
     
     printf("Solutions:\n");
     for(uint i = 0; i < suggestion.solutions.size(); ++i)
     {
-        printf("%s (%d)  -   ", suggestion.solutions[i].c_str(), suggestion.solutionValues[i]);
+        printf("%s (%d)  -   ", suggestion.solutions[i].toString().c_str(), suggestion.solutionValues[i]);
     }
     printf("\n");
     
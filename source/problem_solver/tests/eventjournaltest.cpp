@@ -0,0 +1,290 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "memorydatalayer.h"
+#include "systemmanager.h"
+#include "eventjournal.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+
+using namespace ProblemSolver;
+
+static const char* JOURNAL_FILE = "eventjournaltest.journal";
+
+static const Identifier INVESTIGATION_ID("00000000000000000000b001");
+static const Identifier DELETED_INVESTIGATION_ID("00000000000000000000b002");
+static const Identifier FIRST_SYMPTOM_ID("00000000000000000000b003");
+static const Identifier SECOND_SYMPTOM_ID("00000000000000000000b004");
+static const Identifier THIRD_SYMPTOM_ID("00000000000000000000b005");
+
+/**
+ * Keeps the events passed to the apply function of a journal, it is called by the journal threads
+ */
+class AppliedEvents
+{
+public:
+    
+    void apply(CIdentifier investigationID, const SystemManager::Event& event)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _events.push_back(event);
+    }
+    
+    std::vector<SystemManager::Event> getEvents()
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        return _events;
+    }
+    
+private:
+    
+    boost::mutex _mutex;
+    std::vector<SystemManager::Event> _events;
+};
+
+static void writeFile(const std::string& text)
+{
+    std::ofstream file(JOURNAL_FILE, std::ios::out | std::ios::trunc | std::ios::binary);
+    file << text;
+}
+
+static std::string readFile()
+{
+    std::ifstream file(JOURNAL_FILE, std::ios::in | std::ios::binary);
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+static std::string eventLine(unsigned sequence, CIdentifier investigationID, CIdentifier symptomID, bool checkResult)
+{
+    std::stringstream line;
+    line << "event " << sequence << " " << investigationID << " symptom " << symptomID << " " << (checkResult ? 1 : 0) << "\n";
+    return line.str();
+}
+
+/**
+ * A line cut by a crash is removed from the file and only the events without an "applied" line are applied again
+ */
+bool testTruncatedLine()
+{
+    std::string completeText = eventLine(1, INVESTIGATION_ID, FIRST_SYMPTOM_ID, true) + "applied 1\n" +
+                               eventLine(2, INVESTIGATION_ID, SECOND_SYMPTOM_ID, false);
+    std::string cutLine = eventLine(3, INVESTIGATION_ID, THIRD_SYMPTOM_ID, true);
+    
+    writeFile(completeText + cutLine.substr(0, cutLine.size() / 2));
+    
+    AppliedEvents appliedEvents;
+    {
+        EventJournal journal(JOURNAL_FILE, boost::bind(&AppliedEvents::apply, &appliedEvents, _1, _2));
+        
+        if(journal.getUnappliedCount() != 0)
+        {
+            printf("Error truncated line: %llu events not applied after opening!\n",
+                   static_cast<unsigned long long>(journal.getUnappliedCount()));
+            return false;
+        }
+    }
+    
+    std::vector<SystemManager::Event> events = appliedEvents.getEvents();
+    if(events.size() != 1 || events[0].objectID != SECOND_SYMPTOM_ID || events[0].checkResult)
+    {
+        printf("Error truncated line: %u events applied instead of the second one!\n", static_cast<unsigned>(events.size()));
+        return false;
+    }
+    
+    if(readFile() != completeText + "applied 2\n")
+    {
+        printf("Error truncated line: unexpected journal file:\n%s\n", readFile().c_str());
+        return false;
+    }
+    
+    // everything is applied now
+    AppliedEvents reopenedEvents;
+    {
+        EventJournal journal(JOURNAL_FILE, boost::bind(&AppliedEvents::apply, &reopenedEvents, _1, _2));
+    }
+    
+    if(!reopenedEvents.getEvents().empty())
+    {
+        printf("Error truncated line: events applied again after reopening!\n");
+        return false;
+    }
+    
+    printf("Truncated line OK!\n");
+    return true;
+}
+
+/**
+ * Events left without an "applied" line by a crash are applied again by the system manager, the ones that were
+ * already applied are skipped as already checked and so are the events of deleted investigations
+ */
+bool testReplaySkipsChecked()
+{
+    MemoryDataLayer* dataLayer = new MemoryDataLayer();
+    SystemManager systemManager(dataLayer);
+    
+    // the first event was applied before the crash, its "applied" line was not written
+    Investigation investigation;
+    investigation.id = INVESTIGATION_ID;
+    investigation.positiveSymptoms.push_back(FIRST_SYMPTOM_ID);
+    dataLayer->modify(investigation);
+    
+    writeFile(eventLine(1, INVESTIGATION_ID, FIRST_SYMPTOM_ID, true) +
+              eventLine(2, INVESTIGATION_ID, SECOND_SYMPTOM_ID, false) +
+              eventLine(3, DELETED_INVESTIGATION_ID, THIRD_SYMPTOM_ID, true));
+    
+    try
+    {
+        systemManager.setEventJournal(JOURNAL_FILE);
+    }
+    catch(std::exception& e)
+    {
+        printf("Error replay: opening the journal failed - %s\n", e.what());
+        return false;
+    }
+    
+    if(systemManager.getUnappliedEventCount() != 0)
+    {
+        printf("Error replay: events not applied after opening!\n");
+        return false;
+    }
+    
+    systemManager.closeEventJournal();
+    
+    InvestigationMap investigations;
+    dataLayer->get(std::vector<Identifier>(1, INVESTIGATION_ID), investigations);
+    const Investigation& result = investigations[INVESTIGATION_ID];
+    
+    if(result.positiveSymptoms.size() != 1 || !result.positiveSymptoms.contains(FIRST_SYMPTOM_ID))
+    {
+        printf("Error replay: the event applied before the crash was applied again!\n");
+        return false;
+    }
+    
+    if(result.negativeSymptoms.size() != 1 || !result.negativeSymptoms.contains(SECOND_SYMPTOM_ID))
+    {
+        printf("Error replay: the event left in the journal was not applied!\n");
+        return false;
+    }
+    
+    std::string text = readFile();
+    if(text.find("applied 1\n") == std::string::npos || text.find("applied 2\n") == std::string::npos ||
+       text.find("applied 3\n") == std::string::npos)
+    {
+        printf("Error replay: skipped events not marked as applied:\n%s\n", text.c_str());
+        return false;
+    }
+    
+    printf("Replay OK!\n");
+    return true;
+}
+
+/**
+ * Waits up to two seconds for all appended events to be applied and for the file to have the expected size
+ */
+static bool waitApplied(EventJournal& journal, bool emptyFile)
+{
+    for(unsigned i = 0; i < 200; ++i)
+    {
+        struct stat fileInfo;
+        if(journal.getUnappliedCount() == 0 && stat(JOURNAL_FILE, &fileInfo) == 0 && (fileInfo.st_size == 0) == emptyFile)
+            return true;
+        
+        usleep(10000);
+    }
+    
+    return false;
+}
+
+/**
+ * The file is emptied once all its events are applied, but only when it is longer than the maximum size
+ */
+bool testTruncateWhenFull()
+{
+    std::vector<SystemManager::Event> events;
+    SystemManager::Event firstEvent = {SystemManager::eventSymptomChecked, FIRST_SYMPTOM_ID, true};
+    SystemManager::Event secondEvent = {SystemManager::eventSymptomChecked, SECOND_SYMPTOM_ID, false};
+    events.push_back(firstEvent);
+    events.push_back(secondEvent);
+    
+    // below the maximum size the file keeps its events
+    writeFile("");
+    AppliedEvents appliedEvents;
+    {
+        EventJournal journal(JOURNAL_FILE, boost::bind(&AppliedEvents::apply, &appliedEvents, _1, _2));
+        journal.waitWritten(journal.append(INVESTIGATION_ID, events));
+        
+        if(!waitApplied(journal, false))
+        {
+            printf("Error truncate: events not applied!\n");
+            return false;
+        }
+    }
+    
+    std::string text = readFile();
+    if(text.find(eventLine(1, INVESTIGATION_ID, FIRST_SYMPTOM_ID, true)) == std::string::npos ||
+       text.find("applied 2\n") == std::string::npos)
+    {
+        printf("Error truncate: journal below the maximum size was changed:\n%s\n", text.c_str());
+        return false;
+    }
+    
+    // any event is longer than one byte
+    writeFile("");
+    AppliedEvents fullEvents;
+    {
+        EventJournal journal(JOURNAL_FILE, boost::bind(&AppliedEvents::apply, &fullEvents, _1, _2), 1);
+        journal.waitWritten(journal.append(INVESTIGATION_ID, events));
+        
+        if(!waitApplied(journal, true))
+        {
+            printf("Error truncate: journal above the maximum size not emptied:\n%s\n", readFile().c_str());
+            return false;
+        }
+    }
+    
+    if(fullEvents.getEvents().size() != events.size())
+    {
+        printf("Error truncate: %u events applied instead of %u!\n", static_cast<unsigned>(fullEvents.getEvents().size()),
+               static_cast<unsigned>(events.size()));
+        return false;
+    }
+    
+    AppliedEvents reopenedEvents;
+    {
+        EventJournal journal(JOURNAL_FILE, boost::bind(&AppliedEvents::apply, &reopenedEvents, _1, _2), 1);
+    }
+    
+    if(!reopenedEvents.getEvents().empty())
+    {
+        printf("Error truncate: events applied again after reopening!\n");
+        return false;
+    }
+    
+    printf("Truncate OK!\n");
+    return true;
+}
+
+int main(int argc, const char* argv[])
+{
+    printf("Testing event journal...\n");
+    
+    bool passed = testTruncatedLine() && testReplaySkipsChecked() && testTruncateWhenFull();
+    
+    unlink(JOURNAL_FILE);
+    return passed ? 0 : 1;
+}
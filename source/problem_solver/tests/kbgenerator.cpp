@@ -0,0 +1,104 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "mongodbdatalayer.h"
+#include "memorydatalayer.h"
+#include "snapshotwriter.h"
+#include "knowledgegenerator.h"
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <iostream>
+#include <boost/program_options.hpp>
+
+using namespace ProblemSolver;
+namespace po = boost::program_options;
+
+void printReport(const KnowledgeGenerator::Report& report, double startTime)
+{
+    printf("Generated %u categories, %u problems, %u symptoms, %u solutions, %u symptom links and %u solution links in %.3f seconds\n",
+           report.categories, report.problems, report.symptoms, report.solutions, report.symptomLinks, report.solutionLinks,
+           utils::getCurrentSeconds() - startTime);
+}
+
+/**
+ * Generates a synthetic knowledge base into Mongo or into a snapshot file
+ */
+int main(int argc, const char* argv[])
+{
+    KnowledgeGenerator::Parameters parameters;
+    unsigned scale;
+    
+    po::variables_map optionsMap;
+    try
+    {
+        po::options_description allowedOptions(200, 100);
+        allowedOptions.add_options()
+            ("help,h", "Produce help message.")
+            ("mongoConnection", po::value<std::string>(), "Mongo Connection string of the target database. E.g: host:port")
+            ("mongoDatabase", po::value<std::string>(), "Mongo Database name of the target database. E.g: kb_large")
+            ("snapshot", po::value<std::string>(), "Snapshot file to write instead of a database, its IDs do not depend on any database")
+            ("scale", po::value<unsigned>(&scale)->default_value(1), "Optional. Multiplies the number of problems, symptoms and solutions");
+        
+        KnowledgeGenerator::describeOptions(allowedOptions, parameters);
+        
+        po::store(po::parse_command_line(argc, argv, allowedOptions), optionsMap, true);
+        
+        if (optionsMap.count("help") || (optionsMap.count("snapshot") == optionsMap.count("mongoDatabase")))
+        {
+            std::cout << allowedOptions << "\n";
+            return 1;
+        }
+        
+        po::notify(optionsMap);
+    }
+    catch(std::exception& e)
+    {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    
+    parameters.problems *= scale;
+    parameters.symptoms *= scale;
+    parameters.solutions *= scale;
+    
+    try
+    {
+        KnowledgeGenerator generator(parameters);
+        double startTime = utils::getCurrentSeconds();
+        
+        if(optionsMap.count("snapshot"))
+        {
+            std::string fileName = optionsMap["snapshot"].as<std::string>();
+            
+            MemoryDataLayer dataLayer;
+            printReport(generator.generate(dataLayer, true), startTime);
+            
+            uint64_t size = SnapshotWriter().write(dataLayer, fileName);
+            printf("Snapshot %s written: %.1f MB in %.3f seconds\n", fileName.c_str(), size / (1024.0 * 1024.0), utils::getCurrentSeconds() - startTime);
+            
+            return 0;
+        }
+        
+        if(!optionsMap.count("mongoConnection"))
+        {
+            std::cout << "Error: mongoDatabase requires mongoConnection\n";
+            return 1;
+        }
+        
+        MongoDbDataLayer dataLayer(optionsMap["mongoConnection"].as<std::string>(), optionsMap["mongoDatabase"].as<std::string>());
+        printReport(generator.generate(dataLayer), startTime);
+    }
+    catch(std::exception& e)
+    {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    
+    return 0;
+}
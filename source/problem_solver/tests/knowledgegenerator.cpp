@@ -0,0 +1,448 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "knowledgegenerator.h"
+
+#include <math.h>
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/poisson_distribution.hpp>
+
+namespace po = boost::program_options;
+
+namespace ProblemSolver
+{
+
+KnowledgeGenerator::Parameters::Parameters():
+    seed(1),
+    categoryDepth(2),
+    categoryFanout(4),
+    problems(1000),
+    symptoms(2000),
+    solutions(500),
+    symptomsPerProblem(10),
+    solutionsPerProblem(3),
+    zipfExponent(1),
+    confirmedRatio(0.8),
+    medianChecks(20),
+    checksSigma(1.5),
+    falsePositiveRatio(0.2),
+    negativeRatio(0.3)
+{
+}
+
+KnowledgeGenerator::KnowledgeGenerator(const Parameters& parameters):
+    _parameters(parameters),
+    _random(parameters.seed),
+    _assignIdentifiers(false),
+    _nextIdentifier(0)
+{
+}
+
+void KnowledgeGenerator::describeOptions(po::options_description& options, Parameters& parameters)
+{
+    options.add_options()
+        ("seed", po::value<unsigned>(&parameters.seed)->default_value(parameters.seed), "Optional. Same seed generates the same knowledge base")
+        ("categoryDepth", po::value<unsigned>(&parameters.categoryDepth)->default_value(parameters.categoryDepth),
+            "Optional. Levels of categories below the root category")
+        ("categoryFanout", po::value<unsigned>(&parameters.categoryFanout)->default_value(parameters.categoryFanout),
+            "Optional. Child categories of every category that is not a leaf")
+        ("problems", po::value<unsigned>(&parameters.problems)->default_value(parameters.problems), "Optional. Problems to generate")
+        ("symptoms", po::value<unsigned>(&parameters.symptoms)->default_value(parameters.symptoms), "Optional. Symptoms to generate")
+        ("solutions", po::value<unsigned>(&parameters.solutions)->default_value(parameters.solutions), "Optional. Solutions to generate")
+        ("symptomsPerProblem", po::value<double>(&parameters.symptomsPerProblem)->default_value(parameters.symptomsPerProblem),
+            "Optional. Average symptom links of a problem")
+        ("solutionsPerProblem", po::value<double>(&parameters.solutionsPerProblem)->default_value(parameters.solutionsPerProblem),
+            "Optional. Average solution links of a problem")
+        ("zipfExponent", po::value<double>(&parameters.zipfExponent)->default_value(parameters.zipfExponent),
+            "Optional. Skew of symptom and solution popularity, 0 makes them equally popular")
+        ("confirmedRatio", po::value<double>(&parameters.confirmedRatio)->default_value(parameters.confirmedRatio),
+            "Optional. Part of objects and links that are confirmed")
+        ("medianChecks", po::value<double>(&parameters.medianChecks)->default_value(parameters.medianChecks),
+            "Optional. Median of positive checks of a link")
+        ("checksSigma", po::value<double>(&parameters.checksSigma)->default_value(parameters.checksSigma),
+            "Optional. Spread of the log-normal distribution of positive checks")
+        ("falsePositiveRatio", po::value<double>(&parameters.falsePositiveRatio)->default_value(parameters.falsePositiveRatio),
+            "Optional. Average false positive checks relative to positive checks")
+        ("negativeRatio", po::value<double>(&parameters.negativeRatio)->default_value(parameters.negativeRatio),
+            "Optional. Average negative checks relative to positive checks");
+}
+
+KnowledgeGenerator::Report KnowledgeGenerator::generate(IDataLayer& dataLayer, bool assignIdentifiers)
+{
+    Report report;
+    
+    _random.seed(_parameters.seed);
+    _assignIdentifiers = assignIdentifiers;
+    _nextIdentifier = 0;
+    
+    generateCategories(dataLayer);
+    report.categories = _categoryIDs.size();
+    
+    generateObjects<ExtendedSymptom>(dataLayer, _parameters.symptoms, _symptomIDs, _symptomCategories);
+    generateObjects<ExtendedSolution>(dataLayer, _parameters.solutions, _solutionIDs, _solutionCategories);
+    generateObjects<ExtendedProblem>(dataLayer, _parameters.problems, _problemIDs, _problemCategories);
+    
+    report.symptoms = _symptomIDs.size();
+    report.solutions = _solutionIDs.size();
+    report.problems = _problemIDs.size();
+    
+    generateLinks(dataLayer, report);
+    
+    return report;
+}
+
+void KnowledgeGenerator::generateInvestigations(unsigned count, unsigned depth, std::vector<Investigation>& result)
+{
+    // separate sequence, so the investigations do not depend on how many were made before
+    RandomGenerator random(_parameters.seed + 1);
+    
+    for(unsigned i = 0; i < count && !_problemIDs.empty(); ++i)
+    {
+        unsigned problem = boost::random::uniform_int_distribution<unsigned>(0, _problemIDs.size() - 1)(random);
+        const std::vector<unsigned>& symptoms = _symptomsByProblem[problem];
+        
+        Investigation investigation;
+        investigation.id = Identifier((boost::format("ffffffff%016x") % i).str()); // never one of the generated objects
+        
+        for(unsigned j = 0; j < depth && j < symptoms.size(); ++j)
+        {
+            investigation.positiveSymptoms.push_back(_symptomIDs[symptoms[j]]);
+        }
+        
+        result.push_back(investigation);
+    }
+}
+
+/**
+ * Builds the category tree level by level, the parents are saved again once their children are known
+ */
+void KnowledgeGenerator::generateCategories(IDataLayer& dataLayer)
+{
+    std::vector<Category> categories(1);
+    _categoryParents.assign(1, 0);
+    
+    unsigned levelStart = 0;
+    for(unsigned level = 0; level < _parameters.categoryDepth; ++level)
+    {
+        unsigned levelEnd = categories.size();
+        for(unsigned parent = levelStart; parent < levelEnd; ++parent)
+        {
+            for(unsigned child = 0; child < _parameters.categoryFanout; ++child)
+            {
+                categories.push_back(Category());
+                _categoryParents.push_back(parent);
+            }
+        }
+        
+        levelStart = levelEnd;
+    }
+    
+    _categoryIDs.resize(categories.size());
+    for(unsigned i = 0; i < categories.size(); ++i)
+    {
+        categories[i].name = (boost::format("category %u") % i).str();
+        categories[i].description = "Generated category";
+        if(i > 0)
+            categories[i].parent = _categoryIDs[_categoryParents[i]];
+        
+        save(dataLayer, categories[i]);
+        _categoryIDs[i] = categories[i].id;
+    }
+    
+    for(unsigned i = 1; i < categories.size(); ++i)
+    {
+        categories[_categoryParents[i]].childs.push_back(_categoryIDs[i]);
+    }
+    
+    for(unsigned i = 0; i < categories.size(); ++i)
+    {
+        if(!categories[i].childs.empty())
+            dataLayer.modify(categories[i]);
+    }
+}
+
+template<class T>
+void KnowledgeGenerator::generateObjects(IDataLayer& dataLayer, unsigned count, std::vector<Identifier>& ids, std::vector<unsigned>& categories)
+{
+    ids.resize(count);
+    categories.resize(count);
+    
+    boost::random::uniform_int_distribution<unsigned> categoryDistribution(0, _categoryIDs.size() - 1);
+    
+    std::vector<T> objects;
+    
+    for(unsigned i = 0; i < count; ++i)
+    {
+        T object;
+        categories[i] = categoryDistribution(_random);
+        
+        object.categoryID = _categoryIDs[categories[i]];
+        object.difficulty = randomDifficulty();
+        object.confirmed = randomConfirmed();
+        object.name = (boost::format("generated %u") % i).str();
+        object.description = "Generated object";
+        
+        assignIdentifier(object);
+        objects.push_back(object);
+        
+        if(objects.size() == SAVE_BATCH_SIZE || i + 1 == count)
+        {
+            save(dataLayer, objects);
+            
+            for(unsigned j = 0; j < objects.size(); ++j)
+            {
+                ids[i + 1 - objects.size() + j] = objects[j].id;
+            }
+            
+            objects.clear();
+        }
+    }
+}
+
+/**
+ * Links every problem to symptoms and solutions from its own category and the categories above it.
+ * The index of a symptom or solution is its popularity rank.
+ */
+void KnowledgeGenerator::generateLinks(IDataLayer& dataLayer, Report& report)
+{
+    PopularityTable symptomPopularity;
+    PopularityTable solutionPopularity;
+    
+    symptomPopularity.objectsByCategory.resize(_categoryIDs.size());
+    symptomPopularity.weightsByCategory.resize(_categoryIDs.size());
+    solutionPopularity.objectsByCategory.resize(_categoryIDs.size());
+    solutionPopularity.weightsByCategory.resize(_categoryIDs.size());
+    
+    for(unsigned i = 0; i < _symptomIDs.size(); ++i)
+    {
+        std::vector<double>& weights = symptomPopularity.weightsByCategory[_symptomCategories[i]];
+        symptomPopularity.objectsByCategory[_symptomCategories[i]].push_back(i);
+        weights.push_back((weights.empty() ? 0 : weights.back()) + 1 / pow(i + 1.0, _parameters.zipfExponent));
+    }
+    
+    for(unsigned i = 0; i < _solutionIDs.size(); ++i)
+    {
+        std::vector<double>& weights = solutionPopularity.weightsByCategory[_solutionCategories[i]];
+        solutionPopularity.objectsByCategory[_solutionCategories[i]].push_back(i);
+        weights.push_back((weights.empty() ? 0 : weights.back()) + 1 / pow(i + 1.0, _parameters.zipfExponent));
+    }
+    
+    _symptomsByProblem.assign(_problemIDs.size(), std::vector<unsigned>());
+    
+    std::vector<SymptomLink> symptomLinks;
+    std::vector<SolutionLink> solutionLinks;
+    
+    for(unsigned problem = 0; problem < _problemIDs.size(); ++problem)
+    {
+        std::vector<unsigned>& linkedSymptoms = _symptomsByProblem[problem];
+        
+        // popular objects are picked again often, give up after a few attempts per link
+        unsigned wanted = randomCount(_parameters.symptomsPerProblem);
+        for(unsigned attempt = 0; linkedSymptoms.size() < wanted && attempt < wanted * 4; ++attempt)
+        {
+            unsigned symptom = pick(symptomPopularity, _problemCategories[problem]);
+            if(symptom == static_cast<unsigned>(-1))
+                break;
+            
+            if(std::find(linkedSymptoms.begin(), linkedSymptoms.end(), symptom) == linkedSymptoms.end())
+                linkedSymptoms.push_back(symptom);
+        }
+        
+        std::sort(linkedSymptoms.begin(), linkedSymptoms.end());
+        
+        BOOST_FOREACH(unsigned symptom, linkedSymptoms)
+        {
+            SymptomLink link;
+            link.problemID = _problemIDs[problem];
+            link.symptomID = _symptomIDs[symptom];
+            link.positiveChecks = randomChecks(_parameters.medianChecks);
+            link.falsePositiveChecks = randomRatio(link.positiveChecks, _parameters.falsePositiveRatio);
+            link.negativeChecks = randomRatio(link.positiveChecks, _parameters.negativeRatio);
+            link.confirmed = randomConfirmed();
+            
+            assignIdentifier(link);
+            symptomLinks.push_back(link);
+            ++report.symptomLinks;
+        }
+        
+        std::vector<unsigned> linkedSolutions;
+        
+        wanted = randomCount(_parameters.solutionsPerProblem);
+        for(unsigned attempt = 0; linkedSolutions.size() < wanted && attempt < wanted * 4; ++attempt)
+        {
+            unsigned solution = pick(solutionPopularity, _problemCategories[problem]);
+            if(solution == static_cast<unsigned>(-1))
+                break;
+            
+            if(std::find(linkedSolutions.begin(), linkedSolutions.end(), solution) == linkedSolutions.end())
+                linkedSolutions.push_back(solution);
+        }
+        
+        BOOST_FOREACH(unsigned solution, linkedSolutions)
+        {
+            SolutionLink link;
+            link.problemID = _problemIDs[problem];
+            link.solutionID = _solutionIDs[solution];
+            link.positive = randomChecks(_parameters.medianChecks);
+            link.negative = randomRatio(link.positive, _parameters.negativeRatio);
+            link.confirmed = randomConfirmed();
+            
+            assignIdentifier(link);
+            solutionLinks.push_back(link);
+            ++report.solutionLinks;
+        }
+        
+        if(symptomLinks.size() >= SAVE_BATCH_SIZE || problem + 1 == _problemIDs.size())
+        {
+            save(dataLayer, symptomLinks);
+            symptomLinks.clear();
+        }
+        
+        if(solutionLinks.size() >= SAVE_BATCH_SIZE || problem + 1 == _problemIDs.size())
+        {
+            save(dataLayer, solutionLinks);
+            solutionLinks.clear();
+        }
+    }
+}
+
+/**
+ * Picks an object by popularity from the category and the categories above it, returns -1 if there are none
+ */
+unsigned KnowledgeGenerator::pick(const PopularityTable& popularity, unsigned category)
+{
+    std::vector<unsigned> path;
+    double totalWeight = 0;
+    
+    while(true)
+    {
+        if(!popularity.weightsByCategory[category].empty())
+        {
+            path.push_back(category);
+            totalWeight += popularity.weightsByCategory[category].back();
+        }
+        
+        if(category == 0)
+            break;
+        
+        category = _categoryParents[category];
+    }
+    
+    if(path.empty())
+        return -1;
+    
+    double value = boost::random::uniform_real_distribution<double>(0, totalWeight)(_random);
+    
+    BOOST_FOREACH(unsigned pathCategory, path)
+    {
+        const std::vector<double>& weights = popularity.weightsByCategory[pathCategory];
+        if(value < weights.back())
+        {
+            unsigned position = std::upper_bound(weights.begin(), weights.end(), value) - weights.begin();
+            return popularity.objectsByCategory[pathCategory][std::min<size_t>(position, weights.size() - 1)];
+        }
+        
+        value -= weights.back();
+    }
+    
+    // only reachable through rounding
+    return popularity.objectsByCategory[path.back()].back();
+}
+
+DifficultyLevel KnowledgeGenerator::randomDifficulty()
+{
+    // relative frequency of difficultyOneLook to difficultyCategoryExpertOnly
+    static const unsigned weights[] = {10, 16, 18, 16, 12, 9, 7, 5, 4, 3};
+    static const unsigned totalWeight = 100;
+    
+    unsigned value = boost::random::uniform_int_distribution<unsigned>(0, totalWeight - 1)(_random);
+    
+    unsigned level = 0;
+    while(value >= weights[level])
+    {
+        value -= weights[level];
+        ++level;
+    }
+    
+    return static_cast<DifficultyLevel>(difficultyOneLook + level);
+}
+
+int KnowledgeGenerator::randomChecks(double median)
+{
+    double logarithm = boost::random::normal_distribution<double>(log(median), _parameters.checksSigma)(_random);
+    
+    return static_cast<int>(std::min(exp(logarithm), 1000000.0));
+}
+
+int KnowledgeGenerator::randomRatio(int checks, double ratio)
+{
+    return static_cast<int>(checks * boost::random::uniform_real_distribution<double>(0, 2 * ratio)(_random));
+}
+
+unsigned KnowledgeGenerator::randomCount(double mean)
+{
+    if(mean <= 0)
+        return 0;
+    
+    return std::max(1, boost::random::poisson_distribution<int>(mean)(_random));
+}
+
+bool KnowledgeGenerator::randomConfirmed()
+{
+    return boost::random::uniform_real_distribution<double>(0, 1)(_random) < _parameters.confirmedRatio;
+}
+
+template<class T>
+void KnowledgeGenerator::save(IDataLayer& dataLayer, T& object)
+{
+    if(_assignIdentifiers)
+    {
+        object.id = Identifier((boost::format("%024x") % ++_nextIdentifier).str());
+        dataLayer.modify(object);
+    }
+    else
+    {
+        object.id = dataLayer.add(object);
+    }
+}
+
+
+template<class T>
+void KnowledgeGenerator::assignIdentifier(T& object)
+{
+    if(_assignIdentifiers)
+        object.id = Identifier((boost::format("%024x") % ++_nextIdentifier).str());
+}
+
+template<class T>
+void KnowledgeGenerator::save(IDataLayer& dataLayer, std::vector<T>& objects)
+{
+    if(objects.empty())
+        return;
+    
+    if(_assignIdentifiers)
+    {
+        dataLayer.modify(objects);
+        return;
+    }
+    
+    std::vector<Identifier> newIDs;
+    dataLayer.add(objects, newIDs);
+    
+    for(size_t i = 0; i < objects.size(); ++i)
+    {
+        objects[i].id = newIDs[i];
+    }
+}
+
+} // namespace ProblemSolver
@@ -0,0 +1,168 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "datalayer.h"
+
+#include <vector>
+#include <boost/program_options.hpp>
+#include <boost/random/mersenne_twister.hpp>
+
+namespace ProblemSolver
+{
+
+/**
+ * Generates large synthetic knowledge bases for benchmarks and scale tests.
+ * The same parameters and seed always produce the same knowledge base.
+ *
+ * Categories form a tree of the given depth and fan-out and every object gets a random category.
+ * A problem is linked only to symptoms and solutions from its category and the categories above it,
+ * so the positive symptoms of any investigation of a problem form a valid category branch.
+ * Symptoms and solutions are picked with Zipfian popularity (a few are linked to many problems),
+ * link counters follow a log-normal distribution and difficulties are mostly low to moderate.
+ */
+class KnowledgeGenerator
+{
+public:
+    
+    struct Parameters
+    {
+        Parameters();
+        
+        unsigned seed;
+        
+        unsigned categoryDepth; // levels below the root category
+        unsigned categoryFanout; // children of every category that is not a leaf
+        
+        unsigned problems;
+        unsigned symptoms;
+        unsigned solutions;
+        
+        double symptomsPerProblem; // average, the actual count is Poisson distributed
+        double solutionsPerProblem;
+        double zipfExponent; // 0 makes all symptoms and solutions equally popular
+        
+        double confirmedRatio; // of objects and links
+        double medianChecks; // median of the positive checks of a link
+        double checksSigma; // spread of the log-normal distribution of positive checks
+        double falsePositiveRatio; // average false positive checks relative to positive checks
+        double negativeRatio; // average negative checks (or negative solution results) relative to positive ones
+    };
+    
+    /**
+     * Counts of the generated objects
+     */
+    struct Report
+    {
+        Report():
+            categories(0), problems(0), symptoms(0), solutions(0), symptomLinks(0), solutionLinks(0){}
+        
+        unsigned categories;
+        unsigned problems;
+        unsigned symptoms;
+        unsigned solutions;
+        unsigned symptomLinks;
+        unsigned solutionLinks;
+    };
+    
+public:
+    
+    explicit KnowledgeGenerator(const Parameters& parameters);
+    ~KnowledgeGenerator(){}
+    
+public:
+    
+    /**
+     * Adds the options of all parameters to a command line description, with the defaults from parameters
+     */
+    static void describeOptions(boost::program_options::options_description& options, Parameters& parameters);
+    
+    /**
+     * Saves a new knowledge base into dataLayer.
+     * Normally the objects are added and get their IDs from the data layer. With assignIdentifiers
+     * the generator makes the IDs itself and saves the objects with modify, so the data layer must add
+     * missing objects on modify (like the MemoryDataLayer does) and the result does not depend on it at all.
+     */
+    Report generate(IDataLayer& dataLayer, bool assignIdentifiers = false);
+    
+    /**
+     * Makes investigations of random problems of the last generated knowledge base.
+     * Each has up to depth of the symptoms of its problem as positive, the most popular ones first.
+     */
+    void generateInvestigations(unsigned count, unsigned depth, std::vector<Investigation>& result);
+    
+private:
+    
+    typedef boost::random::mt19937 RandomGenerator;
+    
+    static const unsigned SAVE_BATCH_SIZE = 1000;
+    
+    /**
+     * Symptoms or solutions of every category with the cumulative weight of their popularity
+     */
+    struct PopularityTable
+    {
+        std::vector<std::vector<unsigned> > objectsByCategory;
+        std::vector<std::vector<double> > weightsByCategory; // cumulative
+    };
+    
+private:
+    
+    void generateCategories(IDataLayer& dataLayer);
+    
+    template<class T>
+    void generateObjects(IDataLayer& dataLayer, unsigned count, std::vector<Identifier>& ids, std::vector<unsigned>& categories);
+    
+    void generateLinks(IDataLayer& dataLayer, Report& report);
+    
+    unsigned pick(const PopularityTable& popularity, unsigned category);
+    
+    DifficultyLevel randomDifficulty();
+    int randomChecks(double median);
+    int randomRatio(int checks, double ratio);
+    unsigned randomCount(double mean);
+    bool randomConfirmed();
+    
+    template<class T>
+    void save(IDataLayer& dataLayer, T& object);
+    
+    /**
+     * Objects and links are saved in bulk, SAVE_BATCH_SIZE at a time. With assignIdentifiers they get their IDs
+     * when they are made, so the IDs do not depend on the batches.
+     */
+    template<class T>
+    void assignIdentifier(T& object);
+    
+    template<class T>
+    void save(IDataLayer& dataLayer, std::vector<T>& objects);
+    
+private:
+    
+    Parameters _parameters;
+    RandomGenerator _random;
+    
+    bool _assignIdentifiers;
+    unsigned long long _nextIdentifier;
+    
+    std::vector<Identifier> _categoryIDs;
+    std::vector<unsigned> _categoryParents; // index of the parent category, the root is its own parent
+    
+    std::vector<Identifier> _problemIDs;
+    std::vector<unsigned> _problemCategories;
+    
+    std::vector<Identifier> _symptomIDs;
+    std::vector<unsigned> _symptomCategories;
+    
+    std::vector<Identifier> _solutionIDs;
+    std::vector<unsigned> _solutionCategories;
+    
+    std::vector<std::vector<unsigned> > _symptomsByProblem; // indexes of linked symptoms, most popular first
+
+};
+
+} // namespace ProblemSolver
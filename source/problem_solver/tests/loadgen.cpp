@@ -0,0 +1,711 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "utils.h"
+#include "latencyhistogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <boost/foreach.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/format.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+using namespace utils;
+using boost::property_tree::ptree;
+namespace po = boost::program_options;
+
+typedef boost::random::mt19937 RandomGenerator;
+
+/**
+ * Where and how requests are sent
+ */
+struct Target
+{
+    sockaddr_in address;
+    std::string host;
+};
+
+/**
+ * Sends one request in a new connection and reads the whole response, the server closes every connection after responding.
+ * Returns false if the server can not be reached.
+ */
+bool sendRequest(const Target& target, const std::string& body, std::string& response)
+{
+    response.clear();
+    
+    int clientSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if(clientSocket < 0)
+        return false;
+    
+    if(connect(clientSocket, (const sockaddr*)&target.address, sizeof(target.address)) < 0)
+    {
+        close(clientSocket);
+        return false;
+    }
+    
+    std::string request = (boost::format("POST / HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\n\r\n%s")
+                           % target.host % body.size() % body).str();
+    
+    // the server reads the request until a short read, so it is written at once
+    size_t written = 0;
+    while(written < request.size())
+    {
+        ssize_t result = write(clientSocket, request.c_str() + written, request.size() - written);
+        if(result < 0)
+        {
+            close(clientSocket);
+            return false;
+        }
+        
+        written += result;
+    }
+    
+    char buffer[4096];
+    ssize_t bytesRead = 0;
+    while((bytesRead = read(clientSocket, buffer, sizeof(buffer))) > 0)
+    {
+        response.append(buffer, bytesRead);
+    }
+    
+    close(clientSocket);
+    return bytesRead == 0;
+}
+
+/**
+ * Errors are reported by the server as {"error": "..."}
+ */
+bool isErrorResponse(const std::string& response)
+{
+    return response.empty() || response.compare(0, 10, "{\"error\": ") == 0;
+}
+
+std::string escapeJson(const std::string& text)
+{
+    std::string result;
+    result.reserve(text.size());
+    
+    BOOST_FOREACH(char symbol, text)
+    {
+        if(symbol == '"' || symbol == '\\')
+            result += '\\';
+        
+        if(symbol == '\n' || symbol == '\r' || symbol == '\t')
+            symbol = ' ';
+        
+        result += symbol;
+    }
+    
+    return result;
+}
+
+/**
+ * The requests of a run, either replayed from a log or made up from a mix of request types
+ */
+class Workload
+{
+public:
+    
+    enum RequestType
+    {
+        requestSearch = 0,
+        requestSuggest = 1,
+        requestEvent = 2,
+        requestEventSuggest = 3,
+        requestDatabase = 4,
+        requestTypeCount = 5
+    };
+    
+public:
+    
+    Workload():
+        _totalWeight(0){}
+    
+public:
+    
+    /**
+     * Loads a request log, one JSON request per line.
+     * Of the solvingserver log only the request bodies are taken (the text after "Request Body: "), everything else is skipped.
+     */
+    void loadLog(const std::string& fileName)
+    {
+        std::ifstream file(fileName.c_str());
+        if(!file)
+            throw std::runtime_error("Can not open request log " + fileName);
+        
+        static const std::string serverPrefix = "Request Body: ";
+        
+        std::string line;
+        unsigned lineNumber = 0;
+        while(std::getline(file, line))
+        {
+            ++lineNumber;
+            
+            size_t prefixPosition = line.find(serverPrefix);
+            if(prefixPosition != std::string::npos)
+                line.erase(0, prefixPosition + serverPrefix.size());
+            
+            if(line.empty() || line[0] != '{')
+                continue;
+            
+            std::string type;
+            try
+            {
+                std::stringstream jsonStream(line);
+                ptree json;
+                boost::property_tree::json_parser::read_json(jsonStream, json);
+                
+                type = json.get<std::string>("RequestType");
+            }
+            catch(std::exception& e)
+            {
+                printf("Skipping invalid request on line %u of %s\n", lineNumber, fileName.c_str());
+                continue;
+            }
+            
+            _loggedTypes.push_back(getTypeIndex(type));
+            _loggedRequests.push_back(line);
+        }
+        
+        if(_loggedRequests.empty())
+            throw std::runtime_error("No requests in request log " + fileName);
+    }
+    
+    /**
+     * Prepares a synthetic mix like "search=1,suggest=4,event=2,database=1".
+     * Takes the symptoms of the server knowledge base and adds investigations for the suggest and event requests.
+     */
+    void prepareMix(const Target& target, const std::string& mix, unsigned investigations)
+    {
+        static const char* typeNames[requestTypeCount] = { "search", "suggest", "event", "eventSuggest", "database" };
+        for(unsigned i = 0; i < requestTypeCount; ++i)
+        {
+            getTypeIndex(typeNames[i]);
+        }
+        
+        _mixWeights.assign(requestTypeCount, 0);
+        
+        std::vector<std::string> parts;
+        boost::algorithm::split(parts, mix, boost::algorithm::is_any_of(","));
+        BOOST_FOREACH(const std::string& part, parts)
+        {
+            size_t separator = part.find('=');
+            unsigned type = getTypeIndex(part.substr(0, separator));
+            if(type >= requestTypeCount)
+                throw std::runtime_error("Unknown request type in mix: " + part);
+            
+            _mixWeights[type] = separator == std::string::npos ? 1 : atof(part.c_str() + separator + 1);
+        }
+        
+        for(unsigned i = 0; i < requestTypeCount; ++i)
+        {
+            _totalWeight += _mixWeights[i];
+        }
+        
+        if(_totalWeight <= 0)
+            throw std::runtime_error("Empty request mix " + mix);
+        
+        _target = target;
+        
+        std::string response;
+        if(!sendRequest(target, "{\"RequestType\":\"database\",\"ObjectType\":\"symptom\",\"operation\":\"get\",\"ids\":[]}", response) ||
+           isErrorResponse(response))
+            throw std::runtime_error("Can not get the symptoms from the server: " + response);
+        
+        std::stringstream jsonStream(response);
+        ptree json;
+        boost::property_tree::json_parser::read_json(jsonStream, json);
+        
+        BOOST_FOREACH(const ptree::value_type& symptom, json.get_child("result"))
+        {
+            _symptomsByCategory[symptom.second.get<std::string>("categoryID")].push_back(_symptomIDs.size());
+            _symptomCategories.push_back(symptom.second.get<std::string>("categoryID"));
+            _symptomIDs.push_back(symptom.second.get<std::string>("id"));
+            _symptomNames.push_back(escapeJson(symptom.second.get<std::string>("name")));
+        }
+        
+        // events check the other symptoms from the category of the positive one
+        std::vector<unsigned> positiveSymptoms;
+        for(unsigned i = 0; i < _symptomIDs.size(); ++i)
+        {
+            if(_symptomsByCategory[_symptomCategories[i]].size() > 1)
+                positiveSymptoms.push_back(i);
+        }
+        
+        if(positiveSymptoms.empty())
+            throw std::runtime_error("The server needs a category with at least two symptoms");
+        
+        for(unsigned i = 0; i < investigations; ++i)
+        {
+            InvestigationSlot slot;
+            slot.positiveSymptom = positiveSymptoms[(i * 7919) % positiveSymptoms.size()];
+            slot.id = addInvestigation(slot.positiveSymptom);
+            slot.checked = 0;
+            
+            _investigations.push_back(slot);
+        }
+        
+        if(_investigations.empty())
+            throw std::runtime_error("At least one investigation is needed");
+    }
+    
+    bool isReplay() const { return !_loggedRequests.empty(); }
+    size_t getLoggedCount() const { return _loggedRequests.size(); }
+    
+    const std::vector<std::string>& getTypeNames() const { return _typeNames; }
+    
+    /**
+     * Makes the request with the given sequence number, synthetic requests are random
+     */
+    void makeRequest(unsigned long long number, RandomGenerator& random, unsigned& type, std::string& body)
+    {
+        if(isReplay())
+        {
+            size_t index = number % _loggedRequests.size();
+            type = _loggedTypes[index];
+            body = _loggedRequests[index];
+            return;
+        }
+        
+        double choice = boost::random::uniform_real_distribution<double>(0, _totalWeight)(random);
+        for(type = 0; type + 1 < requestTypeCount; ++type)
+        {
+            if(choice < _mixWeights[type])
+                break;
+            
+            choice -= _mixWeights[type];
+        }
+        
+        size_t slot = randomIndex(random, _investigations.size());
+        
+        switch(type)
+        {
+            case requestSearch:
+                body = "{\"RequestType\":\"search\",\"search\":\"" + _symptomNames[randomIndex(random, _symptomNames.size())] + "\"}";
+                break;
+            case requestSuggest:
+            {
+                boost::mutex::scoped_lock lock(_investigationsMutex);
+                body = "{\"RequestType\":\"suggest\",\"investigation\":\"" + _investigations[slot].id + "\"}";
+                break;
+            }
+            case requestEvent:
+            {
+                std::string investigationID;
+                unsigned symptom = nextEventSymptom(slot, investigationID);
+                body = "{\"RequestType\":\"event\",\"investigation\":\"" + investigationID + "\",\"event\":\"symptom\",\"object\":\"" +
+                       _symptomIDs[symptom] + "\",\"result\":" + (randomIndex(random, 2) == 0 ? "true" : "false") + "}";
+                break;
+            }
+            case requestEventSuggest:
+            {
+                std::string investigationID;
+                unsigned symptom = nextEventSymptom(slot, investigationID);
+                body = "{\"RequestType\":\"eventSuggest\",\"investigation\":\"" + investigationID + "\",\"events\":[{\"event\":\"symptom\",\"object\":\"" +
+                       _symptomIDs[symptom] + "\",\"result\":" + (randomIndex(random, 2) == 0 ? "true" : "false") + "}]}";
+                break;
+            }
+            default:
+                body = "{\"RequestType\":\"database\",\"ObjectType\":\"symptom\",\"operation\":\"get\",\"ids\":[\"" +
+                       _symptomIDs[randomIndex(random, _symptomIDs.size())] + "\"]}";
+                break;
+        }
+    }
+    
+private:
+    
+    /**
+     * One of the investigations the synthetic requests work with
+     */
+    struct InvestigationSlot
+    {
+        std::string id;
+        unsigned positiveSymptom;
+        unsigned checked; // symptoms of its category already sent in events
+    };
+    
+    typedef boost::unordered_map<std::string, std::vector<unsigned> > SymptomsByCategory;
+    
+private:
+    
+    /**
+     * Adds a new investigation with one positive symptom, the suggestions need it to find the category branch
+     */
+    std::string addInvestigation(unsigned positiveSymptom)
+    {
+        static const char* newInvestigation = "{\"RequestType\":\"database\",\"ObjectType\":\"investigation\",\"operation\":\"add\","
+            "\"object\":{\"closed\":false,\"positiveProblem\":\"\",\"positiveSolution\":\"\",\"positiveSymptoms\":[\"%s\"],"
+            "\"negativeSymptoms\":[],\"bannedSymptoms\":[],\"negativeProblems\":[],\"bannedProblems\":[],\"negativeSolutions\":[],"
+            "\"bannedSolutions\":[]}}";
+        
+        std::string response;
+        if(!sendRequest(_target, (boost::format(newInvestigation) % _symptomIDs[positiveSymptom]).str(), response) ||
+           isErrorResponse(response))
+            throw std::runtime_error("Can not add an investigation: " + response);
+        
+        std::stringstream resultStream(response);
+        ptree result;
+        boost::property_tree::json_parser::read_json(resultStream, result);
+        
+        return result.get<std::string>("result");
+    }
+    
+    /**
+     * Returns a symptom the investigation in slot has not checked yet.
+     * Symptoms out of the category branch of the investigation would break its suggestions and every symptom
+     * can be checked only once, so when the category is exhausted the slot gets a new investigation.
+     */
+    unsigned nextEventSymptom(size_t slot, std::string& investigationID)
+    {
+        while(true)
+        {
+            std::string oldID;
+            unsigned positiveSymptom;
+            {
+                boost::mutex::scoped_lock lock(_investigationsMutex);
+                
+                InvestigationSlot& investigation = _investigations[slot];
+                const std::vector<unsigned>& sameCategory = _symptomsByCategory[_symptomCategories[investigation.positiveSymptom]];
+                
+                if(investigation.checked < sameCategory.size() && sameCategory[investigation.checked] == investigation.positiveSymptom)
+                    ++investigation.checked;
+                
+                if(investigation.checked < sameCategory.size())
+                {
+                    investigationID = investigation.id;
+                    return sameCategory[investigation.checked++];
+                }
+                
+                oldID = investigation.id;
+                positiveSymptom = investigation.positiveSymptom;
+            }
+            
+            // not measured, but it is sent from the connection and delays its next request
+            std::string newID = addInvestigation(positiveSymptom);
+            
+            boost::mutex::scoped_lock lock(_investigationsMutex);
+            if(_investigations[slot].id == oldID)
+            {
+                _investigations[slot].id = newID;
+                _investigations[slot].checked = 0;
+            }
+        }
+    }
+    
+    unsigned getTypeIndex(const std::string& type)
+    {
+        for(unsigned i = 0; i < _typeNames.size(); ++i)
+        {
+            if(_typeNames[i] == type)
+                return i;
+        }
+        
+        _typeNames.push_back(type);
+        return _typeNames.size() - 1;
+    }
+    
+    static size_t randomIndex(RandomGenerator& random, size_t size)
+    {
+        return boost::random::uniform_int_distribution<size_t>(0, size - 1)(random);
+    }
+    
+private:
+    
+    std::vector<std::string> _typeNames;
+    
+    std::vector<std::string> _loggedRequests;
+    std::vector<unsigned> _loggedTypes;
+    
+    std::vector<double> _mixWeights;
+    double _totalWeight;
+    Target _target;
+    
+    std::vector<std::string> _symptomIDs;
+    std::vector<std::string> _symptomNames;
+    std::vector<std::string> _symptomCategories;
+    SymptomsByCategory _symptomsByCategory;
+    
+    boost::mutex _investigationsMutex;
+    std::vector<InvestigationSlot> _investigations;
+};
+
+/**
+ * Hands out request numbers and their scheduled start times to the connections
+ */
+class Schedule
+{
+public:
+    
+    Schedule(unsigned long long requests, double duration, double rate):
+        _requests(requests),
+        _rate(rate),
+        _next(0),
+        _start(getMonotonicNanoseconds()),
+        _end(duration > 0 ? _start + static_cast<uint64_t>(duration * 1e9) : 0){}
+    
+public:
+    
+    /**
+     * Returns false when the run is over.
+     * In an open loop the scheduled time is fixed by the rate and the latency is counted from it even if all connections
+     * were busy, in a closed loop every connection sends the next request as soon as it gets a response.
+     */
+    bool next(unsigned long long& number, uint64_t& scheduledTime)
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            
+            if(_end == 0 && _next >= _requests)
+                return false;
+            
+            number = _next++;
+        }
+        
+        uint64_t now = getMonotonicNanoseconds();
+        scheduledTime = _rate > 0 ? _start + static_cast<uint64_t>(number * 1e9 / _rate) : now;
+        
+        if(_end != 0 && scheduledTime >= _end)
+            return false;
+        
+        if(scheduledTime > now)
+            usleep((scheduledTime - now) / 1000);
+        
+        return true;
+    }
+    
+    uint64_t getStart() const { return _start; }
+    
+private:
+    
+    boost::mutex _mutex;
+    
+    unsigned long long _requests;
+    double _rate;
+    unsigned long long _next;
+    
+    uint64_t _start;
+    uint64_t _end;
+};
+
+/**
+ * One concurrent client, keeps its own statistics for every request type
+ */
+struct Connection
+{
+    Connection(unsigned seed, size_t typeCount):
+        random(seed),
+        latencies(typeCount),
+        errors(typeCount, 0),
+        bytesReceived(0){}
+    
+    void run(const Target& target, Workload& workload, Schedule& schedule)
+    {
+        unsigned long long number;
+        uint64_t scheduledTime;
+        
+        unsigned type;
+        std::string request;
+        std::string response;
+        
+        while(schedule.next(number, scheduledTime))
+        {
+            workload.makeRequest(number, random, type, request);
+            
+            bool sent = sendRequest(target, request, response);
+            uint64_t latency = getMonotonicNanoseconds() - scheduledTime;
+            
+            bytesReceived += response.size();
+            
+            if(!sent || isErrorResponse(response))
+                ++errors[type];
+            else
+                latencies[type].record(latency);
+        }
+    }
+    
+    RandomGenerator random;
+    std::vector<LatencyHistogram> latencies;
+    std::vector<unsigned long long> errors;
+    unsigned long long bytesReceived;
+};
+
+void printLatencies(const std::string& name, const LatencyHistogram& latencies, unsigned long long errors, double seconds, bool printHistogram)
+{
+    printf("%-12s %10llu %8llu %10.1f %10.0f %10.0f %10.0f %10.0f %10.0f\n", name.c_str(),
+           static_cast<unsigned long long>(latencies.getCount()), errors, latencies.getCount() / seconds,
+           latencies.getMean() / 1000, latencies.getPercentile(0.5) / 1000.0, latencies.getPercentile(0.99) / 1000.0,
+           latencies.getPercentile(0.999) / 1000.0, latencies.getMax() / 1000.0);
+    
+    if(!printHistogram || latencies.getCount() == 0)
+        return;
+    
+    static const double fractions[] = { 0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 0.995, 0.999, 0.9999, 0.99999, 1 };
+    for(unsigned i = 0; i < sizeof(fractions) / sizeof(fractions[0]); ++i)
+    {
+        printf("    %9.5f%% %12.0f us\n", fractions[i] * 100, latencies.getPercentile(fractions[i]) / 1000.0);
+    }
+}
+
+/**
+ * Replays a mix of requests or a captured request log against a running solvingserver and measures the latencies
+ */
+int main(int argc, const char* argv[])
+{
+    std::string host;
+    int port;
+    unsigned connections;
+    unsigned long long requests;
+    double duration;
+    double rate;
+    std::string mix;
+    unsigned investigations;
+    unsigned seed;
+    
+    po::variables_map optionsMap;
+    try
+    {
+        po::options_description allowedOptions(200, 100);
+        allowedOptions.add_options()
+            ("help,h", "Produce help message.")
+            ("host", po::value<std::string>(&host)->default_value("127.0.0.1"), "Optional. IP address of the solvingserver")
+            ("port", po::value<int>(&port)->default_value(33333), "Optional. Port of the solvingserver")
+            ("connections", po::value<unsigned>(&connections)->default_value(4), "Optional. Concurrent clients, each has one request in flight")
+            ("requests", po::value<unsigned long long>(&requests)->default_value(0),
+                "Optional. Requests to send, 0 means 1000 or every request of the replayed log once")
+            ("duration", po::value<double>(&duration)->default_value(0), "Optional. Seconds to send requests for instead of a number of requests")
+            ("rate", po::value<double>(&rate)->default_value(0),
+                "Optional. Requests per second of an open loop, 0 makes a closed loop where every connection sends as fast as it can")
+            ("mix", po::value<std::string>(&mix)->default_value("search=1,suggest=4,event=2,database=1"),
+                "Optional. Weights of the synthetic request types: search, suggest, event, eventSuggest and database")
+            ("investigations", po::value<unsigned>(&investigations)->default_value(20),
+                "Optional. Investigations added for the synthetic suggest and event requests")
+            ("replay", po::value<std::string>(), "Optional. Request log to replay instead of the synthetic mix, one JSON request per line "
+                "or the solvingserver output with its 'Request Body:' lines")
+            ("seed", po::value<unsigned>(&seed)->default_value(1), "Optional. Seed of the synthetic requests")
+            ("histogram", "Optional. Print the latency distribution of every request type");
+        
+        po::store(po::parse_command_line(argc, argv, allowedOptions), optionsMap, true);
+        
+        if (optionsMap.count("help"))
+        {
+            std::cout << allowedOptions << "\n";
+            return 1;
+        }
+        
+        po::notify(optionsMap);
+        
+        if(connections == 0)
+            throw std::runtime_error("At least one connection is needed");
+    }
+    catch(std::exception& e)
+    {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    
+    try
+    {
+        Target target;
+        target.host = host;
+        memset(&target.address, 0, sizeof(target.address));
+        target.address.sin_family = AF_INET;
+        target.address.sin_addr.s_addr = inet_addr(host.c_str());
+        target.address.sin_port = htons(port);
+        
+        Workload workload;
+        if(optionsMap.count("replay"))
+        {
+            workload.loadLog(optionsMap["replay"].as<std::string>());
+            printf("Replaying %u logged requests\n", static_cast<unsigned>(workload.getLoggedCount()));
+        }
+        else
+        {
+            workload.prepareMix(target, mix, investigations);
+            printf("Sending the request mix %s over %u investigations\n", mix.c_str(), investigations);
+        }
+        
+        if(requests == 0)
+            requests = workload.isReplay() ? workload.getLoggedCount() : 1000;
+        
+        std::vector<Connection*> clients;
+        for(unsigned i = 0; i < connections; ++i)
+        {
+            clients.push_back(new Connection(seed + i, workload.getTypeNames().size()));
+        }
+        
+        Schedule schedule(requests, duration, rate);
+        
+        boost::thread_group threads;
+        BOOST_FOREACH(Connection* client, clients)
+        {
+            threads.create_thread(boost::bind(&Connection::run, client, boost::cref(target), boost::ref(workload), boost::ref(schedule)));
+        }
+        threads.join_all();
+        
+        double seconds = (getMonotonicNanoseconds() - schedule.getStart()) / 1e9;
+        
+        std::vector<LatencyHistogram> latencies(workload.getTypeNames().size());
+        std::vector<unsigned long long> errors(workload.getTypeNames().size(), 0);
+        LatencyHistogram allLatencies;
+        unsigned long long allErrors = 0;
+        unsigned long long bytesReceived = 0;
+        
+        BOOST_FOREACH(Connection* client, clients)
+        {
+            for(size_t type = 0; type < latencies.size(); ++type)
+            {
+                latencies[type].add(client->latencies[type]);
+                allLatencies.add(client->latencies[type]);
+                errors[type] += client->errors[type];
+                allErrors += client->errors[type];
+            }
+            
+            bytesReceived += client->bytesReceived;
+            delete client;
+        }
+        
+        printf("%u connections, %s, %.3f seconds, %.1f requests/s, %.1f MB received\n", connections,
+               rate > 0 ? (boost::format("open loop at %.1f requests/s") % rate).str().c_str() : "closed loop",
+               seconds, (allLatencies.getCount() + allErrors) / seconds, bytesReceived / (1024.0 * 1024.0));
+        printf("%-12s %10s %8s %10s %10s %10s %10s %10s %10s\n", "type", "requests", "errors", "requests/s",
+               "mean us", "p50 us", "p99 us", "p999 us", "max us");
+        
+        for(size_t type = 0; type < latencies.size(); ++type)
+        {
+            if(latencies[type].getCount() > 0 || errors[type] > 0)
+                printLatencies(workload.getTypeNames()[type], latencies[type], errors[type], seconds, optionsMap.count("histogram") > 0);
+        }
+        
+        printLatencies("all", allLatencies, allErrors, seconds, false);
+    }
+    catch(std::exception& e)
+    {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    
+    return 0;
+}
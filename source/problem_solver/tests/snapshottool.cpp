@@ -0,0 +1,184 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "mongodbdatalayer.h"
+#include "snapshotreader.h"
+#include "snapshotwriter.h"
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <boost/program_options.hpp>
+
+using namespace ProblemSolver;
+namespace po = boost::program_options;
+
+const char* getSectionName(unsigned type)
+{
+    switch(type)
+    {
+        case snapshotSectionStrings: return "strings";
+        case snapshotSectionLists: return "lists";
+        case snapshotSectionCategories: return "categories";
+        case snapshotSectionProblems: return "problems";
+        case snapshotSectionSymptoms: return "symptoms";
+        case snapshotSectionSolutions: return "solutions";
+        case snapshotSectionSymptomLinks: return "symptom links";
+        case snapshotSectionSolutionLinks: return "solution links";
+        case snapshotSectionInvestigations: return "investigations";
+        case snapshotSectionSymptomLinksByProblem: return "symptom links by problem index";
+        case snapshotSectionSymptomLinksBySymptom: return "symptom links by symptom index";
+        case snapshotSectionSolutionLinksByProblem: return "solution links by problem index";
+        case snapshotSectionSolutionLinksBySolution: return "solution links by solution index";
+        default: return "unknown";
+    }
+}
+
+int createSnapshot(const std::string& fileName, const std::string& mongoConnectionString, const std::string& mongoDatabase, unsigned batchSize)
+{
+    MongoDbDataLayer dataLayer(mongoConnectionString, mongoDatabase);
+    
+    double startTime = utils::getCurrentSeconds();
+    uint64_t size = SnapshotWriter().write(dataLayer, fileName, batchSize);
+    
+    printf("Snapshot %s created: %.1f MB in %.3f seconds\n", fileName.c_str(), size / (1024.0 * 1024.0), utils::getCurrentSeconds() - startTime);
+    
+    return 0;
+}
+
+int inspectSnapshot(const std::string& fileName, unsigned recordsToPrint)
+{
+    double startTime = utils::getCurrentSeconds();
+    SnapshotReader snapshot(fileName);
+    
+    const SnapshotHeader& header = snapshot.getHeader();
+    time_t createdAt = header.createdAt;
+    
+    printf("Snapshot %s is valid (checked in %.3f seconds)\n", fileName.c_str(), utils::getCurrentSeconds() - startTime);
+    printf("Version: %u\n", header.version);
+    printf("Created: %s", ctime(&createdAt));
+    printf("Size: %llu bytes\n", static_cast<unsigned long long>(header.fileSize));
+    printf("Checksum: %08x\n", header.checksum);
+    
+    for(unsigned type = snapshotSectionStrings; type <= snapshotSectionSolutionLinksBySolution; ++type)
+    {
+        printf("%-34s %u\n", getSectionName(type), snapshot.getRecordCount(static_cast<SnapshotSectionType>(type)));
+    }
+    
+    for(unsigned i = 0; i < recordsToPrint && i < snapshot.getRecordCount(snapshotSectionCategories); ++i)
+    {
+        Category category;
+        snapshot.read(i, category);
+        printf("category %s: %s\n", category.id.toString().c_str(), category.name.c_str());
+    }
+    
+    for(unsigned i = 0; i < recordsToPrint && i < snapshot.getRecordCount(snapshotSectionProblems); ++i)
+    {
+        ExtendedProblem problem;
+        snapshot.read(i, problem);
+        printf("problem %s: %s\n", problem.id.toString().c_str(), problem.name.c_str());
+    }
+    
+    for(unsigned i = 0; i < recordsToPrint && i < snapshot.getRecordCount(snapshotSectionSymptoms); ++i)
+    {
+        ExtendedSymptom symptom;
+        snapshot.read(i, symptom);
+        printf("symptom %s: %s\n", symptom.id.toString().c_str(), symptom.name.c_str());
+    }
+    
+    for(unsigned i = 0; i < recordsToPrint && i < snapshot.getRecordCount(snapshotSectionSolutions); ++i)
+    {
+        ExtendedSolution solution;
+        snapshot.read(i, solution);
+        printf("solution %s: %s\n", solution.id.toString().c_str(), solution.name.c_str());
+    }
+    
+    for(unsigned i = 0; i < recordsToPrint && i < snapshot.getRecordCount(snapshotSectionSymptomLinks); ++i)
+    {
+        SymptomLink link;
+        snapshot.read(i, link);
+        printf("symptom link %s: problem %s symptom %s (%d/%d/%d)\n", link.id.toString().c_str(), link.problemID.toString().c_str(), link.symptomID.toString().c_str(),
+               link.positiveChecks, link.falsePositiveChecks, link.negativeChecks);
+    }
+    
+    for(unsigned i = 0; i < recordsToPrint && i < snapshot.getRecordCount(snapshotSectionSolutionLinks); ++i)
+    {
+        SolutionLink link;
+        snapshot.read(i, link);
+        printf("solution link %s: problem %s solution %s (%d/%d)\n", link.id.toString().c_str(), link.problemID.toString().c_str(), link.solutionID.toString().c_str(),
+               link.positive, link.negative);
+    }
+    
+    for(unsigned i = 0; i < recordsToPrint && i < snapshot.getRecordCount(snapshotSectionInvestigations); ++i)
+    {
+        Investigation investigation;
+        snapshot.read(i, investigation);
+        printf("investigation %s: %s\n", investigation.id.toString().c_str(), investigation.closed ? "closed" : "open");
+    }
+    
+    return 0;
+}
+
+/**
+ * Creates snapshots of a Mongo knowledge base and inspects existing snapshots
+ */
+int main(int argc, const char* argv[])
+{
+    po::variables_map optionsMap;
+    try
+    {
+        po::options_description allowedOptions(200, 100);
+        allowedOptions.add_options()
+            ("help,h", "Produce help message.")
+            ("create", "Create a snapshot from Mongo")
+            ("inspect", "Validate a snapshot and print what it contains")
+            ("file", po::value<std::string>()->required(), "Required. Snapshot file")
+            ("mongoConnection", po::value<std::string>(), "Mongo Connection string for create. E.g: host:port")
+            ("mongoDatabase", po::value<std::string>(), "Mongo Database name for create. E.g: kb")
+            ("batchSize", po::value<unsigned>()->default_value(SnapshotWriter::DEFAULT_BATCH_SIZE),
+                "Optional. How many objects are read from Mongo at once")
+            ("records", po::value<unsigned>()->default_value(0), "Optional. How many records of each type to print on inspect");
+        
+        po::store(po::parse_command_line(argc, argv, allowedOptions), optionsMap, true);
+        
+        if (optionsMap.count("help") || optionsMap.empty() || (optionsMap.count("create") == optionsMap.count("inspect")))
+        {
+            std::cout << allowedOptions << "\n";
+            return 1;
+        }
+        
+        po::notify(optionsMap);
+    }
+    catch(std::exception& e)
+    {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    
+    try
+    {
+        std::string fileName = optionsMap["file"].as<std::string>();
+        
+        if(optionsMap.count("inspect"))
+            return inspectSnapshot(fileName, optionsMap["records"].as<unsigned>());
+        
+        if(!optionsMap.count("mongoConnection") || !optionsMap.count("mongoDatabase"))
+        {
+            std::cout << "Error: create requires mongoConnection and mongoDatabase\n";
+            return 1;
+        }
+        
+        return createSnapshot(fileName, optionsMap["mongoConnection"].as<std::string>(), optionsMap["mongoDatabase"].as<std::string>(),
+                              optionsMap["batchSize"].as<unsigned>());
+    }
+    catch(std::exception& e)
+    {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
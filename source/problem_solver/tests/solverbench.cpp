@@ -0,0 +1,298 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "memorydatalayer.h"
+#include "solvingmachine.h"
+#include "knowledgegenerator.h"
+
+#include "utils.h"
+#include "atomiccounter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <boost/foreach.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/program_options.hpp>
+
+using namespace ProblemSolver;
+namespace po = boost::program_options;
+
+// every allocation of the process is counted, the reader threads allocate at the same time as the main thread
+static utils::AtomicCounter allocationCount;
+static utils::AtomicCounter allocationBytes;
+
+/**
+ * Not inlined, so the optimizer does not see malloc and free meet new and delete and report them as mismatched
+ */
+static void* __attribute__((noinline)) allocate(size_t size)
+{
+    allocationCount.add();
+    allocationBytes.add(size);
+    
+    void* memory = malloc(size > 0 ? size : 1);
+    if(memory == NULL)
+        throw std::bad_alloc();
+    
+    return memory;
+}
+
+static void __attribute__((noinline)) release(void* memory)
+{
+    free(memory);
+}
+
+void* operator new(size_t size) throw(std::bad_alloc)
+{
+    return allocate(size);
+}
+
+void* operator new[](size_t size) throw(std::bad_alloc)
+{
+    return allocate(size);
+}
+
+void operator delete(void* memory) throw()
+{
+    release(memory);
+}
+
+void operator delete[](void* memory) throw()
+{
+    release(memory);
+}
+
+double percentile(const std::vector<uint64_t>& sortedValues, double fraction)
+{
+    if(sortedValues.empty())
+        return 0;
+    
+    return sortedValues[std::min<size_t>(sortedValues.size() - 1, static_cast<size_t>(fraction * sortedValues.size()))];
+}
+
+/**
+ * Orders indexes of values by descending value
+ */
+struct DescendingValue
+{
+    explicit DescendingValue(const std::vector<int>& values):
+        values(values){}
+    
+    bool operator () (unsigned first, unsigned second) const { return values[first] > values[second]; }
+    
+    const std::vector<int>& values;
+};
+
+/**
+ * Compares approximate suggestions with exact ones: how often the best approximate symptom has the best exact value,
+ * how many of the best approximate symptoms have an exact value among the best exact values
+ * and whether the symptoms valued exactly in approximate mode have the same values
+ */
+void printRankingAgreement(IDataLayerRead& dataLayer, const std::vector<Investigation>& investigations, const SolvingMachine::Options& options)
+{
+    static const unsigned RANKING_DEPTH = 10;
+    
+    SolvingMachine exactMachine(dataLayer);
+    SolvingMachine approximateMachine(dataLayer, options);
+    
+    unsigned approximated = 0;
+    unsigned bestAgreements = 0;
+    unsigned long long topSymptoms = 0;
+    unsigned long long topAgreements = 0;
+    unsigned long long exactSymptoms = 0;
+    unsigned long long exactMismatches = 0;
+    
+    BOOST_FOREACH(const Investigation& investigation, investigations)
+    {
+        SolvingMachine::Suggestion exact = exactMachine.makeSuggestion(investigation);
+        SolvingMachine::Suggestion approximate = approximateMachine.makeSuggestion(investigation);
+        
+        // both modes list the same symptoms in the same order
+        if(!approximate.approximate || approximate.symptoms.empty() || approximate.symptoms != exact.symptoms)
+            continue;
+        
+        ++approximated;
+        
+        std::vector<int> sortedExactValues(exact.symptomValues);
+        std::sort(sortedExactValues.begin(), sortedExactValues.end(), std::greater<int>());
+        
+        std::vector<unsigned> order;
+        for(unsigned i = 0; i < approximate.symptoms.size(); ++i)
+            order.push_back(i);
+        
+        std::stable_sort(order.begin(), order.end(), DescendingValue(approximate.symptomValues));
+        
+        if(exact.symptomValues[order[0]] == sortedExactValues[0])
+            ++bestAgreements;
+        
+        unsigned depth = std::min<unsigned>(RANKING_DEPTH, order.size());
+        for(unsigned j = 0; j < depth; ++j)
+        {
+            if(exact.symptomValues[order[j]] >= sortedExactValues[depth - 1])
+                ++topAgreements;
+        }
+        
+        topSymptoms += depth;
+        
+        boost::unordered_map<Identifier, unsigned> positions;
+        for(unsigned i = 0; i < approximate.symptoms.size(); ++i)
+            positions[approximate.symptoms[i]] = i;
+        
+        BOOST_FOREACH(CIdentifier symptomID, approximate.exactSymptoms)
+        {
+            unsigned i = positions[symptomID];
+            if(approximate.symptomValues[i] != exact.symptomValues[i])
+                ++exactMismatches;
+        }
+        
+        exactSymptoms += approximate.exactSymptoms.size();
+    }
+    
+    printf("Approximate mode with %u exact symptoms: %u of %u suggestions approximated\n",
+           options.exactSymptoms, approximated, static_cast<unsigned>(investigations.size()));
+    
+    if(approximated == 0)
+        return;
+    
+    printf("Ranking agreement: best symptom %.1f%%, top %u symptoms %.1f%%, exact values differ for %llu of %llu symptoms\n",
+           100.0 * bestAgreements / approximated, RANKING_DEPTH, 100.0 * topAgreements / topSymptoms, exactMismatches, exactSymptoms);
+}
+
+/**
+ * Measures SolvingMachine::makeSuggestion over a synthetic knowledge base kept in memory
+ */
+int main(int argc, const char* argv[])
+{
+    KnowledgeGenerator::Parameters knowledgeParameters;
+    unsigned depth;
+    unsigned investigationCount;
+    unsigned repetitions;
+    unsigned readThreads;
+    SolvingMachine::Options options;
+    
+    po::variables_map optionsMap;
+    try
+    {
+        po::options_description allowedOptions(200, 100);
+        allowedOptions.add_options()
+            ("help,h", "Produce help message.")
+            ("depth", po::value<unsigned>(&depth)->default_value(2), "Optional. Positive symptoms in every investigation")
+            ("investigations", po::value<unsigned>(&investigationCount)->default_value(200),
+                "Optional. Different investigations suggested in every repetition")
+            ("repetitions", po::value<unsigned>(&repetitions)->default_value(10), "Optional. How many times all investigations are suggested")
+            ("approximate", po::value<unsigned>(&options.exactSymptoms)->default_value(0),
+                "Optional. Value only this many symptoms of a suggestion exactly (approximate mode) "
+                "and compare the rankings with exact suggestions. 0 values all symptoms exactly")
+            ("readThreads", po::value<unsigned>(&readThreads)->default_value(0),
+                "Optional. Read the knowledge with this many threads, independent lookups are then started together. "
+                "0 reads in the suggesting thread");
+        
+        KnowledgeGenerator::describeOptions(allowedOptions, knowledgeParameters);
+        
+        po::store(po::parse_command_line(argc, argv, allowedOptions), optionsMap, true);
+        
+        if (optionsMap.count("help"))
+        {
+            std::cout << allowedOptions << "\n";
+            return 1;
+        }
+        
+        po::notify(optionsMap);
+    }
+    catch(std::exception& e)
+    {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    
+    try
+    {
+        MemoryDataLayer dataLayer;
+        KnowledgeGenerator generator(knowledgeParameters);
+        std::vector<Investigation> investigations;
+        
+        double startTime = utils::getCurrentSeconds();
+        KnowledgeGenerator::Report report = generator.generate(dataLayer, true);
+        generator.generateInvestigations(investigationCount, depth, investigations);
+        
+        printf("Knowledge base: %u categories, %u problems, %u symptoms, %u solutions, %u symptom links and %u solution links "
+               "(generated in %.3f seconds)\n", report.categories, report.problems, report.symptoms, report.solutions,
+               report.symptomLinks, report.solutionLinks, utils::getCurrentSeconds() - startTime);
+        printf("Investigations: %u with up to %u positive symptoms, %u repetitions, %u read threads\n",
+               static_cast<unsigned>(investigations.size()), depth, repetitions, readThreads);
+        
+        if(investigations.empty())
+            return 0;
+        
+        AsyncDataLayerRead reader(dataLayer, readThreads);
+        if(readThreads > 0)
+            options.reader = &reader;
+        
+        SolvingMachine machine(dataLayer, options);
+        
+        std::vector<uint64_t> suggestionTimes; // of every single suggestion
+        std::vector<uint64_t> repetitionTimes; // average of each repetition
+        unsigned long long suggestionAllocations = 0;
+        unsigned long long suggestionBytes = 0;
+        unsigned long long suggestedObjects = 0; // keeps the results in use
+        
+        suggestionTimes.reserve(static_cast<size_t>(repetitions) * investigations.size());
+        
+        for(unsigned repetition = 0; repetition < repetitions; ++repetition)
+        {
+            uint64_t repetitionStart = utils::getMonotonicNanoseconds();
+            
+            BOOST_FOREACH(const Investigation& investigation, investigations)
+            {
+                unsigned long long startAllocations = allocationCount.get();
+                unsigned long long startBytes = allocationBytes.get();
+                uint64_t start = utils::getMonotonicNanoseconds();
+                
+                SolvingMachine::Suggestion suggestion = machine.makeSuggestion(investigation);
+                
+                suggestionTimes.push_back(utils::getMonotonicNanoseconds() - start);
+                suggestionAllocations += allocationCount.get() - startAllocations;
+                suggestionBytes += allocationBytes.get() - startBytes;
+                suggestedObjects += suggestion.problems.size() + suggestion.symptoms.size() + suggestion.solutions.size();
+            }
+            
+            repetitionTimes.push_back((utils::getMonotonicNanoseconds() - repetitionStart) / investigations.size());
+        }
+        
+        std::sort(suggestionTimes.begin(), suggestionTimes.end());
+        std::sort(repetitionTimes.begin(), repetitionTimes.end());
+        
+        uint64_t totalTime = 0;
+        BOOST_FOREACH(uint64_t time, suggestionTimes)
+        {
+            totalTime += time;
+        }
+        
+        double suggestions = suggestionTimes.size();
+        
+        printf("Suggestions: %.0f, suggested objects per suggestion: %.1f\n", suggestions, suggestedObjects / suggestions);
+        printf("ns/suggestion: mean %.0f, p50 %.0f, p90 %.0f, p99 %.0f, max %.0f\n", totalTime / suggestions,
+               percentile(suggestionTimes, 0.5), percentile(suggestionTimes, 0.9), percentile(suggestionTimes, 0.99),
+               static_cast<double>(suggestionTimes.back()));
+        printf("ns/suggestion across repetitions: min %.0f, median %.0f, max %.0f\n",
+               static_cast<double>(repetitionTimes.front()), percentile(repetitionTimes, 0.5), static_cast<double>(repetitionTimes.back()));
+        printf("allocations/suggestion: %.1f, allocated bytes/suggestion: %.0f\n", suggestionAllocations / suggestions, suggestionBytes / suggestions);
+        
+        if(options.exactSymptoms > 0)
+            printRankingAgreement(dataLayer, investigations, options);
+    }
+    catch(std::exception& e)
+    {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    
+    return 0;
+}
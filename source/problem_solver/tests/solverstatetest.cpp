@@ -0,0 +1,375 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "memorydatalayer.h"
+#include "solvingmachine.h"
+#include "knowledgegenerator.h"
+
+#include <stdio.h>
+#include <map>
+#include <iostream>
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/program_options.hpp>
+
+using namespace ProblemSolver;
+namespace po = boost::program_options;
+
+typedef std::map<Identifier, int> ValueMap;
+typedef boost::unordered_set<Identifier> CategorySet;
+
+/**
+ * The order of the objects of a suggestion depends on the order they were added to the state, so only the values are compared
+ */
+static ValueMap getValues(const std::vector<Identifier>& ids, const std::vector<int>& values)
+{
+    ValueMap result;
+    for(unsigned i = 0; i < ids.size() && i < values.size(); ++i)
+        result[ids[i]] = values[i];
+    
+    return result;
+}
+
+static bool compareValues(const std::vector<Identifier>& ids, const std::vector<int>& values,
+                          const std::vector<Identifier>& expectedIDs, const std::vector<int>& expectedValues, const char* objectName)
+{
+    ValueMap result = getValues(ids, values);
+    ValueMap expected = getValues(expectedIDs, expectedValues);
+    
+    if(ids.size() != expectedIDs.size() || result.size() != ids.size())
+    {
+        printf("Error: %u %s suggested instead of %u\n", static_cast<unsigned>(ids.size()), objectName,
+               static_cast<unsigned>(expectedIDs.size()));
+        return false;
+    }
+    
+    BOOST_FOREACH(const ValueMap::value_type& pair, expected)
+    {
+        ValueMap::const_iterator found = result.find(pair.first);
+        if(found == result.end())
+        {
+            printf("Error: %s %s not suggested\n", objectName, pair.first.toString().c_str());
+            return false;
+        }
+        
+        if(found->second != pair.second)
+        {
+            printf("Error: %s %s has value %d instead of %d\n", objectName, pair.first.toString().c_str(), found->second, pair.second);
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+static bool compareSuggestions(const SolvingMachine::Suggestion& incremental, const SolvingMachine::Suggestion& fresh)
+{
+    return incremental.partial == fresh.partial &&
+           compareValues(incremental.symptoms, incremental.symptomValues, fresh.symptoms, fresh.symptomValues, "symptom") &&
+           compareValues(incremental.problems, incremental.problemValues, fresh.problems, fresh.problemValues, "problem") &&
+           compareValues(incremental.solutions, incremental.solutionValues, fresh.solutions, fresh.solutionValues, "solution");
+}
+
+/**
+ * Returns the first suggested object that is not in excluded, the suggestions list the best objects first
+ */
+static Identifier pickSuggested(const std::vector<Identifier>& suggested, const IdentifierList& excluded, unsigned skip = 0)
+{
+    BOOST_FOREACH(CIdentifier id, suggested)
+    {
+        if(excluded.contains(id))
+            continue;
+        
+        if(skip-- == 0)
+            return id;
+    }
+    
+    return Identifier();
+}
+
+/**
+ * Returns the first suggested problem that is not in excluded and has one of the categories.
+ * A checked problem of another category branch than the positive symptoms leaves the investigation without a branch.
+ */
+static Identifier pickSuggested(const std::vector<Identifier>& suggested, const IdentifierList& excluded,
+                                const ProblemMap& problems, const CategorySet& categories)
+{
+    BOOST_FOREACH(CIdentifier id, suggested)
+    {
+        ProblemMap::const_iterator problem = problems.find(id);
+        if(!excluded.contains(id) && problem != problems.end() && categories.find(problem->second.categoryID) != categories.end())
+            return id;
+    }
+    
+    return Identifier();
+}
+
+/**
+ * Counts what kind of updates the states went through, so the test fails if a path was never taken
+ */
+struct Coverage
+{
+    Coverage():
+        steps(0), allProblemsSteps(0), branchChanges(0), unbannedProblems(0){}
+    
+    unsigned steps;
+    unsigned allProblemsSteps;
+    unsigned branchChanges;
+    unsigned unbannedProblems;
+};
+
+/**
+ * Changes the investigation one event at a time, as a client would, and compares the suggestion made from the state
+ * kept since the first event with a suggestion made from scratch after every event.
+ * A suggestion needs a checked object, the investigation starts with a negative symptom of the root category.
+ */
+static bool testInvestigation(SolvingMachine& machine, const Investigation& target, const std::vector<Identifier>& positiveSymptoms,
+                              CIdentifier rootSymptomID, const ProblemMap& problems, const CategorySet& targetCategories,
+                              Coverage& coverage)
+{
+    Investigation investigation;
+    investigation.id = target.id;
+    
+    SolvingMachine::State state;
+    SolvingMachine::Suggestion suggestion;
+    unsigned previousBranchSize = 0;
+    Identifier bannedProblem;
+    
+    // the positive symptoms come last, so the first steps have no candidate problems and suggest from all problems
+    for(unsigned step = 0; step < 2 + 3 * positiveSymptoms.size(); ++step)
+    {
+        if(step == 0)
+        {
+            investigation.negativeSymptoms.push_back(rootSymptomID);
+        }
+        else if(step == 1)
+        {
+            Identifier symptomID = pickSuggested(suggestion.symptoms, target.positiveSymptoms);
+            if(!symptomID.empty())
+                investigation.bannedSymptoms.push_back(symptomID);
+        }
+        else
+        {
+            unsigned event = (step - 2) % 3;
+            if(event == 0)
+            {
+                investigation.positiveSymptoms.push_back(positiveSymptoms[(step - 2) / 3]);
+            }
+            else if(event == 1)
+            {
+                // a banned symptom is not loaded, it only leaves the suggestion
+                Identifier symptomID = pickSuggested(suggestion.symptoms, target.positiveSymptoms);
+                if(!symptomID.empty())
+                    investigation.bannedSymptoms.push_back(symptomID);
+                
+                // a problem banned at one step is a subject again at the next one
+                if(!bannedProblem.empty())
+                {
+                    investigation.bannedProblems.remove(bannedProblem);
+                    bannedProblem.clear();
+                    ++coverage.unbannedProblems;
+                }
+                else
+                {
+                    bannedProblem = pickSuggested(suggestion.problems, investigation.negativeProblems, 1);
+                    if(!bannedProblem.empty())
+                        investigation.bannedProblems.push_back(bannedProblem);
+                }
+            }
+            else
+            {
+                Identifier problemID = pickSuggested(suggestion.problems, investigation.bannedProblems, problems, targetCategories);
+                if(!problemID.empty())
+                    investigation.negativeProblems.push_back(problemID);
+            }
+        }
+        
+        suggestion = machine.makeSuggestion(investigation, state);
+        SolvingMachine::Suggestion fresh = machine.makeSuggestion(investigation);
+        
+        ++coverage.steps;
+        
+        if(state.allProblems)
+            ++coverage.allProblemsSteps;
+        
+        if(previousBranchSize != 0 && state.categoryBranch.size() != previousBranchSize)
+            ++coverage.branchChanges;
+        
+        previousBranchSize = state.categoryBranch.size();
+        
+        if(!compareSuggestions(suggestion, fresh))
+        {
+            printf("Error: investigation %s differs from a fresh suggestion after step %u (%u positive, %u negative and %u banned symptoms, "
+                   "%u negative and %u banned problems)\n", investigation.id.toString().c_str(), step,
+                   static_cast<unsigned>(investigation.positiveSymptoms.size()), static_cast<unsigned>(investigation.negativeSymptoms.size()),
+                   static_cast<unsigned>(investigation.bannedSymptoms.size()), static_cast<unsigned>(investigation.negativeProblems.size()),
+                   static_cast<unsigned>(investigation.bannedProblems.size()));
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/**
+ * Orders the symptoms by the depth of their category, the root first.
+ * Each deeper category narrows the category branch of the investigation, so the state must be built again.
+ */
+struct CategoryDepthOrder
+{
+    CategoryDepthOrder(const SymptomMap& symptoms, const CategoryMap& categories):
+        symptoms(symptoms), categories(categories){}
+    
+    unsigned getDepth(CIdentifier symptomID) const
+    {
+        unsigned depth = 0;
+        
+        SymptomMap::const_iterator symptom = symptoms.find(symptomID);
+        if(symptom == symptoms.end())
+            return depth;
+        
+        CategoryMap::const_iterator category = categories.find(symptom->second.categoryID);
+        while(category != categories.end() && !category->second.parent.empty())
+        {
+            ++depth;
+            category = categories.find(category->second.parent);
+        }
+        
+        return depth;
+    }
+    
+    /**
+     * Adds the category of the symptom and all categories above it
+     */
+    void addCategories(CIdentifier symptomID, CategorySet& result) const
+    {
+        SymptomMap::const_iterator symptom = symptoms.find(symptomID);
+        if(symptom == symptoms.end())
+            return;
+        
+        CategoryMap::const_iterator category = categories.find(symptom->second.categoryID);
+        while(category != categories.end())
+        {
+            result.insert(category->first);
+            category = categories.find(category->second.parent);
+        }
+    }
+    
+    bool operator () (CIdentifier first, CIdentifier second) const { return getDepth(first) < getDepth(second); }
+    
+    const SymptomMap& symptoms;
+    const CategoryMap& categories;
+};
+
+/**
+ * Checks that suggestions made from a SolvingMachine::State kept across the events of an investigation
+ * are the same as suggestions made from scratch, over a synthetic knowledge base kept in memory
+ */
+int main(int argc, const char* argv[])
+{
+    KnowledgeGenerator::Parameters knowledgeParameters;
+    unsigned depth;
+    unsigned investigationCount;
+    
+    po::variables_map optionsMap;
+    try
+    {
+        po::options_description allowedOptions(200, 100);
+        allowedOptions.add_options()
+            ("help,h", "Produce help message.")
+            ("depth", po::value<unsigned>(&depth)->default_value(5), "Optional. Positive symptoms added to every investigation")
+            ("investigations", po::value<unsigned>(&investigationCount)->default_value(50), "Optional. Investigations replayed");
+        
+        KnowledgeGenerator::describeOptions(allowedOptions, knowledgeParameters);
+        
+        po::store(po::parse_command_line(argc, argv, allowedOptions), optionsMap, true);
+        
+        if (optionsMap.count("help"))
+        {
+            std::cout << allowedOptions << "\n";
+            return 1;
+        }
+        
+        po::notify(optionsMap);
+    }
+    catch(std::exception& e)
+    {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    
+    try
+    {
+        MemoryDataLayer dataLayer;
+        KnowledgeGenerator generator(knowledgeParameters);
+        std::vector<Investigation> investigations;
+        
+        generator.generate(dataLayer, true);
+        generator.generateInvestigations(investigationCount, depth, investigations);
+        
+        CategoryMap categories;
+        dataLayer.get(std::vector<Identifier>(), categories);
+        
+        SymptomMap symptoms;
+        dataLayer.get(std::vector<Identifier>(), symptoms);
+        
+        ProblemMap problems;
+        dataLayer.get(std::vector<Identifier>(), problems);
+        
+        CategoryDepthOrder depthOrder(symptoms, categories);
+        
+        std::vector<Identifier> rootSymptoms;
+        BOOST_FOREACH(const SymptomMap::value_type& pair, symptoms)
+        {
+            if(depthOrder.getDepth(pair.first) == 0)
+                rootSymptoms.push_back(pair.first);
+        }
+        
+        std::sort(rootSymptoms.begin(), rootSymptoms.end());
+        
+        SolvingMachine machine(dataLayer);
+        Coverage coverage;
+        
+        printf("Testing incremental suggestions of %u investigations...\n", static_cast<unsigned>(investigations.size()));
+        
+        BOOST_FOREACH(const Investigation& investigation, investigations)
+        {
+            std::vector<Identifier> positiveSymptoms(investigation.positiveSymptoms.getItems());
+            std::stable_sort(positiveSymptoms.begin(), positiveSymptoms.end(), depthOrder);
+            
+            Identifier rootSymptomID = pickSuggested(rootSymptoms, investigation.positiveSymptoms);
+            if(rootSymptomID.empty())
+                continue;
+            
+            // the deepest positive symptom has the narrowest category branch
+            CategorySet targetCategories;
+            if(!positiveSymptoms.empty())
+                depthOrder.addCategories(positiveSymptoms.back(), targetCategories);
+            
+            if(!testInvestigation(machine, investigation, positiveSymptoms, rootSymptomID, problems, targetCategories, coverage))
+                return 1;
+        }
+        
+        printf("%u suggestions compared, %u of all problems, %u after a category branch change, %u after an unbanned problem\n",
+               coverage.steps, coverage.allProblemsSteps, coverage.branchChanges, coverage.unbannedProblems);
+        
+        if(!investigations.empty() && (coverage.allProblemsSteps == 0 || coverage.branchChanges == 0 || coverage.unbannedProblems == 0))
+        {
+            printf("Error: the investigations did not cover all kinds of state updates\n");
+            return 1;
+        }
+    }
+    catch(std::exception& e)
+    {
+        printf("Error: %s\n", e.what());
+        return 1;
+    }
+    
+    printf("Incremental suggestions OK!\n");
+    return 0;
+}
@@ -83,7 +83,7 @@ bool testSaveLoadObject(T& testObject, const std::string& objectName, DummyRemot
     ptree jsonTree;
     json_parser::read_json(jsonStream, jsonTree);
     
-    std::string newID = jsonTree.get<std::string>("result");
+    Identifier newID = jsonTree.get<Identifier>("result");
     
     T newTestObject = testObject;
     newTestObject.id = newID;
@@ -94,7 +94,7 @@ bool testSaveLoadObject(T& testObject, const std::string& objectName, DummyRemot
     queryGet += "\"RequestType\" : \"database\", ";
     queryGet += "\"ObjectType\" : \"" + objectName + "\", ";
     queryGet += "\"operation\" : \"get\", ";
-    queryGet += "\"ids\" : [\"" + newID + "\"] }";
+    queryGet += "\"ids\" : [\"" + newID.toString() + "\"] }";
     
     std::string responseGet = dummyManager.testRequest(queryGet);
     printf("Get %s result: %s\n", objectName.c_str(), responseGet.c_str());
@@ -120,6 +120,42 @@ bool testSaveLoadObject(T& testObject, const std::string& objectName, DummyRemot
     return true;
 }
 
+template<class T>
+bool testGetAll(const T& testObject, const std::string& objectName, DummyRemoteManager& dummyManager)
+{
+    JsonDeserializer deserializer;
+    
+    // small batches make sure objects are streamed in more than one part
+    std::string queryGet = "\n\n{ ";
+    queryGet += "\"RequestType\" : \"database\", ";
+    queryGet += "\"ObjectType\" : \"" + objectName + "\", ";
+    queryGet += "\"operation\" : \"get\", ";
+    queryGet += "\"batchSize\" : 1, ";
+    queryGet += "\"ids\" : [] }";
+    
+    std::string responseGet = dummyManager.testRequest(queryGet);
+    printf("Get all %s result: %s\n", objectName.c_str(), responseGet.c_str());
+    
+    std::stringstream jsonStreamGet;
+    jsonStreamGet << responseGet;
+    ptree jsonTreeGet;
+    json_parser::read_json(jsonStreamGet, jsonTreeGet);
+    
+    BOOST_FOREACH(const ptree::value_type& value, jsonTreeGet.get_child("result"))
+    {
+        T testObjectResult;
+        deserializer.deserialize(value.second, true, testObjectResult);
+        if(testObject == testObjectResult)
+        {
+            printf("Get all %s OK!\n", objectName.c_str());
+            return true;
+        }
+    }
+    
+    printf("Error get all %s!\n", objectName.c_str());
+    return false;
+}
+
 bool testSearch(const std::string& phrase, CIdentifier identifier, DummyRemoteManager& dummyManager)
 {
     std::string query = "\n\n{";
@@ -138,7 +174,7 @@ bool testSearch(const std::string& phrase, CIdentifier identifier, DummyRemoteMa
     ptree node = jsonTree.get_child("symptoms");
     BOOST_FOREACH(const ptree::value_type& value, node)
     {
-        if(identifier == value.second.get_value<std::string>())
+        if(identifier == value.second.get_value<Identifier>())
         {
             printf("Search '%s' OK!\n", phrase.c_str());
             return true;
@@ -152,17 +188,17 @@ bool testSearch(const std::string& phrase, CIdentifier identifier, DummyRemoteMa
 int main(int argc, const char* argv[])
 {
     Category testCategory;
-    testCategory.id = "testCategoryID";
+    testCategory.id = Identifier("00000000000000000000a001");
     testCategory.name = "testCategoryName";
     testCategory.description = "testCategoryDescription";
-    testCategory.parent = "testCategoryParent";
-    testCategory.childs.push_back("testCategoryChild1");
-    testCategory.childs.push_back("testCategoryChild2");
-    testCategory.childs.push_back("testCategoryChild3");
+    testCategory.parent = Identifier("00000000000000000000a002");
+    testCategory.childs.push_back(Identifier("00000000000000000000a003"));
+    testCategory.childs.push_back(Identifier("00000000000000000000a004"));
+    testCategory.childs.push_back(Identifier("00000000000000000000a005"));
 
     ExtendedSymptom testSymptom;
-    testSymptom.id = "testID";
-    testSymptom.categoryID = "testCategoryID";
+    testSymptom.id = Identifier("00000000000000000000a006");
+    testSymptom.categoryID = Identifier("00000000000000000000a001");
     testSymptom.difficulty = difficultyManyTimesAndStillNotEasy;
     testSymptom.confirmed = false;
     testSymptom.name = "testName";
@@ -175,8 +211,8 @@ int main(int argc, const char* argv[])
     testSymptom.steps.push_back("testStep1");
     
     ExtendedProblem testProblem;
-    testProblem.id = "testID123";
-    testProblem.categoryID = "testCategoryID";
+    testProblem.id = Identifier("00000000000000000000a007");
+    testProblem.categoryID = Identifier("00000000000000000000a001");
     testProblem.difficulty = difficultyManyTimesAndStillNotEasy;
     testProblem.confirmed = false;
     testProblem.name = "testNameProblem";
@@ -189,8 +225,8 @@ int main(int argc, const char* argv[])
     testProblem.steps.push_back("testStep32");
     
     ExtendedSolution testSolution;
-    testSolution.id = "testID123111";
-    testSolution.categoryID = "testCategoryID";
+    testSolution.id = Identifier("00000000000000000000a008");
+    testSolution.categoryID = Identifier("00000000000000000000a001");
     testSolution.difficulty = difficultyManyTimesAndStillNotEasy;
     testSolution.confirmed = false;
     testSolution.name = "testNameSolution";
@@ -203,38 +239,38 @@ int main(int argc, const char* argv[])
     testSolution.steps.push_back("testStep132");
     
     SymptomLink testSymptomLink;
-    testSymptomLink.id = "testSymptomLink";
-    testSymptomLink.problemID = "testID123";
-    testSymptomLink.symptomID = "testID";
+    testSymptomLink.id = Identifier("00000000000000000000a009");
+    testSymptomLink.problemID = Identifier("00000000000000000000a007");
+    testSymptomLink.symptomID = Identifier("00000000000000000000a006");
     testSymptomLink.positiveChecks = 12;
     testSymptomLink.falsePositiveChecks = 10;
     testSymptomLink.negativeChecks = 5;
     testSymptomLink.confirmed = false;
     
     SolutionLink testSolutionLink;
-    testSolutionLink.id = "testSolutionLink";
-    testSolutionLink.problemID = "testID123";
-    testSolutionLink.solutionID = "testID123111";
+    testSolutionLink.id = Identifier("00000000000000000000a00a");
+    testSolutionLink.problemID = Identifier("00000000000000000000a007");
+    testSolutionLink.solutionID = Identifier("00000000000000000000a008");
     testSolutionLink.positive = 12;
     testSolutionLink.negative = 10;
     testSolutionLink.confirmed = false;
     
     Investigation testInvestigation;
-    testInvestigation.id = "testIDinvestigation";
+    testInvestigation.id = Identifier("00000000000000000000a00b");
     testInvestigation.closed = true;
-    testInvestigation.positiveProblem = "testPositive";
-    testInvestigation.positiveSolution = "";
-    testInvestigation.positiveSymptoms.push_back("testSym24");
-    testInvestigation.positiveSymptoms.push_back("testSym21");
-    testInvestigation.positiveSymptoms.push_back("testSym22");
-    testInvestigation.negativeSymptoms.push_back("testSym24");
-    testInvestigation.negativeSymptoms.push_back("testSym21");
-    testInvestigation.bannedSymptoms.push_back("bannedSym");
-    testInvestigation.negativeProblems.push_back("testS23424");
-    testInvestigation.negativeProblems.push_back("testS23421");
-    testInvestigation.bannedProblems.push_back("bannedPro");
-    testInvestigation.negativeSolutions.push_back("123testS23424");
-    testInvestigation.bannedSolutions.push_back("bannedSol");
+    testInvestigation.positiveProblem = Identifier("00000000000000000000a00c");
+    testInvestigation.positiveSolution.clear();
+    testInvestigation.positiveSymptoms.push_back(Identifier("00000000000000000000a00d"));
+    testInvestigation.positiveSymptoms.push_back(Identifier("00000000000000000000a00e"));
+    testInvestigation.positiveSymptoms.push_back(Identifier("00000000000000000000a00f"));
+    testInvestigation.negativeSymptoms.push_back(Identifier("00000000000000000000a00d"));
+    testInvestigation.negativeSymptoms.push_back(Identifier("00000000000000000000a00e"));
+    testInvestigation.bannedSymptoms.push_back(Identifier("00000000000000000000a010"));
+    testInvestigation.negativeProblems.push_back(Identifier("00000000000000000000a011"));
+    testInvestigation.negativeProblems.push_back(Identifier("00000000000000000000a012"));
+    testInvestigation.bannedProblems.push_back(Identifier("00000000000000000000a013"));
+    testInvestigation.negativeSolutions.push_back(Identifier("00000000000000000000a014"));
+    testInvestigation.bannedSolutions.push_back(Identifier("00000000000000000000a015"));
     
     // test JSON serialization
     printf("Testing JSON serialization...\n");
@@ -288,6 +324,14 @@ int main(int argc, const char* argv[])
         return 1;
     
     
+    // test streamed get of all objects
+    printf("Testing get all...\n");
+    if(!testGetAll(testSymptom, "symptom", dummyManager))
+        return 1;
+    
+    if(!testGetAll(testSymptomLink, "symptomLink", dummyManager))
+        return 1;
+    
     // test search
     printf("Testing search...\n");
     if(!testSearch("testTag3", testSymptom.id, dummyManager))
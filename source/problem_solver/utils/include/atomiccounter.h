@@ -0,0 +1,40 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace utils
+{
+
+/**
+ * Counter that many threads can increment at once without locks
+ */
+class AtomicCounter
+{
+public:
+    
+    AtomicCounter():
+        _value(0){}
+    
+public:
+    
+    /**
+     * Return the value after the change
+     */
+    uint64_t add(uint64_t count = 1) { return __sync_add_and_fetch(&_value, count); }
+    uint64_t subtract(uint64_t count = 1) { return __sync_sub_and_fetch(&_value, count); }
+    
+    uint64_t get() const { return __sync_fetch_and_add(&_value, 0); }
+    
+private:
+    
+    mutable uint64_t _value;
+};
+
+} // namespace utils
@@ -0,0 +1,166 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <deque>
+#include <vector>
+#include <ucontext.h>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace utils
+{
+
+/**
+ * Runs many fibers (coroutines with their own stacks) on one thread.
+ * A fiber that waits for a socket or for work done by another thread is suspended and the thread runs
+ * the other fibers meanwhile. The loop waits with epoll for the sockets and for the fibers resumed by other threads.
+ * A fiber stays on the thread of its scheduler, so the thread locals of other code are shared by all fibers of the
+ * thread, the ones that must belong to a fiber are registered with addLocal.
+ * A fiber must not block its thread on a lock that another fiber of the thread can hold while it is suspended,
+ * and it must not suspend while it handles an exception.
+ */
+class FiberScheduler
+{
+public:
+    
+    static const unsigned DEFAULT_STACK_SIZE = 256 * 1024; // bytes
+    
+public:
+    
+    explicit FiberScheduler(unsigned stackSize = DEFAULT_STACK_SIZE);
+    ~FiberScheduler();
+    
+private:
+    
+    struct Fiber;
+    
+public:
+    
+    /**
+     * The running fiber, used by another thread to resume it after it suspends
+     */
+    class Handle
+    {
+    public:
+        
+        Handle():
+            _scheduler(NULL), _fiber(NULL){}
+        
+        bool isEmpty() const { return _fiber == NULL; }
+        
+        /**
+         * Thread safe, the fiber runs again after it suspends. Every suspend needs its own resume
+         */
+        void resume() const;
+        
+    private:
+        
+        friend class FiberScheduler;
+        
+        FiberScheduler* _scheduler;
+        Fiber* _fiber;
+    };
+    
+    /**
+     * Exchanges the value of a thread local variable with the value saved for a fiber. Every fiber starts with 0
+     */
+    typedef void (*SwapLocal)(uint64_t& saved);
+    
+    /**
+     * Must be called before any fiber is started, usually by the initialization of a static variable
+     */
+    static bool addLocal(SwapLocal swap);
+    
+public:
+    
+    /**
+     * Thread safe. The body runs as a new fiber of this scheduler
+     */
+    void spawn(const boost::function<void ()>& body);
+    
+    /**
+     * Runs the fibers in the calling thread until stop is called and all fibers have finished
+     */
+    void run();
+    
+    /**
+     * Thread safe. The fibers still running are not interrupted
+     */
+    void stop();
+    
+public:
+    
+    /**
+     * These work on the fiber running in the calling thread
+     */
+    static bool isInFiber();
+    static Handle getRunning();
+    
+    /**
+     * Suspends the running fiber until its handle is resumed
+     */
+    static void suspend();
+    
+    /**
+     * Lets the other fibers of the thread run before the running fiber continues
+     */
+    static void yield();
+    
+    /**
+     * Suspend the running fiber until the descriptor can be read or written, or until the deadline in monotonic
+     * nanoseconds passes, 0 waits without a deadline. The caller finds out which one happened by trying again.
+     * Return false right away when the calling thread is not running a fiber or the descriptor can not be watched.
+     */
+    static bool waitReadable(int descriptor, uint64_t deadline = 0);
+    static bool waitWritable(int descriptor, uint64_t deadline = 0);
+    
+private:
+    
+    typedef std::multimap<uint64_t, Fiber*> Timers;
+    
+    static void startFiber();
+    static bool waitDescriptor(int descriptor, uint32_t events, uint64_t deadline);
+    
+    int getEpollTimeout() const;
+    void takeExpiredTimers();
+    
+    void switchTo(Fiber* fiber);
+    void switchToLoop();
+    void takeInbox();
+    void wake();
+    void destroy(Fiber* fiber);
+    
+    static std::vector<SwapLocal>& getLocals();
+    
+private:
+    
+    unsigned _stackSize;
+    
+    int _epoll;
+    int _wakeEvent; // eventfd, written when the inbox gets a fiber
+    
+    ucontext_t _loopContext;
+    Fiber* _running;
+    
+    std::deque<Fiber*> _ready;
+    unsigned _fiberCount;
+    
+    Timers _timers; // of the fibers waiting for a descriptor with a deadline
+    
+    // filled by other threads
+    std::vector<Fiber*> _inbox;
+    bool _stopped;
+    boost::mutex _inboxMutex;
+    
+    static __thread FiberScheduler* _threadScheduler; // of the thread running a fiber, NULL in the loop and other threads
+};
+
+} // namespace utils
@@ -0,0 +1,64 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "fiberscheduler.h"
+#include "atomiccounter.h"
+
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+namespace utils
+{
+
+/**
+ * Shared mutex that fibers and threads can lock together, it works with boost::unique_lock and boost::shared_lock.
+ * A thread blocks on it as on a boost::shared_mutex. A fiber must not block its thread while another fiber of the
+ * thread can hold the mutex, so it is suspended until an unlock resumes it, and the other fibers run meanwhile.
+ * Fibers that need the mutex alone keep new fibers from sharing it, or a steady stream of shared fibers would never
+ * let them in.
+ */
+class FiberSharedMutex
+{
+public:
+    
+    FiberSharedMutex():
+        _generation(0){}
+    
+public:
+    
+    void lock();
+    bool try_lock();
+    void unlock();
+    
+    void lock_shared();
+    bool try_lock_shared();
+    void unlock_shared();
+    
+private:
+    
+    /**
+     * Suspends the fiber until the next unlock, unless there was an unlock since the generation was read
+     */
+    void waitUnlock(uint64_t generation);
+    void resumeWaiting();
+    
+    uint64_t getGeneration();
+    
+private:
+    
+    boost::shared_mutex _mutex;
+    AtomicCounter _fibersWaitingAlone;
+    
+    boost::mutex _waitingMutex;
+    std::vector<FiberScheduler::Handle> _waiting;
+    uint64_t _generation; // of the unlocks, guarded by _waitingMutex
+};
+
+} // namespace utils
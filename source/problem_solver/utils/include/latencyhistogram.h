@@ -0,0 +1,101 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace utils
+{
+
+/**
+ * Counts values (usually latencies in nanoseconds) in logarithmic buckets with fixed relative precision,
+ * so percentiles of millions of values can be taken without keeping the values.
+ * Values below SUB_BUCKET_COUNT are exact, bigger ones are rounded to about 1.5%.
+ * Not thread safe, keep one histogram per thread and add them together at the end.
+ */
+class LatencyHistogram
+{
+public:
+    
+    static const unsigned SUB_BUCKET_BITS = 7;
+    static const unsigned SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const unsigned HALF_SUB_BUCKET_COUNT = SUB_BUCKET_COUNT / 2;
+    
+public:
+    
+    LatencyHistogram();
+    ~LatencyHistogram(){}
+    
+public:
+    
+    void record(uint64_t value);
+    
+    /**
+     * Adds all values recorded in other
+     */
+    void add(const LatencyHistogram& other);
+    
+    void clear();
+    
+    uint64_t getCount() const { return _count; }
+    uint64_t getMin() const { return _count > 0 ? _min : 0; }
+    uint64_t getMax() const { return _max; }
+    double getMean() const;
+    
+    /**
+     * Returns the highest value of the bucket that holds the value at fraction (0.5 for the median)
+     * of the recorded values, never more than the biggest recorded value
+     */
+    uint64_t getPercentile(double fraction) const;
+    
+private:
+    
+    static unsigned getBucket(uint64_t value);
+    static uint64_t getBucketEnd(unsigned bucket);
+    
+private:
+    
+    std::vector<uint64_t> _counts;
+    
+    uint64_t _count;
+    uint64_t _total;
+    uint64_t _min;
+    uint64_t _max;
+    
+    friend class ConcurrentLatencyHistogram;
+};
+
+/**
+ * LatencyHistogram that many threads can record to at once without locks (with atomic increments).
+ * The values are read through a snapshot, values recorded while it is taken may be partly included.
+ */
+class ConcurrentLatencyHistogram
+{
+public:
+    
+    ConcurrentLatencyHistogram();
+    ~ConcurrentLatencyHistogram(){}
+    
+public:
+    
+    void record(uint64_t value);
+    
+    void getSnapshot(LatencyHistogram& result) const;
+    
+private:
+    
+    mutable std::vector<uint64_t> _counts;
+    
+    mutable uint64_t _count;
+    mutable uint64_t _total;
+    mutable uint64_t _min;
+    mutable uint64_t _max;
+};
+
+} // namespace utils
@@ -0,0 +1,112 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#pragma once
+
+#include "atomiccounter.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string>
+#include <boost/thread/thread.hpp>
+
+namespace utils
+{
+
+enum LogLevel
+{
+    logDebug = 0,
+    logInfo = 1,
+    logWarning = 2,
+    logError = 3
+};
+
+/**
+ * Leveled logger that keeps the output away from the threads that log.
+ * A message is formatted into a slot of a lock free ring buffer and a background thread writes the slots
+ * as lines "<date> <time> <LEVEL> [<thread id>] <message>". When the buffer is full messages are dropped
+ * (and counted) instead of waiting for the output.
+ * Until start is called, or after stop, messages are written directly to stdout.
+ * Stop must not be called while other threads still log.
+ */
+class Logger
+{
+public:
+    
+    static const unsigned DEFAULT_CAPACITY = 1024; // messages, rounded up to a power of two
+    static const unsigned MAX_MESSAGE_SIZE = 4096; // longer messages are cut
+    
+public:
+    
+    /**
+     * Starts the background writer, messages below level are skipped
+     */
+    static void start(LogLevel level, unsigned capacity = DEFAULT_CAPACITY, FILE* output = stdout);
+    
+    /**
+     * Writes all buffered messages and stops the background writer
+     */
+    static void stop();
+    
+    static void setLevel(LogLevel level) { _level = level; }
+    static bool isEnabled(LogLevel level) { return level >= _level; }
+    
+    static void log(LogLevel level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+    
+    /**
+     * Returns the number of messages dropped because the buffer was full
+     */
+    static uint64_t getDroppedCount() { return _dropped.get(); }
+    
+    /**
+     * Parses "debug", "info", "warning" or "error", returns false for other names
+     */
+    static bool parseLevel(const std::string& name, LogLevel& result);
+    
+private:
+    
+    struct Record
+    {
+        volatile uint64_t sequence; // position + 1 when the record is ready to be written
+        LogLevel level;
+        int threadID;
+        double time;
+        char message[MAX_MESSAGE_SIZE];
+    };
+    
+private:
+    
+    Logger(unsigned capacity, FILE* output);
+    ~Logger();
+    
+    void push(LogLevel level, const char* format, va_list arguments);
+    
+    void writeLoop();
+    bool writeRecords();
+    
+    static void writeLine(FILE* output, LogLevel level, int threadID, double time, const char* message);
+    
+private:
+    
+    Record* _records;
+    uint64_t _mask;
+    
+    volatile uint64_t _pushPosition;
+    uint64_t _writePosition; // used only by the writer thread
+    
+    FILE* _output;
+    uint64_t _reportedDropped;
+    
+    volatile bool _stopping;
+    boost::thread _writer;
+    
+    static Logger* _logger;
+    static volatile LogLevel _level;
+    static AtomicCounter _dropped;
+};
+
+} // namespace utils
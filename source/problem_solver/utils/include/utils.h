@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 namespace utils
 {
 
@@ -22,4 +24,19 @@ bool contains(const T& container, const Y& element)
     return false;
 }
 
+/**
+ * Returns the resident memory of the current process in bytes or 0 if it can not be determined
+ */
+long getResidentMemory();
+
+/**
+ * Returns the current wall clock time in seconds with microsecond precision
+ */
+double getCurrentSeconds();
+
+/**
+ * Returns nanoseconds from a monotonic clock, only differences between two calls are meaningful
+ */
+uint64_t getMonotonicNanoseconds();
+
 } // namespace utils
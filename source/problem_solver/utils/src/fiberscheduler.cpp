@@ -0,0 +1,427 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "fiberscheduler.h"
+#include "logger.h"
+#include "utils.h"
+
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include <memory>
+#include <stdexcept>
+#include <boost/foreach.hpp>
+
+namespace utils
+{
+
+struct FiberScheduler::Fiber
+{
+    Fiber():
+        memory(NULL), memorySize(0), started(false), finished(false), waitedDescriptor(-1), hasTimer(false){}
+    
+    boost::function<void ()> body;
+    ucontext_t context;
+    
+    char* memory; // the stack with a guard page below it
+    size_t memorySize;
+    
+    bool started;
+    bool finished;
+    
+    std::vector<uint64_t> locals; // saved values of the registered thread locals
+    
+    int waitedDescriptor;
+    bool hasTimer;
+    Timers::iterator timer; // valid if hasTimer
+};
+
+const unsigned FiberScheduler::DEFAULT_STACK_SIZE;
+
+__thread FiberScheduler* FiberScheduler::_threadScheduler = NULL;
+
+FiberScheduler::FiberScheduler(unsigned stackSize):
+    _stackSize(stackSize),
+    _running(NULL),
+    _fiberCount(0),
+    _stopped(false)
+{
+    _epoll = epoll_create(64);
+    _wakeEvent = eventfd(0, EFD_NONBLOCK);
+    
+    if(_epoll < 0 || _wakeEvent < 0)
+        throw std::runtime_error("FiberScheduler: ERROR creating the event loop");
+    
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    
+    if(epoll_ctl(_epoll, EPOLL_CTL_ADD, _wakeEvent, &event) != 0)
+        throw std::runtime_error("FiberScheduler: ERROR watching the wake event");
+}
+
+FiberScheduler::~FiberScheduler()
+{
+    // fibers that never started, run returns only when all started fibers have finished
+    BOOST_FOREACH(Fiber* fiber, _inbox)
+    {
+        if(!fiber->started)
+            destroy(fiber);
+    }
+    
+    close(_wakeEvent);
+    close(_epoll);
+}
+
+void FiberScheduler::Handle::resume() const
+{
+    {
+        boost::mutex::scoped_lock lock(_scheduler->_inboxMutex);
+        _scheduler->_inbox.push_back(_fiber);
+    }
+    
+    _scheduler->wake();
+}
+
+bool FiberScheduler::addLocal(SwapLocal swap)
+{
+    getLocals().push_back(swap);
+    return true;
+}
+
+std::vector<FiberScheduler::SwapLocal>& FiberScheduler::getLocals()
+{
+    static std::vector<SwapLocal> locals;
+    return locals;
+}
+
+void FiberScheduler::spawn(const boost::function<void ()>& body)
+{
+    std::auto_ptr<Fiber> fiber(new Fiber());
+    fiber->body = body;
+    fiber->locals.resize(getLocals().size(), 0);
+    
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    fiber->memorySize = (_stackSize + pageSize - 1) / pageSize * pageSize + pageSize;
+    
+    void* memory = mmap(NULL, fiber->memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(memory == MAP_FAILED)
+        throw std::runtime_error("FiberScheduler: ERROR allocating a fiber stack");
+    
+    fiber->memory = static_cast<char*>(memory);
+    
+    // a fiber that overflows its stack crashes instead of writing over other memory
+    mprotect(fiber->memory, pageSize, PROT_NONE);
+    
+    getcontext(&fiber->context);
+    fiber->context.uc_stack.ss_sp = fiber->memory + pageSize;
+    fiber->context.uc_stack.ss_size = fiber->memorySize - pageSize;
+    fiber->context.uc_link = &_loopContext; // the loop continues when the fiber returns
+    makecontext(&fiber->context, &FiberScheduler::startFiber, 0);
+    
+    {
+        boost::mutex::scoped_lock lock(_inboxMutex);
+        _inbox.push_back(fiber.release());
+    }
+    
+    wake();
+}
+
+void FiberScheduler::run()
+{
+    std::vector<epoll_event> events(64);
+    
+    while(true)
+    {
+        takeInbox();
+        
+        if(_ready.empty())
+        {
+            boost::mutex::scoped_lock lock(_inboxMutex);
+            
+            if(_stopped && _inbox.empty() && _fiberCount == 0)
+                break;
+        }
+        
+        int count = epoll_wait(_epoll, &events[0], events.size(), getEpollTimeout());
+        if(count < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            
+            Logger::log(logError, "FiberScheduler: ERROR waiting for events, %u fibers are dropped", _fiberCount);
+            break;
+        }
+        
+        for(int i = 0; i < count; ++i)
+        {
+            Fiber* fiber = static_cast<Fiber*>(events[i].data.ptr);
+            
+            if(fiber != NULL)
+            {
+                if(fiber->hasTimer)
+                {
+                    _timers.erase(fiber->timer);
+                    fiber->hasTimer = false;
+                }
+                
+                _ready.push_back(fiber);
+                continue;
+            }
+            
+            uint64_t value;
+            ssize_t bytesRead = read(_wakeEvent, &value, sizeof(value));
+            (void)bytesRead;
+        }
+        
+        takeExpiredTimers();
+        
+        // the fibers that become ready while these run wait for the next round, so the events are checked in between
+        size_t readyCount = _ready.size();
+        for(size_t i = 0; i < readyCount; ++i)
+        {
+            Fiber* fiber = _ready.front();
+            _ready.pop_front();
+            
+            switchTo(fiber);
+            
+            if(fiber->finished)
+            {
+                destroy(fiber);
+                --_fiberCount;
+            }
+        }
+    }
+}
+
+void FiberScheduler::stop()
+{
+    {
+        boost::mutex::scoped_lock lock(_inboxMutex);
+        _stopped = true;
+    }
+    
+    wake();
+}
+
+bool FiberScheduler::isInFiber()
+{
+    return _threadScheduler != NULL;
+}
+
+FiberScheduler::Handle FiberScheduler::getRunning()
+{
+    Handle handle;
+    
+    if(_threadScheduler != NULL)
+    {
+        handle._scheduler = _threadScheduler;
+        handle._fiber = _threadScheduler->_running;
+    }
+    
+    return handle;
+}
+
+void FiberScheduler::suspend()
+{
+    if(_threadScheduler == NULL)
+        throw std::logic_error("FiberScheduler: suspend called outside of a fiber");
+    
+    _threadScheduler->switchToLoop();
+}
+
+void FiberScheduler::yield()
+{
+    if(_threadScheduler == NULL)
+        return;
+    
+    FiberScheduler* scheduler = _threadScheduler;
+    scheduler->_ready.push_back(scheduler->_running);
+    scheduler->switchToLoop();
+}
+
+bool FiberScheduler::waitReadable(int descriptor, uint64_t deadline)
+{
+    return waitDescriptor(descriptor, EPOLLIN, deadline);
+}
+
+bool FiberScheduler::waitWritable(int descriptor, uint64_t deadline)
+{
+    return waitDescriptor(descriptor, EPOLLOUT, deadline);
+}
+
+/**
+ * The descriptor is watched only while the fiber waits, so it can be closed without removing it from epoll.
+ * The loop drops the timer when the descriptor is ready and stops watching the descriptor when the timer expires,
+ * so the fiber is resumed only once.
+ */
+bool FiberScheduler::waitDescriptor(int descriptor, uint32_t events, uint64_t deadline)
+{
+    FiberScheduler* scheduler = _threadScheduler;
+    if(scheduler == NULL)
+        return false;
+    
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events | EPOLLONESHOT;
+    event.data.ptr = scheduler->_running;
+    
+    if(epoll_ctl(scheduler->_epoll, EPOLL_CTL_ADD, descriptor, &event) != 0)
+        return false;
+    
+    Fiber* fiber = scheduler->_running;
+    fiber->waitedDescriptor = descriptor;
+    
+    if(deadline != 0)
+    {
+        fiber->timer = scheduler->_timers.insert(std::make_pair(deadline, fiber));
+        fiber->hasTimer = true;
+    }
+    
+    scheduler->switchToLoop();
+    
+    fiber->waitedDescriptor = -1;
+    
+    epoll_ctl(scheduler->_epoll, EPOLL_CTL_DEL, descriptor, &event);
+    return true;
+}
+
+/**
+ * Entry point of every fiber, it returns to the loop when the body returns
+ */
+void FiberScheduler::startFiber()
+{
+    Fiber* fiber = _threadScheduler->_running;
+    
+    try
+    {
+        fiber->body();
+    }
+    catch(std::exception& e)
+    {
+        Logger::log(logError, "FiberScheduler: ERROR fiber stopped by an exception: %s", e.what());
+    }
+    catch(...)
+    {
+        Logger::log(logError, "FiberScheduler: ERROR fiber stopped by an unknown exception");
+    }
+    
+    fiber->body = boost::function<void ()>();
+    fiber->finished = true;
+}
+
+/**
+ * Runs the fiber until it suspends or returns, with its own values of the registered thread locals
+ */
+void FiberScheduler::switchTo(Fiber* fiber)
+{
+    std::vector<SwapLocal>& locals = getLocals();
+    for(unsigned i = 0; i < locals.size(); ++i)
+    {
+        locals[i](fiber->locals[i]);
+    }
+    
+    _running = fiber;
+    _threadScheduler = this;
+    
+    swapcontext(&_loopContext, &fiber->context);
+    
+    _threadScheduler = NULL;
+    _running = NULL;
+    
+    for(unsigned i = 0; i < locals.size(); ++i)
+    {
+        locals[i](fiber->locals[i]);
+    }
+}
+
+void FiberScheduler::switchToLoop()
+{
+    swapcontext(&_running->context, &_loopContext);
+}
+
+/**
+ * Moves the new and resumed fibers to the ready fibers
+ */
+void FiberScheduler::takeInbox()
+{
+    std::vector<Fiber*> inbox;
+    
+    {
+        boost::mutex::scoped_lock lock(_inboxMutex);
+        inbox.swap(_inbox);
+    }
+    
+    BOOST_FOREACH(Fiber* fiber, inbox)
+    {
+        if(!fiber->started)
+        {
+            fiber->started = true;
+            ++_fiberCount;
+        }
+        
+        _ready.push_back(fiber);
+    }
+}
+
+/**
+ * Milliseconds until the first timer expires, 0 when fibers are ready and -1 when there is nothing to wait for
+ */
+int FiberScheduler::getEpollTimeout() const
+{
+    if(!_ready.empty())
+        return 0;
+    
+    if(_timers.empty())
+        return -1;
+    
+    uint64_t now = getMonotonicNanoseconds();
+    uint64_t first = _timers.begin()->first;
+    
+    return first <= now ? 0 : static_cast<int>((first - now + 999999) / 1000000);
+}
+
+/**
+ * The fibers whose deadline passed stop waiting for their descriptor and become ready
+ */
+void FiberScheduler::takeExpiredTimers()
+{
+    uint64_t now = getMonotonicNanoseconds();
+    
+    while(!_timers.empty() && _timers.begin()->first <= now)
+    {
+        Fiber* fiber = _timers.begin()->second;
+        _timers.erase(_timers.begin());
+        fiber->hasTimer = false;
+        
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        epoll_ctl(_epoll, EPOLL_CTL_DEL, fiber->waitedDescriptor, &event);
+        
+        _ready.push_back(fiber);
+    }
+}
+
+void FiberScheduler::wake()
+{
+    uint64_t value = 1;
+    ssize_t written = write(_wakeEvent, &value, sizeof(value));
+    (void)written;
+}
+
+void FiberScheduler::destroy(Fiber* fiber)
+{
+    munmap(fiber->memory, fiber->memorySize);
+    delete fiber;
+}
+
+} // namespace utils
@@ -0,0 +1,120 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "fibersharedmutex.h"
+
+#include <boost/foreach.hpp>
+
+namespace utils
+{
+
+void FiberSharedMutex::lock()
+{
+    if(!FiberScheduler::isInFiber())
+    {
+        _mutex.lock();
+        return;
+    }
+    
+    _fibersWaitingAlone.add();
+    
+    while(true)
+    {
+        // read before trying, so an unlock between the try and the wait is not missed
+        uint64_t generation = getGeneration();
+        
+        if(_mutex.try_lock())
+            break;
+        
+        waitUnlock(generation);
+    }
+    
+    _fibersWaitingAlone.subtract();
+}
+
+bool FiberSharedMutex::try_lock()
+{
+    return _mutex.try_lock();
+}
+
+void FiberSharedMutex::unlock()
+{
+    _mutex.unlock();
+    resumeWaiting();
+}
+
+void FiberSharedMutex::lock_shared()
+{
+    if(!FiberScheduler::isInFiber())
+    {
+        _mutex.lock_shared();
+        return;
+    }
+    
+    while(true)
+    {
+        uint64_t generation = getGeneration();
+        
+        if(_fibersWaitingAlone.get() == 0 && _mutex.try_lock_shared())
+            break;
+        
+        waitUnlock(generation);
+    }
+}
+
+bool FiberSharedMutex::try_lock_shared()
+{
+    return _mutex.try_lock_shared();
+}
+
+void FiberSharedMutex::unlock_shared()
+{
+    _mutex.unlock_shared();
+    resumeWaiting();
+}
+
+void FiberSharedMutex::waitUnlock(uint64_t generation)
+{
+    {
+        boost::mutex::scoped_lock lock(_waitingMutex);
+        
+        if(generation != _generation)
+            return;
+        
+        _waiting.push_back(FiberScheduler::getRunning());
+    }
+    
+    FiberScheduler::suspend();
+}
+
+/**
+ * Every waiting fiber tries again, the ones that still can not lock wait for the next unlock
+ */
+void FiberSharedMutex::resumeWaiting()
+{
+    std::vector<FiberScheduler::Handle> waiting;
+    
+    {
+        boost::mutex::scoped_lock lock(_waitingMutex);
+        
+        ++_generation;
+        waiting.swap(_waiting);
+    }
+    
+    BOOST_FOREACH(const FiberScheduler::Handle& handle, waiting)
+    {
+        handle.resume();
+    }
+}
+
+uint64_t FiberSharedMutex::getGeneration()
+{
+    boost::mutex::scoped_lock lock(_waitingMutex);
+    return _generation;
+}
+
+} // namespace utils
@@ -0,0 +1,176 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "latencyhistogram.h"
+
+#include <math.h>
+
+namespace utils
+{
+
+const unsigned LatencyHistogram::SUB_BUCKET_BITS;
+const unsigned LatencyHistogram::SUB_BUCKET_COUNT;
+const unsigned LatencyHistogram::HALF_SUB_BUCKET_COUNT;
+
+LatencyHistogram::LatencyHistogram():
+    _counts(getBucket(~static_cast<uint64_t>(0)) + 1, 0),
+    _count(0),
+    _total(0),
+    _min(~static_cast<uint64_t>(0)),
+    _max(0)
+{
+}
+
+void LatencyHistogram::record(uint64_t value)
+{
+    ++_counts[getBucket(value)];
+    
+    ++_count;
+    _total += value;
+    
+    if(value < _min)
+        _min = value;
+    if(value > _max)
+        _max = value;
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other)
+{
+    for(size_t i = 0; i < _counts.size(); ++i)
+    {
+        _counts[i] += other._counts[i];
+    }
+    
+    _count += other._count;
+    _total += other._total;
+    
+    if(other._min < _min)
+        _min = other._min;
+    if(other._max > _max)
+        _max = other._max;
+}
+
+void LatencyHistogram::clear()
+{
+    _counts.assign(_counts.size(), 0);
+    
+    _count = 0;
+    _total = 0;
+    _min = ~static_cast<uint64_t>(0);
+    _max = 0;
+}
+
+double LatencyHistogram::getMean() const
+{
+    if(_count == 0)
+        return 0;
+    
+    return static_cast<double>(_total) / _count;
+}
+
+uint64_t LatencyHistogram::getPercentile(double fraction) const
+{
+    if(_count == 0)
+        return 0;
+    
+    uint64_t rank = static_cast<uint64_t>(ceil(fraction * _count));
+    if(rank < 1)
+        rank = 1;
+    
+    uint64_t seen = 0;
+    for(size_t i = 0; i < _counts.size(); ++i)
+    {
+        seen += _counts[i];
+        if(seen >= rank)
+        {
+            uint64_t end = getBucketEnd(i);
+            return end < _max ? end : _max;
+        }
+    }
+    
+    return _max;
+}
+
+/**
+ * Small values get a bucket each. Every next power of two is split in HALF_SUB_BUCKET_COUNT
+ * buckets keeping the SUB_BUCKET_BITS highest bits of the value.
+ */
+unsigned LatencyHistogram::getBucket(uint64_t value)
+{
+    if(value < SUB_BUCKET_COUNT)
+        return value;
+    
+    unsigned highestBit = 63 - __builtin_clzll(value);
+    unsigned shift = highestBit - (SUB_BUCKET_BITS - 1);
+    
+    return shift * HALF_SUB_BUCKET_COUNT + static_cast<unsigned>(value >> shift);
+}
+
+uint64_t LatencyHistogram::getBucketEnd(unsigned bucket)
+{
+    if(bucket < SUB_BUCKET_COUNT)
+        return bucket;
+    
+    unsigned shift = bucket / HALF_SUB_BUCKET_COUNT - 1;
+    uint64_t mantissa = bucket % HALF_SUB_BUCKET_COUNT + HALF_SUB_BUCKET_COUNT;
+    
+    return ((mantissa + 1) << shift) - 1;
+}
+
+ConcurrentLatencyHistogram::ConcurrentLatencyHistogram():
+    _counts(LatencyHistogram::getBucket(~static_cast<uint64_t>(0)) + 1, 0),
+    _count(0),
+    _total(0),
+    _min(~static_cast<uint64_t>(0)),
+    _max(0)
+{
+}
+
+void ConcurrentLatencyHistogram::record(uint64_t value)
+{
+    __sync_fetch_and_add(&_counts[LatencyHistogram::getBucket(value)], 1);
+    
+    __sync_fetch_and_add(&_count, 1);
+    __sync_fetch_and_add(&_total, value);
+    
+    uint64_t current = _min;
+    while(value < current)
+    {
+        uint64_t previous = __sync_val_compare_and_swap(&_min, current, value);
+        if(previous == current)
+            break;
+        
+        current = previous;
+    }
+    
+    current = _max;
+    while(value > current)
+    {
+        uint64_t previous = __sync_val_compare_and_swap(&_max, current, value);
+        if(previous == current)
+            break;
+        
+        current = previous;
+    }
+}
+
+void ConcurrentLatencyHistogram::getSnapshot(LatencyHistogram& result) const
+{
+    result._count = 0;
+    for(size_t i = 0; i < _counts.size(); ++i)
+    {
+        // the count is summed from the buckets, so the percentiles always add up
+        result._counts[i] = __sync_fetch_and_add(&_counts[i], 0);
+        result._count += result._counts[i];
+    }
+    
+    result._total = __sync_fetch_and_add(&_total, 0);
+    result._min = __sync_fetch_and_add(&_min, 0);
+    result._max = __sync_fetch_and_add(&_max, 0);
+}
+
+} // namespace utils
@@ -0,0 +1,248 @@
+/**
+ * ProblemSolver - Self-service problem identification and fixing solution
+ *
+ *  Copyright (C) 2013 Lyubomir Stankov.
+ *  This program is free software: you can redistribute it and/or modify it under the terms of the FreeBSD license.
+ */
+
+#include "logger.h"
+#include "utils.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace utils
+{
+
+const unsigned Logger::DEFAULT_CAPACITY;
+const unsigned Logger::MAX_MESSAGE_SIZE;
+
+Logger* Logger::_logger = NULL;
+volatile LogLevel Logger::_level = logInfo;
+AtomicCounter Logger::_dropped;
+
+namespace
+{
+
+__thread int threadID = 0;
+
+int getThreadID()
+{
+    if(threadID == 0)
+        threadID = syscall(SYS_gettid);
+    
+    return threadID;
+}
+
+} // anonymous namespace
+
+/**
+ * The logger is also stopped when the process exits, so the buffered messages are not lost
+ */
+void Logger::start(LogLevel level, unsigned capacity, FILE* output)
+{
+    static bool stopAtExit = false;
+    if(!stopAtExit)
+    {
+        atexit(&Logger::stop);
+        stopAtExit = true;
+    }
+    
+    stop();
+    
+    unsigned roundedCapacity = 1;
+    while(roundedCapacity < capacity)
+        roundedCapacity <<= 1;
+    
+    _level = level;
+    _logger = new Logger(roundedCapacity, output);
+}
+
+void Logger::stop()
+{
+    Logger* logger = _logger;
+    _logger = NULL;
+    
+    delete logger;
+}
+
+void Logger::log(LogLevel level, const char* format, ...)
+{
+    if(!isEnabled(level))
+        return;
+    
+    va_list arguments;
+    va_start(arguments, format);
+    
+    if(_logger != NULL)
+    {
+        _logger->push(level, format, arguments);
+    }
+    else
+    {
+        char message[MAX_MESSAGE_SIZE];
+        vsnprintf(message, sizeof(message), format, arguments);
+        writeLine(stdout, level, getThreadID(), getCurrentSeconds(), message);
+        fflush(stdout);
+    }
+    
+    va_end(arguments);
+}
+
+bool Logger::parseLevel(const std::string& name, LogLevel& result)
+{
+    if(name == "debug")
+        result = logDebug;
+    else if(name == "info")
+        result = logInfo;
+    else if(name == "warning")
+        result = logWarning;
+    else if(name == "error")
+        result = logError;
+    else
+        return false;
+    
+    return true;
+}
+
+Logger::Logger(unsigned capacity, FILE* output):
+    _records(new Record[capacity]),
+    _mask(capacity - 1),
+    _pushPosition(0),
+    _writePosition(0),
+    _output(output),
+    _reportedDropped(_dropped.get()),
+    _stopping(false)
+{
+    for(unsigned i = 0; i < capacity; ++i)
+    {
+        _records[i].sequence = i;
+    }
+    
+    _writer = boost::thread(&Logger::writeLoop, this);
+}
+
+Logger::~Logger()
+{
+    _stopping = true;
+    _writer.join();
+    
+    delete[] _records;
+}
+
+/**
+ * Reserves the next free record with a compare and swap of the push position, so many threads can push at once.
+ * A record is free when its sequence equals the position, the writer moves the sequence a whole lap ahead after writing it.
+ */
+void Logger::push(LogLevel level, const char* format, va_list arguments)
+{
+    uint64_t position = _pushPosition;
+    Record* record = NULL;
+    
+    while(true)
+    {
+        record = &_records[position & _mask];
+        __sync_synchronize();
+        int64_t difference = static_cast<int64_t>(record->sequence - position);
+        
+        if(difference == 0)
+        {
+            uint64_t previous = __sync_val_compare_and_swap(&_pushPosition, position, position + 1);
+            if(previous == position)
+                break;
+            
+            position = previous;
+        }
+        else if(difference < 0)
+        {
+            _dropped.add(); // the writer is a lap behind
+            return;
+        }
+        else
+        {
+            position = _pushPosition;
+        }
+    }
+    
+    record->level = level;
+    record->threadID = getThreadID();
+    record->time = getCurrentSeconds();
+    vsnprintf(record->message, MAX_MESSAGE_SIZE, format, arguments);
+    
+    __sync_synchronize();
+    record->sequence = position + 1;
+}
+
+void Logger::writeLoop()
+{
+    while(true)
+    {
+        bool stopping = _stopping;
+        
+        if(writeRecords())
+            continue;
+        
+        if(stopping)
+            break; // everything pushed before stop is written
+        
+        usleep(10000); // sleep 10ms
+    }
+}
+
+/**
+ * Writes the ready records, returns false if there were none
+ */
+bool Logger::writeRecords()
+{
+    bool written = false;
+    
+    while(true)
+    {
+        Record& record = _records[_writePosition & _mask];
+        __sync_synchronize();
+        if(record.sequence != _writePosition + 1)
+            break;
+        
+        writeLine(_output, record.level, record.threadID, record.time, record.message);
+        
+        __sync_synchronize();
+        record.sequence = _writePosition + _mask + 1;
+        ++_writePosition;
+        
+        written = true;
+    }
+    
+    uint64_t dropped = _dropped.get();
+    if(dropped != _reportedDropped)
+    {
+        char message[64];
+        snprintf(message, sizeof(message), "%llu log messages dropped", static_cast<unsigned long long>(dropped - _reportedDropped));
+        writeLine(_output, logWarning, getThreadID(), getCurrentSeconds(), message);
+        
+        _reportedDropped = dropped;
+        written = true;
+    }
+    
+    if(written)
+        fflush(_output);
+    
+    return written;
+}
+
+void Logger::writeLine(FILE* output, LogLevel level, int threadID, double time, const char* message)
+{
+    static const char* levelNames[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+    
+    time_t seconds = static_cast<time_t>(time);
+    tm localTime;
+    localtime_r(&seconds, &localTime);
+    
+    char timeText[32];
+    strftime(timeText, sizeof(timeText), "%Y-%m-%d %H:%M:%S", &localTime);
+    
+    fprintf(output, "%s.%06d %s [%d] %s\n", timeText, static_cast<int>((time - seconds) * 1000000), levelNames[level], threadID, message);
+}
+
+} // namespace utils
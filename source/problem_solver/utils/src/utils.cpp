@@ -7,10 +7,45 @@
 
 #include "utils.h"
 
+#include <stdio.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
 
 namespace utils
 {
 
+long getResidentMemory()
+{
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if(statm == NULL)
+        return 0;
+    
+    long totalPages = 0;
+    long residentPages = 0;
+    int readCount = fscanf(statm, "%ld %ld", &totalPages, &residentPages);
+    fclose(statm);
+    
+    if(readCount != 2)
+        return 0;
+    
+    return residentPages * sysconf(_SC_PAGESIZE);
+}
+
+double getCurrentSeconds()
+{
+    timeval now;
+    gettimeofday(&now, NULL);
+    
+    return now.tv_sec + now.tv_usec / 1000000.0;
+}
 
+uint64_t getMonotonicNanoseconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
 
 } // namespace utils